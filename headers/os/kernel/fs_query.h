@@ -19,6 +19,10 @@
 	// Only enable this feature for non time-critical things, it might
 	// take a long time to proceed.
 	// Also, not every file system might support this feature.
+#define B_QUERY_COALESCE_UPDATES	0x00000004
+	// Live query updates are collected for a short time, and are then
+	// delivered together in a B_QUERY_UPDATE message with the opcode
+	// B_EVENTS_COALESCED (see NodeMonitor.h).
 
 
 #ifdef  __cplusplus
@@ -18,8 +18,10 @@ namespace BPackageKit {
 
 
 namespace BPrivate {
+	class ApplyRepositoryDeltaJob;
 	class ValidateChecksumJob;
 }
+using BPrivate::ApplyRepositoryDeltaJob;
 using BPrivate::ValidateChecksumJob;
 
 
@@ -39,12 +41,18 @@ protected:
 	virtual	void				JobSucceeded(BSupportKit::BJob* job);
 
 private:
+			status_t			_ApplyRepositoryDelta();
 			status_t			_FetchRepositoryCache();
+			status_t			_ActivateRepositoryCache(
+									const BEntry& repoCacheEntry,
+									BSupportKit::BJob* dependency);
 
 			BEntry				fFetchedChecksumFile;
+			BEntry				fUpdatedRepoCache;
 			BRepositoryConfig	fRepoConfig;
 
 			ValidateChecksumJob*	fValidateChecksumJob;
+			ApplyRepositoryDeltaJob* fApplyDeltaJob;
 };
 
 
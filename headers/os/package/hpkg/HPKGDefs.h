@@ -97,9 +97,18 @@ enum BHPKGAttributeID {
 
 // compression types
 enum {
-	B_HPKG_COMPRESSION_NONE	= 0,
-	B_HPKG_COMPRESSION_ZLIB	= 1,
-	B_HPKG_COMPRESSION_ZSTD	= 2
+	B_HPKG_COMPRESSION_NONE				= 0,
+	B_HPKG_COMPRESSION_ZLIB				= 1,
+	B_HPKG_COMPRESSION_ZSTD				= 2,
+	B_HPKG_COMPRESSION_ZSTD_DICTIONARY	= 3
+		// zstd, all chunks are compressed against a dictionary stored in the
+		// file
+};
+
+
+// maximum size of the dictionary used with B_HPKG_COMPRESSION_ZSTD_DICTIONARY
+enum {
+	B_HPKG_MAX_COMPRESSION_DICTIONARY_SIZE	= 1024 * 1024
 };
 
 
@@ -128,6 +137,10 @@ enum {
 		// when updating a pre-existing entry, don't fail, but replace the
 		// entry, if possible (directories will be merged, but won't replace a
 		// non-directory)
+	B_HPKG_WRITER_TOC_INDEX			= 0x04,
+		// append a TOC index, so that single entries can be looked up without
+		// parsing the whole TOC; when updating a package that already has one,
+		// it is kept up to date regardless
 };
 
 
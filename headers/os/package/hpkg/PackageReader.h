@@ -43,6 +43,10 @@ public:
 									BPackageContentHandler* contentHandler);
 			status_t			ParseContent(BLowLevelPackageContentHandler*
 										contentHandler);
+			status_t			FindEntry(const char* path,
+									BPackageContentHandler* contentHandler);
+									// B_NOT_SUPPORTED, if the package has
+									// no TOC index
 
 			BPositionIO*		PackageFile() const;
 
@@ -57,10 +57,24 @@ public:
 			int32				CompressionLevel() const;
 			void				SetCompressionLevel(int32 compressionLevel);
 
+			const void*			CompressionDictionary() const;
+			size_t				CompressionDictionarySize() const;
+			void				SetCompressionDictionary(
+									const void* dictionary, size_t size);
+									// only used with
+									// B_HPKG_COMPRESSION_ZSTD_DICTIONARY;
+									// the data are not copied
+
+			int32				CompressionThreadCount() const;
+			void				SetCompressionThreadCount(int32 count);
+
 private:
 			uint32				fFlags;
 			uint32				fCompression;
 			int32				fCompressionLevel;
+			const void*			fCompressionDictionary;
+			size_t				fCompressionDictionarySize;
+			int32				fCompressionThreadCount;
 };
 
 
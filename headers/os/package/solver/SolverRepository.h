@@ -6,6 +6,7 @@
 #define _PACKAGE__SOLVER_REPOSITORY_H_
 
 
+#include <Entry.h>
 #include <ObjectList.h>
 #include <package/PackageDefs.h>
 #include <package/PackageInfoSet.h>
@@ -70,6 +71,10 @@ public:
 
 			uint64				ChangeCount() const;
 
+			const BEntry&		RepositoryCacheEntry() const;
+									// unset, if the packages don't
+									// (exactly) stem from a repository cache
+
 private:
 			typedef BObjectList<BSolverPackage, true> PackageList;
 
@@ -79,6 +84,7 @@ private:
 			bool				fIsInstalled;
 			PackageList			fPackages;
 			uint64				fChangeCount;
+			BEntry				fRepositoryCacheEntry;
 };
 
 
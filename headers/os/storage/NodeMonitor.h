@@ -24,7 +24,11 @@ enum {
 
 	B_WATCH_MOUNT			= 0x0010,
 	B_WATCH_INTERIM_STAT	= 0x0020,
-	B_WATCH_CHILDREN		= 0x0040
+	B_WATCH_CHILDREN		= 0x0040,
+
+	B_WATCH_COALESCE		= 0x0080
+		// Haiku only: events are collected for a short time, and are then
+		// delivered together, see B_EVENTS_COALESCED
 };
 
 
@@ -40,6 +44,10 @@ enum {
 #define B_ATTR_CHANGED	 	5
 #define B_DEVICE_MOUNTED	6
 #define B_DEVICE_UNMOUNTED	7
+#define B_EVENTS_COALESCED	8
+	// (Haiku only) the "events" field contains the original notification
+	// messages, in the order they occurred; redundant events may have been
+	// merged, or dropped
 
 
 // More specific info in the "cause" field of B_ATTR_CHANGED notification
@@ -31,6 +31,12 @@ extern status_t node_monitor_init(void);
 extern status_t notify_unmount(dev_t device);
 extern status_t notify_mount(dev_t device, dev_t parentDevice,
 					ino_t parentDirectory);
+extern status_t start_coalescing_query_updates(port_id port, int32 token,
+					int32* _queryToken);
+extern void set_coalesced_query_cookie(port_id port, int32 queryToken,
+					void* cookie);
+extern void cancel_coalescing_query_updates(port_id port, int32 queryToken);
+extern void stop_coalescing_query_updates(void* cookie);
 
 // user-space exported calls
 extern status_t _user_stop_notifying(port_id port, uint32 token);
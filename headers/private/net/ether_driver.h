@@ -28,6 +28,8 @@ enum {
 
 	ETHER_SEND_NET_BUFFER,					/* send a net_buffer */
 	ETHER_RECEIVE_NET_BUFFER,				/* receive a net_buffer */
+	ETHER_RECEIVE_NET_BUFFERS,
+		/* receive several net_buffers at once (ether_receive_net_buffers_t *) */
 };
 
 
@@ -43,4 +45,10 @@ typedef struct ether_link_state {
 	uint64	speed;		/* in bit/s */
 } ether_link_state_t;
 
+/* ETHER_RECEIVE_NET_BUFFERS */
+typedef struct ether_receive_net_buffers {
+	struct net_buffer**	buffers;
+	uint32				count;	/* in: size of buffers, out: buffers received */
+} ether_receive_net_buffers_t;
+
 #endif	/* _ETHER_DRIVER_H */
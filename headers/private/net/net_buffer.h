@@ -19,6 +19,7 @@
 enum net_buffer_flags {
 	NET_BUFFER_L3_CHECKSUM_VALID = (1 << 0),
 	NET_BUFFER_L4_CHECKSUM_VALID = (1 << 1),
+	NET_BUFFER_FLOW_HASH_VALID = (1 << 2),
 };
 
 
@@ -42,6 +43,11 @@ typedef struct net_buffer {
 	uint32					size;
 	uint8					protocol;
 	uint16					buffer_flags;
+	uint32					flow_hash;
+		// only valid with NET_BUFFER_FLOW_HASH_VALID
+	uint32					segment_size;
+		// if not 0, the buffer is a TCP super-segment that has to be split
+		// into segments of this size before it leaves the host
 } net_buffer;
 
 struct ancillary_data_container;
@@ -108,6 +114,9 @@ struct net_buffer_module_info {
 	void			(*swap_addresses)(net_buffer* buffer);
 
 	void			(*dump)(net_buffer* buffer);
+
+	status_t		(*append_external)(net_buffer* buffer, void* data,
+						size_t bytes, void (*freeData)(void* data));
 };
 
 
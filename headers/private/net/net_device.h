@@ -61,6 +61,11 @@ struct net_device_module_info {
 					const struct sockaddr* address);
 	status_t	(*remove_multicast)(net_device* device,
 					const struct sockaddr* address);
+
+	// optional: like receive_data(), but returns up to *_count buffers at
+	// once; only waits for the first one
+	status_t	(*receive_data_batch)(net_device* device, net_buffer** buffers,
+					size_t* _count);
 };
 
 
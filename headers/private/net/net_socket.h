@@ -32,6 +32,8 @@ typedef struct net_socket {
 
 	int						options;
 	int						linger;
+	uid_t					owner_uid;
+		// effective user ID of the creator, see SO_REUSEPORT
 	uint32					bound_to_device;
 
 	struct {
@@ -108,6 +110,8 @@ struct net_socket_module_info {
 					size_t length, int flags);
 	ssize_t		(*send)(net_socket* socket, struct msghdr* , const void* data,
 					size_t length, int flags);
+	ssize_t		(*send_external)(net_socket* socket, void* data,
+					size_t length, int flags, void (*freeData)(void* data));
 	int			(*setsockopt)(net_socket* socket, int level, int option,
 					const void* optionValue, int optionLength);
 	int			(*shutdown)(net_socket* socket, int direction);
@@ -0,0 +1,64 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+#ifndef _PACKAGE__PRIVATE__APPLY_REPOSITORY_DELTA_JOB_H_
+#define _PACKAGE__PRIVATE__APPLY_REPOSITORY_DELTA_JOB_H_
+
+
+#include <Entry.h>
+#include <String.h>
+
+#include <package/Job.h>
+
+
+namespace BPackageKit {
+
+namespace BPrivate {
+
+
+/*!	Tries to update a repository cache by fetching a delta from the
+	repository and applying it to the current cache file.
+	The job doesn't fail, if that doesn't work out -- e.g. because the
+	repository doesn't provide a delta for our cache -- since the caller can
+	always fall back to fetching the complete repository file. Applied()
+	tells whether \a targetEntry contains the updated cache, with the checksum
+	found in \a fetchedChecksumEntry.
+*/
+class ApplyRepositoryDeltaJob : public BJob {
+	typedef	BJob				inherited;
+
+public:
+								ApplyRepositoryDeltaJob(
+									const BContext& context,
+									const BString& title,
+									const BString& deltaBaseURL,
+									const BEntry& repoCacheEntry,
+									const BEntry& fetchedChecksumEntry,
+									const BEntry& targetEntry);
+	virtual						~ApplyRepositoryDeltaJob();
+
+			bool				Applied() const
+									{ return fApplied; }
+
+protected:
+	virtual	status_t			Execute();
+
+private:
+			status_t			_ApplyDelta(const BEntry& deltaEntry);
+
+private:
+			BString				fDeltaBaseURL;
+			BEntry				fRepoCacheEntry;
+			BEntry				fFetchedChecksumEntry;
+			BEntry				fTargetEntry;
+			bool				fApplied;
+};
+
+
+}	// namespace BPrivate
+
+}	// namespace BPackageKit
+
+
+#endif // _PACKAGE__PRIVATE__APPLY_REPOSITORY_DELTA_JOB_H_
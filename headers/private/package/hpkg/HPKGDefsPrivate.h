@@ -36,7 +36,8 @@ struct hpkg_header {
 	uint32	attributes_length;
 	uint32	attributes_strings_length;
 	uint32	attributes_strings_count;
-	uint32	reserved1;
+	uint32	heap_dictionary_size;
+		// only used with B_HPKG_COMPRESSION_ZSTD_DICTIONARY, 0 otherwise
 
 	// TOC section
 	uint64	toc_length;
@@ -61,7 +62,8 @@ struct hpkg_repo_header {
 
 	// repository info section
 	uint32	info_length;
-	uint32	reserved1;
+	uint32	heap_dictionary_size;
+		// only used with B_HPKG_COMPRESSION_ZSTD_DICTIONARY, 0 otherwise
 
 	// package attributes section
 	uint64	packages_length;
@@ -70,6 +72,97 @@ struct hpkg_repo_header {
 };
 
 
+// magic & version of repository delta files
+enum {
+	B_HPKG_REPO_DELTA_MAGIC		= 'hpkd',
+	B_HPKG_REPO_DELTA_VERSION	= 1
+};
+
+
+// repository delta file header
+struct hpkg_repo_delta_header {
+	uint32	magic;							// "hpkd"
+	uint16	header_size;
+	uint16	version;
+	uint64	total_size;
+
+	// SHA-256 checksums of the repository files the delta is between
+	uint8	base_checksum[32];
+	uint8	target_checksum[32];
+
+	// uncompressed heap sizes
+	uint64	base_heap_size;
+	uint64	target_heap_size;
+
+	// level the target heap must be compressed with to get the target file
+	uint32	target_compression_level;
+
+	// commands section
+	uint16	commands_compression;
+	uint16	reserved;
+	uint64	commands_size_compressed;
+	uint64	commands_size_uncompressed;
+
+	// followed by the target's hpkg_repo_header and the commands
+};
+
+
+// magic & version of the package TOC index
+enum {
+	B_HPKG_TOC_INDEX_MAGIC		= 'hpki',
+	B_HPKG_TOC_INDEX_VERSION	= 3
+};
+
+
+// TOC index entry
+// The index is an optional trailer following the heap of a package file. It
+// consists of the entries -- sorted by path hash -- followed by the footer.
+// Readers that don't know about it ignore it, since the header's total size
+// includes it, but the heap doesn't.
+struct hpkg_toc_index_entry {
+	uint64	path_hash;
+	uint64	offset;
+		// of the entry's attribute relative to the start of the TOC section
+	uint64	length;
+		// of the entry's attribute including all of its children
+	uint64	attributes_length;
+		// of the entry's attribute up to its child entries, which follow all
+		// of its other child attributes
+	uint64	parent_offset;
+		// of the parent entry's attribute, kTOCIndexNoParentOffset for
+		// top level entries
+};
+
+
+// TOC index footer
+struct hpkg_toc_index_footer {
+	uint32	magic;							// "hpki"
+	uint16	footer_size;
+	uint16	version;
+	uint64	toc_length;
+		// of the TOC the index belongs to
+	uint64	entry_count;
+};
+
+
+// Hash of an entry path for the TOC index (64 bit FNV-1a of the path with a
+// leading slash, e.g. "/lib/libfoo.so"). The hash of a path is computed from
+// the hash of its parent's path and the entry's name.
+static const uint64 kTOCIndexRootPathHash = 0xcbf29ce484222325ULL;
+
+static const uint64 kTOCIndexNoParentOffset = ~(uint64)0;
+
+
+static inline uint64
+toc_index_path_hash(uint64 parentHash, const char* name, size_t nameLength)
+{
+	uint64 hash = (parentHash ^ '/') * 0x100000001b3ULL;
+	for (size_t i = 0; i < nameLength; i++)
+		hash = (hash ^ (uint8)name[i]) * 0x100000001b3ULL;
+	return hash;
+}
+
+
 // attribute tag arithmetics
 // (using 7 bits for id, 3 for type, 1 for hasChildren and 2 for encoding)
 static inline uint16
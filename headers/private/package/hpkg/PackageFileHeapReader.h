@@ -23,6 +23,9 @@ namespace BPrivate {
 
 
 class PackageFileHeapReader : public PackageFileHeapAccessorBase {
+public:
+			class ChunkCache;
+
 public:
 								PackageFileHeapReader(BErrorOutput* errorOutput,
 									BPositionIO* file, off_t heapOffset,
@@ -39,6 +42,10 @@ public:
 			const OffsetArray&	Offsets() const
 									{ return fOffsets; }
 
+			void				SetChunkCache(ChunkCache* cache)
+									{ fChunkCache = cache; }
+									// not copied by Clone()
+
 protected:
 	virtual	status_t			ReadAndDecompressChunk(size_t chunkIndex,
 									void* compressedDataBuffer,
@@ -47,6 +54,24 @@ protected:
 
 private:
 			OffsetArray			fOffsets;
+			ChunkCache*			fChunkCache;
+};
+
+
+/*!	A cache for decompressed chunks.
+	If set, the heap reader looks up compressed chunks in the cache before
+	reading and decompressing them, and adds them afterwards. Uncompressed
+	chunks are not cached, since reading them is cheap anyway.
+*/
+class PackageFileHeapReader::ChunkCache {
+public:
+	virtual						~ChunkCache();
+
+	virtual	bool				GetChunk(size_t chunkIndex, void* buffer,
+									size_t size) = 0;
+									// copies the chunk, if cached
+	virtual	void				PutChunk(size_t chunkIndex, const void* buffer,
+									size_t size) = 0;
 };
 
 
@@ -45,6 +45,17 @@ public:
 			void				Init();
 			void				Reinit(PackageFileHeapReader* heapReader);
 
+			void				SetDictionary(const void* dictionary,
+									size_t size);
+									// written at the end of the heap by
+									// Finish(); not copied
+			size_t				DictionarySize() const
+									{ return fDictionarySize; }
+
+			void				SetCompressionThreadCount(int32 count);
+									// > 1 compresses the chunks in parallel;
+									// the heap is the same either way
+
 			status_t			AddData(BDataReader& dataReader, off_t size,
 									uint64& _offset);
 			void				AddDataThrows(const void* buffer, size_t size);
@@ -64,6 +75,8 @@ private:
 			struct Chunk;
 			struct ChunkSegment;
 			struct ChunkBuffer;
+			struct CompressionJob;
+			struct CompressionPipeline;
 
 			friend struct ChunkBuffer;
 
@@ -71,6 +84,9 @@ private:
 			void				_Uninit();
 
 			status_t			_FlushPendingData();
+			status_t			_QueuePendingData();
+			status_t			_WriteQueuedChunk(bool wait);
+			status_t			_WriteQueuedChunks();
 			status_t			_WriteChunk(const void* data, size_t size,
 									bool mayCompress);
 			status_t			_WriteDataCompressed(const void* data,
@@ -88,6 +104,11 @@ private:
 			size_t				fPendingDataSize;
 			Array<uint64>		fOffsets;
 			CompressionAlgorithmOwner* fCompressionAlgorithm;
+			const void*			fDictionary;
+			size_t				fDictionarySize;
+			CompressionPipeline* fCompressionPipeline;
+			int32				fCompressionThreadCount;
+			bool				fWriteSynchronously;
 };
 
 
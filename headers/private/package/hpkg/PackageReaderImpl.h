@@ -23,6 +23,7 @@ namespace BPrivate {
 
 
 struct hpkg_header;
+struct hpkg_toc_index_entry;
 class PackageWriterImpl;
 
 
@@ -40,6 +41,10 @@ public:
 									BPackageContentHandler* contentHandler);
 			status_t			ParseContent(BLowLevelPackageContentHandler*
 										contentHandler);
+			status_t			FindEntry(const char* path,
+									BPackageContentHandler* contentHandler);
+
+			status_t			GetTOCIndex(off_t& _offset, off_t& _size);
 
 			BPositionIO*		PackageFile() const;
 
@@ -50,6 +55,10 @@ public:
 									{ return inherited::RawHeapReader(); }
 			BAbstractBufferedDataReader* HeapReader() const
 									{ return inherited::HeapReader(); }
+			const void*			HeapDictionary() const
+									{ return inherited::HeapDictionary(); }
+			size_t				HeapDictionarySize() const
+									{ return inherited::HeapDictionarySize(); }
 
 	inline	const PackageFileSection& TOCSection() const
 									{ return fTOCSection; }
@@ -63,6 +72,8 @@ private:
 			struct AttributeAttributeHandler;
 			struct EntryAttributeHandler;
 			struct RootAttributeHandler;
+			struct IndexedAncestorAttributeHandler;
+			struct IndexedEntryAttributeHandler;
 
 			friend class PackageWriterImpl;
 
@@ -74,11 +85,49 @@ private:
 
 			status_t			_GetTOCBuffer(size_t size,
 									const void*& _buffer);
+
+			status_t			_InitTOCIndex();
+			status_t			_ReadTOCIndexEntry(uint64 index,
+									hpkg_toc_index_entry& _entry);
+			status_t			_FindTOCIndexEntry(uint64 pathHash,
+									uint64& _index);
+			status_t			_CheckTOCIndexEntryName(
+									const hpkg_toc_index_entry& entry,
+									const char* name);
+			status_t			_CheckTOCIndexEntryAncestors(
+									const hpkg_toc_index_entry& entry,
+									char** components, int32 ancestorCount,
+									hpkg_toc_index_entry* ancestorEntries);
+			status_t			_FindEntry(AttributeHandlerContext* context,
+									BPackageEntry* parentEntry,
+									BPackageEntry** ancestors,
+									char** components, int32 componentCount,
+									int32 index, uint64 pathHash,
+									int32& _notifiedAncestorCount);
+			status_t			_FindIndexedEntry(
+									AttributeHandlerContext* context,
+									BPackageEntry* parentEntry,
+									BPackageEntry** ancestors,
+									char** components, int32 ancestorCount,
+									uint64 pathHash,
+									int32& _notifiedAncestorCount);
+			status_t			_NotifyIndexedAncestor(
+									AttributeHandlerContext* context,
+									const hpkg_toc_index_entry& indexEntry,
+									BPackageEntry* entry);
+			status_t			_PrepareTOCRange(uint64 offset,
+									uint64 length);
+
 private:
 			uint64				fHeapOffset;
 			uint64				fHeapSize;
+			uint64				fTotalSize;
 
 			PackageFileSection	fTOCSection;
+
+			uint64				fTOCIndexOffset;
+			uint64				fTOCIndexEntryCount;
+			bool				fTOCIndexChecked;
 };
 
 
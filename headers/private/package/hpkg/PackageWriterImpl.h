@@ -18,6 +18,7 @@
 
 
 namespace BPrivate {
+	template<typename Element> class Array;
 	template<typename Value> class RangeArray;
 }
 
@@ -93,7 +94,11 @@ private:
 			void				_AttributeRemoved(Attribute* attribute);
 
 			void				_WriteTOC(hpkg_header& header, uint64& _length);
-			void				_WriteAttributeChildren(Attribute* attribute);
+			uint64				_WriteAttributeChildren(Attribute* attribute,
+									uint64 tocOffset, uint64 pathHash,
+									uint64 parentOffset);
+			off_t				_WriteTOCIndex(off_t offset,
+									uint64 tocLength);
 
 			void				_WritePackageAttributes(hpkg_header& header,
 									uint64& _length);
@@ -130,6 +135,7 @@ private:
 			uint16				fHeaderSize;
 
 			::BPrivate::RangeArray<uint64>* fHeapRangesToRemove;
+			::BPrivate::Array<hpkg_toc_index_entry>* fTOCIndex;
 
 			Entry*				fRootEntry;
 
@@ -20,6 +20,7 @@
 #include <package/hpkg/ErrorOutput.h>
 #include <package/hpkg/PackageAttributeValue.h>
 #include <package/hpkg/PackageContentHandler.h>
+#include <package/hpkg/PackageFileHeapAccessorBase.h>
 #include <package/hpkg/PackageInfoAttributeValue.h>
 
 
@@ -93,6 +94,13 @@ protected:
 									{ return fHeapReader; }
 									// equals RawHeapReader(), if uncached
 
+			const void*			HeapDictionary() const
+									{ return fHeapDictionary; }
+			size_t				HeapDictionarySize() const
+									{ return fHeapDictionarySize; }
+									// only with
+									// B_HPKG_COMPRESSION_ZSTD_DICTIONARY
+
 			BAbstractBufferedDataReader* DetachHeapReader(
 									PackageFileHeapReader*& _rawHeapReader);
 									// Detaches both raw and (if applicable)
@@ -128,7 +136,16 @@ protected:
 			status_t			InitHeapReader(uint32 compression,
 									uint32 chunkSize, off_t offset,
 									uint64 compressedSize,
-									uint64 uncompressedSize);
+									uint64 uncompressedSize,
+									uint32 dictionarySize);
+	virtual	status_t			CreateDecompressionAlgorithm(
+									uint32 compression,
+									const void* dictionary,
+									size_t dictionarySize,
+									DecompressionAlgorithmOwner*&
+										_algorithm);
+									// _algorithm is NULL for uncompressed
+									// heaps; the caller gets a reference
 	virtual	status_t			CreateCachedHeapReader(
 									PackageFileHeapReader* heapReader,
 									BAbstractBufferedDataReader*&
@@ -147,6 +164,10 @@ protected:
 			status_t			ParseAttributeTree(
 									AttributeHandlerContext* context,
 									bool& _sectionHandled);
+			status_t			ParseAttribute(
+									AttributeHandlerContext* context);
+			status_t			ReadAttribute(uint8& _id,
+									AttributeValue& _value);
 
 	virtual	status_t			ReadAttributeValue(uint8 type, uint8 encoding,
 									AttributeValue& _value);
@@ -199,6 +220,9 @@ private:
 			PackageFileHeapReader* fRawHeapReader;
 			BAbstractBufferedDataReader* fHeapReader;
 
+			void*				fHeapDictionary;
+			size_t				fHeapDictionarySize;
+
 			PackageFileSection*	fCurrentSection;
 
 			AttributeHandlerList fAttributeHandlerStack;
@@ -527,7 +551,8 @@ ReaderImplBase::Init(BPositionIO* file, bool keepFile, Header& header, uint32 fl
 		B_BENDIAN_TO_HOST_INT16(header.heap_compression),
 		B_BENDIAN_TO_HOST_INT32(header.heap_chunk_size), heapOffset,
 		compressedHeapSize,
-		B_BENDIAN_TO_HOST_INT64(header.heap_size_uncompressed));
+		B_BENDIAN_TO_HOST_INT64(header.heap_size_uncompressed),
+		B_BENDIAN_TO_HOST_INT32(header.heap_dictionary_size));
 	if (error != B_OK)
 		return error;
 
@@ -0,0 +1,55 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+#ifndef _PACKAGE__HPKG__PRIVATE__REPOSITORY_DELTA_H_
+#define _PACKAGE__HPKG__PRIVATE__REPOSITORY_DELTA_H_
+
+
+#include <SupportDefs.h>
+
+
+class BDataIO;
+class BPositionIO;
+
+
+namespace BPackageKit {
+
+namespace BHPKG {
+
+
+class BErrorOutput;
+
+
+namespace BPrivate {
+
+
+/*!	Creates and applies binary deltas between two versions of a repository
+	file.
+	The delta describes the target's uncompressed heap in terms of copies from
+	the base's uncompressed heap and literal data. Applying it recompresses the
+	resulting heap, so the delta only gets created, if doing that reproduces
+	the target file exactly. Both checksums are stored in the delta and
+	verified when applying it.
+*/
+class RepositoryDelta {
+public:
+	static	status_t			Create(BErrorOutput* errorOutput,
+									BPositionIO* baseFile,
+									BPositionIO* targetFile,
+									BDataIO* deltaFile);
+	static	status_t			Apply(BErrorOutput* errorOutput,
+									BPositionIO* baseFile,
+									BPositionIO* deltaFile,
+									BPositionIO* targetFile);
+};
+
+
+}	// namespace BPrivate
+
+}	// namespace BHPKG
+
+}	// namespace BPackageKit
+
+
+#endif	// _PACKAGE__HPKG__PRIVATE__REPOSITORY_DELTA_H_
@@ -38,6 +38,11 @@ public:
 			status_t			ParseContent(
 									BRepositoryContentHandler* contentHandler);
 
+			uint64				UncompressedHeapSize() const
+									{ return inherited::UncompressedHeapSize(); }
+			PackageFileHeapReader* RawHeapReader() const
+									{ return inherited::RawHeapReader(); }
+
 private:
 			class PackagesAttributeHandler;
 			class PackageContentHandlerAdapter;
@@ -107,6 +107,11 @@ protected:
 			status_t			InitHeapReader(size_t headerSize);
 
 			void				SetCompression(uint32 compression);
+			void				SetCompressionDictionary(
+									const void* dictionary, size_t size);
+									// copies the dictionary
+			size_t				CompressionDictionarySize() const
+									{ return fCompressionDictionarySize; }
 
 			void				RegisterPackageInfo(
 									PackageAttributeList& attributeList,
@@ -192,6 +197,8 @@ private:
 			BPositionIO*		fFile;
 			bool				fOwnsFile;
 			bool				fFinished;
+			void*				fCompressionDictionary;
+			size_t				fCompressionDictionarySize;
 
 			StringCache			fPackageStringCache;
 			PackageAttributeList	fPackageAttributes;
@@ -14,6 +14,7 @@
 #include <string>
 
 #include <Directory.h>
+#include <Locker.h>
 #include <ObjectList.h>
 #include <package/Context.h>
 #include <package/PackageDefs.h>
@@ -77,6 +78,10 @@ public:
 
 			void				SetDebugLevel(int32 level);
 									// 0 - 10 (passed to libsolv)
+			void				SetDownloadConcurrency(int32 concurrency);
+									// max. number of parallel downloads;
+									// DownloadPackage() overrides must be
+									// thread safe to use more than one
 
 			BSolver*			Solver() const
 									{ return fSolver; }
@@ -122,6 +127,12 @@ protected:
 	virtual	void				JobProgress(BSupportKit::BJob* job);
 	virtual	void				JobSucceeded(BSupportKit::BJob* job);
 
+private:
+			struct DownloadItem;
+			struct DownloadQueue;
+
+			typedef BObjectList<DownloadItem, true> DownloadItemList;
+
 private:
 			void				_HandleProblems();
 			void				_AnalyzeResult();
@@ -133,6 +144,11 @@ private:
 										installationRepository);
 			void				_CommitPackageChanges(Transaction& transaction);
 
+			void				_DownloadPackages(DownloadItemList& items);
+	static	status_t			_DownloadThreadEntry(void* data);
+			void				_DownloadQueuedPackages(DownloadQueue& queue);
+			status_t			_DownloadPackage(DownloadItem& item);
+
 			void				_ClonePackageFile(
 									LocalRepository* repository,
 									BSolverPackage* package,
@@ -159,6 +175,10 @@ private:
 
 protected:
 			int32				fDebugLevel;
+			int32				fDownloadConcurrency;
+			BLocker				fJobStateLock;
+									// serializes the BJobStateListener
+									// hooks for parallel downloads
 			BPackageInstallationLocation fLocation;
 			BSolver*			fSolver;
 			InstalledRepository* fSystemRepository;
@@ -24,7 +24,8 @@ enum PackageFSMountType {
 enum {
 	PACKAGE_FS_OPERATION_GET_VOLUME_INFO		= B_DEVICE_OP_CODES_END + 1,
 	PACKAGE_FS_OPERATION_GET_PACKAGE_INFOS,
-	PACKAGE_FS_OPERATION_CHANGE_ACTIVATION
+	PACKAGE_FS_OPERATION_CHANGE_ACTIVATION,
+	PACKAGE_FS_OPERATION_GET_CHUNK_CACHE_STATISTICS
 };
 
 
@@ -104,4 +105,20 @@ struct PackageFSActivationChangeRequest {
 };
 
 
+// PACKAGE_FS_OPERATION_GET_CHUNK_CACHE_STATISTICS
+
+struct PackageFSChunkCacheStatistics {
+	// The cache of decompressed package heap chunks is shared by all packagefs
+	// volumes, so the statistics are global as well.
+	uint64							hits;
+	uint64							misses;
+	uint64							insertions;
+	uint64							evictions;
+	uint64							size;
+										// bytes currently used
+	uint64							maxSize;
+	uint32							chunkCount;
+};
+
+
 #endif	// _PACKAGE__PRIVATE__PACKAGE_FS_H_
@@ -10,6 +10,10 @@
 #include <CompressionAlgorithm.h>
 
 
+struct ZSTD_CDict_s;
+struct ZSTD_DDict_s;
+
+
 // compression level
 enum {
 	B_ZSTD_COMPRESSION_NONE		= 0,
@@ -32,9 +36,17 @@ public:
 			size_t				BufferSize() const;
 			void				SetBufferSize(size_t size);
 
+			status_t			SetDictionary(const void* dictionary,
+									size_t size);
+									// copies the dictionary; must be called
+									// after setting the compression level
+			ZSTD_CDict_s*		Dictionary() const
+									{ return fDictionary; }
+
 private:
 			int32				fCompressionLevel;
 			size_t				fBufferSize;
+			ZSTD_CDict_s*		fDictionary;
 };
 
 
@@ -46,8 +58,15 @@ public:
 			size_t				BufferSize() const;
 			void				SetBufferSize(size_t size);
 
+			status_t			SetDictionary(const void* dictionary,
+									size_t size);
+									// copies the dictionary
+			ZSTD_DDict_s*		Dictionary() const
+									{ return fDictionary; }
+
 private:
 			size_t				fBufferSize;
+			ZSTD_DDict_s*		fDictionary;
 };
 
 
@@ -18,6 +18,7 @@
 #include "Utility.h"
 
 #if !_BOOT_MODE
+#	include "CRCTable.h"
 #	include "Inode.h"
 #else
 #	include "Stream.h"
@@ -245,6 +246,80 @@ private:
 // Since BFS supports block sizes of 1024 bytes or greater, and the node size
 // is hard-coded to 1024 bytes, that's not an issue now.
 
+static inline bool
+is_node_link(off_t link, uint32 nodeSize)
+{
+	return link == BPLUSTREE_NULL || (link > 0 && (link % nodeSize) == 0);
+}
+
+
+/*!	Returns whether or not the node at \a offset has room for a checksum.
+	Duplicate and fragment nodes store a small count where the links of the
+	other nodes are, free nodes are marked with BPLUSTREE_FREE.
+*/
+static bool
+is_checksummed_node(const bplustree_node* node, off_t offset, uint32 nodeSize)
+{
+	if (offset == 0)
+		return true;
+
+	return is_node_link(node->LeftLink(), nodeSize)
+		&& is_node_link(node->RightLink(), nodeSize)
+		&& is_node_link(node->OverflowLink(), nodeSize);
+}
+
+
+static uint32
+node_checksum(const bplustree_node* node, off_t offset, uint32 nodeSize)
+{
+	int64 location = HOST_ENDIAN_TO_BFS_INT64(offset);
+	uint32 checksum = calculate_crc32c(0xffffffff, (const uint8*)&location,
+		sizeof(location));
+	return calculate_crc32c(checksum, (const uint8*)node,
+		nodeSize - BPLUSTREE_CHECKSUM_SIZE);
+}
+
+
+static inline uint32*
+node_checksum_field(const bplustree_node* node, uint32 nodeSize)
+{
+	return (uint32*)((uint8*)node + nodeSize - BPLUSTREE_CHECKSUM_SIZE);
+}
+
+
+/*!	Stores the checksum of the current node, if it has been changed. This must
+	be done before the node is released.
+*/
+void
+CachedNode::_UpdateChecksum()
+{
+	if (!fWritable || fNode == NULL || !fTree->_HasChecksums())
+		return;
+
+	uint32 nodeSize = fTree->fNodeSize;
+	if (!is_checksummed_node(fNode, fOffset, nodeSize))
+		return;
+
+	*node_checksum_field(fNode, nodeSize)
+		= HOST_ENDIAN_TO_BFS_INT32(node_checksum(fNode, fOffset, nodeSize));
+}
+
+
+bool
+CachedNode::HasValidChecksum() const
+{
+	if (fNode == NULL || !fTree->_HasChecksums())
+		return true;
+
+	uint32 nodeSize = fTree->fNodeSize;
+	if (!is_checksummed_node(fNode, fOffset, nodeSize))
+		return true;
+
+	return BFS_ENDIAN_TO_HOST_INT32(*node_checksum_field(fNode, nodeSize))
+		== node_checksum(fNode, fOffset, nodeSize);
+}
+
+
 void
 CachedNode::UnsetUnchanged(Transaction& transaction)
 {
@@ -271,6 +346,8 @@ CachedNode::Unset()
 
 	if (fNode != NULL) {
 #if !_BOOT_MODE
+		_UpdateChecksum();
+
 		if (fWritable && fOffset == 0) {
 			// The B+tree header has been updated - we need to update the
 			// BPlusTrees copy of it, as well.
@@ -323,6 +400,15 @@ CachedNode::SetTo(off_t offset, const bplustree_node** _node, bool check)
 			Unset();
 			return B_BAD_DATA;
 		}
+#if !_BOOT_MODE
+		if (!HasValidChecksum()) {
+			FATAL(("node at offset %" B_PRIdOFF " (block %" B_PRIdOFF "), "
+				"inode at %" B_PRIdINO " has an invalid checksum\n", offset,
+				fBlockNumber, fTree->fStream->ID()));
+			Unset();
+			return B_BAD_DATA;
+		}
+#endif
 	}
 
 	*_node = fNode;
@@ -351,10 +437,12 @@ CachedNode::SetToWritable(Transaction& transaction, off_t offset, bool check)
 
 	if (InternalSetTo(&transaction, offset) != NULL && check) {
 		// sanity checks (links, all_key_count)
-		if (!fTree->fHeader.CheckNode(fNode)) {
+		if (!fTree->fHeader.CheckNode(fNode) || !HasValidChecksum()) {
 			FATAL(("invalid node [%p] read from offset %" B_PRIdOFF " (block %"
 				B_PRIdOFF "), inode at %" B_PRIdINO "\n", fNode, offset,
 				fBlockNumber, fTree->fStream->ID()));
+			// the node hasn't been changed, don't update its checksum
+			fWritable = false;
 			Unset();
 			return NULL;
 		}
@@ -372,6 +460,7 @@ CachedNode::MakeWritable(Transaction& transaction)
 
 	if (block_cache_make_writable(transaction.GetVolume()->BlockCache(),
 			fBlockNumber, transaction.ID()) == B_OK) {
+		fWritable = true;
 		return fNode;
 	}
 
@@ -443,6 +532,11 @@ CachedNode::InternalSetTo(Transaction* transaction, off_t offset)
 	if (transaction == NULL && fBlock != NULL && fBlockNumber == newBlockNumber) {
 		// Same block as before, no need to re-fetch.
 		block = fBlock;
+#if !_BOOT_MODE
+		// but the previous node in it may have been changed
+		_UpdateChecksum();
+		fWritable = false;
+#endif
 	} else {
 #if !_BOOT_MODE
 		if (fBlock != NULL)
@@ -736,6 +830,14 @@ BPlusTree::SetTo(Inode* stream)
 
 	fNodeSize = fHeader.NodeSize();
 
+#if !_BOOT_MODE
+	if (!cached.HasValidChecksum()) {
+		FATAL(("B+tree header of inode %" B_PRIdINO " has an invalid "
+			"checksum\n", stream->ID()));
+		RETURN_ERROR(fStatus = B_BAD_DATA);
+	}
+#endif
+
 	// validity check
 	static const uint32 kToMode[] = {S_STR_INDEX, S_INT_INDEX, S_UINT_INDEX,
 		S_LONG_LONG_INDEX, S_ULONG_LONG_INDEX, S_FLOAT_INDEX,
@@ -907,6 +1009,28 @@ BPlusTree::MakeEmpty()
 }
 
 
+/*!	Returns whether or not any TreeIterator currently points into the tree.
+	Iterators that have not been positioned yet don't depend on the layout
+	of the tree, and are therefore not considered to be active.
+	You need to have the inode write locked to get a reliable answer.
+*/
+bool
+BPlusTree::HasActiveIterators()
+{
+	MutexLocker _(fIteratorLock);
+
+	SinglyLinkedList<TreeIterator>::ConstIterator iterator
+		= fIterators.GetIterator();
+	while (iterator.HasNext()) {
+		off_t offset = iterator.Next()->fCurrentNodeOffset;
+		if (offset != BPLUSTREE_NULL && offset != BPLUSTREE_FREE)
+			return true;
+	}
+
+	return false;
+}
+
+
 int32
 BPlusTree::TypeCodeToKeyType(type_code code)
 {
@@ -1022,6 +1146,23 @@ BPlusTree::_RemoveIterator(TreeIterator* iterator)
 #endif // !_BOOT_MODE
 
 
+#if !_BOOT_MODE
+bool
+BPlusTree::_HasChecksums() const
+{
+	return fStream->GetVolume()->HasMetadataChecksums();
+}
+
+
+/*!	Returns the number of bytes a node can use for its keys and values. */
+int32
+BPlusTree::_NodeSpace() const
+{
+	return _HasChecksums() ? fNodeSize - BPLUSTREE_CHECKSUM_SIZE : fNodeSize;
+}
+#endif // !_BOOT_MODE
+
+
 int32
 BPlusTree::_CompareKeys(const void* key1, int keyLength1, const void* key2,
 	int keyLength2)
@@ -1746,7 +1887,7 @@ BPlusTree::Insert(Transaction& transaction, const uint8* key, uint16 keyLength,
 		if (int32(key_align(sizeof(bplustree_node)
 				+ writableNode->AllKeyLength() + keyLength)
 				+ (writableNode->NumKeys() + 1) * (sizeof(uint16)
-				+ sizeof(off_t))) < fNodeSize) {
+				+ sizeof(off_t))) < _NodeSpace()) {
 			_InsertKey(writableNode, nodeAndKey.keyIndex,
 				keyBuffer, keyLength, value);
 			_UpdateIterators(nodeAndKey.nodeOffset, BPLUSTREE_NULL,
@@ -2916,6 +3057,210 @@ TreeIterator::Dump()
 #endif
 
 
+//	#pragma mark - TreeBulkLoader
+
+
+#if !_BOOT_MODE
+/*!	The loader fills the leaves from left to right, and only ever touches the
+	right-most node of each level. Whenever a node is full, a new one is
+	started next to it, and the largest key of the full node is added to its
+	parent as the separator key. The right-most child of an index node is
+	always referenced by its overflow link, so the tree is structurally
+	valid after each call to Add(); only the header is updated in Finish().
+*/
+TreeBulkLoader::TreeBulkLoader(BPlusTree* tree, uint32 fillPercentage)
+	:
+	fTree(tree),
+	fLevels(1),
+	fLastKeyLength(0),
+	fCount(0)
+{
+	if (fillPercentage == 0 || fillPercentage > 100)
+		fillPercentage = 100;
+	else if (fillPercentage < 50)
+		fillPercentage = 50;
+
+	fFillSize = tree->_NodeSpace() * fillPercentage / 100;
+	fLevelOffsets[0] = tree->fHeader.RootNode();
+}
+
+
+TreeBulkLoader::~TreeBulkLoader()
+{
+}
+
+
+/*!	Adds the key/value pair to the tree. The key must not be smaller than
+	the last key added; if it is equal, and the tree allows duplicates, the
+	value is added as a duplicate to that key.
+	You need to have the inode write locked.
+*/
+status_t
+TreeBulkLoader::Add(Transaction& transaction, const uint8* key,
+	uint16 keyLength, off_t value)
+{
+	if (keyLength < BPLUSTREE_MIN_KEY_LENGTH
+		|| keyLength > BPLUSTREE_MAX_KEY_LENGTH)
+		RETURN_ERROR(B_BAD_VALUE);
+
+	ASSERT_WRITE_LOCKED_INODE(fTree->fStream);
+
+	CachedNode cached(fTree);
+	bplustree_node* node = cached.SetToWritable(transaction, fLevelOffsets[0],
+		false);
+	if (node == NULL)
+		RETURN_ERROR(B_IO_ERROR);
+
+	if (fCount == 0) {
+		// we can only start with an empty tree
+		if (fLevels != 1 || !node->IsLeaf() || node->NumKeys() != 0)
+			RETURN_ERROR(B_BAD_VALUE);
+	} else {
+		int32 compare = fTree->_CompareKeys(key, keyLength, fLastKey,
+			fLastKeyLength);
+		if (compare < 0)
+			RETURN_ERROR(B_BAD_VALUE);
+
+		if (compare == 0) {
+			if (!fTree->fAllowDuplicates)
+				return B_NAME_IN_USE;
+
+			status_t status = fTree->_InsertDuplicate(transaction, cached,
+				node, node->NumKeys() - 1, value);
+			if (status != B_OK)
+				RETURN_ERROR(status);
+
+			fCount++;
+			return B_OK;
+		}
+	}
+
+	if (!_Fits(node, keyLength)) {
+		// start a new leaf to the right of the current one
+		CachedNode cachedOther(fTree);
+		bplustree_node* other;
+		off_t otherOffset;
+		status_t status = cachedOther.Allocate(transaction, &other,
+			&otherOffset);
+		if (status != B_OK)
+			RETURN_ERROR(status);
+
+		other->left_link = HOST_ENDIAN_TO_BFS_INT64(fLevelOffsets[0]);
+		node->right_link = HOST_ENDIAN_TO_BFS_INT64(otherOffset);
+
+		status = _AddChild(transaction, 1, fLastKey, fLastKeyLength,
+			fLevelOffsets[0], otherOffset);
+		if (status != B_OK)
+			return status;
+
+		fLevelOffsets[0] = otherOffset;
+
+		fTree->_InsertKey(other, 0, (uint8*)key, keyLength, value);
+	} else
+		fTree->_InsertKey(node, node->NumKeys(), (uint8*)key, keyLength, value);
+
+	memcpy(fLastKey, key, keyLength);
+	fLastKeyLength = keyLength;
+	fCount++;
+
+	return B_OK;
+}
+
+
+/*!	Points the tree's header to the new root node. The tree can be used
+	as usual afterwards.
+*/
+status_t
+TreeBulkLoader::Finish(Transaction& transaction)
+{
+	CachedNode cached(fTree);
+	bplustree_header* header = cached.SetToWritableHeader(transaction);
+	if (header == NULL)
+		RETURN_ERROR(B_IO_ERROR);
+
+	header->root_node_pointer = HOST_ENDIAN_TO_BFS_INT64(
+		fLevelOffsets[fLevels - 1]);
+	header->max_number_of_levels = HOST_ENDIAN_TO_BFS_INT32(fLevels);
+
+	return B_OK;
+}
+
+
+bool
+TreeBulkLoader::_Fits(const bplustree_node* node, uint16 keyLength) const
+{
+	int32 used = key_align(sizeof(bplustree_node) + node->AllKeyLength()
+		+ keyLength) + (node->NumKeys() + 1) * (sizeof(uint16) + sizeof(off_t));
+	if (used >= fTree->_NodeSpace())
+		return false;
+
+	return node->NumKeys() == 0 || used <= fFillSize;
+}
+
+
+/*!	Adds \a closedChild with the separator \a key to the right-most node of
+	the given \a level, and lets that node's overflow link point to
+	\a newChild. If the node is full, a new node is started that will only
+	reference \a newChild, and the full node is added to the next level in
+	the same way.
+*/
+status_t
+TreeBulkLoader::_AddChild(Transaction& transaction, uint32 level,
+	const uint8* key, uint16 keyLength, off_t closedChild, off_t newChild)
+{
+	if (level >= BPLUSTREE_MAX_BULK_LEVELS)
+		RETURN_ERROR(B_BAD_VALUE);
+
+	CachedNode cached(fTree);
+	bplustree_node* node;
+
+	if (level == fLevels) {
+		// the tree grows by one level
+		off_t offset;
+		status_t status = cached.Allocate(transaction, &node, &offset);
+		if (status != B_OK)
+			RETURN_ERROR(status);
+
+		node->overflow_link = HOST_ENDIAN_TO_BFS_INT64(closedChild);
+		fLevelOffsets[level] = offset;
+		fLevels++;
+	} else {
+		node = cached.SetToWritable(transaction, fLevelOffsets[level], false);
+		if (node == NULL)
+			RETURN_ERROR(B_IO_ERROR);
+	}
+
+	if (_Fits(node, keyLength)) {
+		fTree->_InsertKey(node, node->NumKeys(), (uint8*)key, keyLength,
+			closedChild);
+		node->overflow_link = HOST_ENDIAN_TO_BFS_INT64(newChild);
+		return B_OK;
+	}
+
+	// The node is full; its overflow link already points to "closedChild",
+	// and "key" becomes its separator in the parent node
+	CachedNode cachedOther(fTree);
+	bplustree_node* other;
+	off_t otherOffset;
+	status_t status = cachedOther.Allocate(transaction, &other, &otherOffset);
+	if (status != B_OK)
+		RETURN_ERROR(status);
+
+	other->left_link = HOST_ENDIAN_TO_BFS_INT64(fLevelOffsets[level]);
+	other->overflow_link = HOST_ENDIAN_TO_BFS_INT64(newChild);
+	node->right_link = HOST_ENDIAN_TO_BFS_INT64(otherOffset);
+
+	status = _AddChild(transaction, level + 1, key, keyLength,
+		fLevelOffsets[level], otherOffset);
+	if (status != B_OK)
+		return status;
+
+	fLevelOffsets[level] = otherOffset;
+	return B_OK;
+}
+#endif // !_BOOT_MODE
+
+
 // #pragma mark -
 
 
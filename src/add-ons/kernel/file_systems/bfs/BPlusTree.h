@@ -59,6 +59,13 @@ struct bplustree_header {
 #define BPLUSTREE_NODE_SIZE 		1024
 #define BPLUSTREE_MAX_KEY_LENGTH	256
 #define BPLUSTREE_MIN_KEY_LENGTH	1
+#define BPLUSTREE_MAX_BULK_LEVELS	32
+
+// On volumes with SUPER_BLOCK_FEATURE_METADATA_CHECKSUMS, the last four bytes
+// of the header node, and of every node holding keys contain a CRC32C of the
+// rest of the node and its offset. Duplicate and fragment nodes use the whole
+// node, and are not checksummed.
+#define BPLUSTREE_CHECKSUM_SIZE		sizeof(uint32)
 
 enum bplustree_types {
 	BPLUSTREE_STRING_TYPE	= 0,
@@ -161,6 +168,7 @@ enum bplustree_traversing {
 class BPlusTree;
 struct TreeCheck;
 class TreeIterator;
+class TreeBulkLoader;
 
 
 #if !_BOOT_MODE
@@ -228,10 +236,16 @@ public:
 
 			bool				IsWritable() const { return fWritable; }
 			bplustree_node*		Node() const { return fNode; }
+#if !_BOOT_MODE
+			bool				HasValidChecksum() const;
+#endif
 
 protected:
 			bplustree_node*		InternalSetTo(Transaction* transaction,
 									off_t offset);
+#if !_BOOT_MODE
+			void				_UpdateChecksum();
+#endif
 
 			BPlusTree*			fTree;
 			bplustree_node*		fNode;
@@ -268,6 +282,7 @@ public:
 #if !_BOOT_MODE
 			status_t			Validate(bool repair, bool& _errorsFound);
 			status_t			MakeEmpty();
+			bool				HasActiveIterators();
 
 			status_t			Remove(Transaction& transaction,
 									const uint8* key, uint16 keyLength,
@@ -317,6 +332,10 @@ private:
 
 			int32				_CompareKeys(const void* key1, int keylength1,
 									const void* key2, int keylength2);
+#if !_BOOT_MODE
+			bool				_HasChecksums() const;
+			int32				_NodeSpace() const;
+#endif
 			status_t			_FindKey(const bplustree_node* node,
 									const uint8* key, uint16 keyLength,
 									uint16* index = NULL, off_t* next = NULL);
@@ -366,6 +385,7 @@ private:
 
 private:
 			friend class TreeIterator;
+			friend class TreeBulkLoader;
 			friend class CachedNode;
 			friend struct TreeCheck;
 
@@ -433,6 +453,44 @@ private:
 };
 
 
+#if !_BOOT_MODE
+/*!	Builds a B+tree bottom-up from keys that are added in ascending order.
+	The tree has to be empty when the loader is created, and the keys may
+	be added over several transactions.
+*/
+class TreeBulkLoader {
+public:
+								TreeBulkLoader(BPlusTree* tree,
+									uint32 fillPercentage = 100);
+								~TreeBulkLoader();
+
+			status_t			Add(Transaction& transaction, const uint8* key,
+									uint16 keyLength, off_t value);
+			status_t			Finish(Transaction& transaction);
+
+			off_t				CountEntries() const { return fCount; }
+			uint32				CountLevels() const { return fLevels; }
+
+private:
+			bool				_Fits(const bplustree_node* node,
+									uint16 keyLength) const;
+			status_t			_AddChild(Transaction& transaction,
+									uint32 level, const uint8* key,
+									uint16 keyLength, off_t closedChild,
+									off_t newChild);
+
+private:
+			BPlusTree*			fTree;
+			int32				fFillSize;
+			uint32				fLevels;
+			off_t				fLevelOffsets[BPLUSTREE_MAX_BULK_LEVELS];
+			uint8				fLastKey[BPLUSTREE_MAX_KEY_LENGTH];
+			uint16				fLastKeyLength;
+			off_t				fCount;
+};
+#endif // !_BOOT_MODE
+
+
 //	#pragma mark - BPlusTree's inline functions
 //	(most of them may not be needed)
 
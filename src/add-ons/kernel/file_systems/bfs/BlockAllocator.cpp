@@ -9,6 +9,7 @@
 
 #include "BlockAllocator.h"
 
+#include "CRCTable.h"
 #include "Debug.h"
 #include "Inode.h"
 #include "Volume.h"
@@ -192,9 +193,86 @@ private:
 };
 
 
-class AllocationGroup {
+// Free ranges of at least this many blocks are kept in the free extent index
+// of their allocation group, shorter ones can only be found in the bitmap.
+static const int32 kMinIndexedExtent = 8;
+
+// If an allocation group contains more indexed free ranges than this, it
+// is considered fragmented enough that a bitmap scan will quickly find a
+// range, and its index is dropped to bound the memory use. It is only read
+// in again after as many allocations and frees, as it is unlikely to fit
+// before.
+static const int32 kMaxIndexedExtents = 256;
+
+
+struct FreeExtent {
+	int32						start;
+	int32						length;
+	SplayTreeLink<FreeExtent>	startLink;
+	SplayTreeLink<FreeExtent>	lengthLink;
+};
+
+
+struct FreeExtentStartDefinition {
+	typedef int32		KeyType;
+	typedef FreeExtent	NodeType;
+
+	static const KeyType& GetKey(const FreeExtent* node)
+	{
+		return node->start;
+	}
+
+	static SplayTreeLink<FreeExtent>* GetLink(FreeExtent* node)
+	{
+		return &node->startLink;
+	}
+
+	static int Compare(const KeyType& key, const FreeExtent* node)
+	{
+		if (key != node->start)
+			return key < node->start ? -1 : 1;
+		return 0;
+	}
+};
+
+
+/*!	Orders the extents by their length, and then by their start, so that
+	looking up the first extent of a given minimum length returns the lowest
+	extent that fits best.
+*/
+struct FreeExtentLengthDefinition {
+	typedef FreeExtent	KeyType;
+	typedef FreeExtent	NodeType;
+
+	static const KeyType& GetKey(const FreeExtent* node)
+	{
+		return *node;
+	}
+
+	static SplayTreeLink<FreeExtent>* GetLink(FreeExtent* node)
+	{
+		return &node->lengthLink;
+	}
+
+	static int Compare(const KeyType& key, const FreeExtent* node)
+	{
+		if (key.length != node->length)
+			return key.length < node->length ? -1 : 1;
+		if (key.start != node->start)
+			return key.start < node->start ? -1 : 1;
+		return 0;
+	}
+};
+
+
+typedef SplayTree<FreeExtentStartDefinition> FreeExtentStartTree;
+typedef SplayTree<FreeExtentLengthDefinition> FreeExtentLengthTree;
+
+
+class AllocationGroup : public TransactionListener {
 public:
 	AllocationGroup();
+	~AllocationGroup();
 
 	void AddFreeRange(int32 start, int32 blocks);
 	bool IsFull() const { return fFreeBits == 0; }
@@ -202,13 +280,32 @@ public:
 	status_t Allocate(Transaction& transaction, uint16 start, int32 length);
 	status_t Free(Transaction& transaction, uint16 start, int32 length);
 
+	bool FindFreeRange(int32 start, int32 maximum, int32& rangeStart,
+		int32& rangeLength);
+
 	uint32 NumBits() const { return fNumBits; }
 	uint32 NumBitmapBlocks() const { return fNumBitmapBlocks; }
 	int32 Start() const { return fStart; }
 
+	// TransactionListener
+	virtual void TransactionDone(bool success);
+	virtual void RemovedFromTransaction();
+
 private:
 	friend class BlockAllocator;
 
+	void _ListenTo(Transaction& transaction);
+	void _InitializeExtents();
+	void _InvalidateExtents();
+	void _DropExtents(int32 changes);
+	void _InsertExtent(FreeExtent* extent);
+	void _RemoveExtent(FreeExtent* extent);
+	void _AddExtent(int32 start, int32 length);
+	void _AllocateExtent(int32 start, int32 length);
+	void _FreeExtent(Volume* volume, int32 start, int32 length);
+	int32 _CountFreeBits(Volume* volume, int32 bit, bool forward);
+	void _ReadExtents(Volume* volume);
+
 	uint32	fNumBits;
 	uint32	fNumBitmapBlocks;
 	int32	fStart;
@@ -218,6 +315,16 @@ private:
 	int32	fLargestStart;
 	int32	fLargestLength;
 	bool	fLargestValid;
+
+	FreeExtentStartTree		fExtents;
+	FreeExtentLengthTree	fExtentsByLength;
+	int32	fNumExtents;
+	int32	fExtentsRetry;
+	bool	fExtentsValid;
+	bool	fExtentsPending;
+
+	Volume*	fVolume;
+	bool	fInTransaction;
 };
 
 
@@ -370,8 +477,20 @@ AllocationGroup::AllocationGroup()
 	:
 	fFirstFree(-1),
 	fFreeBits(0),
-	fLargestValid(false)
+	fLargestValid(false),
+	fNumExtents(0),
+	fExtentsRetry(0),
+	fExtentsValid(false),
+	fExtentsPending(false),
+	fVolume(NULL),
+	fInTransaction(false)
+{
+}
+
+
+AllocationGroup::~AllocationGroup()
 {
+	_InvalidateExtents();
 }
 
 
@@ -391,6 +510,9 @@ AllocationGroup::AddFreeRange(int32 start, int32 blocks)
 	}
 
 	fFreeBits += blocks;
+
+	if (fExtentsValid)
+		_AddExtent(start, blocks);
 }
 
 
@@ -405,6 +527,8 @@ AllocationGroup::Allocate(Transaction& transaction, uint16 start, int32 length)
 {
 	ASSERT(start + length <= (int32)fNumBits);
 
+	_ListenTo(transaction);
+
 	// Update the allocation group info
 	// TODO: this info will be incorrect if something goes wrong later
 	// Note, the fFirstFree block doesn't have to be really free
@@ -433,6 +557,8 @@ AllocationGroup::Allocate(Transaction& transaction, uint16 start, int32 length)
 		}
 	}
 
+	_AllocateExtent(start, length);
+
 	Volume* volume = transaction.GetVolume();
 
 	// calculate block in the block bitmap and position within
@@ -474,6 +600,8 @@ AllocationGroup::Free(Transaction& transaction, uint16 start, int32 length)
 {
 	ASSERT(start + length <= (int32)fNumBits);
 
+	_ListenTo(transaction);
+
 	// Update the allocation group info
 	// TODO: this info will be incorrect if something goes wrong later
 	if (fFirstFree > start)
@@ -495,6 +623,8 @@ AllocationGroup::Free(Transaction& transaction, uint16 start, int32 length)
 	}
 
 	Volume* volume = transaction.GetVolume();
+	int32 freeStart = start;
+	int32 freeLength = length;
 
 	// calculate block in the block bitmap and position within
 	uint32 bitsPerBlock = volume->BlockSize() << 3;
@@ -504,8 +634,10 @@ AllocationGroup::Free(Transaction& transaction, uint16 start, int32 length)
 	AllocationBlock cached(volume);
 
 	while (length > 0) {
-		if (cached.SetToWritable(transaction, *this, block) < B_OK)
+		if (cached.SetToWritable(transaction, *this, block) < B_OK) {
+			_DropExtents(0);
 			RETURN_ERROR(B_IO_ERROR);
+		}
 
 		T(Block("free-1", block, cached.Block(), volume->BlockSize()));
 		uint16 freeLength = length;
@@ -519,17 +651,347 @@ AllocationGroup::Free(Transaction& transaction, uint16 start, int32 length)
 		T(Block("free-2", block, cached.Block(), volume->BlockSize()));
 		block++;
 	}
+	cached.Unset();
+
+	// The bitmap has to be updated already, as we might need to look at the
+	// blocks next to the freed range
+	_FreeExtent(volume, freeStart, freeLength);
 	return B_OK;
 }
 
 
+/*!	Finds a free range in the allocation group using its free extent index.
+	If there is a range of at least \a maximum blocks at \a start, or
+	otherwise anywhere in the group, it is returned (in the latter case,
+	the smallest one that fits). If there is none, the largest indexed range
+	is returned instead.
+	Returns \c false if the allocation group does not have a valid index, in
+	which case the bitmap has to be scanned.
+	Note that free ranges shorter than \c kMinIndexedExtent are not part of
+	the index, and cannot be returned by this method.
+*/
+bool
+AllocationGroup::FindFreeRange(int32 start, int32 maximum, int32& rangeStart,
+	int32& rangeLength)
+{
+	if (!fExtentsValid)
+		return false;
+
+	// Prefer to continue right where the last allocation ended
+	FreeExtent* extent = fExtents.FindClosest(start, false, true);
+	if (extent != NULL && extent->start + extent->length - start >= maximum) {
+		rangeStart = start;
+		rangeLength = extent->start + extent->length - start;
+		return true;
+	}
+
+	FreeExtent key;
+	key.start = -1;
+	key.length = maximum;
+
+	extent = fExtentsByLength.FindClosest(key, true, true);
+	if (extent == NULL)
+		extent = fExtentsByLength.FindMax();
+
+	if (extent != NULL) {
+		rangeStart = extent->start;
+		rangeLength = extent->length;
+	} else {
+		rangeStart = -1;
+		rangeLength = 0;
+	}
+	return true;
+}
+
+
+/*!	Makes sure the group learns about the outcome of \a transaction, as
+	its free extent index will have to be read in again from the bitmap if
+	the transaction is aborted.
+	Also counts the changes to the group until a dropped index is read in
+	again.
+*/
+void
+AllocationGroup::_ListenTo(Transaction& transaction)
+{
+	if (!fInTransaction) {
+		fVolume = transaction.GetVolume();
+		transaction.AddListener(this);
+		fInTransaction = true;
+	}
+
+	if (fExtentsRetry > 0 && --fExtentsRetry == 0)
+		fExtentsPending = true;
+}
+
+
+void
+AllocationGroup::_InitializeExtents()
+{
+	_InvalidateExtents();
+	fExtentsValid = true;
+	fExtentsPending = false;
+	fExtentsRetry = 0;
+}
+
+
+/*!	Empties the free extent index of this group; until it is initialized
+	again, all allocations from this group will scan the bitmap instead.
+*/
+void
+AllocationGroup::_InvalidateExtents()
+{
+	while (FreeExtent* extent = fExtents.Root()) {
+		fExtents.Remove(extent);
+		delete extent;
+	}
+	fExtentsByLength = FreeExtentLengthTree();
+	fNumExtents = 0;
+	fExtentsValid = false;
+}
+
+
+/*!	Drops the free extent index of this group, and lets it be read in again
+	from the bitmap once \a changes allocations and frees have been made in
+	the group, or with the next allocation that can use it if \a changes is
+	zero.
+*/
+void
+AllocationGroup::_DropExtents(int32 changes)
+{
+	_InvalidateExtents();
+	fExtentsRetry = changes;
+	fExtentsPending = changes == 0;
+}
+
+
+void
+AllocationGroup::_InsertExtent(FreeExtent* extent)
+{
+	fExtents.Insert(extent);
+	fExtentsByLength.Insert(extent);
+	fNumExtents++;
+}
+
+
+void
+AllocationGroup::_RemoveExtent(FreeExtent* extent)
+{
+	fExtents.Remove(extent);
+	fExtentsByLength.Remove(extent);
+	fNumExtents--;
+}
+
+
+void
+AllocationGroup::_AddExtent(int32 start, int32 length)
+{
+	if (!fExtentsValid || length < kMinIndexedExtent)
+		return;
+
+	if (fNumExtents >= kMaxIndexedExtents) {
+		_DropExtents(kMaxIndexedExtents);
+		return;
+	}
+
+	FreeExtent* extent = new(std::nothrow) FreeExtent;
+	if (extent == NULL) {
+		_DropExtents(kMaxIndexedExtents);
+		return;
+	}
+
+	extent->start = start;
+	extent->length = length;
+	_InsertExtent(extent);
+}
+
+
+/*!	Removes the specified range from the free extent index. The range must
+	either lie completely within one indexed extent, or in a free range that
+	is too short to be indexed.
+*/
+void
+AllocationGroup::_AllocateExtent(int32 start, int32 length)
+{
+	if (!fExtentsValid)
+		return;
+
+	int32 end = start + length;
+
+	FreeExtent* extent = fExtents.FindClosest(start, false, true);
+	if (extent == NULL || extent->start + extent->length <= start) {
+		// The range must not overlap with an indexed extent
+		extent = fExtents.FindClosest(start, true, false);
+		if (extent != NULL && extent->start < end)
+			_DropExtents(0);
+		return;
+	}
+
+	int32 extentEnd = extent->start + extent->length;
+	if (end > extentEnd) {
+		_DropExtents(0);
+		return;
+	}
+
+	_RemoveExtent(extent);
+
+	if (start - extent->start >= kMinIndexedExtent) {
+		extent->length = start - extent->start;
+		_InsertExtent(extent);
+	} else
+		delete extent;
+
+	_AddExtent(end, extentEnd - end);
+}
+
+
+/*!	Adds the specified range to the free extent index, and joins it with its
+	neighbours. Since those might be too short to be indexed themselves, the
+	bitmap around the range is checked as well.
+*/
+void
+AllocationGroup::_FreeExtent(Volume* volume, int32 start, int32 length)
+{
+	if (!fExtentsValid)
+		return;
+
+	int32 end = start + length;
+
+	FreeExtent* next = fExtents.FindClosest(start, true, true);
+	if (next != NULL && next->start < end) {
+		// this range has already been free
+		_DropExtents(0);
+		return;
+	}
+	if (next != NULL && next->start == end) {
+		end += next->length;
+		_RemoveExtent(next);
+		delete next;
+	} else {
+		int32 count = _CountFreeBits(volume, end, true);
+		if (count < 0) {
+			_DropExtents(0);
+			return;
+		}
+		end += count;
+	}
+
+	FreeExtent* previous = fExtents.FindClosest(start, false, false);
+	if (previous != NULL && previous->start + previous->length > start) {
+		_DropExtents(0);
+		return;
+	}
+	if (previous != NULL && previous->start + previous->length == start) {
+		start = previous->start;
+		_RemoveExtent(previous);
+		delete previous;
+	} else {
+		int32 count = _CountFreeBits(volume, start - 1, false);
+		if (count < 0) {
+			_DropExtents(0);
+			return;
+		}
+		start -= count;
+	}
+
+	_AddExtent(start, end - start);
+}
+
+
+/*!	Counts the free bits starting at \a bit in the given direction. Since
+	a longer free range would have been indexed, this never looks at more
+	than \c kMinIndexedExtent - 1 bits.
+*/
+int32
+AllocationGroup::_CountFreeBits(Volume* volume, int32 bit, bool forward)
+{
+	uint32 bitsPerBlock = volume->BlockSize() << 3;
+	AllocationBlock cached(volume);
+	int32 block = -1;
+	int32 count = 0;
+
+	while (count < kMinIndexedExtent - 1 && bit >= 0 && bit < (int32)fNumBits) {
+		if ((int32)(bit / bitsPerBlock) != block) {
+			block = bit / bitsPerBlock;
+			if (cached.SetTo(*this, block) != B_OK)
+				RETURN_ERROR(B_IO_ERROR);
+		}
+		if (cached.IsUsed(bit % bitsPerBlock))
+			break;
+
+		count++;
+		bit += forward ? 1 : -1;
+	}
+
+	return count;
+}
+
+
+/*!	Builds the free extent index from the block bitmap. This is done lazily
+	for allocation groups that were initialized from the allocation summary,
+	and for those that had to drop their index.
+*/
+void
+AllocationGroup::_ReadExtents(Volume* volume)
+{
+	_InitializeExtents();
+
+	AllocationBlock cached(volume);
+	int32 start = -1;
+	int32 length = 0;
+	int32 bit = 0;
+
+	for (uint32 block = 0; block < fNumBitmapBlocks && fExtentsValid;
+			block++) {
+		if (cached.SetTo(*this, block) != B_OK) {
+			_DropExtents(kMaxIndexedExtents);
+			return;
+		}
+
+		for (uint32 i = 0; i < cached.NumBlockBits(); i++, bit++) {
+			if (!cached.IsUsed(i)) {
+				if (length++ == 0)
+					start = bit;
+			} else if (length > 0) {
+				_AddExtent(start, length);
+				length = 0;
+			}
+		}
+	}
+	if (length > 0)
+		_AddExtent(start, length);
+}
+
+
+/*!	The block bitmap changes of an aborted transaction are reverted by the
+	block cache, but the free extent index doesn't know about that, and has
+	to be read in again.
+*/
+void
+AllocationGroup::TransactionDone(bool success)
+{
+	if (success)
+		return;
+
+	RecursiveLocker locker(fVolume->Allocator().Lock());
+	_DropExtents(0);
+}
+
+
+void
+AllocationGroup::RemovedFromTransaction()
+{
+	fInTransaction = false;
+}
+
+
 //	#pragma mark -
 
 
 BlockAllocator::BlockAllocator(Volume* volume)
 	:
 	fVolume(volume),
-	fGroups(NULL)
+	fGroups(NULL),
+	fGroupsInitialized(false)
 	//fCheckBitmap(NULL),
 	//fCheckCookie(NULL)
 {
@@ -558,6 +1020,9 @@ BlockAllocator::Initialize(bool full)
 	if (!full)
 		return B_OK;
 
+	if (_LoadSummary() == B_OK)
+		return B_OK;
+
 	recursive_lock_lock(&fLock);
 		// the lock will be released by the _Initialize() method
 
@@ -613,10 +1078,13 @@ BlockAllocator::InitializeAndClearBitmap(Transaction& transaction)
 		fGroups[i].fFirstFree = fGroups[i].fLargestStart = 0;
 		fGroups[i].fFreeBits = fGroups[i].fLargestLength = fGroups[i].fNumBits;
 		fGroups[i].fLargestValid = true;
+		fGroups[i]._InitializeExtents();
+		fGroups[i]._AddExtent(0, fGroups[i].fNumBits);
 
 		offset += fBlocksPerGroup;
 	}
 	free(buffer);
+	fGroupsInitialized = true;
 
 	// reserve the boot block, the log area, and the block bitmap itself
 	uint32 reservedBlocks = fVolume->ToBlock(fVolume->Log()) + fVolume->Log().Length();
@@ -673,6 +1141,11 @@ BlockAllocator::_Initialize(BlockAllocator* allocator)
 			groups[i].fNumBitmapBlocks = blocks;
 		}
 		groups[i].fStart = offset;
+		groups[i].fFirstFree = -1;
+		groups[i].fFreeBits = 0;
+		groups[i].fLargestValid = false;
+		groups[i].fExtentsPending = false;
+		groups[i]._InitializeExtents();
 
 		// finds all free ranges in this allocation group
 		int32 start = -1, range = 0;
@@ -699,6 +1172,8 @@ BlockAllocator::_Initialize(BlockAllocator* allocator)
 		freeBlocks += groups[i].fFreeBits;
 
 		offset += blocks;
+		if (i == numGroups - 1)
+			allocator->fGroupsInitialized = true;
 	}
 	free(buffer);
 
@@ -745,12 +1220,328 @@ BlockAllocator::Uninitialize()
 }
 
 
+/*!	Reads in the block bitmap again to update the allocation groups. This is
+	needed after the bitmap has been changed directly, ie. by the file system
+	check.
+*/
+status_t
+BlockAllocator::Reload()
+{
+	recursive_lock_lock(&fLock);
+		// the lock will be released by the _Initialize() method
+
+	fGroupsInitialized = false;
+	return _Initialize(this);
+}
+
+
+/*!	Saves the state of all allocation groups in the allocation summary, so
+	that the next mount does not need to read the whole block bitmap.
+	This is done when the volume is unmounted; the summary is allocated
+	first if necessary.
+*/
+status_t
+BlockAllocator::WriteSummary()
+{
+	if (!fVolume->HasAllocationSummary() || fVolume->IsReadOnly())
+		return B_OK;
+
+	RecursiveLocker locker(fLock);
+
+	if (!fGroupsInitialized)
+		return B_NO_INIT;
+
+	uint32 length = _SummaryLength();
+	block_run run = fVolume->SuperBlock().allocation_summary;
+
+	if (!_IsValidSummaryRun(run) || run.Length() < length) {
+		// the volume doesn't have a summary yet, or it is too small
+		Transaction transaction(fVolume, 0);
+
+		if (_IsValidSummaryRun(run) && Free(transaction, run) != B_OK)
+			RETURN_ERROR(B_IO_ERROR);
+
+		status_t status = AllocateBlocks(transaction, 0, 0, length, 1, run);
+		if (status != B_OK)
+			RETURN_ERROR(status);
+
+		if (run.Length() < length) {
+			Free(transaction, run);
+			run.SetTo(0, 0, 0);
+		}
+
+		fVolume->SuperBlock().allocation_summary = run;
+		status = transaction.Done();
+		if (status != B_OK)
+			return status;
+
+		if (run.IsZero())
+			RETURN_ERROR(B_DEVICE_FULL);
+	}
+
+	allocation_summary_header header;
+	memset(&header, 0, sizeof(allocation_summary_header));
+	header.magic = HOST_ENDIAN_TO_BFS_INT32(ALLOCATION_SUMMARY_MAGIC);
+	header.num_ags = HOST_ENDIAN_TO_BFS_INT32(fNumGroups);
+	header.blocks_per_ag = HOST_ENDIAN_TO_BFS_INT32(fBlocksPerGroup);
+	header.num_blocks = HOST_ENDIAN_TO_BFS_INT64(fVolume->NumBlocks());
+	header.used_blocks = HOST_ENDIAN_TO_BFS_INT64(fVolume->UsedBlocks());
+
+	uint32 checksum = 0xffffffff;
+
+	off_t block = fVolume->ToBlock(run);
+	uint32 blockSize = fVolume->BlockSize();
+	int32 entriesPerBlock = blockSize / sizeof(allocation_group_summary);
+	int32 groupIndex = 0;
+
+	for (uint32 i = 1; i < length;) {
+		// Use several transactions, so that we don't blow the maximum log
+		// size on large disks
+		Transaction transaction(fVolume, block + i);
+
+		for (uint32 count = 0; count < 512 && i < length; count++, i++) {
+			CachedBlock cached(fVolume);
+			status_t status = cached.SetToWritable(transaction, block + i,
+				true);
+			if (status != B_OK)
+				RETURN_ERROR(status);
+
+			allocation_group_summary* entries
+				= (allocation_group_summary*)cached.WritableBlock();
+			memset(entries, 0, blockSize);
+
+			int32 numEntries = min_c(entriesPerBlock, fNumGroups - groupIndex);
+			for (int32 j = 0; j < numEntries; j++, groupIndex++) {
+				AllocationGroup& group = fGroups[groupIndex];
+
+				entries[j].free_bits = HOST_ENDIAN_TO_BFS_INT32(group.fFreeBits);
+				entries[j].first_free
+					= HOST_ENDIAN_TO_BFS_INT32(group.fFirstFree);
+				entries[j].largest_start = HOST_ENDIAN_TO_BFS_INT32(
+					group.fLargestValid ? group.fLargestStart : 0);
+				entries[j].largest_length = HOST_ENDIAN_TO_BFS_INT32(
+					group.fLargestValid ? group.fLargestLength : -1);
+			}
+
+			checksum = calculate_crc32c(checksum, (uint8*)entries,
+				numEntries * sizeof(allocation_group_summary));
+		}
+
+		status_t status = transaction.Done();
+		if (status != B_OK)
+			return status;
+	}
+
+	// Only the header makes the summary valid, so it must be written last.
+	// It records the position of the log at this point; since every
+	// transaction moves it, the summary is no longer used once the volume
+	// has been changed by a driver that doesn't know about it. Therefore,
+	// it must be written after the log has been flushed, and without a
+	// transaction.
+
+	status_t status = fVolume->GetJournal(0)->FlushLogAndBlocks();
+	if (status != B_OK)
+		return status;
+
+	header.log_end = HOST_ENDIAN_TO_BFS_INT64(fVolume->LogEnd());
+	header.checksum = HOST_ENDIAN_TO_BFS_INT32(calculate_crc32c(checksum,
+		(uint8*)&header, sizeof(allocation_summary_header)));
+
+	uint8* buffer = (uint8*)malloc(blockSize);
+	if (buffer == NULL)
+		RETURN_ERROR(B_NO_MEMORY);
+
+	MemoryDeleter deleter(buffer);
+	memset(buffer, 0, blockSize);
+	memcpy(buffer, &header, sizeof(allocation_summary_header));
+
+	block_cache_discard(fVolume->BlockCache(), block, 1);
+
+	if (write_pos(fVolume->Device(), block << fVolume->BlockShift(), buffer,
+			blockSize) != (ssize_t)blockSize)
+		RETURN_ERROR(B_IO_ERROR);
+
+	return B_OK;
+}
+
+
+/*!	Returns the number of blocks the allocation summary needs: one block
+	for the header, and then as many as are needed for the entries.
+*/
+uint32
+BlockAllocator::_SummaryLength() const
+{
+	uint32 entriesPerBlock
+		= fVolume->BlockSize() / sizeof(allocation_group_summary);
+	return 1 + (fNumGroups + entriesPerBlock - 1) / entriesPerBlock;
+}
+
+
+bool
+BlockAllocator::_IsValidSummaryRun(block_run run) const
+{
+	return !run.IsZero() && run.AllocationGroup() >= 0
+		&& run.AllocationGroup() < fNumGroups
+		&& uint32(run.Start() + run.Length())
+			<= (1UL << fVolume->AllocationGroupShift())
+		&& fVolume->ToBlock(run) + run.Length() <= fVolume->NumBlocks();
+}
+
+
+/*!	Initializes the allocation groups from the allocation summary, if the
+	volume has a valid one, and it was written at the current position of
+	the log, ie. no transaction has changed the volume since. If the volume
+	can be written to, the summary is invalidated, so that it is not used
+	again after an unclean shutdown.
+	If this method fails, the allocation groups have to be rebuilt from the
+	block bitmap instead.
+*/
+status_t
+BlockAllocator::_LoadSummary()
+{
+	if (!fVolume->HasAllocationSummary())
+		return B_ENTRY_NOT_FOUND;
+
+	// If the log could not be replayed, the bitmap may differ from what
+	// is on disk
+	if (fVolume->LogStart() != fVolume->LogEnd())
+		return B_BUSY;
+
+	block_run run = fVolume->SuperBlock().allocation_summary;
+	uint32 length = _SummaryLength();
+	if (!_IsValidSummaryRun(run) || run.Length() < length)
+		return B_ENTRY_NOT_FOUND;
+
+	uint32 blockShift = fVolume->BlockShift();
+	uint8* buffer = (uint8*)malloc(length << blockShift);
+	if (buffer == NULL)
+		RETURN_ERROR(B_NO_MEMORY);
+
+	MemoryDeleter deleter(buffer);
+
+	if (read_pos(fVolume->Device(), fVolume->ToOffset(run), buffer,
+			length << blockShift) != (ssize_t)(length << blockShift))
+		RETURN_ERROR(B_IO_ERROR);
+
+	allocation_summary_header header;
+	memcpy(&header, buffer, sizeof(allocation_summary_header));
+
+	if (header.Magic() != ALLOCATION_SUMMARY_MAGIC) {
+		// the volume was not unmounted cleanly
+		return B_ENTRY_NOT_FOUND;
+	}
+
+	allocation_group_summary* entries
+		= (allocation_group_summary*)(buffer + fVolume->BlockSize());
+	uint32 checksum = header.Checksum();
+	header.checksum = 0;
+
+	if (calculate_crc32c(calculate_crc32c(0xffffffff, (uint8*)entries,
+				fNumGroups * sizeof(allocation_group_summary)),
+			(uint8*)&header, sizeof(allocation_summary_header)) != checksum
+		|| header.LogEnd() != fVolume->LogEnd()
+		|| header.AllocationGroups() != fNumGroups
+		|| header.BlocksPerAllocationGroup() != (int32)fBlocksPerGroup
+		|| header.NumBlocks() != fVolume->NumBlocks()
+		|| header.UsedBlocks() != fVolume->UsedBlocks()) {
+		INFORM(("allocation summary does not match the volume, reading "
+			"block bitmap\n"));
+		return B_BAD_DATA;
+	}
+
+	uint32 bitsPerGroup = 8 * (fBlocksPerGroup << blockShift);
+	off_t freeBlocks = 0;
+
+	for (int32 i = 0; i < fNumGroups; i++) {
+		AllocationGroup& group = fGroups[i];
+
+		// the last allocation group may contain less blocks than the others
+		if (i == fNumGroups - 1) {
+			group.fNumBits = fVolume->NumBlocks() - i * bitsPerGroup;
+			group.fNumBitmapBlocks = 1 + ((group.NumBits() - 1)
+				>> (blockShift + 3));
+		} else {
+			group.fNumBits = bitsPerGroup;
+			group.fNumBitmapBlocks = fBlocksPerGroup;
+		}
+		group.fStart = 1 + i * fBlocksPerGroup;
+
+		int32 numBits = group.fNumBits;
+		int32 freeBits = entries[i].FreeBits();
+		int32 firstFree = entries[i].FirstFree();
+		int32 largestStart = entries[i].LargestStart();
+		int32 largestLength = entries[i].LargestLength();
+
+		if (freeBits < 0 || freeBits > numBits || firstFree < -1
+			|| firstFree > numBits
+			|| (largestLength >= 0 && (largestStart < 0
+				|| largestStart + largestLength > numBits))) {
+			INFORM(("allocation summary of group %" B_PRId32 " is invalid\n",
+				i));
+			return B_BAD_DATA;
+		}
+
+		group.fFreeBits = freeBits;
+		group.fFirstFree = firstFree;
+		group.fLargestStart = largestStart;
+		group.fLargestLength = largestLength;
+		group.fLargestValid = largestLength >= 0;
+
+		// the free extent index is read in when it's needed first
+		group.fExtentsPending = true;
+
+		freeBlocks += freeBits;
+	}
+
+	if (fVolume->NumBlocks() - freeBlocks != fVolume->UsedBlocks()) {
+		INFORM(("allocation summary does not match the used blocks, reading "
+			"block bitmap\n"));
+		return B_BAD_DATA;
+	}
+
+	if (!fVolume->IsReadOnly()) {
+		status_t status = _InvalidateSummary(run);
+		if (status != B_OK)
+			return status;
+	}
+
+	fGroupsInitialized = true;
+	return B_OK;
+}
+
+
+/*!	Invalidates the allocation summary on disk. Since this is done in a
+	transaction, any later change to the block bitmap can only make it to
+	the disk together with this change.
+*/
+status_t
+BlockAllocator::_InvalidateSummary(block_run run)
+{
+	off_t block = fVolume->ToBlock(run);
+
+	Transaction transaction(fVolume, block);
+	CachedBlock cached(fVolume);
+	status_t status = cached.SetToWritable(transaction, block);
+	if (status != B_OK)
+		RETURN_ERROR(status);
+
+	allocation_summary_header* header
+		= (allocation_summary_header*)cached.WritableBlock();
+	header->magic = 0;
+
+	return transaction.Done();
+}
+
+
 /*!	Tries to allocate between \a minimum, and \a maximum blocks starting
 	at group \a groupIndex with offset \a start. The resulting allocation
 	is put into \a run.
 
 	The number of allocated blocks is always a multiple of \a minimum which
 	has to be a power of two value.
+
+	Allocation groups with a free extent index are only scanned when none
+	of the indexed free ranges could be used.
 */
 status_t
 BlockAllocator::AllocateBlocks(Transaction& transaction, int32 groupIndex,
@@ -788,6 +1579,31 @@ BlockAllocator::AllocateBlocks(Transaction& transaction, int32 groupIndex,
 		if (start < group.fFirstFree)
 			start = group.fFirstFree;
 
+		if (maximum >= kMinIndexedExtent && group.fExtentsPending) {
+			group._ListenTo(transaction);
+			group._ReadExtents(fVolume);
+		}
+
+		int32 rangeStart;
+		int32 rangeLength;
+		if (maximum >= kMinIndexedExtent
+			&& group.FindFreeRange(start, maximum, rangeStart, rangeLength)) {
+			if (rangeLength > bestLength) {
+				bestGroup = groupIndex;
+				bestStart = rangeStart;
+				bestLength = rangeLength;
+
+				if (bestLength >= maximum)
+					break;
+			}
+
+			// Only ranges shorter than kMinIndexedExtent are missing from the
+			// index, so we only need to scan the bitmap if we haven't found
+			// anything better yet
+			if (bestLength >= kMinIndexedExtent)
+				continue;
+		}
+
 		if (group.fLargestValid) {
 			if (group.fLargestLength < bestLength)
 				continue;
@@ -1126,13 +1942,55 @@ BlockAllocator::_CheckGroup(int32 groupIndex) const
 
 	AllocationGroup& group = fGroups[groupIndex];
 
+	if (group.fExtentsValid) {
+		// all free ranges that are long enough must be in the index
+		int32 numExtents = 0;
+		int32 start = 0;
+		int32 length = 0;
+
+		for (uint32 bit = 0; bit <= group.NumBits(); bit++) {
+			if (bit < group.NumBits()) {
+				if (cached.SetTo(group, bit / (fVolume->BlockSize() << 3))
+						< B_OK) {
+					panic("setting group block failed\n");
+					return;
+				}
+				if (!cached.IsUsed(bit % (fVolume->BlockSize() << 3))) {
+					if (length++ == 0)
+						start = bit;
+					continue;
+				}
+			}
+			if (length < kMinIndexedExtent) {
+				length = 0;
+				continue;
+			}
+
+			FreeExtent* extent = group.fExtents.Lookup(start);
+			if (extent == NULL || extent->length != length) {
+				panic("bfs %p: group %d free range %d.%d is not indexed "
+					"(%d.%d)\n", fVolume, (int)groupIndex, (int)start,
+					(int)length, extent != NULL ? (int)extent->start : -1,
+					extent != NULL ? (int)extent->length : -1);
+			}
+			numExtents++;
+			length = 0;
+		}
+
+		if (numExtents != group.fNumExtents) {
+			panic("bfs %p: group %d has %d indexed free ranges, checked %d\n",
+				fVolume, (int)groupIndex, (int)group.fNumExtents,
+				(int)numExtents);
+		}
+	}
+
 	int32 currentStart = 0, currentLength = 0;
 	int32 firstFree = -1;
 	int32 largestStart = -1;
 	int32 largestLength = 0;
 	int32 currentBit = 0;
 
-	for (uint32 block = 0; block < group.NumBlocks(); block++) {
+	for (uint32 block = 0; block < group.NumBitmapBlocks(); block++) {
 		if (cached.SetTo(group, block) < B_OK) {
 			panic("setting group block %d failed\n", (int)block);
 			return;
@@ -1217,7 +2075,6 @@ BlockAllocator::Trim(uint64 offset, uint64 size, uint64& trimmedSize)
 	uint32 firstBlock = 0;
 	uint32 firstBit = 0;
 	uint64 currentBlock = 0;
-	uint32 blockShift = fVolume->BlockShift();
 
 	uint64 firstFree = 0;
 	uint64 freeLength = 0;
@@ -1236,18 +2093,8 @@ BlockAllocator::Trim(uint64 offset, uint64 size, uint64& trimmedSize)
 				if (cached.IsUsed(i)) {
 					// Block is in use
 					if (freeLength > 0) {
-						// Overflow is unlikely to happen, but check it anyway
-						if ((firstFree << blockShift) >> blockShift
-								!= firstFree
-							|| (freeLength << blockShift) >> blockShift
-								!= freeLength) {
-							FATAL(("BlockAllocator::Trim:"
-								" Overflow detected!\n"));
-							return B_ERROR;
-						}
-						status_t status = _TrimNext(*trimData, kTrimRanges,
-							firstFree << blockShift, freeLength << blockShift,
-							false, trimmedSize);
+						status_t status = _TrimRange(*trimData, kTrimRanges,
+							firstFree, freeLength, false, trimmedSize);
 						if (status != B_OK)
 							return status;
 
@@ -1266,8 +2113,8 @@ BlockAllocator::Trim(uint64 offset, uint64 size, uint64& trimmedSize)
 		firstBit = 0;
 	}
 
-	return _TrimNext(*trimData, kTrimRanges, firstFree << blockShift,
-		freeLength << blockShift, true, trimmedSize);
+	return _TrimRange(*trimData, kTrimRanges, firstFree, freeLength, true,
+		trimmedSize);
 }
 
 
@@ -1376,6 +2223,27 @@ BlockAllocator::_AddTrim(fs_trim_data& trimData, uint32 maxRanges,
 }
 
 
+/*!	Adds the range of \a length blocks starting at block \a start to the
+	ranges to be trimmed.
+*/
+status_t
+BlockAllocator::_TrimRange(fs_trim_data& trimData, uint32 maxRanges,
+	uint64 start, uint64 length, bool force, uint64& trimmedSize)
+{
+	uint32 blockShift = fVolume->BlockShift();
+
+	// Overflow is unlikely to happen, but check it anyway
+	if ((start << blockShift) >> blockShift != start
+		|| (length << blockShift) >> blockShift != length) {
+		FATAL(("BlockAllocator::Trim: Overflow detected!\n"));
+		return B_ERROR;
+	}
+
+	return _TrimNext(trimData, maxRanges, start << blockShift,
+		length << blockShift, force, trimmedSize);
+}
+
+
 status_t
 BlockAllocator::_TrimNext(fs_trim_data& trimData, uint32 maxRanges,
 	uint64 offset, uint64 size, bool force, uint64& trimmedSize)
@@ -1435,6 +2303,8 @@ BlockAllocator::Dump(int32 index)
 			group.fLargestValid ? "" : "  (invalid)");
 		kprintf("      largest length: %" B_PRId32 "\n", group.fLargestLength);
 		kprintf("      free bits:      %" B_PRId32 "\n", group.fFreeBits);
+		kprintf("      free extents:   %" B_PRId32 "%s\n", group.fNumExtents,
+			group.fExtentsValid ? "" : "  (no index)");
 	}
 }
 
@@ -30,6 +30,8 @@ public:
 			status_t		InitializeAndClearBitmap(Transaction& transaction);
 
 			void			Uninitialize();
+			status_t		Reload();
+			status_t		WriteSummary();
 
 			status_t		AllocateForInode(Transaction& transaction,
 								const block_run* parent, mode_t type,
@@ -70,10 +72,18 @@ private:
 #endif
 			bool			_AddTrim(fs_trim_data& trimData, uint32 maxRanges,
 								uint64 offset, uint64 size);
+			status_t		_TrimRange(fs_trim_data& trimData,
+								uint32 maxRanges, uint64 start, uint64 length,
+								bool force, uint64& trimmedSize);
 			status_t		_TrimNext(fs_trim_data& trimData, uint32 maxRanges,
 								uint64 offset, uint64 size, bool force,
 								uint64& trimmedSize);
 
+			uint32			_SummaryLength() const;
+			bool			_IsValidSummaryRun(block_run run) const;
+			status_t		_LoadSummary();
+			status_t		_InvalidateSummary(block_run run);
+
 	static	status_t		_Initialize(BlockAllocator* self);
 
 private:
@@ -83,6 +93,7 @@ private:
 			int32			fNumGroups;
 			uint32			fBlocksPerGroup;
 			uint32			fNumBitmapBlocks;
+			bool			fGroupsInitialized;
 };
 
 #ifdef BFS_DEBUGGER_COMMANDS
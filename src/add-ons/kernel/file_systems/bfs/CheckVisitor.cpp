@@ -73,6 +73,13 @@ CheckVisitor::StartBitmapPass()
 	Control().pass = BFS_CHECK_PASS_BITMAP;
 	Control().stats.block_size = GetVolume()->BlockSize();
 
+	// the allocation summary is not referenced by any inode
+	if (GetVolume()->HasAllocationSummary()
+		&& !GetVolume()->SuperBlock().allocation_summary.IsZero()) {
+		_CheckAllocated(GetVolume()->SuperBlock().allocation_summary,
+			"allocation summary");
+	}
+
 	// TODO: check reserved area in bitmap!
 
 	Start(VISIT_REGULAR | VISIT_INDICES | VISIT_REMOVED
@@ -92,7 +99,6 @@ CheckVisitor::WriteBackCheckBitmap()
 	size_t size = _BitmapSize();
 	off_t usedBlocks = 0LL;
 
-	// TODO: update the allocation groups used blocks info
 	for (uint32 i = size >> 2; i-- > 0;) {
 		uint32 compare = 1;
 		// Count the number of bits set
@@ -153,6 +159,9 @@ CheckVisitor::WriteBackCheckBitmap()
 			}
 			transaction.Done();
 		}
+
+		// the allocation groups need to reflect the new bitmap
+		return GetVolume()->Allocator().Reload();
 	}
 
 	return B_OK;
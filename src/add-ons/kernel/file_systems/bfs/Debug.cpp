@@ -132,6 +132,7 @@ dump_inode(const bfs_inode* inode)
 	dump_block_run(	"  attributes         = ", inode->attributes);
 	kprintf("  type               = %u\n", (unsigned)inode->Type());
 	kprintf("  inode_size         = %u\n", (unsigned)inode->InodeSize());
+	kprintf("  checksum           = %08x\n", (unsigned)inode->Checksum());
 	kprintf("  short_symlink      = %s\n",
 		S_ISLNK(inode->Mode()) && (inode->Flags() & INODE_LONG_SYMLINK) == 0
 			? inode->short_symlink : "-");
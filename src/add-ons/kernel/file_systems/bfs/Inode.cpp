@@ -11,6 +11,7 @@
 #include "Inode.h"
 #include "BPlusTree.h"
 #include "Index.h"
+#include "CRCTable.h"
 
 
 #if BFS_TRACING && !defined(FS_SHELL) && !defined(_BOOT_MODE)
@@ -334,6 +335,21 @@ bfs_inode::InitCheck(Volume* volume) const
 }
 
 
+/*!	Calculates the CRC32C of the whole inode block, including its small data
+	section, but leaving out the checksum field itself.
+*/
+uint32
+bfs_inode::CalculateChecksum(Volume* volume) const
+{
+	const uint8* block = (const uint8*)this;
+	uint32 offset = offsetof(bfs_inode, checksum);
+
+	uint32 crc = calculate_crc32c(0xffffffff, block, offset);
+	offset += sizeof(checksum);
+	return calculate_crc32c(crc, block + offset, volume->InodeSize() - offset);
+}
+
+
 //	#pragma mark - Inode
 
 
@@ -568,7 +584,9 @@ Inode::_MakeSpaceForSmallData(Transaction& transaction, bfs_inode* node,
 		int32 index = 0, maxIndex = 0;
 		for (; !item->IsLast(node); item = item->Next(), index++) {
 			// should not remove those
-			if (*item->Name() == FILE_NAME_NAME || !strcmp(name, item->Name()))
+			if (*item->Name() == FILE_NAME_NAME
+				|| *item->Name() == INLINE_DATA_NAME
+				|| !strcmp(name, item->Name()))
 				continue;
 
 			if (max == NULL || max->Size() < item->Size()) {
@@ -1415,6 +1433,153 @@ Inode::ContainerContentsChanged(Transaction& transaction)
 }
 
 
+/*!	Rebuilds the B+tree of this container bottom-up, so that its nodes are
+	filled up to \a fillPercentage, and the stream only contains as many
+	nodes as needed.
+	The new tree is built in a temporary index over as many transactions as
+	needed; the old tree stays intact until both data streams are exchanged
+	in a single transaction at the end. Should the system go down before the
+	temporary index is removed again, Volume::Mount() removes it. Like the file system check, this
+	holds the journal lock during the whole operation, so that no other
+	transaction can come in between; the inode is write locked inside of it,
+	in the same order as everywhere else.
+*/
+status_t
+Inode::RebuildTree(uint32 fillPercentage, off_t* _oldSize, off_t* _newSize)
+{
+	if (fTree == NULL || !IsContainer())
+		RETURN_ERROR(B_BAD_VALUE);
+	if (fTree->NodeSize() != BPLUSTREE_NODE_SIZE)
+		return B_NOT_SUPPORTED;
+
+	Journal* journal = fVolume->GetJournal(0);
+	status_t status = journal->Lock(NULL, true);
+	if (status != B_OK)
+		RETURN_ERROR(status);
+
+	WriteLocker locker(fLock);
+
+	// Iterators that already point into the tree would be lost
+	if (fTree->HasActiveIterators()) {
+		locker.Unlock();
+		journal->Unlock(NULL, true);
+		return B_BUSY;
+	}
+
+	off_t oldSize = Size();
+
+	// Create the temporary inode that gets the new tree; it's created as an
+	// index, so that its tree accepts duplicates, and doesn't get any "."
+	// entries. Since it's linked into the indices directory, it won't get
+	// lost if we don't get to remove it again.
+	Inode* temporary;
+	{
+		Transaction transaction(fVolume, BlockNumber());
+		if (fVolume->IndicesNode() == NULL)
+			status = fVolume->CreateIndicesRoot(transaction);
+		if (status == B_OK) {
+			status = Inode::Create(transaction, fVolume->IndicesNode(),
+				REBUILD_TREE_INDEX_NAME,
+				S_INDEX_DIR | S_DIRECTORY | (Mode() & S_INDEX_TYPES), 0, 0,
+				NULL, NULL, &temporary);
+		}
+		if (status == B_OK)
+			status = transaction.Done();
+	}
+	if (status != B_OK) {
+		locker.Unlock();
+		journal->Unlock(NULL, true);
+		RETURN_ERROR(status);
+	}
+
+	TreeBulkLoader* loader = new(std::nothrow) TreeBulkLoader(
+		temporary->Tree(), fillPercentage);
+	if (loader == NULL)
+		status = B_NO_MEMORY;
+	ObjectDeleter<TreeBulkLoader> loaderDeleter(loader);
+
+	if (status == B_OK) {
+		Transaction transaction(fVolume, temporary->BlockNumber());
+		temporary->WriteLockInTransaction(transaction);
+		off_t transactionStart = temporary->Size();
+
+		TreeIterator iterator(fTree);
+		uint8 key[BPLUSTREE_MAX_KEY_LENGTH + 1];
+		uint16 keyLength;
+		off_t value;
+
+		while ((status = iterator.GetNextEntry(key, &keyLength, sizeof(key),
+				&value)) == B_OK) {
+			status = loader->Add(transaction, key, keyLength, value);
+			if (status != B_OK)
+				break;
+
+			// Don't let a single transaction become too large
+			if (temporary->Size() - transactionStart >= 1024 * 1024) {
+				status = transaction.Done();
+				if (status != B_OK)
+					break;
+
+				transaction.Start(fVolume, temporary->BlockNumber());
+				temporary->WriteLockInTransaction(transaction);
+				transactionStart = temporary->Size();
+			}
+		}
+
+		if (status == B_ENTRY_NOT_FOUND)
+			status = loader->Finish(transaction);
+		if (status == B_OK)
+			status = transaction.Done();
+	}
+
+	if (status == B_OK) {
+		// Exchange the data streams of both inodes
+		Transaction transaction(fVolume, BlockNumber());
+		WriteLockInTransaction(transaction);
+		temporary->WriteLockInTransaction(transaction);
+
+		data_stream data = Node().data;
+		Node().data = temporary->Node().data;
+		temporary->Node().data = data;
+
+		status = WriteBack(transaction);
+		if (status == B_OK)
+			status = temporary->WriteBack(transaction);
+		if (status == B_OK)
+			status = transaction.Done();
+		if (status == B_OK) {
+			// Let the tree pick up its new header
+			status = fTree->SetTo(this);
+		}
+	}
+
+	// Remove the temporary index again; it now either contains the old, or
+	// an incomplete tree. If that fails, the next mount will take care of it.
+	{
+		Transaction transaction(fVolume, fVolume->Indices());
+		if (fVolume->IndicesNode()->Remove(transaction,
+				REBUILD_TREE_INDEX_NAME) == B_OK) {
+			transaction.Done();
+		}
+	}
+
+	locker.Unlock();
+	journal->Unlock(NULL, true);
+
+	put_vnode(fVolume->FSVolume(), temporary->ID());
+
+	if (status != B_OK)
+		RETURN_ERROR(status);
+
+	if (_oldSize != NULL)
+		*_oldSize = oldSize;
+	if (_newSize != NULL)
+		*_newSize = Size();
+
+	return B_OK;
+}
+
+
 //	#pragma mark - data stream
 
 
@@ -1599,18 +1764,24 @@ Inode::WriteAt(Transaction& transaction, off_t pos, const uint8* buffer,
 	if (pos < 0)
 		return B_BAD_VALUE;
 
+	// inline data is part of the inode, and can only be written back as part
+	// of a transaction -- which the file cache might need to do right away
+	// when memory is low
+	bool inlineData = HasInlineData() || _IsInlineCandidate(pos + length);
+
 	locker.Unlock();
 
 	// the transaction doesn't have to be started already
-	if (changeSize && !transaction.IsStarted())
+	if ((changeSize || inlineData) && !transaction.IsStarted())
 		transaction.Start(fVolume, BlockNumber());
 
 	WriteLocker writeLocker(fLock);
 
 	// Work around possible race condition: Someone might have shrunken the file
-	// while we had no lock.
+	// (or stored its data inline) while we had no lock.
 	if (!transaction.IsStarted()
-		&& (uint64)pos + (uint64)length > (uint64)Size()) {
+		&& ((uint64)pos + (uint64)length > (uint64)Size()
+			|| HasInlineData())) {
 		writeLocker.Unlock();
 		transaction.Start(fVolume, BlockNumber());
 		writeLocker.Lock();
@@ -1686,6 +1857,128 @@ Inode::FillGapWithZeros(off_t pos, off_t newSize)
 }
 
 
+/*!	Reads from the file data that is stored in the inode's small_data section
+	instead of in its data stream (see INODE_INLINE_DATA).
+	Like the data stream, the inline data is only what the file cache reads
+	its pages from, and writes them back to; it does not contain changes that
+	have not been written back yet. Use ReadAt() to get the current contents.
+	You need to hold the inode's read lock when you call this method.
+*/
+status_t
+Inode::ReadInlineData(off_t pos, uint8* buffer, size_t* _length)
+{
+	if (pos < 0)
+		return B_BAD_VALUE;
+	if (pos >= Size()) {
+		*_length = 0;
+		return B_OK;
+	}
+
+	NodeGetter node(fVolume);
+	status_t status = node.SetTo(this);
+	if (status != B_OK)
+		return status;
+
+	RecursiveLocker locker(fSmallDataLock);
+
+	small_data* item = _FindInlineData(node.Node());
+	if (item == NULL || item->DataSize() != Size())
+		RETURN_ERROR(B_BAD_DATA);
+
+	size_t length = *_length;
+	if (pos + (off_t)length > Size())
+		length = Size() - pos;
+
+	if (user_memcpy(buffer, item->Data() + pos, length) < B_OK)
+		return B_BAD_ADDRESS;
+
+	*_length = length;
+	return B_OK;
+}
+
+
+/*!	Changes the file data that is stored in the inode's small_data section:
+	afterwards, the file will be \a size bytes long, and contain \a length
+	bytes from \a buffer at \a pos. The rest of the data is preserved, and
+	any space added is filled with zeros. A \a size of zero removes the
+	inline data again.
+	If the data does not fit into the small_data section, B_DEVICE_FULL is
+	returned, and the inode is left untouched; the caller has to use a real
+	data stream then.
+	You need to hold the inode's write lock when you call this method, unless
+	you only change existing data (as bfs_write_pages() does): since inline
+	data is only ever changed in a transaction, owning the journal is enough
+	then.
+*/
+status_t
+Inode::WriteInlineData(Transaction& transaction, off_t size, off_t pos,
+	const uint8* buffer, size_t length)
+{
+	if (pos < 0 || pos + (off_t)length > size)
+		return B_BAD_VALUE;
+	if (size > (off_t)(fVolume->InodeSize() - sizeof(bfs_inode)))
+		return B_DEVICE_FULL;
+
+	NodeGetter node(fVolume);
+	status_t status = node.SetToWritable(transaction, this);
+	if (status != B_OK)
+		return status;
+
+	const char nameTag[2] = {INLINE_DATA_NAME, 0};
+	uint8* data = NULL;
+	MemoryDeleter dataDeleter;
+	off_t oldSize = 0;
+
+	if (size == 0) {
+		if (HasInlineData()) {
+			status = _RemoveSmallData(transaction, node, nameTag);
+			if (status != B_OK)
+				return status;
+		}
+
+		Node().flags &= ~HOST_ENDIAN_TO_BFS_INT32(INODE_INLINE_DATA);
+	} else {
+		data = (uint8*)malloc(size);
+		if (data == NULL)
+			return B_NO_MEMORY;
+
+		dataDeleter.SetTo(data);
+
+		if (HasInlineData()) {
+			RecursiveLocker locker(fSmallDataLock);
+
+			small_data* item = _FindInlineData(node.Node());
+			if (item == NULL)
+				RETURN_ERROR(B_BAD_DATA);
+
+			oldSize = min_c(item->DataSize(), size);
+			memcpy(data, item->Data(), oldSize);
+		}
+		memset(data + oldSize, 0, size - oldSize);
+
+		if (length > 0 && user_memcpy(data + pos, buffer, length) < B_OK)
+			return B_BAD_ADDRESS;
+
+		status = _AddSmallData(transaction, node, nameTag, INLINE_DATA_TYPE,
+			0, data, size);
+		if (status != B_OK)
+			return status;
+
+		Node().flags |= HOST_ENDIAN_TO_BFS_INT32(INODE_INLINE_DATA);
+	}
+
+	Node().data.size = HOST_ENDIAN_TO_BFS_INT64(size);
+
+	status = WriteBack(transaction);
+	if (status != B_OK)
+		return status;
+
+	file_cache_set_size(FileCache(), size);
+	file_map_set_size(Map(), size);
+	return B_OK;
+}
+
+
 /*!	Allocates \a length blocks, and clears their contents. Growing
 	the indirect and double indirect range uses this method.
 	The allocated block_run is saved in "run"
@@ -2277,6 +2570,18 @@ Inode::SetFileSize(Transaction& transaction, off_t size)
 	if (size == oldSize)
 		return B_OK;
 
+	if (HasInlineData() || _IsInlineCandidate(size)) {
+		status_t status = WriteInlineData(transaction, size, 0, NULL, 0);
+		if (status != B_DEVICE_FULL)
+			return status;
+
+		if (HasInlineData()) {
+			status = _MoveInlineDataToStream(transaction);
+			if (status != B_OK)
+				return status;
+		}
+	}
+
 	T(Resize(this, oldSize, size, false));
 
 	// should the data stream grow or shrink?
@@ -2308,6 +2613,98 @@ Inode::Append(Transaction& transaction, off_t bytes)
 }
 
 
+/*!	Returns whether or not the data of this file should be stored in its
+	small_data section, if it would be \a size bytes large. Only files that
+	do not have any data yet can become inlined.
+*/
+bool
+Inode::_IsInlineCandidate(off_t size) const
+{
+	return fVolume->SupportsInlineData() && IsFile() && !HasInlineData()
+		&& Size() == 0 && Node().data.MaxDirectRange() == 0 && size > 0
+		&& size <= (off_t)(fVolume->InodeSize() - sizeof(bfs_inode));
+}
+
+
+/*!	Returns the small_data item that contains the inline data of the file,
+	or NULL if there is none.
+	You need to hold the fSmallDataLock when you call this method
+*/
+small_data*
+Inode::_FindInlineData(const bfs_inode* node) const
+{
+	ASSERT_LOCKED_RECURSIVE(&fSmallDataLock);
+
+	small_data* smallData = NULL;
+	while (_GetNextSmallData(const_cast<bfs_inode*>(node), &smallData)
+			== B_OK) {
+		if (*smallData->Name() == INLINE_DATA_NAME
+			&& smallData->NameSize() == INLINE_DATA_NAME_LENGTH)
+			return smallData;
+	}
+	return NULL;
+}
+
+
+/*!	Moves the inline data of the file into a newly allocated data stream, so
+	that the file can grow beyond what fits into its small_data section.
+	You need to hold the inode's write lock when you call this method.
+*/
+status_t
+Inode::_MoveInlineDataToStream(Transaction& transaction)
+{
+	uint32 blockSize = fVolume->BlockSize();
+	uint8* block = (uint8*)malloc(blockSize);
+	if (block == NULL)
+		return B_NO_MEMORY;
+
+	MemoryDeleter blockDeleter(block);
+	off_t size = Size();
+
+	NodeGetter node(fVolume);
+	status_t status = node.SetToWritable(transaction, this);
+	if (status != B_OK)
+		return status;
+
+	{
+		RecursiveLocker locker(fSmallDataLock);
+
+		small_data* item = _FindInlineData(node.Node());
+		if (item == NULL || item->DataSize() != size || size > blockSize)
+			RETURN_ERROR(B_BAD_DATA);
+
+		memcpy(block, item->Data(), size);
+		memset(block + size, 0, blockSize - size);
+	}
+
+	const char nameTag[2] = {INLINE_DATA_NAME, 0};
+	status = _RemoveSmallData(transaction, node, nameTag);
+	if (status != B_OK)
+		return status;
+
+	Node().flags &= ~HOST_ENDIAN_TO_BFS_INT32(INODE_INLINE_DATA);
+	Node().data.size = 0;
+
+	status = _GrowStream(transaction, size);
+	if (status != B_OK)
+		return status;
+
+	// Only the location of the data changes, so the file cache stays valid:
+	// the pages it has not modified match the inline data, and the modified
+	// ones will be written to the new block later on. Writing through the
+	// file cache is not an option anyway, as it might have to wait for a page
+	// that is currently read in by bfs_read_pages(), which needs our lock.
+	// The block has just been allocated, and was therefore removed from the
+	// block cache (see BlockAllocator::AllocateBlocks()).
+	if (write_pos(fVolume->Device(), fVolume->ToOffset(Node().data.direct[0]),
+			block, blockSize) != (ssize_t)blockSize)
+		RETURN_ERROR(B_IO_ERROR);
+
+	file_map_invalidate(Map(), 0, size);
+	return WriteBack(transaction);
+}
+
+
 /*!	Checks whether or not this inode's data stream needs to be trimmed
 	because of an earlier preallocation.
 	Returns true if there are any blocks to be trimmed.
@@ -2386,6 +2783,18 @@ Inode::Free(Transaction& transaction)
 status_t
 Inode::Sync()
 {
+	if (FileCache() != NULL && HasInlineData() && !fVolume->IsReadOnly()) {
+		// bfs_write_pages() can only write back inline data as part of a
+		// transaction, but won't wait for one: start it here instead
+		Transaction transaction(fVolume, BlockNumber());
+		status_t status = file_cache_sync(FileCache());
+		if (status == B_OK)
+			status = transaction.Done();
+		if (status == B_OK)
+			status = fVolume->GetJournal(0)->FlushLogAndBlocks();
+		return status;
+	}
+
 	if (FileCache())
 		return file_cache_sync(FileCache());
 
@@ -2897,6 +3306,9 @@ AttributeIterator::GetNext(char* name, size_t* _length, uint32* _type,
 			if (item->NameSize() == FILE_NAME_NAME_LENGTH
 				&& *item->Name() == FILE_NAME_NAME)
 				continue;
+			if (item->NameSize() == INLINE_DATA_NAME_LENGTH
+				&& *item->Name() == INLINE_DATA_NAME)
+				continue;
 
 			if (index >= fCurrentSmallData)
 				break;
@@ -75,6 +75,9 @@ public:
 			bool				IsLongSymLink() const
 									{ return (Flags() & INODE_LONG_SYMLINK)
 										!= 0; }
+			bool				HasInlineData() const
+									{ return (Flags() & INODE_INLINE_DATA)
+										!= 0; }
 
 			bool				HasUserAccessableStream() const
 									{ return IsFile(); }
@@ -140,6 +143,8 @@ public:
 			bool				IsEmpty();
 			status_t			ContainerContentsChanged(
 									Transaction& transaction);
+			status_t			RebuildTree(uint32 fillPercentage,
+									off_t* _oldSize, off_t* _newSize);
 
 			// manipulating the data stream
 			status_t			FindBlockRun(off_t pos, block_run& run,
@@ -150,6 +155,12 @@ public:
 									const uint8* buffer, size_t* length);
 			status_t			FillGapWithZeros(off_t oldSize, off_t newSize);
 
+			status_t			ReadInlineData(off_t pos, uint8* buffer,
+									size_t* _length);
+			status_t			WriteInlineData(Transaction& transaction,
+									off_t size, off_t pos, const uint8* buffer,
+									size_t length);
+
 			status_t			SetFileSize(Transaction& transaction,
 									off_t size);
 			status_t			Append(Transaction& transaction, off_t bytes);
@@ -254,6 +265,11 @@ private:
 			status_t			_ShrinkStream(Transaction& transaction,
 									off_t size);
 
+			bool				_IsInlineCandidate(off_t size) const;
+			small_data*			_FindInlineData(const bfs_inode* node) const;
+			status_t			_MoveInlineDataToStream(
+									Transaction& transaction);
+
 private:
 			rw_lock				fLock;
 			Volume*				fVolume;
@@ -339,12 +355,25 @@ class NodeGetter : public CachedBlock {
 public:
 	NodeGetter(Volume* volume = NULL)
 		:
-		CachedBlock(volume)
+		CachedBlock(volume),
+		fWritable(false)
 	{
 	}
 
 	~NodeGetter()
 	{
+		Unset();
+	}
+
+	void Unset()
+	{
+		// a changed inode gets a new checksum before it is released
+		if (fWritable && Block() != NULL && fVolume->HasMetadataChecksums()) {
+			WritableNode()->checksum = HOST_ENDIAN_TO_BFS_INT32(
+				Node()->CalculateChecksum(fVolume));
+		}
+		fWritable = false;
+		CachedBlock::Unset();
 	}
 
 	status_t SetTo(const Inode* inode)
@@ -359,12 +388,25 @@ public:
 	{
 		Unset();
 		fVolume = inode->GetVolume();
-		return CachedBlock::SetToWritable(transaction,
+		status_t status = CachedBlock::SetToWritable(transaction,
 			fVolume->VnodeToBlock(inode->ID()), empty);
+		fWritable = status == B_OK;
+		return status;
+	}
+
+	status_t MakeWritable(Transaction& transaction)
+	{
+		status_t status = CachedBlock::MakeWritable(transaction);
+		if (status == B_OK)
+			fWritable = true;
+		return status;
 	}
 
 	const bfs_inode* Node() const { return (const bfs_inode*)Block(); }
 	bfs_inode* WritableNode() const { return (bfs_inode*)Block();  }
+
+private:
+	bool	fWritable;
 };
 
 
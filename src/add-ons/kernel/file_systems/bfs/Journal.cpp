@@ -11,6 +11,7 @@
 
 #include "Journal.h"
 
+#include "CRCTable.h"
 #include "Debug.h"
 #include "Inode.h"
 
@@ -28,9 +29,22 @@ struct run_array {
 		// that -1 accounts for an off-by-one error in Be's BFS implementation
 	const block_run& RunAt(int32 i) const { return runs[i]; }
 
+	uint32 Checksum(int32 blockSize) const
+		{ return BFS_ENDIAN_TO_HOST_INT32(*_ChecksumField(blockSize)); }
+	void SetChecksum(int32 blockSize, uint32 checksum)
+		{ *(uint32*)_ChecksumField(blockSize)
+			= HOST_ENDIAN_TO_BFS_INT32(checksum); }
+
 	static int32 MaxRuns(int32 blockSize);
 
 private:
+	// The last four bytes of the block are never used by a run (see
+	// MaxRuns()); on volumes with metadata checksums, they contain the
+	// CRC32C of the whole log entry.
+	const uint32* _ChecksumField(int32 blockSize) const
+		{ return (const uint32*)((const uint8*)this + blockSize
+			- sizeof(uint32)); }
+
 	static int _Compare(block_run& a, block_run& b);
 	int32 _FindInsertionIndex(block_run& run);
 };
@@ -470,21 +484,22 @@ Journal::_CheckRunArray(const run_array* array)
 }
 
 
-/*!	Replays an entry in the log.
+/*!	Checks the integrity of an entry in the log, including its checksum on
+	volumes that have them.
 	\a _start points to the entry in the log, and will be bumped to the next
-	one if replaying succeeded.
+	one if the entry is valid.
 */
 status_t
-Journal::_ReplayRunArray(int32* _start)
+Journal::_CheckLogEntry(int32* _start)
 {
-	PRINT(("ReplayRunArray(start = %" B_PRId32 ")\n", *_start));
+	PRINT(("CheckLogEntry(start = %" B_PRId32 ")\n", *_start));
 
 	off_t logOffset = fVolume->ToBlock(fVolume->Log());
-	off_t firstBlockNumber = *_start % fLogSize;
+	off_t blockNumber = *_start % fLogSize;
 
 	CachedBlock cachedArray(fVolume);
 
-	status_t status = cachedArray.SetTo(logOffset + firstBlockNumber);
+	status_t status = cachedArray.SetTo(logOffset + blockNumber);
 	if (status != B_OK)
 		return status;
 
@@ -492,13 +507,18 @@ Journal::_ReplayRunArray(int32* _start)
 	if (_CheckRunArray(array) < B_OK)
 		return B_BAD_DATA;
 
-	// First pass: check integrity of the blocks in the run array
-
 	CachedBlock cached(fVolume);
 
-	firstBlockNumber = (firstBlockNumber + 1) % fLogSize;
-	off_t blockNumber = firstBlockNumber;
+	blockNumber = (blockNumber + 1) % fLogSize;
 	int32 blockSize = fVolume->BlockSize();
+	int32 count = 1;
+
+	bool checksums = fVolume->HasMetadataChecksums();
+	uint32 checksum = 0;
+	if (checksums) {
+		checksum = calculate_crc32c(0xffffffff, (const uint8*)array,
+			blockSize - sizeof(uint32));
+	}
 
 	for (int32 index = 0; index < array->CountRuns(); index++) {
 		const block_run& run = array->RunAt(index);
@@ -520,14 +540,55 @@ Journal::_ReplayRunArray(int32* _start)
 				}
 			}
 
+			if (checksums) {
+				checksum = calculate_crc32c(checksum, cached.Block(),
+					blockSize);
+			}
+
 			blockNumber = (blockNumber + 1) % fLogSize;
 			offset += blockSize;
+			count++;
 		}
 	}
 
-	// Second pass: write back its blocks
+	if (checksums && checksum != array->Checksum(blockSize)) {
+		FATAL(("Log entry at %" B_PRId32 " has an invalid checksum!\n",
+			*_start));
+		RETURN_ERROR(B_BAD_DATA);
+	}
 
-	blockNumber = firstBlockNumber;
+	*_start += count;
+	return B_OK;
+}
+
+
+/*!	Replays an entry in the log; it must have been checked with
+	_CheckLogEntry() before.
+	\a _start points to the entry in the log, and will be bumped to the next
+	one if replaying succeeded.
+*/
+status_t
+Journal::_ReplayRunArray(int32* _start)
+{
+	PRINT(("ReplayRunArray(start = %" B_PRId32 ")\n", *_start));
+
+	off_t logOffset = fVolume->ToBlock(fVolume->Log());
+	off_t blockNumber = *_start % fLogSize;
+
+	CachedBlock cachedArray(fVolume);
+
+	status_t status = cachedArray.SetTo(logOffset + blockNumber);
+	if (status != B_OK)
+		return status;
+
+	const run_array* array = (const run_array*)cachedArray.Block();
+	if (_CheckRunArray(array) < B_OK)
+		return B_BAD_DATA;
+
+	CachedBlock cached(fVolume);
+
+	blockNumber = (blockNumber + 1) % fLogSize;
+	int32 blockSize = fVolume->BlockSize();
 	int32 count = 1;
 
 	for (int32 index = 0; index < array->CountRuns(); index++) {
@@ -560,6 +621,12 @@ Journal::_ReplayRunArray(int32* _start)
 /*!	Replays all log entries - this will put the disk into a
 	consistent and clean state, if it was not correctly unmounted
 	before.
+	All entries are checked before the first one is replayed. On volumes
+	with metadata checksums, the last transaction in the log may not have
+	been written completely, as the drive cache is only flushed after the
+	superblock has been updated; if any of its entries is invalid, the whole
+	transaction is dropped. Since its blocks are only written back after
+	the flush, none of them can have reached their final location yet.
 	This method is called by Journal::InitCheck() if the log start
 	and end pointer don't match.
 */
@@ -581,19 +648,45 @@ Journal::ReplayLog()
 	if (fVolume->IsReadOnly())
 		return B_READ_ONLY_DEVICE;
 
+	// First pass: check all entries, and find out where to stop replaying
+
+	bool checksums = fVolume->HasMetadataChecksums();
+	int32 lastTransaction
+		= fVolume->SuperBlock().LastTransactionStart() % fLogSize;
+	bool inLastTransaction = false;
+
+	int32 end = fVolume->LogEnd();
 	int32 start = fVolume->LogStart();
 	int32 lastStart = -1;
-	while (true) {
-		// stop if the log is completely flushed
-		if (start == fVolume->LogEnd())
-			break;
-
+	while (start != end) {
 		if (start == lastStart) {
-			// strange, flushing the log hasn't changed the log_start pointer
+			// strange, the entry hasn't changed the start pointer
 			return B_ERROR;
 		}
 		lastStart = start;
 
+		if (checksums && start % fLogSize == lastTransaction)
+			inLastTransaction = true;
+
+		status_t status = _CheckLogEntry(&start);
+		if (status == B_BAD_DATA && inLastTransaction) {
+			INFORM(("last transaction in the log at %" B_PRId32 " is "
+				"incomplete, ignoring it\n", lastTransaction));
+			end = lastTransaction;
+			break;
+		}
+		if (status != B_OK) {
+			FATAL(("checking log entry at %d failed: %s\n", (int)lastStart,
+				strerror(status)));
+			return B_ERROR;
+		}
+		start = start % fLogSize;
+	}
+
+	// Second pass: write back the blocks of all entries
+
+	start = fVolume->LogStart();
+	while (start != end) {
 		status_t status = _ReplayRunArray(&start);
 		if (status != B_OK) {
 			FATAL(("replaying log entry from %d failed: %s\n", (int)start,
@@ -719,6 +812,37 @@ Journal::_LogFlusher(void* _journal)
 }
 
 
+/*!	Computes the checksum over the log entry described by \a array, that is,
+	the array itself, and all blocks it refers to, and stores it in the array.
+*/
+status_t
+Journal::_SetLogEntryChecksum(run_array* array)
+{
+	int32 blockSize = fVolume->BlockSize();
+	uint32 checksum = calculate_crc32c(0xffffffff, (const uint8*)array,
+		blockSize - sizeof(uint32));
+
+	for (int32 i = 0; i < array->CountRuns(); i++) {
+		const block_run& run = array->RunAt(i);
+		off_t blockNumber = fVolume->ToBlock(run);
+
+		for (int32 j = 0; j < run.Length(); j++) {
+			const void* data = block_cache_get(fVolume->BlockCache(),
+				blockNumber + j);
+			if (data == NULL)
+				return B_IO_ERROR;
+
+			checksum = calculate_crc32c(checksum, (const uint8*)data,
+				blockSize);
+			block_cache_put(fVolume->BlockCache(), blockNumber + j);
+		}
+	}
+
+	array->SetChecksum(blockSize, checksum);
+	return B_OK;
+}
+
+
 /*!	Writes the blocks that are part of current transaction into the log,
 	and ends the current transaction.
 	If the current transaction is too large to fit into the log, it will
@@ -754,6 +878,7 @@ Journal::_WriteTransactionToLog()
 	off_t logOffset = fVolume->ToBlock(fVolume->Log()) << blockShift;
 	off_t logStart = fVolume->LogEnd() % fLogSize;
 	off_t logPosition = logStart;
+	off_t transactionStart = logStart;
 	status_t status;
 
 	// create run_array structures for all changed blocks
@@ -796,6 +921,14 @@ Journal::_WriteTransactionToLog()
 		}
 	}
 
+	if (fVolume->HasMetadataChecksums()) {
+		for (int32 k = 0; k < runArrays.CountArrays(); k++) {
+			status = _SetLogEntryChecksum(runArrays.ArrayAt(k));
+			if (status != B_OK)
+				return status;
+		}
+	}
+
 	// Write log entries to disk
 
 	int32 maxVecs = runArrays.MaxArrayLength() + 1;
@@ -882,6 +1015,14 @@ Journal::_WriteTransactionToLog()
 
 	fVolume->SuperBlock().flags = SUPER_BLOCK_DISK_DIRTY;
 	fVolume->SuperBlock().log_end = HOST_ENDIAN_TO_BFS_INT64(logPosition);
+	if (fVolume->HasMetadataChecksums()) {
+		// lets ReplayLog() find this transaction, and tells Volume::Mount()
+		// that the checksums are still maintained
+		fVolume->SuperBlock().last_transaction_start
+			= HOST_ENDIAN_TO_BFS_INT64(transactionStart);
+		fVolume->SuperBlock().checksums_log_end
+			= fVolume->SuperBlock().log_end;
+	}
 
 	status = fVolume->WriteSuperBlock();
 
@@ -973,6 +1114,30 @@ Journal::Lock(Transaction* owner, bool separateSubTransactions)
 	if (status != B_OK)
 		return status;
 
+	return _Locked(owner, separateSubTransactions);
+}
+
+
+/*!	Like Lock(), but fails with B_WOULD_BLOCK instead of waiting in case
+	another thread currently owns the journal.
+*/
+status_t
+Journal::TryLock(Transaction* owner)
+{
+	status_t status = recursive_lock_trylock(&fLock);
+	if (status != B_OK)
+		return status;
+
+	return _Locked(owner, false);
+}
+
+
+/*!	Starts the transaction of \a owner; the caller must have acquired the
+	journal lock already.
+*/
+status_t
+Journal::_Locked(Transaction* owner, bool separateSubTransactions)
+{
 	if (!fSeparateSubTransactions && recursive_lock_get_recursion(&fLock) > 1) {
 		// we'll just use the current transaction again
 		return B_OK;
@@ -1183,6 +1348,28 @@ Transaction::Start(Volume* volume, off_t refBlock)
 }
 
 
+/*!	Like Start(), but doesn't wait for other transactions to finish; if the
+	journal is currently busy, B_WOULD_BLOCK is returned.
+*/
+status_t
+Transaction::TryStart(Volume* volume, off_t refBlock)
+{
+	// has it already been started?
+	if (fJournal != NULL)
+		return B_OK;
+
+	fJournal = volume->GetJournal(refBlock);
+	if (fJournal == NULL)
+		return B_ERROR;
+
+	status_t status = fJournal->TryLock(this);
+	if (status != B_OK)
+		fJournal = NULL;
+
+	return status;
+}
+
+
 void
 Transaction::AddListener(TransactionListener* listener)
 {
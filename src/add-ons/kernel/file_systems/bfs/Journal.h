@@ -27,6 +27,7 @@ public:
 
 			status_t		Lock(Transaction* owner,
 								bool separateSubTransactions);
+			status_t		TryLock(Transaction* owner);
 			status_t		Unlock(Transaction* owner, bool success);
 
 			status_t		ReplayLog();
@@ -51,9 +52,13 @@ private:
 
 			status_t		_FlushLog(bool canWait, bool flushBlocks);
 			uint32			_TransactionSize() const;
+			status_t		_SetLogEntryChecksum(run_array* array);
 			status_t		_WriteTransactionToLog();
 			status_t		_CheckRunArray(const run_array* array);
+			status_t		_CheckLogEntry(int32* start);
 			status_t		_ReplayRunArray(int32* start);
+			status_t		_Locked(Transaction* owner,
+								bool separateSubTransactions);
 			status_t		_TransactionDone(bool success);
 
 	static	void			_TransactionWritten(int32 transactionID,
@@ -136,6 +141,7 @@ public:
 	}
 
 	status_t Start(Volume* volume, off_t refBlock);
+	status_t TryStart(Volume* volume, off_t refBlock);
 	bool IsStarted() const { return fJournal != NULL; }
 
 	status_t Done()
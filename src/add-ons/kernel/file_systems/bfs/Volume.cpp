@@ -8,6 +8,7 @@
 
 
 #include "Attribute.h"
+#include "BPlusTree.h"
 #include "CheckVisitor.h"
 #include "Debug.h"
 #include "file_systems/DeviceOpener.h"
@@ -200,6 +201,12 @@ Volume::Mount(const char* deviceName, uint32 flags)
 		return B_BAD_VALUE;
 	}
 
+	if ((fSuperBlock.Features() & ~SUPER_BLOCK_KNOWN_FEATURES) != 0) {
+		FATAL(("volume uses unknown features (%#" B_PRIx32 ")!\n",
+			(uint32)fSuperBlock.Features()));
+		return B_UNSUPPORTED;
+	}
+
 	// initialize short hands to the superblock (to save byte swapping)
 	fBlockSize = fSuperBlock.BlockSize();
 	fBlockShift = fSuperBlock.BlockShift();
@@ -219,6 +226,18 @@ Volume::Mount(const char* deviceName, uint32 flags)
 	fLogStart = fSuperBlock.LogStart();
 	fLogEnd = fSuperBlock.LogEnd();
 
+	if (HasMetadataChecksums()
+		&& fSuperBlock.ChecksumsLogEnd() != fSuperBlock.LogEnd()) {
+		// The volume has been changed by a driver that doesn't know about
+		// the checksums, so neither the log entries, nor the inodes and
+		// B+tree nodes it wrote can be verified; the checksums are turned
+		// off for good with the next superblock update.
+		INFORM(("volume has been changed without updating its metadata "
+			"checksums, disabling them.\n"));
+		fSuperBlock.features &= ~HOST_ENDIAN_TO_BFS_INT32(
+			SUPER_BLOCK_FEATURE_METADATA_CHECKSUMS);
+	}
+
 	if ((fBlockCache = opener.InitCache(NumBlocks(), fBlockSize)) == NULL)
 		return B_ERROR;
 
@@ -276,6 +295,9 @@ Volume::Mount(const char* deviceName, uint32 flags)
 				}
 			} else {
 				// we don't use the vnode layer to access the indices node
+
+				if (!IsReadOnly())
+					_RemoveRebuildTreeIndex();
 			}
 		} else {
 			FATAL(("could not create root node: publish_vnode() failed!\n"));
@@ -303,6 +325,8 @@ Volume::Unmount()
 	put_vnode(fVolume, ToVnode(Root()));
 
 	fBlockAllocator.Uninitialize();
+	if (!IsReadOnly())
+		fBlockAllocator.WriteSummary();
 
 	// This will also flush the log & all blocks to disk
 	delete fJournal;
@@ -579,6 +603,19 @@ Volume::Initialize(int fd, const char* name, uint32 blockSize,
 	// create valid superblock
 
 	fSuperBlock.Initialize(name, numBlocks, blockSize);
+	if ((flags & VOLUME_INLINE_DATA) != 0) {
+		fSuperBlock.features
+			|= HOST_ENDIAN_TO_BFS_INT32(SUPER_BLOCK_FEATURE_INLINE_DATA);
+	}
+	if ((flags & VOLUME_ALLOCATION_SUMMARY) != 0) {
+		// the summary itself is only created when the volume is unmounted
+		fSuperBlock.features |= HOST_ENDIAN_TO_BFS_INT32(
+			SUPER_BLOCK_FEATURE_ALLOCATION_SUMMARY);
+	}
+	if ((flags & VOLUME_METADATA_CHECKSUMS) != 0) {
+		fSuperBlock.features |= HOST_ENDIAN_TO_BFS_INT32(
+			SUPER_BLOCK_FEATURE_METADATA_CHECKSUMS);
+	}
 
 	// initialize short hands to the superblock (to save byte swapping)
 	fBlockSize = fSuperBlock.BlockSize();
@@ -600,6 +637,8 @@ Volume::Initialize(int fd, const char* name, uint32 blockSize,
 	fSuperBlock.log_blocks.length = HOST_ENDIAN_TO_BFS_INT16(logSize);
 	fSuperBlock.log_start = fSuperBlock.log_end = HOST_ENDIAN_TO_BFS_INT64(
 		ToBlock(Log()));
+	fSuperBlock.checksums_log_end = fSuperBlock.last_transaction_start
+		= fSuperBlock.log_end;
 
 	// set the current log pointers, so that journaling will work correctly
 	fLogStart = fSuperBlock.LogStart();
@@ -673,6 +712,33 @@ Volume::Initialize(int fd, const char* name, uint32 blockSize,
 }
 
 
+/*!	Removes the temporary index left behind by an interrupted
+	Inode::RebuildTree(), if any. It contains either an incomplete, or the
+	old tree, and is of no use anymore.
+*/
+void
+Volume::_RemoveRebuildTreeIndex()
+{
+	off_t id;
+	if (fIndicesNode->Tree()->Find((const uint8*)REBUILD_TREE_INDEX_NAME,
+			strlen(REBUILD_TREE_INDEX_NAME), &id) != B_OK) {
+		return;
+	}
+
+	INFORM(("removing the left-over index of an interrupted tree rebuild\n"));
+
+	Transaction transaction(this, Indices());
+	status_t status = fIndicesNode->Remove(transaction,
+		REBUILD_TREE_INDEX_NAME);
+	if (status == B_OK)
+		status = transaction.Done();
+	if (status != B_OK) {
+		FATAL(("could not remove the index of an interrupted tree rebuild: "
+			"%s\n", strerror(status)));
+	}
+}
+
+
 /*!	Erase the first boot block, as we don't use it and there
  *	might be leftovers from other file systems. This can cause
  *	confusion for identifying the partition if not erased.
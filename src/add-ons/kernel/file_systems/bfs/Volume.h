@@ -24,6 +24,9 @@ enum volume_flags {
 
 enum volume_initialize_flags {
 	VOLUME_NO_INDICES	= 0x0001,
+	VOLUME_INLINE_DATA	= 0x0002,
+	VOLUME_ALLOCATION_SUMMARY = 0x0004,
+	VOLUME_METADATA_CHECKSUMS = 0x0008,
 };
 
 typedef DoublyLinkedList<Inode> InodeList;
@@ -79,6 +82,17 @@ public:
 								{ return fSuperBlock.AllocationGroups(); }
 			uint32			AllocationGroupShift() const
 								{ return fAllocationGroupShift; }
+			bool			SupportsInlineData() const
+								{ return (fSuperBlock.Features()
+									& SUPER_BLOCK_FEATURE_INLINE_DATA) != 0; }
+			bool			HasAllocationSummary() const
+								{ return (fSuperBlock.Features()
+									& SUPER_BLOCK_FEATURE_ALLOCATION_SUMMARY)
+										!= 0; }
+			bool			HasMetadataChecksums() const
+								{ return (fSuperBlock.Features()
+									& SUPER_BLOCK_FEATURE_METADATA_CHECKSUMS)
+										!= 0; }
 			disk_super_block& SuperBlock() { return fSuperBlock; }
 
 			off_t			ToOffset(block_run run) const
@@ -149,6 +163,7 @@ public:
 	static	status_t		Identify(int fd, disk_super_block* superBlock);
 
 private:
+			void			_RemoveRebuildTreeIndex();
 			status_t		_EraseUnusedBootBlock();
 
 protected:
@@ -76,7 +76,14 @@ struct disk_super_block {
 	int32		magic3;
 	inode_addr	root_dir;
 	inode_addr	indices;
-	int32		_reserved[8];
+	int32		features;
+	block_run	allocation_summary;
+	int64		checksums_log_end;
+		// the log_end at the time the metadata checksums were last known
+		// to be up to date; older drivers move log_end without updating it
+	int64		last_transaction_start;
+		// the log position of the last transaction written
+	int32		_reserved[1];
 	int32		pad_to_block[87];
 		// this also contains parts of the boot block
 
@@ -97,6 +104,11 @@ struct disk_super_block {
 	int32 Flags() const { return BFS_ENDIAN_TO_HOST_INT32(flags); }
 	off_t LogStart() const { return BFS_ENDIAN_TO_HOST_INT64(log_start); }
 	off_t LogEnd() const { return BFS_ENDIAN_TO_HOST_INT64(log_end); }
+	int32 Features() const { return BFS_ENDIAN_TO_HOST_INT32(features); }
+	off_t ChecksumsLogEnd() const
+		{ return BFS_ENDIAN_TO_HOST_INT64(checksums_log_end); }
+	off_t LastTransactionStart() const
+		{ return BFS_ENDIAN_TO_HOST_INT64(last_transaction_start); }
 
 	// implemented in Volume.cpp:
 	bool IsMagicValid() const;
@@ -113,6 +125,76 @@ struct disk_super_block {
 #define SUPER_BLOCK_DISK_CLEAN		'CLEN'		/* CLEN */
 #define SUPER_BLOCK_DISK_DIRTY		'DIRT'		/* DIRT */
 
+// Optional on-disk features; volumes created by BeOS or older versions of
+// this file system leave the features field zeroed.
+#define SUPER_BLOCK_FEATURE_INLINE_DATA	0x00000001
+	// the data of small files may be stored in the inode's small_data section
+#define SUPER_BLOCK_FEATURE_ALLOCATION_SUMMARY	0x00000002
+	// the allocation group state is saved on unmount, see allocation_summary
+#define SUPER_BLOCK_FEATURE_METADATA_CHECKSUMS	0x00000004
+	// inodes, B+tree nodes, and log entries are protected by a CRC32C; the
+	// feature is dropped when a driver that doesn't know about it changed
+	// the volume, see disk_super_block::checksums_log_end
+
+// All features this implementation knows about; volumes that use any other
+// feature are not mounted, as they might store their data in a way we don't
+// understand.
+#define SUPER_BLOCK_KNOWN_FEATURES \
+	(SUPER_BLOCK_FEATURE_INLINE_DATA | SUPER_BLOCK_FEATURE_ALLOCATION_SUMMARY \
+		| SUPER_BLOCK_FEATURE_METADATA_CHECKSUMS)
+
+//**************************************
+
+/*!	The allocation summary lets a cleanly unmounted volume be mounted
+	without reading the whole block bitmap. It starts with this header
+	in the first block of the superblock's allocation_summary run, followed
+	by one allocation_group_summary per allocation group, starting with the
+	second block.
+	The summary is only valid if the magic matches, and the log is still
+	where it was when the summary was written; it is invalidated as soon as
+	the volume is mounted read-write. Since drivers that don't know about the
+	summary don't invalidate it, but move the log with every transaction, it
+	is not used anymore after those changed the volume.
+*/
+struct allocation_summary_header {
+	int32		magic;
+	uint32		checksum;
+		// CRC32C over all entries, and then the header (with this field
+		// zeroed)
+	int32		num_ags;
+	int32		blocks_per_ag;
+	int64		num_blocks;
+	int64		used_blocks;
+	int64		log_end;
+		// the super block's log_end when the summary was written
+
+	int32 Magic() const { return BFS_ENDIAN_TO_HOST_INT32(magic); }
+	uint32 Checksum() const { return BFS_ENDIAN_TO_HOST_INT32(checksum); }
+	int32 AllocationGroups() const { return BFS_ENDIAN_TO_HOST_INT32(num_ags); }
+	int32 BlocksPerAllocationGroup() const
+		{ return BFS_ENDIAN_TO_HOST_INT32(blocks_per_ag); }
+	off_t NumBlocks() const { return BFS_ENDIAN_TO_HOST_INT64(num_blocks); }
+	off_t UsedBlocks() const { return BFS_ENDIAN_TO_HOST_INT64(used_blocks); }
+	off_t LogEnd() const { return BFS_ENDIAN_TO_HOST_INT64(log_end); }
+} _PACKED;
+
+struct allocation_group_summary {
+	int32		free_bits;
+	int32		first_free;
+	int32		largest_start;
+	int32		largest_length;
+		// negative if the largest free range is not known
+
+	int32 FreeBits() const { return BFS_ENDIAN_TO_HOST_INT32(free_bits); }
+	int32 FirstFree() const { return BFS_ENDIAN_TO_HOST_INT32(first_free); }
+	int32 LargestStart() const
+		{ return BFS_ENDIAN_TO_HOST_INT32(largest_start); }
+	int32 LargestLength() const
+		{ return BFS_ENDIAN_TO_HOST_INT32(largest_length); }
+} _PACKED;
+
+#define ALLOCATION_SUMMARY_MAGIC	'BFSa'
+
 //**************************************
 
 #define NUM_DIRECT_BLOCKS			12
@@ -172,11 +254,21 @@ struct small_data {
 #define FILE_NAME_NAME			0x13
 #define FILE_NAME_NAME_LENGTH	1
 
+// The data of inlined files (INODE_INLINE_DATA) is also part of the small_data
+// structure
+#define INLINE_DATA_TYPE		'RAWT'
+#define INLINE_DATA_NAME		0x14
+#define INLINE_DATA_NAME_LENGTH	1
+
 // The maximum key length of attribute data that is put  in the index.
 // This excludes a terminating null byte.
 // This must be smaller than or equal as BPLUSTREE_MAX_KEY_LENGTH.
 #define MAX_INDEX_KEY_LENGTH	255
 
+// Inode::RebuildTree() builds the new tree in an index of this name, so that
+// it can be found and removed on mount if rebuilding has been interrupted
+#define REBUILD_TREE_INDEX_NAME	"\x15rebuild tree"
+
 
 //**************************************
 
@@ -206,7 +298,9 @@ struct bfs_inode {
 	uint32		type;				// attribute type
 
 	int32		inode_size;
-	uint32		etc;
+	uint32		checksum;
+		// CRC32C of the inode block with SUPER_BLOCK_FEATURE_METADATA_CHECKSUMS
+		// (unused otherwise)
 
 	union {
 		data_stream		data;
@@ -226,6 +320,7 @@ struct bfs_inode {
 	int32 Flags() const { return BFS_ENDIAN_TO_HOST_INT32(flags); }
 	int32 Type() const { return BFS_ENDIAN_TO_HOST_INT32(type); }
 	int32 InodeSize() const { return BFS_ENDIAN_TO_HOST_INT32(inode_size); }
+	uint32 Checksum() const { return BFS_ENDIAN_TO_HOST_INT32(checksum); }
 	int64 LastModifiedTime() const
 		{ return BFS_ENDIAN_TO_HOST_INT64(last_modified_time); }
 	int64 CreateTime() const
@@ -235,6 +330,7 @@ struct bfs_inode {
 	small_data* SmallDataStart() { return small_data_start; }
 
 	status_t InitCheck(Volume* volume) const;
+	uint32 CalculateChecksum(Volume* volume) const;
 		// defined in Inode.cpp
 
 	static int64 ToInode(bigtime_t time)
@@ -259,6 +355,7 @@ enum inode_flags {
 	INODE_DELETED			= 0x00000010,
 	INODE_NOT_READY			= 0x00000020,	// used during Inode construction
 	INODE_LONG_SYMLINK		= 0x00000040,	// symlink in data stream
+	INODE_INLINE_DATA		= 0x00000080,	// file data in small_data section
 
 	INODE_PERMANENT_FLAGS	= 0x0000ffff,
 
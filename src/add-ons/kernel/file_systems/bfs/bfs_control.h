@@ -103,5 +103,20 @@ struct check_control {
  */
 #define BFS_IOCTL_RESIZE		14205
 
+/* Rebuilds the B+tree of the directory the ioctl is issued on, or of the
+ * index "index", if that is not empty. The nodes of the new tree are filled
+ * up to "fill_percentage" (50 - 100, 0 means 100). The sizes of the tree
+ * before, and after the operation are returned.
+ * Fails with B_BUSY if the directory is currently being read.
+ */
+#define BFS_IOCTL_COMPACT_TREE	14206
+
+struct compact_tree_control {
+	char		index[B_FILE_NAME_LENGTH];
+	uint32		fill_percentage;
+	off_t		old_size;
+	off_t		new_size;
+};
+
 
 #endif	/* BFS_CONTROL_H */
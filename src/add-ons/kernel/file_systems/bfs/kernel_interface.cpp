@@ -315,6 +315,12 @@ bfs_get_vnode(fs_volume* _volume, ino_t id, fs_vnode* _node, int* _type,
 		return status;
 	}
 
+	if (volume->HasMetadataChecksums()
+		&& node->Checksum() != node->CalculateChecksum(volume)) {
+		FATAL(("inode at %" B_PRIdINO " has an invalid checksum!\n", id));
+		return B_BAD_DATA;
+	}
+
 	Inode* inode = new(std::nothrow) Inode(volume, id);
 	if (inode == NULL)
 		return B_NO_MEMORY;
@@ -408,6 +414,62 @@ bfs_can_page(fs_volume* _volume, fs_vnode* _v, void* _cookie)
 }
 
 
+/*!	Copies the inline data of \a inode into the given pages; anything beyond
+	the end of the file is cleared.
+	The inode must be read locked.
+*/
+static status_t
+read_inline_data_pages(Inode* inode, off_t pos, const iovec* vecs,
+	size_t count, size_t numBytes)
+{
+	for (size_t i = 0; i < count && numBytes > 0; i++) {
+		size_t length = min_c(vecs[i].iov_len, numBytes);
+		size_t bytesRead = length;
+		status_t status = inode->ReadInlineData(pos,
+			(uint8*)vecs[i].iov_base, &bytesRead);
+		if (status != B_OK)
+			return status;
+
+		memset((uint8*)vecs[i].iov_base + bytesRead, 0, length - bytesRead);
+
+		pos += length;
+		numBytes -= length;
+	}
+
+	return B_OK;
+}
+
+
+/*!	Writes the given pages back into the inline data of \a inode; anything
+	beyond the end of the file is ignored.
+	The inline data is only ever changed as part of a transaction, so running
+	\a transaction is enough to keep it stable, and the inode does not need to
+	be locked.
+*/
+static status_t
+write_inline_data_pages(Transaction& transaction, Inode* inode, off_t pos,
+	const iovec* vecs, size_t count, size_t numBytes)
+{
+	if (pos >= inode->Size())
+		return B_OK;
+	if (pos + (off_t)numBytes > inode->Size())
+		numBytes = inode->Size() - pos;
+
+	for (size_t i = 0; i < count && numBytes > 0; i++) {
+		size_t length = min_c(vecs[i].iov_len, numBytes);
+		status_t status = inode->WriteInlineData(transaction, inode->Size(),
+			pos, (const uint8*)vecs[i].iov_base, length);
+		if (status != B_OK)
+			return status;
+
+		pos += length;
+		numBytes -= length;
+	}
+
+	return B_OK;
+}
+
+
 static status_t
 bfs_read_pages(fs_volume* _volume, fs_vnode* _node, void* _cookie,
 	off_t pos, const iovec* vecs, size_t count, size_t* _numBytes)
@@ -420,6 +482,9 @@ bfs_read_pages(fs_volume* _volume, fs_vnode* _node, void* _cookie,
 
 	InodeReadLocker _(inode);
 
+	if (inode->HasInlineData())
+		return read_inline_data_pages(inode, pos, vecs, count, *_numBytes);
+
 	uint32 vecIndex = 0;
 	size_t vecOffset = 0;
 	size_t bytesLeft = *_numBytes;
@@ -463,6 +528,30 @@ bfs_write_pages(fs_volume* _volume, fs_vnode* _node, void* _cookie,
 	if (inode->FileCache() == NULL)
 		RETURN_ERROR(B_BAD_VALUE);
 
+	if (inode->HasInlineData()) {
+		// The inline data is part of the inode, and can only be changed
+		// in a transaction. Since we might have been called by the page
+		// writer, we must not wait for one, though: the thread owning the
+		// journal could itself be waiting for the page writer to free some
+		// memory. The pages just stay modified then, and are retried later.
+		Transaction transaction;
+		status_t status = transaction.TryStart(volume, inode->BlockNumber());
+		if (status != B_OK)
+			return status;
+
+		if (inode->HasInlineData()) {
+			status = write_inline_data_pages(transaction, inode, pos, vecs,
+				count, *_numBytes);
+			if (status == B_OK)
+				status = transaction.Done();
+
+			return status;
+		}
+
+		// the data has been moved to the data stream in the mean time
+		transaction.Done();
+	}
+
 	InodeReadLocker _(inode);
 
 	uint32 vecIndex = 0;
@@ -520,6 +609,11 @@ bfs_io(fs_volume* _volume, fs_vnode* _node, void* _cookie, io_request* request)
 		RETURN_ERROR(B_BAD_VALUE);
 	}
 
+	// Inline data has no blocks to map, let the VFS fall back to
+	// bfs_read_pages() and bfs_write_pages() instead
+	if (inode->HasInlineData())
+		return B_UNSUPPORTED;
+
 	// We lock the node here and will unlock it in the "finished" hook.
 	rw_lock_read_lock(&inode->Lock());
 
@@ -793,6 +887,38 @@ bfs_ioctl(fs_volume* _volume, fs_vnode* _node, void* _cookie, uint32 cmd,
 			ResizeVisitor resizer(volume);
 			return resizer.Resize(size, -1);
 		}
+		case BFS_IOCTL_COMPACT_TREE:
+		{
+			if (bufferLength != sizeof(compact_tree_control))
+				return B_BAD_VALUE;
+
+			compact_tree_control control;
+			if (user_memcpy(&control, buffer, sizeof(compact_tree_control))
+					!= B_OK) {
+				return B_BAD_ADDRESS;
+			}
+			control.index[B_FILE_NAME_LENGTH - 1] = '\0';
+
+			if (volume->IsReadOnly())
+				return B_READ_ONLY_DEVICE;
+
+			Inode* inode = (Inode*)_node->private_node;
+			Index index(volume);
+			if (control.index[0] != '\0') {
+				status_t status = index.SetTo(control.index);
+				if (status != B_OK)
+					return status;
+
+				inode = index.Node();
+			}
+
+			status_t status = inode->RebuildTree(control.fill_percentage,
+				&control.old_size, &control.new_size);
+			if (status != B_OK)
+				return status;
+
+			return user_memcpy(buffer, &control, sizeof(compact_tree_control));
+		}
 
 #ifdef DEBUG_FRAGMENTER
 		case 56741:
@@ -2393,6 +2519,12 @@ bfs_initialize(int fd, partition_id partitionID, const char* name,
 		INFORM(("\tallocation group size: %ld blocks\n",
 			1L << super.AllocationGroupShift()));
 		INFORM(("\tlog size: %u blocks\n", super.log_blocks.Length()));
+		if ((super.Features() & SUPER_BLOCK_FEATURE_INLINE_DATA) != 0)
+			INFORM(("\tsmall files are stored inline\n"));
+		if ((super.Features() & SUPER_BLOCK_FEATURE_ALLOCATION_SUMMARY) != 0)
+			INFORM(("\tallocation summary is kept for fast mounting\n"));
+		if ((super.Features() & SUPER_BLOCK_FEATURE_METADATA_CHECKSUMS) != 0)
+			INFORM(("\tmetadata is protected by checksums\n"));
 	}
 
 	return B_OK;
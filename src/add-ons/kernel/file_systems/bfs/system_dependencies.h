@@ -10,6 +10,7 @@
 
 #include "fssh_api_wrapper.h"
 #include "fssh_auto_deleter.h"
+#include <kernel/util/SplayTree.h>
 
 #else	// !FS_SHELL
 
@@ -17,6 +18,7 @@
 #include <util/AutoLock.h>
 #include <util/DoublyLinkedList.h>
 #include <util/SinglyLinkedList.h>
+#include <util/SplayTree.h>
 #include <util/Stack.h>
 
 #include <ByteOrder.h>
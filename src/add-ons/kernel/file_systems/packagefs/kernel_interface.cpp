@@ -24,6 +24,7 @@
 #include "AttributeCookie.h"
 #include "AttributeDirectoryCookie.h"
 #include "DebugSupport.h"
+#include "DecompressedChunkCache.h"
 #include "Directory.h"
 #include "Query.h"
 #include "PackageFSRoot.h"
@@ -1161,9 +1162,19 @@ packagefs_std_ops(int32 op, ...)
 				create_object_cache("pkgfs TKAVLTreeNodes",
 					sizeof(TwoKeyAVLTreeNode<void*>), CACHE_NO_DEPOT);
 
+			error = DecompressedChunkCache::Init();
+			if (error != B_OK) {
+				ERROR("Failed to init DecompressedChunkCache\n");
+				StringConstants::Cleanup();
+				StringPool::Cleanup();
+				exit_debugging();
+				return error;
+			}
+
 			error = PackageFSRoot::GlobalInit();
 			if (error != B_OK) {
 				ERROR("Failed to init PackageFSRoot\n");
+				DecompressedChunkCache::Cleanup();
 				StringConstants::Cleanup();
 				StringPool::Cleanup();
 				exit_debugging();
@@ -1177,6 +1188,7 @@ packagefs_std_ops(int32 op, ...)
 		{
 			PRINT("package_std_ops(): B_MODULE_UNINIT\n");
 			PackageFSRoot::GlobalUninit();
+			DecompressedChunkCache::Cleanup();
 			delete_object_cache(TwoKeyAVLTreeNode<void*>::sNodeCache);
 			delete_object_cache((object_cache*)
 				PackageFileHeapAccessorBase::sQuadChunkCache);
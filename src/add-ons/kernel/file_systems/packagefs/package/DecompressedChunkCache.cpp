@@ -0,0 +1,297 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+#include "DecompressedChunkCache.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <new>
+
+#include <package/packagefs.h>
+
+#include <low_resource_manager.h>
+#include <lock.h>
+#include <util/AutoLock.h>
+#include <util/DoublyLinkedList.h>
+#include <util/OpenHashTable.h>
+#include <vm/vm_page.h>
+
+#include "DebugSupport.h"
+
+
+// The cache may use 1/256 of the physical memory, but at least 1 MiB and at
+// most 32 MiB.
+static const size_t kMinCacheSize = 1024 * 1024;
+static const size_t kMaxCacheSize = 32 * 1024 * 1024;
+static const size_t kMemoryFraction = 256;
+
+
+struct ChunkCacheKey {
+	const void*	owner;
+	size_t		chunkIndex;
+
+	ChunkCacheKey(const void* owner, size_t chunkIndex)
+		:
+		owner(owner),
+		chunkIndex(chunkIndex)
+	{
+	}
+};
+
+
+struct ChunkCacheEntry : DoublyLinkedListLinkImpl<ChunkCacheEntry> {
+	ChunkCacheEntry*	hashNext;
+	const void*			owner;
+	size_t				chunkIndex;
+	size_t				size;
+	uint8				data[0];
+
+	size_t AllocationSize() const
+	{
+		return sizeof(ChunkCacheEntry) + size;
+	}
+};
+
+
+struct ChunkCacheEntryHashDefinition {
+	typedef ChunkCacheKey	KeyType;
+	typedef	ChunkCacheEntry	ValueType;
+
+	size_t HashKey(const ChunkCacheKey& key) const
+	{
+		return ((size_t)key.owner >> 3) ^ (key.chunkIndex * 0x9e3779b1);
+	}
+
+	size_t Hash(const ChunkCacheEntry* value) const
+	{
+		return HashKey(ChunkCacheKey(value->owner, value->chunkIndex));
+	}
+
+	bool Compare(const ChunkCacheKey& key, const ChunkCacheEntry* value) const
+	{
+		return key.owner == value->owner && key.chunkIndex == value->chunkIndex;
+	}
+
+	ChunkCacheEntry*& GetLink(ChunkCacheEntry* value) const
+	{
+		return value->hashNext;
+	}
+};
+
+
+typedef BOpenHashTable<ChunkCacheEntryHashDefinition> ChunkCacheEntryTable;
+typedef DoublyLinkedList<ChunkCacheEntry> ChunkCacheEntryList;
+
+
+static mutex sLock = MUTEX_INITIALIZER("packagefs chunk cache");
+static ChunkCacheEntryTable* sEntries = NULL;
+static ChunkCacheEntryList sEntryList;
+	// least recently used first
+static size_t sSize = 0;
+static size_t sMaxSize = 0;
+
+static uint64 sHits = 0;
+static uint64 sMisses = 0;
+static uint64 sInsertions = 0;
+static uint64 sEvictions = 0;
+
+
+static void
+remove_entry(ChunkCacheEntry* entry)
+{
+	sEntries->RemoveUnchecked(entry);
+	sEntryList.Remove(entry);
+	sSize -= entry->AllocationSize();
+	free(entry);
+}
+
+
+// #pragma mark - DecompressedChunkCache
+
+
+/*static*/ status_t
+DecompressedChunkCache::Init()
+{
+	sEntries = new(std::nothrow) ChunkCacheEntryTable;
+	if (sEntries == NULL)
+		RETURN_ERROR(B_NO_MEMORY);
+
+	status_t error = sEntries->Init();
+	if (error != B_OK) {
+		delete sEntries;
+		sEntries = NULL;
+		RETURN_ERROR(error);
+	}
+
+	sMaxSize = (size_t)vm_page_num_pages() * B_PAGE_SIZE / kMemoryFraction;
+	sMaxSize = min_c(max_c(sMaxSize, kMinCacheSize), kMaxCacheSize);
+
+	error = register_low_resource_handler(&_LowMemoryHandler, NULL,
+		B_KERNEL_RESOURCE_PAGES | B_KERNEL_RESOURCE_MEMORY
+			| B_KERNEL_RESOURCE_ADDRESS_SPACE, 0);
+	if (error != B_OK) {
+		delete sEntries;
+		sEntries = NULL;
+		RETURN_ERROR(error);
+	}
+
+	return B_OK;
+}
+
+
+/*static*/ void
+DecompressedChunkCache::Cleanup()
+{
+	unregister_low_resource_handler(&_LowMemoryHandler, NULL);
+
+	MutexLocker locker(sLock);
+	_RemoveEntries(0);
+	delete sEntries;
+	sEntries = NULL;
+}
+
+
+/*!	Copies the chunk into \a buffer, if it is cached, and marks it most
+	recently used.
+*/
+/*static*/ bool
+DecompressedChunkCache::Get(const void* owner, size_t chunkIndex,
+	void* buffer, size_t size)
+{
+	MutexLocker locker(sLock);
+
+	ChunkCacheEntry* entry = sEntries->Lookup(
+		ChunkCacheKey(owner, chunkIndex));
+	if (entry == NULL || entry->size != size) {
+		sMisses++;
+		return false;
+	}
+
+	sEntryList.Remove(entry);
+	sEntryList.Add(entry);
+	sHits++;
+
+	memcpy(buffer, entry->data, size);
+	return true;
+}
+
+
+/*static*/ void
+DecompressedChunkCache::Put(const void* owner, size_t chunkIndex,
+	const void* buffer, size_t size)
+{
+	// When memory is getting tight, don't add to the cache. The low memory
+	// handler will shrink it.
+	if (low_resource_state(B_KERNEL_RESOURCE_PAGES | B_KERNEL_RESOURCE_MEMORY
+			| B_KERNEL_RESOURCE_ADDRESS_SPACE) != B_NO_LOW_RESOURCE) {
+		return;
+	}
+
+	ChunkCacheEntry* entry = (ChunkCacheEntry*)malloc(
+		sizeof(ChunkCacheEntry) + size);
+	if (entry == NULL)
+		return;
+
+	entry->owner = owner;
+	entry->chunkIndex = chunkIndex;
+	entry->size = size;
+	memcpy(entry->data, buffer, size);
+
+	MutexLocker locker(sLock);
+
+	// someone else might have added the chunk in the meantime
+	if (sEntries->Lookup(ChunkCacheKey(owner, chunkIndex)) != NULL) {
+		locker.Unlock();
+		free(entry);
+		return;
+	}
+
+	// make room
+	if (sSize + entry->AllocationSize() > sMaxSize)
+		_RemoveEntries(sMaxSize - min_c(sMaxSize, entry->AllocationSize()));
+
+	if (sEntries->Insert(entry) != B_OK) {
+		locker.Unlock();
+		free(entry);
+		return;
+	}
+
+	sEntryList.Add(entry);
+	sSize += entry->AllocationSize();
+	sInsertions++;
+}
+
+
+/*!	Removes all chunks of the given owner. Must be called before the owner
+	goes away, since another one could be created at the same address.
+*/
+/*static*/ void
+DecompressedChunkCache::RemoveAll(const void* owner)
+{
+	MutexLocker locker(sLock);
+
+	ChunkCacheEntryList::Iterator it = sEntryList.GetIterator();
+	while (ChunkCacheEntry* entry = it.Next()) {
+		if (entry->owner == owner)
+			remove_entry(entry);
+	}
+}
+
+
+/*static*/ void
+DecompressedChunkCache::GetStatistics(
+	PackageFSChunkCacheStatistics& statistics)
+{
+	MutexLocker locker(sLock);
+
+	statistics.hits = sHits;
+	statistics.misses = sMisses;
+	statistics.insertions = sInsertions;
+	statistics.evictions = sEvictions;
+	statistics.size = sSize;
+	statistics.maxSize = sMaxSize;
+	statistics.chunkCount = sEntries->CountElements();
+}
+
+
+/*static*/ void
+DecompressedChunkCache::_LowMemoryHandler(void* data, uint32 resources,
+	int32 level)
+{
+	MutexLocker locker(sLock);
+
+	switch (level) {
+		case B_NO_LOW_RESOURCE:
+			return;
+		case B_LOW_RESOURCE_NOTE:
+			_RemoveEntries(sSize / 2);
+			break;
+		case B_LOW_RESOURCE_WARNING:
+			_RemoveEntries(sSize / 4);
+			break;
+		case B_LOW_RESOURCE_CRITICAL:
+			_RemoveEntries(0);
+			break;
+	}
+}
+
+
+/*!	Removes the least recently used entries until the cache size is at most
+	\a targetSize. The caller must hold the lock.
+*/
+/*static*/ void
+DecompressedChunkCache::_RemoveEntries(size_t targetSize)
+{
+	while (sSize > targetSize) {
+		ChunkCacheEntry* entry = sEntryList.Head();
+		if (entry == NULL)
+			break;
+
+		remove_entry(entry);
+		sEvictions++;
+	}
+}
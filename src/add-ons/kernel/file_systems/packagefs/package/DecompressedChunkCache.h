@@ -0,0 +1,41 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+#ifndef DECOMPRESSED_CHUNK_CACHE_H
+#define DECOMPRESSED_CHUNK_CACHE_H
+
+
+#include <SupportDefs.h>
+
+
+struct PackageFSChunkCacheStatistics;
+
+
+/*!	A global LRU cache of decompressed package heap chunks, shared by all
+	packages of all volumes.
+	The chunks are keyed by an owner -- the package's heap reader -- and the
+	chunk index. The cache gives back memory when the system runs low on it.
+*/
+class DecompressedChunkCache {
+public:
+	static	status_t			Init();
+	static	void				Cleanup();
+
+	static	bool				Get(const void* owner, size_t chunkIndex,
+									void* buffer, size_t size);
+	static	void				Put(const void* owner, size_t chunkIndex,
+									const void* buffer, size_t size);
+	static	void				RemoveAll(const void* owner);
+
+	static	void				GetStatistics(
+									PackageFSChunkCacheStatistics& statistics);
+
+private:
+	static	void				_LowMemoryHandler(void* data,
+									uint32 resources, int32 level);
+	static	void				_RemoveEntries(size_t targetSize);
+};
+
+
+#endif	// DECOMPRESSED_CHUNK_CACHE_H
@@ -22,9 +22,12 @@
 #include <package/hpkg/PackageFileHeapReader.h>
 #include <package/hpkg/PackageReaderImpl.h>
 #include <util/AutoLock.h>
+#include <zlib.h>
 
 #include "CachedDataReader.h"
 #include "DebugSupport.h"
+#include "DecompressedChunkCache.h"
+#include "PackageContentRecording.h"
 #include "PackageDirectory.h"
 #include "PackageFile.h"
 #include "PackagesDirectory.h"
@@ -40,6 +43,7 @@ using BPackageKit::BHPKG::BErrorOutput;
 using BPackageKit::BHPKG::BFDDataReader;
 using BPackageKit::BHPKG::BPackageInfoAttributeValue;
 using BPackageKit::BHPKG::BPackageVersionData;
+using BPackageKit::BHPKG::BPrivate::DecompressionAlgorithmOwner;
 using BPackageKit::BHPKG::BPrivate::PackageFileHeapReader;
 
 // current format version types
@@ -63,6 +67,28 @@ const char* const kArchitectureNames[B_PACKAGE_ARCHITECTURE_ENUM_COUNT] = {
 	"riscv64"
 };
 
+static const size_t kContentChecksumBufferSize = 64 * 1024;
+
+
+/*!	Packages compressed with a dictionary usually share it with the other
+	packages of their repository. Since the digested dictionary is rather big,
+	the decompression algorithms are shared between packages using the same
+	dictionary.
+	An entry is dropped once it holds the only reference to its algorithm.
+	Since new references are only handed out with the lock held, that check
+	is race-free.
+*/
+struct SharedDictionaryAlgorithm {
+	SharedDictionaryAlgorithm*		next;
+	DecompressionAlgorithmOwner*	algorithm;
+	size_t							dictionarySize;
+	uint8							dictionary[];
+};
+
+static mutex sSharedDictionaryAlgorithmsLock
+	= MUTEX_INITIALIZER("packagefs dictionaries");
+static SharedDictionaryAlgorithm* sSharedDictionaryAlgorithms = NULL;
+
 
 // #pragma mark - LoaderErrorOutput
 
@@ -392,7 +418,8 @@ struct Package::HeapReader {
 
 
 struct Package::HeapReaderV2 : public HeapReader, public CachedDataReader,
-	private BErrorOutput, private BFdIO {
+	private BErrorOutput, private BFdIO,
+	private PackageFileHeapReader::ChunkCache {
 public:
 	HeapReaderV2()
 		:
@@ -402,6 +429,7 @@ public:
 
 	~HeapReaderV2()
 	{
+		DecompressedChunkCache::RemoveAll(this);
 		delete fHeapReader;
 	}
 
@@ -415,6 +443,7 @@ public:
 
 		fHeapReader->SetErrorOutput(this);
 		fHeapReader->SetFile(this);
+		fHeapReader->SetChunkCache(this);
 
 		status_t error = CachedDataReader::Init(fHeapReader,
 			fHeapReader->UncompressedHeapSize());
@@ -444,6 +473,19 @@ private:
 		ERRORV(format, args);
 	}
 
+private:
+	// PackageFileHeapReader::ChunkCache
+
+	virtual bool GetChunk(size_t chunkIndex, void* buffer, size_t size)
+	{
+		return DecompressedChunkCache::Get(this, chunkIndex, buffer, size);
+	}
+
+	virtual void PutChunk(size_t chunkIndex, const void* buffer, size_t size)
+	{
+		DecompressedChunkCache::Put(this, chunkIndex, buffer, size);
+	}
+
 private:
 	PackageFileHeapReader*	fHeapReader;
 };
@@ -471,6 +513,61 @@ struct Package::CachingPackageReader : public PackageReaderImpl {
 		return PackageReaderImpl::Init(fd, keepFD, flags);
 	}
 
+	virtual status_t CreateDecompressionAlgorithm(uint32 compression,
+		const void* dictionary, size_t dictionarySize,
+		DecompressionAlgorithmOwner*& _algorithm)
+	{
+		if (compression != BHPKG::B_HPKG_COMPRESSION_ZSTD_DICTIONARY) {
+			return PackageReaderImpl::CreateDecompressionAlgorithm(compression,
+				dictionary, dictionarySize, _algorithm);
+		}
+
+		MutexLocker locker(sSharedDictionaryAlgorithmsLock);
+
+		// look for an algorithm using the same dictionary, dropping unused
+		// ones on the way
+		SharedDictionaryAlgorithm** link = &sSharedDictionaryAlgorithms;
+		while (SharedDictionaryAlgorithm* shared = *link) {
+			if (shared->algorithm->CountReferences() == 1) {
+				*link = shared->next;
+				shared->algorithm->ReleaseReference();
+				free(shared);
+				continue;
+			}
+
+			if (shared->dictionarySize == dictionarySize
+				&& memcmp(shared->dictionary, dictionary, dictionarySize)
+					== 0) {
+				shared->algorithm->AcquireReference();
+				_algorithm = shared->algorithm;
+				return B_OK;
+			}
+
+			link = &shared->next;
+		}
+
+		DecompressionAlgorithmOwner* algorithm;
+		status_t error = PackageReaderImpl::CreateDecompressionAlgorithm(
+			compression, dictionary, dictionarySize, algorithm);
+		if (error != B_OK)
+			return error;
+
+		// If we can't share the algorithm, that's no reason to fail.
+		SharedDictionaryAlgorithm* shared = (SharedDictionaryAlgorithm*)malloc(
+			sizeof(SharedDictionaryAlgorithm) + dictionarySize);
+		if (shared != NULL) {
+			shared->algorithm = algorithm;
+			shared->algorithm->AcquireReference();
+			shared->dictionarySize = dictionarySize;
+			memcpy(shared->dictionary, dictionary, dictionarySize);
+			shared->next = sSharedDictionaryAlgorithms;
+			sSharedDictionaryAlgorithms = shared;
+		}
+
+		_algorithm = algorithm;
+		return B_OK;
+	}
+
 	virtual status_t CreateCachedHeapReader(
 		PackageFileHeapReader* rawHeapReader,
 		BAbstractBufferedDataReader*& _cachedReader)
@@ -487,6 +584,60 @@ struct Package::CachingPackageReader : public PackageReaderImpl {
 		return B_OK;
 	}
 
+	/*!	Computes a CRC-32 over everything in the package file the content
+		handler is fed from: the header, the compressed heap chunks that
+		contain the TOC and the package attributes, which are at the end of
+		the heap, and everything following them, i.e. the chunk size table
+		and the TOC index, if any. Only that part of the file is read, and
+		nothing needs to be decompressed.
+	*/
+	status_t ComputeContentChecksum(uint32& _checksum)
+	{
+		struct stat st;
+		if (fstat(fFD, &st) != 0)
+			RETURN_ERROR(errno);
+
+		PackageFileHeapReader* heapReader = RawHeapReader();
+		uint64 chunkIndex = TOCSection().offset / heapReader->ChunkSize();
+		off_t offset = heapReader->HeapOffset()
+			+ heapReader->Offsets()[chunkIndex];
+		if (offset > st.st_size)
+			RETURN_ERROR(B_BAD_DATA);
+
+		uint8* buffer = (uint8*)malloc(kContentChecksumBufferSize);
+		if (buffer == NULL)
+			RETURN_ERROR(B_NO_MEMORY);
+		MemoryDeleter bufferDeleter(buffer);
+
+		// the header
+		size_t headerSize = min_c(heapReader->HeapOffset(),
+			(off_t)kContentChecksumBufferSize);
+		ssize_t bytesRead = pread(fFD, buffer, headerSize, 0);
+		if (bytesRead < 0)
+			RETURN_ERROR(errno);
+		if ((size_t)bytesRead != headerSize)
+			RETURN_ERROR(B_IO_ERROR);
+
+		uint32 checksum = crc32(0, buffer, headerSize);
+
+		// the end of the heap, and the rest of the file
+		while (offset < st.st_size) {
+			size_t toRead = min_c(st.st_size - offset,
+				(off_t)kContentChecksumBufferSize);
+			bytesRead = pread(fFD, buffer, toRead, offset);
+			if (bytesRead < 0)
+				RETURN_ERROR(errno);
+			if ((size_t)bytesRead != toRead)
+				RETURN_ERROR(B_IO_ERROR);
+
+			checksum = crc32(checksum, buffer, toRead);
+			offset += toRead;
+		}
+
+		_checksum = checksum;
+		return B_OK;
+	}
+
 	HeapReaderV2* DetachCachedHeapReader()
 	{
 		PackageFileHeapReader* rawHeapReader;
@@ -566,10 +717,21 @@ Package::Init(const char* fileName)
 }
 
 
+/*!	Loads the package's content.
+	If a \a recording is given and set, its content is used instead of parsing
+	the package file's TOC, provided that its content checksum still matches
+	the package file. Otherwise, if a \a recording is given, the content read
+	from the package file is recorded into it.
+	The content checksum covers the compressed TOC and package attributes
+	sections, including everything the reader needs to interpret them, but
+	not the file data, which a recording doesn't contain, so it is all that
+	needs to be read to make sure a recording is still valid.
+*/
 status_t
-Package::Load(const PackageSettings& settings)
+Package::Load(const PackageSettings& settings,
+	PackageContentRecording* recording)
 {
-	status_t error = _Load(settings);
+	status_t error = _Load(settings, recording);
 	if (error != B_OK)
 		return error;
 
@@ -712,7 +874,8 @@ Package::CreateDataReader(const PackageData& data,
 
 
 status_t
-Package::_Load(const PackageSettings& settings)
+Package::_Load(const PackageSettings& settings,
+	PackageContentRecording* recording)
 {
 	// open package file
 	int fd = Open();
@@ -729,15 +892,43 @@ Package::_Load(const PackageSettings& settings)
 		status_t error = packageReader.Init(fd, false,
 			BHPKG::B_HPKG_READER_DONT_PRINT_VERSION_MISMATCH_MESSAGE);
 		if (error == B_OK) {
-			// parse content
+			// parse content -- or replay it from the recording, in which
+			// case the reader is only needed to get us the heap reader
 			LoaderContentHandler handler(this, settings);
 			error = handler.Init();
 			if (error != B_OK)
 				RETURN_ERROR(error);
 
-			error = packageReader.ParseContent(&handler);
-			if (error != B_OK)
-				RETURN_ERROR(error);
+			uint32 contentChecksum = 0;
+			if (recording != NULL) {
+				error = packageReader.ComputeContentChecksum(contentChecksum);
+				if (error != B_OK)
+					RETURN_ERROR(error);
+
+				if (recording->IsSet()
+					&& recording->ContentChecksum() != contentChecksum) {
+					recording->Unset();
+				}
+			}
+
+			if (recording != NULL && recording->IsSet()) {
+				error = recording->Replay(&handler);
+				if (error != B_OK)
+					RETURN_ERROR(error);
+			} else if (recording != NULL) {
+				PackageContentRecorder recorder(&handler);
+				error = packageReader.ParseContent(&recorder);
+				if (error == B_OK)
+					error = recorder.Detach(*recording);
+				if (error != B_OK)
+					RETURN_ERROR(error);
+
+				recording->SetContentChecksum(contentChecksum);
+			} else {
+				error = packageReader.ParseContent(&handler);
+				if (error != B_OK)
+					RETURN_ERROR(error);
+			}
 
 			// get the heap reader
 			fHeapReader = packageReader.DetachCachedHeapReader();
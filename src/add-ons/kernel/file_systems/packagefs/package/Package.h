@@ -28,6 +28,7 @@ using BPackageKit::BPackageArchitecture;
 using BPackageKit::BHPKG::BAbstractBufferedDataReader;
 
 
+class PackageContentRecording;
 class PackageLinkDirectory;
 class PackagesDirectory;
 class PackageSettings;
@@ -44,7 +45,8 @@ public:
 								~Package();
 
 			status_t			Init(const char* fileName);
-			status_t			Load(const PackageSettings& settings);
+			status_t			Load(const PackageSettings& settings,
+									PackageContentRecording* recording = NULL);
 
 			::Volume*			Volume() const		{ return fVolume; }
 			const String&		FileName() const	{ return fFileName; }
@@ -117,7 +119,8 @@ private:
 			struct CachingPackageReader;
 
 private:
-			status_t			_Load(const PackageSettings& settings);
+			status_t			_Load(const PackageSettings& settings,
+									PackageContentRecording* recording);
 			bool				_InitVersionedName();
 
 private:
@@ -0,0 +1,688 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+#include "PackageContentRecording.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <new>
+
+#include <package/hpkg/HPKGDefs.h>
+#include <package/hpkg/PackageData.h>
+#include <package/hpkg/PackageEntry.h>
+#include <package/hpkg/PackageEntryAttribute.h>
+#include <package/hpkg/PackageInfoAttributeValue.h>
+
+#include "DebugSupport.h"
+
+
+using namespace BPackageKit;
+using BPackageKit::BHPKG::B_HPKG_MAX_INLINE_DATA_SIZE;
+using BPackageKit::BHPKG::BPackageResolvableData;
+using BPackageKit::BHPKG::BPackageResolvableExpressionData;
+
+
+static const size_t kInitialRecordingCapacity = 4096;
+
+enum {
+	RECORD_ENTRY				= 1,
+	RECORD_ENTRY_ATTRIBUTE		= 2,
+	RECORD_ENTRY_DONE			= 3,
+	RECORD_PACKAGE_ATTRIBUTE	= 4
+};
+
+enum {
+	RESOLVABLE_HAS_VERSION				= 0x01,
+	RESOLVABLE_HAS_COMPATIBLE_VERSION	= 0x02
+};
+
+
+// #pragma mark - Reader
+
+
+struct PackageContentRecording::Reader {
+	Reader(const uint8* data, size_t size)
+		:
+		fData(data),
+		fEnd(data + size)
+	{
+	}
+
+	bool HasMoreData() const
+	{
+		return fData < fEnd;
+	}
+
+	status_t ReadByte(uint8& _value)
+	{
+		if (fData >= fEnd)
+			RETURN_ERROR(B_BAD_DATA);
+
+		_value = *fData++;
+		return B_OK;
+	}
+
+	status_t ReadUnsigned(uint64& _value)
+	{
+		uint64 value = 0;
+		int shift = 0;
+		for (;;) {
+			uint8 byte;
+			status_t error = ReadByte(byte);
+			if (error != B_OK)
+				return error;
+
+			if (shift >= 64)
+				RETURN_ERROR(B_BAD_DATA);
+
+			value |= uint64(byte & 0x7f) << shift;
+			if ((byte & 0x80) == 0)
+				break;
+			shift += 7;
+		}
+
+		_value = value;
+		return B_OK;
+	}
+
+	status_t ReadString(const char*& _string)
+	{
+		// the length is stored + 1, 0 stands for NULL
+		uint64 length;
+		status_t error = ReadUnsigned(length);
+		if (error != B_OK)
+			return error;
+
+		if (length == 0) {
+			_string = NULL;
+			return B_OK;
+		}
+
+		// the string is stored null-terminated, so we can use it in place
+		if (length > (uint64)(fEnd - fData) || fData[length - 1] != '\0')
+			RETURN_ERROR(B_BAD_DATA);
+
+		_string = (const char*)fData;
+		fData += length;
+		return B_OK;
+	}
+
+	status_t ReadData(BPackageData& data)
+	{
+		uint64 size;
+		uint8 encodedInline;
+		status_t error = ReadUnsigned(size);
+		if (error == B_OK)
+			error = ReadByte(encodedInline);
+		if (error != B_OK)
+			return error;
+
+		if (encodedInline != 0) {
+			if (size > B_HPKG_MAX_INLINE_DATA_SIZE
+				|| size > (uint64)(fEnd - fData)) {
+				RETURN_ERROR(B_BAD_DATA);
+			}
+
+			data.SetData((uint8)size, fData);
+			fData += size;
+			return B_OK;
+		}
+
+		uint64 offset;
+		error = ReadUnsigned(offset);
+		if (error != B_OK)
+			return error;
+
+		data.SetData(size, offset);
+		return B_OK;
+	}
+
+	status_t ReadVersion(BPackageVersionData& version)
+	{
+		uint64 revision;
+		status_t error = ReadString(version.major);
+		if (error == B_OK)
+			error = ReadString(version.minor);
+		if (error == B_OK)
+			error = ReadString(version.micro);
+		if (error == B_OK)
+			error = ReadString(version.preRelease);
+		if (error == B_OK)
+			error = ReadUnsigned(revision);
+		if (error != B_OK)
+			return error;
+
+		version.revision = (uint32)revision;
+		return B_OK;
+	}
+
+private:
+	const uint8*	fData;
+	const uint8*	fEnd;
+};
+
+
+// #pragma mark - ReplayEntry
+
+
+struct PackageContentRecording::ReplayEntry {
+	ReplayEntry(ReplayEntry* parent, const char* name)
+		:
+		entry(parent != NULL ? &parent->entry : NULL, name),
+		parent(parent)
+	{
+	}
+
+	BPackageEntry	entry;
+	ReplayEntry*	parent;
+};
+
+
+// #pragma mark - PackageContentRecording
+
+
+PackageContentRecording::PackageContentRecording()
+	:
+	fData(NULL),
+	fSize(0),
+	fOwnedData(NULL),
+	fContentChecksum(0)
+{
+}
+
+
+PackageContentRecording::~PackageContentRecording()
+{
+	free(fOwnedData);
+}
+
+
+void
+PackageContentRecording::SetTo(const void* data, size_t size,
+	uint32 contentChecksum)
+{
+	Unset();
+
+	fData = (const uint8*)data;
+	fSize = size;
+	fContentChecksum = contentChecksum;
+}
+
+
+void
+PackageContentRecording::Adopt(void* data, size_t size)
+{
+	Unset();
+
+	fData = fOwnedData = (uint8*)data;
+	fSize = size;
+}
+
+
+void
+PackageContentRecording::Unset()
+{
+	free(fOwnedData);
+	fOwnedData = NULL;
+	fData = NULL;
+	fSize = 0;
+}
+
+
+status_t
+PackageContentRecording::Replay(BPackageContentHandler* handler) const
+{
+	if (fData == NULL)
+		RETURN_ERROR(B_NO_INIT);
+
+	Reader reader(fData, fSize);
+	ReplayEntry* currentEntry = NULL;
+	status_t error = B_OK;
+
+	while (error == B_OK && reader.HasMoreData()) {
+		uint8 recordType;
+		error = reader.ReadByte(recordType);
+		if (error != B_OK)
+			break;
+
+		switch (recordType) {
+			case RECORD_ENTRY:
+			{
+				const char* name;
+				uint64 mode;
+				uint64 modifiedTime;
+				uint64 modifiedTimeNanos;
+				error = reader.ReadString(name);
+				if (error == B_OK)
+					error = reader.ReadUnsigned(mode);
+				if (error == B_OK)
+					error = reader.ReadUnsigned(modifiedTime);
+				if (error == B_OK)
+					error = reader.ReadUnsigned(modifiedTimeNanos);
+				if (error != B_OK)
+					break;
+				if (name == NULL) {
+					error = B_BAD_DATA;
+					break;
+				}
+
+				ReplayEntry* entry
+					= new(std::nothrow) ReplayEntry(currentEntry, name);
+				if (entry == NULL) {
+					error = B_NO_MEMORY;
+					break;
+				}
+				currentEntry = entry;
+
+				entry->entry.SetType((uint32)mode);
+				entry->entry.SetPermissions((uint32)mode);
+				entry->entry.SetModifiedTime((uint32)modifiedTime);
+				entry->entry.SetModifiedTimeNanos((uint32)modifiedTimeNanos);
+
+				if (S_ISREG(mode)) {
+					error = reader.ReadData(entry->entry.Data());
+				} else if (S_ISLNK(mode)) {
+					const char* path;
+					error = reader.ReadString(path);
+					entry->entry.SetSymlinkPath(path);
+				}
+
+				if (error == B_OK)
+					error = handler->HandleEntry(&entry->entry);
+				break;
+			}
+
+			case RECORD_ENTRY_ATTRIBUTE:
+			{
+				const char* name;
+				uint64 type;
+				error = reader.ReadString(name);
+				if (error == B_OK)
+					error = reader.ReadUnsigned(type);
+				if (error != B_OK)
+					break;
+				if (name == NULL || currentEntry == NULL) {
+					error = B_BAD_DATA;
+					break;
+				}
+
+				BPackageEntryAttribute attribute(name);
+				attribute.SetType((uint32)type);
+				error = reader.ReadData(attribute.Data());
+				if (error == B_OK) {
+					error = handler->HandleEntryAttribute(&currentEntry->entry,
+						&attribute);
+				}
+				break;
+			}
+
+			case RECORD_ENTRY_DONE:
+			{
+				if (currentEntry == NULL) {
+					error = B_BAD_DATA;
+					break;
+				}
+
+				error = handler->HandleEntryDone(&currentEntry->entry);
+
+				ReplayEntry* entry = currentEntry;
+				currentEntry = entry->parent;
+				delete entry;
+				break;
+			}
+
+			case RECORD_PACKAGE_ATTRIBUTE:
+			{
+				uint64 id;
+				error = reader.ReadUnsigned(id);
+				if (error != B_OK)
+					break;
+
+				BPackageInfoAttributeValue value;
+				value.attributeID = (BPackageInfoAttributeID)id;
+
+				switch (id) {
+					case B_PACKAGE_INFO_NAME:
+					case B_PACKAGE_INFO_INSTALL_PATH:
+						error = reader.ReadString(value.string);
+						break;
+
+					case B_PACKAGE_INFO_VERSION:
+						error = reader.ReadVersion(value.version);
+						break;
+
+					case B_PACKAGE_INFO_FLAGS:
+					case B_PACKAGE_INFO_ARCHITECTURE:
+						error = reader.ReadUnsigned(value.unsignedInt);
+						break;
+
+					case B_PACKAGE_INFO_PROVIDES:
+					{
+						BPackageResolvableData& resolvable = value.resolvable;
+						uint8 flags;
+						error = reader.ReadString(resolvable.name);
+						if (error == B_OK)
+							error = reader.ReadByte(flags);
+						if (error != B_OK)
+							break;
+
+						resolvable.haveVersion
+							= (flags & RESOLVABLE_HAS_VERSION) != 0;
+						resolvable.haveCompatibleVersion
+							= (flags & RESOLVABLE_HAS_COMPATIBLE_VERSION) != 0;
+						if (resolvable.haveVersion)
+							error = reader.ReadVersion(resolvable.version);
+						if (error == B_OK && resolvable.haveCompatibleVersion) {
+							error = reader.ReadVersion(
+								resolvable.compatibleVersion);
+						}
+						break;
+					}
+
+					case B_PACKAGE_INFO_REQUIRES:
+					{
+						BPackageResolvableExpressionData& expression
+							= value.resolvableExpression;
+						uint8 haveOpAndVersion;
+						error = reader.ReadString(expression.name);
+						if (error == B_OK)
+							error = reader.ReadByte(haveOpAndVersion);
+						if (error != B_OK)
+							break;
+
+						expression.haveOpAndVersion = haveOpAndVersion != 0;
+						if (expression.haveOpAndVersion) {
+							uint64 op;
+							error = reader.ReadUnsigned(op);
+							if (error == B_OK) {
+								expression.op = (BPackageResolvableOperator)op;
+								error = reader.ReadVersion(expression.version);
+							}
+						}
+						break;
+					}
+
+					default:
+						error = B_BAD_DATA;
+						break;
+				}
+
+				if (error == B_OK)
+					error = handler->HandlePackageAttribute(value);
+				break;
+			}
+
+			default:
+				error = B_BAD_DATA;
+				break;
+		}
+	}
+
+	if (error == B_OK && currentEntry != NULL)
+		error = B_BAD_DATA;
+
+	while (currentEntry != NULL) {
+		ReplayEntry* entry = currentEntry;
+		currentEntry = entry->parent;
+		delete entry;
+	}
+
+	if (error != B_OK) {
+		handler->HandleErrorOccurred();
+		RETURN_ERROR(error);
+	}
+
+	return B_OK;
+}
+
+
+// #pragma mark - PackageContentRecorder
+
+
+PackageContentRecorder::PackageContentRecorder(BPackageContentHandler* target)
+	:
+	fTarget(target),
+	fData(NULL),
+	fSize(0),
+	fCapacity(0),
+	fError(B_OK)
+{
+}
+
+
+PackageContentRecorder::~PackageContentRecorder()
+{
+	free(fData);
+}
+
+
+status_t
+PackageContentRecorder::Detach(PackageContentRecording& recording)
+{
+	if (fError != B_OK)
+		return fError;
+
+	// trim the buffer to its actual size
+	uint8* data = (uint8*)realloc(fData, fSize);
+	if (data == NULL && fSize > 0)
+		data = fData;
+
+	recording.Adopt(data, fSize);
+	fData = NULL;
+	fSize = 0;
+	fCapacity = 0;
+	return B_OK;
+}
+
+
+status_t
+PackageContentRecorder::HandleEntry(BPackageEntry* entry)
+{
+	uint8 recordType = RECORD_ENTRY;
+	_Write(&recordType, 1);
+	_WriteString(entry->Name());
+	_WriteUnsigned(entry->Mode());
+	_WriteUnsigned((uint32)entry->ModifiedTime().tv_sec);
+	_WriteUnsigned((uint32)entry->ModifiedTime().tv_nsec);
+
+	if (S_ISREG(entry->Mode()))
+		_WriteData(entry->Data());
+	else if (S_ISLNK(entry->Mode()))
+		_WriteString(entry->SymlinkPath());
+
+	return fTarget->HandleEntry(entry);
+}
+
+
+status_t
+PackageContentRecorder::HandleEntryAttribute(BPackageEntry* entry,
+	BPackageEntryAttribute* attribute)
+{
+	uint8 recordType = RECORD_ENTRY_ATTRIBUTE;
+	_Write(&recordType, 1);
+	_WriteString(attribute->Name());
+	_WriteUnsigned(attribute->Type());
+	_WriteData(attribute->Data());
+
+	return fTarget->HandleEntryAttribute(entry, attribute);
+}
+
+
+status_t
+PackageContentRecorder::HandleEntryDone(BPackageEntry* entry)
+{
+	uint8 recordType = RECORD_ENTRY_DONE;
+	_Write(&recordType, 1);
+
+	return fTarget->HandleEntryDone(entry);
+}
+
+
+status_t
+PackageContentRecorder::HandlePackageAttribute(
+	const BPackageInfoAttributeValue& value)
+{
+	// only record the attributes packagefs is interested in
+	switch (value.attributeID) {
+		case B_PACKAGE_INFO_NAME:
+		case B_PACKAGE_INFO_INSTALL_PATH:
+		case B_PACKAGE_INFO_VERSION:
+		case B_PACKAGE_INFO_FLAGS:
+		case B_PACKAGE_INFO_ARCHITECTURE:
+		case B_PACKAGE_INFO_PROVIDES:
+		case B_PACKAGE_INFO_REQUIRES:
+			break;
+		default:
+			return fTarget->HandlePackageAttribute(value);
+	}
+
+	uint8 recordType = RECORD_PACKAGE_ATTRIBUTE;
+	_Write(&recordType, 1);
+	_WriteUnsigned(value.attributeID);
+
+	switch (value.attributeID) {
+		case B_PACKAGE_INFO_NAME:
+		case B_PACKAGE_INFO_INSTALL_PATH:
+			_WriteString(value.string);
+			break;
+
+		case B_PACKAGE_INFO_VERSION:
+			_WriteVersion(value.version);
+			break;
+
+		case B_PACKAGE_INFO_FLAGS:
+		case B_PACKAGE_INFO_ARCHITECTURE:
+			_WriteUnsigned(value.unsignedInt);
+			break;
+
+		case B_PACKAGE_INFO_PROVIDES:
+		{
+			const BPackageResolvableData& resolvable = value.resolvable;
+			uint8 flags = (resolvable.haveVersion ? RESOLVABLE_HAS_VERSION : 0)
+				| (resolvable.haveCompatibleVersion
+					? RESOLVABLE_HAS_COMPATIBLE_VERSION : 0);
+			_WriteString(resolvable.name);
+			_Write(&flags, 1);
+			if (resolvable.haveVersion)
+				_WriteVersion(resolvable.version);
+			if (resolvable.haveCompatibleVersion)
+				_WriteVersion(resolvable.compatibleVersion);
+			break;
+		}
+
+		case B_PACKAGE_INFO_REQUIRES:
+		{
+			const BPackageResolvableExpressionData& expression
+				= value.resolvableExpression;
+			uint8 haveOpAndVersion = expression.haveOpAndVersion ? 1 : 0;
+			_WriteString(expression.name);
+			_Write(&haveOpAndVersion, 1);
+			if (expression.haveOpAndVersion) {
+				_WriteUnsigned(expression.op);
+				_WriteVersion(expression.version);
+			}
+			break;
+		}
+
+		default:
+			break;
+	}
+
+	return fTarget->HandlePackageAttribute(value);
+}
+
+
+void
+PackageContentRecorder::HandleErrorOccurred()
+{
+	fError = B_ERROR;
+	fTarget->HandleErrorOccurred();
+}
+
+
+void
+PackageContentRecorder::_Write(const void* buffer, size_t size)
+{
+	if (fError != B_OK)
+		return;
+
+	if (fSize + size > fCapacity) {
+		size_t newCapacity = fCapacity > 0
+			? fCapacity * 2 : kInitialRecordingCapacity;
+		while (newCapacity < fSize + size)
+			newCapacity *= 2;
+
+		uint8* data = (uint8*)realloc(fData, newCapacity);
+		if (data == NULL) {
+			fError = B_NO_MEMORY;
+			return;
+		}
+
+		fData = data;
+		fCapacity = newCapacity;
+	}
+
+	memcpy(fData + fSize, buffer, size);
+	fSize += size;
+}
+
+
+void
+PackageContentRecorder::_WriteUnsigned(uint64 value)
+{
+	uint8 buffer[10];
+	size_t size = 0;
+	do {
+		uint8 byte = value & 0x7f;
+		value >>= 7;
+		if (value != 0)
+			byte |= 0x80;
+		buffer[size++] = byte;
+	} while (value != 0);
+
+	_Write(buffer, size);
+}
+
+
+void
+PackageContentRecorder::_WriteString(const char* string)
+{
+	// the length is stored + 1, 0 stands for NULL
+	if (string == NULL) {
+		_WriteUnsigned(0);
+		return;
+	}
+
+	size_t length = strlen(string) + 1;
+	_WriteUnsigned(length);
+	_Write(string, length);
+}
+
+
+void
+PackageContentRecorder::_WriteData(const BPackageData& data)
+{
+	uint8 encodedInline = data.IsEncodedInline() ? 1 : 0;
+	_WriteUnsigned(data.Size());
+	_Write(&encodedInline, 1);
+
+	if (data.IsEncodedInline())
+		_Write(data.InlineData(), data.Size());
+	else
+		_WriteUnsigned(data.Offset());
+}
+
+
+void
+PackageContentRecorder::_WriteVersion(const BPackageVersionData& version)
+{
+	_WriteString(version.major);
+	_WriteString(version.minor);
+	_WriteString(version.micro);
+	_WriteString(version.preRelease);
+	_WriteUnsigned(version.revision);
+}
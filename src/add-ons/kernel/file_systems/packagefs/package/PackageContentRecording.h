@@ -0,0 +1,105 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+#ifndef PACKAGE_CONTENT_RECORDING_H
+#define PACKAGE_CONTENT_RECORDING_H
+
+
+#include <package/hpkg/PackageContentHandler.h>
+#include <package/hpkg/PackageData.h>
+#include <package/hpkg/PackageInfoAttributeValue.h>
+
+
+using BPackageKit::BHPKG::BPackageContentHandler;
+using BPackageKit::BHPKG::BPackageData;
+using BPackageKit::BHPKG::BPackageEntry;
+using BPackageKit::BHPKG::BPackageEntryAttribute;
+using BPackageKit::BHPKG::BPackageInfoAttributeValue;
+using BPackageKit::BHPKG::BPackageVersionData;
+
+
+/*!	The content of a package, as it is passed to a content handler by the
+	package reader, in a compact pre-parsed form.
+	Replaying a recording is a lot cheaper than parsing the package's TOC,
+	since nothing needs to be read from the package file or decompressed.
+	Only the information packagefs uses is recorded.
+
+	A recording also stores the content checksum of the package file it was
+	made from (see Package::Load()), so it can be checked whether it still
+	matches the file.
+*/
+class PackageContentRecording {
+public:
+								PackageContentRecording();
+								~PackageContentRecording();
+
+			void				SetTo(const void* data, size_t size,
+									uint32 contentChecksum);
+									// data is not copied
+			void				Adopt(void* data, size_t size);
+									// takes over ownership of data
+			void				Unset();
+
+			bool				IsSet() const	{ return fData != NULL; }
+			const void*			Data() const	{ return fData; }
+			size_t				Size() const	{ return fSize; }
+
+			uint32				ContentChecksum() const
+									{ return fContentChecksum; }
+			void				SetContentChecksum(uint32 checksum)
+									{ fContentChecksum = checksum; }
+
+			status_t			Replay(BPackageContentHandler* handler) const;
+
+private:
+			struct Reader;
+			struct ReplayEntry;
+
+private:
+			const uint8*		fData;
+			size_t				fSize;
+			uint8*				fOwnedData;
+			uint32				fContentChecksum;
+};
+
+
+/*!	A content handler that records everything passed to it, before it
+	forwards it to another content handler.
+*/
+class PackageContentRecorder : public BPackageContentHandler {
+public:
+								PackageContentRecorder(
+									BPackageContentHandler* target);
+	virtual						~PackageContentRecorder();
+
+			status_t			Detach(PackageContentRecording& recording);
+
+	virtual	status_t			HandleEntry(BPackageEntry* entry);
+	virtual	status_t			HandleEntryAttribute(BPackageEntry* entry,
+									BPackageEntryAttribute* attribute);
+	virtual	status_t			HandleEntryDone(BPackageEntry* entry);
+
+	virtual	status_t			HandlePackageAttribute(
+									const BPackageInfoAttributeValue& value);
+
+	virtual	void				HandleErrorOccurred();
+
+private:
+			void				_Write(const void* buffer, size_t size);
+			void				_WriteUnsigned(uint64 value);
+			void				_WriteString(const char* string);
+			void				_WriteData(const BPackageData& data);
+			void				_WriteVersion(
+									const BPackageVersionData& version);
+
+private:
+			BPackageContentHandler* fTarget;
+			uint8*				fData;
+			size_t				fSize;
+			size_t				fCapacity;
+			status_t			fError;
+};
+
+
+#endif	// PACKAGE_CONTENT_RECORDING_H
@@ -7,6 +7,7 @@
 
 
 #include <slab/Slab.h>
+#include <util/atomic.h>
 
 
 #define CLASS_CACHE(CLASS) \
@@ -17,12 +18,22 @@
 	{ \
 		if (size != sizeof(CLASS)) \
 			panic("unexpected size passed to operator new!"); \
-		if (s##CLASS##Cache == NULL) { \
-			s##CLASS##Cache = create_object_cache("pkgfs " #CLASS "s", \
+		object_cache* cache = atomic_pointer_get(&s##CLASS##Cache); \
+		if (cache == NULL) { \
+			/* packages may be loaded concurrently, so we may race here */ \
+			cache = create_object_cache("pkgfs " #CLASS "s", \
 				sizeof(CLASS), CACHE_NO_DEPOT); \
+			if (cache == NULL) \
+				return NULL; \
+			object_cache* existingCache = atomic_pointer_test_and_set( \
+				&s##CLASS##Cache, cache, (object_cache*)NULL); \
+			if (existingCache != NULL) { \
+				delete_object_cache(cache); \
+				cache = existingCache; \
+			} \
 		} \
 	\
-		return object_cache_alloc(s##CLASS##Cache, 0); \
+		return object_cache_alloc(cache, 0); \
 	} \
 	\
 	void \
@@ -0,0 +1,388 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+#include "PackagesSnapshot.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <new>
+
+#include <zlib.h>
+
+#include <AutoDeleter.h>
+#include <AutoDeleterPosix.h>
+#include <syscalls.h>
+
+#include "DebugSupport.h"
+#include "PackageContentRecording.h"
+
+
+static const uint32 kSnapshotMagic = 'PkSn';
+static const uint32 kSnapshotVersion = 2;
+
+// sanity limit for the snapshot file size
+static const off_t kMaxSnapshotSize = 64 * 1024 * 1024;
+
+static const size_t kWriteBufferSize = 64 * 1024;
+
+
+struct packages_snapshot_header {
+	uint32	magic;
+	uint32	version;
+	uint32	package_count;
+	uint32	checksum;
+		// CRC-32 of everything following the header
+	uint64	size;
+		// total size of the file
+};
+
+
+struct packages_snapshot_package {
+	uint32	content_checksum;
+		// see Package::Load()
+	uint32	name_length;
+		// including the terminating null
+	uint64	recording_size;
+
+	// followed by the name and the recording, each padded to 8 bytes
+};
+
+
+static inline size_t
+snapshot_padding(size_t size)
+{
+	return (8 - size % 8) % 8;
+}
+
+
+// #pragma mark - PackagesSnapshot
+
+
+struct PackagesSnapshot::PackageEntry {
+	const packages_snapshot_package*	package;
+	const char*							name;
+	const uint8*						recording;
+};
+
+
+PackagesSnapshot::PackagesSnapshot()
+	:
+	fData(NULL),
+	fPackages(NULL),
+	fPackageCount(0)
+{
+}
+
+
+PackagesSnapshot::~PackagesSnapshot()
+{
+	free(fPackages);
+	free(fData);
+}
+
+
+status_t
+PackagesSnapshot::Read(int directoryFD, const char* path)
+{
+	FileDescriptorCloser fd(openat(directoryFD, path, O_RDONLY));
+	if (!fd.IsSet())
+		return errno;
+
+	struct stat st;
+	if (fstat(fd.Get(), &st) != 0)
+		RETURN_ERROR(errno);
+
+	if (st.st_size < (off_t)sizeof(packages_snapshot_header)
+		|| st.st_size > kMaxSnapshotSize) {
+		RETURN_ERROR(B_BAD_DATA);
+	}
+
+	uint8* data = (uint8*)malloc(st.st_size);
+	if (data == NULL)
+		RETURN_ERROR(B_NO_MEMORY);
+	MemoryDeleter dataDeleter(data);
+
+	ssize_t bytesRead = read(fd.Get(), data, st.st_size);
+	if (bytesRead < 0)
+		RETURN_ERROR(errno);
+	if (bytesRead != st.st_size)
+		RETURN_ERROR(B_BAD_DATA);
+
+	// check the header
+	const packages_snapshot_header* header
+		= (const packages_snapshot_header*)data;
+	if (header->magic != kSnapshotMagic || header->version != kSnapshotVersion
+		|| header->size != (uint64)st.st_size) {
+		RETURN_ERROR(B_BAD_DATA);
+	}
+
+	const uint8* contents = data + sizeof(packages_snapshot_header);
+	size_t contentsSize = st.st_size - sizeof(packages_snapshot_header);
+	if (crc32(0, contents, contentsSize) != header->checksum)
+		RETURN_ERROR(B_BAD_DATA);
+
+	if (header->package_count > contentsSize / sizeof(packages_snapshot_package))
+		RETURN_ERROR(B_BAD_DATA);
+
+	// index the packages
+	PackageEntry* packages = (PackageEntry*)malloc(
+		sizeof(PackageEntry) * (header->package_count + 1));
+	if (packages == NULL)
+		RETURN_ERROR(B_NO_MEMORY);
+	MemoryDeleter packagesDeleter(packages);
+
+	const uint8* position = contents;
+	const uint8* end = contents + contentsSize;
+	for (uint32 i = 0; i < header->package_count; i++) {
+		if ((size_t)(end - position) < sizeof(packages_snapshot_package))
+			RETURN_ERROR(B_BAD_DATA);
+
+		const packages_snapshot_package* package
+			= (const packages_snapshot_package*)position;
+		position += sizeof(packages_snapshot_package);
+
+		size_t nameSize = package->name_length
+			+ snapshot_padding(package->name_length);
+		if (package->name_length == 0
+			|| nameSize > (size_t)(end - position)
+			|| position[package->name_length - 1] != '\0') {
+			RETURN_ERROR(B_BAD_DATA);
+		}
+
+		packages[i].package = package;
+		packages[i].name = (const char*)position;
+		position += nameSize;
+
+		if (package->recording_size > (uint64)(end - position))
+			RETURN_ERROR(B_BAD_DATA);
+		size_t recordingSize = package->recording_size
+			+ snapshot_padding(package->recording_size);
+		if (recordingSize > (size_t)(end - position))
+			RETURN_ERROR(B_BAD_DATA);
+
+		packages[i].recording = position;
+		position += recordingSize;
+	}
+
+	free(fPackages);
+	free(fData);
+	fData = (uint8*)dataDeleter.Detach();
+	fPackages = (PackageEntry*)packagesDeleter.Detach();
+	fPackageCount = header->package_count;
+
+	return B_OK;
+}
+
+
+bool
+PackagesSnapshot::GetRecording(const char* fileName, int32 indexHint,
+	PackageContentRecording& recording) const
+{
+	// The packages are usually added in the same order they were written in,
+	// so check the hinted index first.
+	int32 index = -1;
+	if (indexHint >= 0 && indexHint < fPackageCount
+		&& strcmp(fPackages[indexHint].name, fileName) == 0) {
+		index = indexHint;
+	} else {
+		for (int32 i = 0; i < fPackageCount; i++) {
+			if (strcmp(fPackages[i].name, fileName) == 0) {
+				index = i;
+				break;
+			}
+		}
+	}
+
+	if (index < 0)
+		return false;
+
+	const PackageEntry& entry = fPackages[index];
+	recording.SetTo(entry.recording, entry.package->recording_size,
+		entry.package->content_checksum);
+	return true;
+}
+
+
+// #pragma mark - PackagesSnapshotWriter
+
+
+PackagesSnapshotWriter::PackagesSnapshotWriter()
+	:
+	fDirectoryFD(-1),
+	fPath(NULL),
+	fTempPath(NULL),
+	fFD(-1),
+	fBuffer(NULL),
+	fBufferSize(0),
+	fSize(0),
+	fChecksum(0),
+	fPackageCount(0)
+{
+}
+
+
+PackagesSnapshotWriter::~PackagesSnapshotWriter()
+{
+	if (fFD >= 0) {
+		// not finished -- remove the incomplete file
+		close(fFD);
+		unlinkat(fDirectoryFD, fTempPath, 0);
+	}
+
+	free(fTempPath);
+	free(fBuffer);
+}
+
+
+status_t
+PackagesSnapshotWriter::Init(int directoryFD, const char* path)
+{
+	fDirectoryFD = directoryFD;
+	fPath = path;
+
+	size_t tempPathSize = strlen(path) + 5;
+	fTempPath = (char*)malloc(tempPathSize);
+	fBuffer = (uint8*)malloc(kWriteBufferSize);
+	if (fTempPath == NULL || fBuffer == NULL)
+		RETURN_ERROR(B_NO_MEMORY);
+
+	// write to a temporary file first, so an incomplete snapshot never
+	// replaces a complete one
+	snprintf(fTempPath, tempPathSize, "%s.new", path);
+
+	fFD = openat(fDirectoryFD, fTempPath, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if (fFD < 0)
+		return errno;
+
+	// reserve space for the header, it is written when we're done
+	packages_snapshot_header header;
+	memset(&header, 0, sizeof(header));
+	memcpy(fBuffer, &header, sizeof(header));
+	fBufferSize = sizeof(header);
+	fSize = sizeof(header);
+
+	return B_OK;
+}
+
+
+status_t
+PackagesSnapshotWriter::AddPackage(const char* fileName,
+	const PackageContentRecording& recording)
+{
+	if (fFD < 0)
+		RETURN_ERROR(B_NO_INIT);
+
+	packages_snapshot_package package;
+	package.content_checksum = recording.ContentChecksum();
+	package.name_length = strlen(fileName) + 1;
+	package.recording_size = recording.Size();
+
+	static const uint8 kPadding[8] = {};
+
+	status_t error = _Write(&package, sizeof(package));
+	if (error == B_OK)
+		error = _Write(fileName, package.name_length);
+	if (error == B_OK)
+		error = _Write(kPadding, snapshot_padding(package.name_length));
+	if (error == B_OK)
+		error = _Write(recording.Data(), recording.Size());
+	if (error == B_OK)
+		error = _Write(kPadding, snapshot_padding(recording.Size()));
+	if (error != B_OK)
+		return error;
+
+	fPackageCount++;
+	return B_OK;
+}
+
+
+status_t
+PackagesSnapshotWriter::Finish()
+{
+	if (fFD < 0)
+		RETURN_ERROR(B_NO_INIT);
+
+	status_t error = _Flush();
+	if (error != B_OK)
+		return error;
+
+	packages_snapshot_header header;
+	header.magic = kSnapshotMagic;
+	header.version = kSnapshotVersion;
+	header.package_count = fPackageCount;
+	header.checksum = fChecksum;
+	header.size = fSize;
+
+	ssize_t bytesWritten = write_pos(fFD, 0, &header, sizeof(header));
+	if (bytesWritten < 0)
+		return errno;
+	if (bytesWritten != sizeof(header))
+		return B_IO_ERROR;
+
+	if (fsync(fFD) != 0)
+		return errno;
+
+	close(fFD);
+	fFD = -1;
+
+	error = _kern_rename(fDirectoryFD, fTempPath, fDirectoryFD, fPath);
+	if (error != B_OK) {
+		unlinkat(fDirectoryFD, fTempPath, 0);
+		return error;
+	}
+
+	return B_OK;
+}
+
+
+status_t
+PackagesSnapshotWriter::_Write(const void* buffer, size_t size)
+{
+	if (size == 0)
+		return B_OK;
+
+	fChecksum = crc32(fChecksum, (const uint8*)buffer, size);
+	fSize += size;
+
+	while (size > 0) {
+		if (fBufferSize == kWriteBufferSize) {
+			status_t error = _Flush();
+			if (error != B_OK)
+				return error;
+		}
+
+		size_t toCopy = min_c(size, kWriteBufferSize - fBufferSize);
+		memcpy(fBuffer + fBufferSize, buffer, toCopy);
+		fBufferSize += toCopy;
+		buffer = (const uint8*)buffer + toCopy;
+		size -= toCopy;
+	}
+
+	return B_OK;
+}
+
+
+status_t
+PackagesSnapshotWriter::_Flush()
+{
+	if (fBufferSize == 0)
+		return B_OK;
+
+	ssize_t bytesWritten = write(fFD, fBuffer, fBufferSize);
+	if (bytesWritten < 0)
+		return errno;
+	if ((size_t)bytesWritten != fBufferSize)
+		return B_IO_ERROR;
+
+	fBufferSize = 0;
+	return B_OK;
+}
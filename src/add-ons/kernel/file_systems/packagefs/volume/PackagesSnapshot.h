@@ -0,0 +1,72 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+#ifndef PACKAGES_SNAPSHOT_H
+#define PACKAGES_SNAPSHOT_H
+
+
+#include <SupportDefs.h>
+
+
+class PackageContentRecording;
+
+
+/*!	A file containing the content recordings of a set of packages.
+	The snapshot of the activated packages is written when the volume is
+	mounted, and used at the next mount to avoid parsing the TOCs of all
+	packages that haven't changed in the meantime.
+*/
+class PackagesSnapshot {
+public:
+								PackagesSnapshot();
+								~PackagesSnapshot();
+
+			status_t			Read(int directoryFD, const char* path);
+
+			int32				CountPackages() const
+									{ return fPackageCount; }
+			bool				GetRecording(const char* fileName,
+									int32 indexHint,
+									PackageContentRecording& recording) const;
+									// the recording refers to the
+									// snapshot's data
+
+private:
+			struct PackageEntry;
+
+private:
+			uint8*				fData;
+			PackageEntry*		fPackages;
+			int32				fPackageCount;
+};
+
+
+class PackagesSnapshotWriter {
+public:
+								PackagesSnapshotWriter();
+								~PackagesSnapshotWriter();
+
+			status_t			Init(int directoryFD, const char* path);
+			status_t			AddPackage(const char* fileName,
+									const PackageContentRecording& recording);
+			status_t			Finish();
+
+private:
+			status_t			_Write(const void* buffer, size_t size);
+			status_t			_Flush();
+
+private:
+			int					fDirectoryFD;
+			const char*			fPath;
+			char*				fTempPath;
+			int					fFD;
+			uint8*				fBuffer;
+			size_t				fBufferSize;
+			uint64				fSize;
+			uint32				fChecksum;
+			uint32				fPackageCount;
+};
+
+
+#endif	// PACKAGES_SNAPSHOT_H
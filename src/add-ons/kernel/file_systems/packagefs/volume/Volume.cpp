@@ -26,17 +26,22 @@
 #include <AutoDeleterDrivers.h>
 #include <PackagesDirectoryDefs.h>
 
+#include <smp.h>
+#include <util/Vector.h>
 #include <vfs.h>
 
 #include "AttributeIndex.h"
 #include "DebugSupport.h"
+#include "DecompressedChunkCache.h"
 #include "kernel_interface.h"
 #include "LastModifiedIndex.h"
 #include "NameIndex.h"
 #include "OldUnpackingNodeAttributes.h"
+#include "PackageContentRecording.h"
 #include "PackageFSRoot.h"
 #include "PackageLinkDirectory.h"
 #include "PackageLinksDirectory.h"
+#include "PackagesSnapshot.h"
 #include "Resolvable.h"
 #include "SizeIndex.h"
 #include "UnpackingLeafNode.h"
@@ -63,6 +68,12 @@ const size_t kMaxActivationRequestSize = 10 * 1024 * 1024;
 // sanity limit for activation file size
 const size_t kMaxActivationFileSize = 10 * 1024 * 1024;
 
+// upper limit for the number of threads loading the initial packages
+static const int32 kMaxInitialPackageLoaderThreads = 8;
+
+// name of the (kernel) driver settings file with debug settings
+static const char* const kDriverSettingsName = "packagefs";
+
 static const char* const kAdministrativeDirectoryName
 	= PACKAGES_DIRECTORY_ADMIN_DIRECTORY;
 static const char* const kActivationFileName
@@ -70,6 +81,41 @@ static const char* const kActivationFileName
 static const char* const kActivationFilePath
 	= PACKAGES_DIRECTORY_ADMIN_DIRECTORY "/"
 		PACKAGES_DIRECTORY_ACTIVATION_FILE;
+static const char* const kSnapshotFilePath
+	= PACKAGES_DIRECTORY_ADMIN_DIRECTORY "/packagefs-snapshot";
+
+
+static void
+get_initial_package_loading_settings(int32& _threadCount, bool& _useSnapshot,
+	bool& _printTimes)
+{
+	_threadCount = min_c(smp_get_num_cpus(), kMaxInitialPackageLoaderThreads);
+	_useSnapshot = true;
+	_printTimes = false;
+
+	DriverSettingsUnloader settingsHandle(
+		load_driver_settings(kDriverSettingsName));
+	if (!settingsHandle.IsSet())
+		return;
+
+	// "load_threads <count>" overrides the number of loader threads, 1
+	// disables concurrent loading
+	const char* threads = get_driver_parameter(settingsHandle.Get(),
+		"load_threads", NULL, NULL);
+	if (threads != NULL) {
+		_threadCount = max_c(1, min_c((int32)strtol(threads, NULL, 0),
+			kMaxInitialPackageLoaderThreads));
+	}
+
+	// "use_snapshot false" disables reading and writing the packages snapshot
+	_useSnapshot = get_driver_boolean_parameter(settingsHandle.Get(),
+		"use_snapshot", true, true);
+
+	// "print_load_times true" prints where the time mounting the volume was
+	// spent
+	_printTimes = get_driver_boolean_parameter(settingsHandle.Get(),
+		"print_load_times", false, true);
+}
 
 
 // #pragma mark - ShineThroughDirectory
@@ -161,6 +207,194 @@ private:
 };
 
 
+// #pragma mark - InitialPackageLoader
+
+
+/*!	Loads the packages that are present at mount time.
+	Parsing the package files is by far the most expensive part of mounting
+	the volume, and it is independent for every package, so it is distributed
+	over a number of threads. Adding the loaded packages to the volume is left
+	to the caller, and done in the order the packages were added here.
+
+	If a snapshot is set, the recorded content of packages that haven't
+	changed since the snapshot was written is used instead of parsing their
+	TOCs, and the content of all others is recorded, so that a new snapshot
+	can be written.
+*/
+struct Volume::InitialPackageLoader {
+public:
+	struct Item {
+		String		name;
+		Package*	package;
+		status_t	error;
+		bigtime_t	loadTime;
+		bool		usedSnapshot;
+	};
+
+public:
+	InitialPackageLoader(Volume* volume, PackagesDirectory* packagesDirectory)
+		:
+		fVolume(volume),
+		fPackagesDirectory(packagesDirectory),
+		fItems(16),
+		fNextItem(0),
+		fSnapshot(NULL),
+		fRecordings(NULL)
+	{
+	}
+
+	~InitialPackageLoader()
+	{
+		for (int32 i = 0; i < fItems.Count(); i++) {
+			if (fItems[i].package != NULL)
+				fItems[i].package->ReleaseReference();
+		}
+
+		delete[] fRecordings;
+	}
+
+	PackagesDirectory* Directory() const
+	{
+		return fPackagesDirectory;
+	}
+
+	/*!	Enables recording the packages' content. Must be called after all
+		packages have been added and before Load().
+		\param snapshot Optional snapshot providing the recordings of
+			unchanged packages. Must live as long as the recordings are used.
+	*/
+	status_t SetSnapshot(const PackagesSnapshot* snapshot)
+	{
+		fRecordings = new(std::nothrow)
+			PackageContentRecording[max_c(fItems.Count(), 1)];
+		if (fRecordings == NULL)
+			RETURN_ERROR(B_NO_MEMORY);
+
+		fSnapshot = snapshot;
+		return B_OK;
+	}
+
+	const PackageContentRecording* RecordingAt(int32 index) const
+	{
+		return fRecordings != NULL ? &fRecordings[index] : NULL;
+	}
+
+	status_t AddPackage(const char* name)
+	{
+		Item item;
+		if (!item.name.SetTo(name))
+			RETURN_ERROR(B_NO_MEMORY);
+		item.package = NULL;
+		item.error = B_OK;
+		item.loadTime = 0;
+		item.usedSnapshot = false;
+
+		return fItems.Add(item);
+	}
+
+	int32 CountItems() const
+	{
+		return fItems.Count();
+	}
+
+	const Item& ItemAt(int32 index) const
+	{
+		return fItems[index];
+	}
+
+	/*!	Loads all packages. Errors loading individual packages are not
+		returned, but stored in the respective item.
+		\param threadCount The maximum number of threads to use, including the
+			calling one.
+		\return The number of threads that were actually used.
+	*/
+	int32 Load(int32 threadCount)
+	{
+		if (threadCount > fItems.Count())
+			threadCount = fItems.Count();
+
+		thread_id threads[kMaxInitialPackageLoaderThreads];
+		int32 spawnedCount = 0;
+		for (int32 i = 1; i < threadCount
+				&& spawnedCount < kMaxInitialPackageLoaderThreads; i++) {
+			thread_id thread = spawn_kernel_thread(&_LoaderThreadEntry,
+				"packagefs package loader", B_NORMAL_PRIORITY, this);
+			if (thread < 0)
+				break;
+
+			resume_thread(thread);
+			threads[spawnedCount++] = thread;
+		}
+
+		// the calling thread does its share of the work as well
+		_LoadPackages();
+
+		for (int32 i = 0; i < spawnedCount; i++)
+			wait_for_thread(threads[i], NULL);
+
+		return spawnedCount + 1;
+	}
+
+	/*!	Detaches the loaded package of the given item. The caller gets the
+		loader's reference.
+	*/
+	Package* DetachPackage(int32 index)
+	{
+		Package* package = fItems[index].package;
+		fItems[index].package = NULL;
+		return package;
+	}
+
+private:
+	static status_t _LoaderThreadEntry(void* data)
+	{
+		((InitialPackageLoader*)data)->_LoadPackages();
+		return B_OK;
+	}
+
+	void _LoadPackages()
+	{
+		for (;;) {
+			int32 index = atomic_add(&fNextItem, 1);
+			if (index >= fItems.Count())
+				break;
+
+			Item& item = fItems[index];
+			bigtime_t startTime = system_time();
+
+			PackageContentRecording* recording = NULL;
+			const void* snapshotData = NULL;
+			if (fRecordings != NULL) {
+				recording = &fRecordings[index];
+				if (fSnapshot != NULL
+					&& fSnapshot->GetRecording(item.name, index, *recording)) {
+					snapshotData = recording->Data();
+				}
+			}
+
+			item.error = fVolume->_LoadPackage(fPackagesDirectory, item.name,
+				item.package, recording);
+			item.loadTime = system_time() - startTime;
+			item.usedSnapshot = snapshotData != NULL
+				&& recording->Data() == snapshotData;
+			if (item.error != B_OK) {
+				ERROR("Failed to load package \"%s\": %s\n", item.name.Data(),
+					strerror(item.error));
+				item.package = NULL;
+			}
+		}
+	}
+
+private:
+	Volume*				fVolume;
+	PackagesDirectory*	fPackagesDirectory;
+	Vector<Item>		fItems;
+	int32				fNextItem;
+	const PackagesSnapshot* fSnapshot;
+	PackageContentRecording* fRecordings;
+};
+
+
 // #pragma mark - Volume
 
 
@@ -173,7 +407,10 @@ Volume::Volume(fs_volume* fsVolume)
 	fPackagesDirectories(),
 	fPackagesDirectoriesByNodeRef(),
 	fPackageSettings(),
-	fNextNodeID(kRootDirectoryID + 1)
+	fNextNodeID(kRootDirectoryID + 1),
+	fInitialPackageLoaderThreads(1),
+	fUseSnapshot(false),
+	fPrintLoadTimes(false)
 {
 	rw_lock_init(&fLock, "packagefs volume");
 }
@@ -559,6 +796,18 @@ Volume::IOCtl(Node* node, uint32 operation, void* buffer, size_t size)
 			return _ChangeActivation(request);
 		}
 
+		case PACKAGE_FS_OPERATION_GET_CHUNK_CACHE_STATISTICS:
+		{
+			if (size < sizeof(PackageFSChunkCacheStatistics))
+				RETURN_ERROR(B_BAD_VALUE);
+
+			PackageFSChunkCacheStatistics statistics;
+			DecompressedChunkCache::GetStatistics(statistics);
+
+			RETURN_ERROR(user_memcpy(buffer, &statistics,
+				sizeof(statistics)));
+		}
+
 		default:
 			return B_BAD_VALUE;
 	}
@@ -758,6 +1007,11 @@ Volume::_AddInitialPackages()
 	PackagesDirectory* packagesDirectory = fPackagesDirectories.Last();
 	INFORM("Adding packages from \"%s\"\n", packagesDirectory->Path());
 
+	get_initial_package_loading_settings(fInitialPackageLoaderThreads,
+		fUseSnapshot, fPrintLoadTimes);
+
+	bigtime_t startTime = system_time();
+
 	// try reading the activation file of the oldest state
 	status_t error = _AddInitialPackagesFromActivationFile(packagesDirectory);
 	if (error != B_OK && packagesDirectory != fPackagesDirectory) {
@@ -797,6 +1051,8 @@ Volume::_AddInitialPackages()
 			RETURN_ERROR(error);
 	}
 
+	bigtime_t loadedTime = system_time();
+
 	// add the packages to the node tree
 	VolumeWriteLocker systemVolumeLocker(_SystemVolumeIfNotSelf());
 	VolumeWriteLocker volumeLocker(this);
@@ -813,6 +1069,14 @@ Volume::_AddInitialPackages()
 		}
 	}
 
+	if (fPrintLoadTimes) {
+		bigtime_t endTime = system_time();
+		INFORM("Added %" B_PRIuSIZE " packages in %" B_PRIdBIGTIME " ms: "
+			"loading %" B_PRIdBIGTIME " ms, adding content %" B_PRIdBIGTIME
+			" ms\n", fPackages.CountElements(), (endTime - startTime) / 1000,
+			(loadedTime - startTime) / 1000, (endTime - loadedTime) / 1000);
+	}
+
 	return B_OK;
 }
 
@@ -865,6 +1129,7 @@ Volume::_AddInitialPackagesFromActivationFile(
 	fileContent[st.st_size] = '\0';
 
 	// parse the file and add the respective packages
+	InitialPackageLoader loader(this, packagesDirectory);
 	const char* packageName = fileContent;
 	char* const fileContentEnd = fileContent + st.st_size;
 	while (packageName < fileContentEnd) {
@@ -884,15 +1149,14 @@ Volume::_AddInitialPackagesFromActivationFile(
 			RETURN_ERROR(B_BAD_DATA);
 		}
 
-		status_t error = _LoadAndAddInitialPackage(packagesDirectory,
-			packageName);
+		status_t error = loader.AddPackage(packageName);
 		if (error != B_OK)
 			RETURN_ERROR(error);
 
 		packageName = packageNameEnd + 1;
 	}
 
-	return B_OK;
+	return _LoadAndAddInitialPackages(loader, false);
 }
 
 
@@ -913,6 +1177,7 @@ Volume::_AddInitialPackagesFromDirectory()
 		RETURN_ERROR(errno);
 	}
 
+	InitialPackageLoader loader(this, fPackagesDirectory);
 	while (dirent* entry = readdir(dir.Get())) {
 		// skip "." and ".."
 		if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0)
@@ -925,33 +1190,143 @@ Volume::_AddInitialPackagesFromDirectory()
 			continue;
 		}
 
-		_LoadAndAddInitialPackage(fPackagesDirectory, entry->d_name);
+		status_t error = loader.AddPackage(entry->d_name);
+		if (error != B_OK)
+			RETURN_ERROR(error);
 	}
 
-	return B_OK;
+	return _LoadAndAddInitialPackages(loader, true);
 }
 
 
+/*!	Loads the packages of the given loader and adds them to the volume (not
+	yet to the node tree, though).
+	\param ignoreErrors If \c false, the packages are only added, if all of
+		them could be loaded.
+*/
 status_t
-Volume::_LoadAndAddInitialPackage(PackagesDirectory* packagesDirectory,
-	const char* name)
+Volume::_LoadAndAddInitialPackages(InitialPackageLoader& loader,
+	bool ignoreErrors)
 {
-	Package* package;
-	status_t error = _LoadPackage(packagesDirectory, name, package);
-	if (error != B_OK) {
-		ERROR("Failed to load package \"%s\": %s\n", name, strerror(error));
-		RETURN_ERROR(error);
+	bigtime_t startTime = system_time();
+
+	// The snapshot is only used for the latest state. Its recordings are
+	// independent of the package settings, so those may change freely.
+	PackagesSnapshot snapshot;
+	bool useSnapshot = fUseSnapshot
+		&& loader.Directory() == fPackagesDirectory;
+	if (useSnapshot) {
+		status_t error = snapshot.Read(fPackagesDirectory->DirectoryFD(),
+			kSnapshotFilePath);
+		if (error != B_OK && error != B_ENTRY_NOT_FOUND) {
+			INFORM("Failed to read packages snapshot: %s\n",
+				strerror(error));
+		}
+
+		error = loader.SetSnapshot(error == B_OK ? &snapshot : NULL);
+		if (error != B_OK)
+			RETURN_ERROR(error);
+	}
+
+	int32 threadCount = loader.Load(fInitialPackageLoaderThreads);
+
+	int32 itemCount = loader.CountItems();
+	int32 loadedCount = 0;
+	int32 snapshotCount = 0;
+	for (int32 i = 0; i < itemCount; i++) {
+		if (loader.ItemAt(i).package != NULL)
+			loadedCount++;
+		if (loader.ItemAt(i).usedSnapshot)
+			snapshotCount++;
+	}
+
+	if (fPrintLoadTimes) {
+		bigtime_t totalLoadTime = 0;
+		int32 slowestIndex = -1;
+		for (int32 i = 0; i < itemCount; i++) {
+			const InitialPackageLoader::Item& item = loader.ItemAt(i);
+			totalLoadTime += item.loadTime;
+			if (slowestIndex < 0
+				|| item.loadTime > loader.ItemAt(slowestIndex).loadTime) {
+				slowestIndex = i;
+			}
+		}
+
+		INFORM("Loaded %" B_PRId32 " packages (%" B_PRId32 " from snapshot) "
+			"using %" B_PRId32 " threads in %" B_PRIdBIGTIME " ms (%"
+			B_PRIdBIGTIME " ms accumulated)\n", itemCount, snapshotCount,
+			threadCount, (system_time() - startTime) / 1000,
+			totalLoadTime / 1000);
+		if (slowestIndex >= 0) {
+			const InitialPackageLoader::Item& item
+				= loader.ItemAt(slowestIndex);
+			INFORM("  slowest package: \"%s\" (%" B_PRIdBIGTIME " ms)\n",
+				item.name.Data(), item.loadTime / 1000);
+		}
+	}
+
+	if (!ignoreErrors) {
+		for (int32 i = 0; i < itemCount; i++) {
+			if (loader.ItemAt(i).error != B_OK)
+				RETURN_ERROR(loader.ItemAt(i).error);
+		}
+	}
+
+	// write a new snapshot, if anything changed
+	if (useSnapshot && (snapshotCount != loadedCount
+			|| snapshot.CountPackages() != loadedCount)) {
+		bigtime_t snapshotStartTime = system_time();
+		status_t error = _WriteSnapshot(loader);
+		if (error != B_OK) {
+			INFORM("Failed to write packages snapshot: %s\n",
+				strerror(error));
+		} else if (fPrintLoadTimes) {
+			INFORM("Wrote packages snapshot in %" B_PRIdBIGTIME " ms\n",
+				(system_time() - snapshotStartTime) / 1000);
+		}
 	}
-	BReference<Package> packageReference(package, true);
 
 	VolumeWriteLocker systemVolumeLocker(_SystemVolumeIfNotSelf());
 	VolumeWriteLocker volumeLocker(this);
-	_AddPackage(package);
+	for (int32 i = 0; i < itemCount; i++) {
+		Package* package = loader.DetachPackage(i);
+		if (package == NULL)
+			continue;
+
+		_AddPackage(package);
+		package->ReleaseReference();
+			// _AddPackage() acquired its own reference
+	}
 
 	return B_OK;
 }
 
 
+status_t
+Volume::_WriteSnapshot(const InitialPackageLoader& loader)
+{
+	PackagesSnapshotWriter writer;
+	status_t error = writer.Init(fPackagesDirectory->DirectoryFD(),
+		kSnapshotFilePath);
+	if (error != B_OK)
+		return error;
+
+	for (int32 i = 0; i < loader.CountItems(); i++) {
+		const PackageContentRecording* recording = loader.RecordingAt(i);
+		if (loader.ItemAt(i).package == NULL || recording == NULL
+			|| !recording->IsSet()) {
+			continue;
+		}
+
+		error = writer.AddPackage(loader.ItemAt(i).name, *recording);
+		if (error != B_OK)
+			return error;
+	}
+
+	return writer.Finish();
+}
+
+
 inline void
 Volume::_AddPackage(Package* package)
 {
@@ -1505,9 +1880,14 @@ Volume::_RemoveNodeAndVNode(Node* node)
 }
 
 
+/*!	Loads the package with the given file name.
+	\param recording If not \c NULL, the package's content is recorded into
+		it. If it is already set and matches the package file's content, it
+		is replayed instead of parsing the package file's TOC.
+*/
 status_t
 Volume::_LoadPackage(PackagesDirectory* packagesDirectory, const char* name,
-	Package*& _package)
+	Package*& _package, PackageContentRecording* recording)
 {
 	// Find the package -- check the specified packages directory and iterate
 	// toward the newer states.
@@ -1526,23 +1906,34 @@ Volume::_LoadPackage(PackagesDirectory* packagesDirectory, const char* name,
 		packagesDirectory = fPackagesDirectories.GetPrevious(packagesDirectory);
 	}
 
-	// create a package
-	Package* package = new(std::nothrow) Package(this, packagesDirectory,
-		st.st_dev, st.st_ino);
-	if (package == NULL)
-		RETURN_ERROR(B_NO_MEMORY);
-	BReference<Package> packageReference(package, true);
+	for (;;) {
+		// create a package
+		Package* package = new(std::nothrow) Package(this, packagesDirectory,
+			st.st_dev, st.st_ino);
+		if (package == NULL)
+			RETURN_ERROR(B_NO_MEMORY);
+		BReference<Package> packageReference(package, true);
 
-	status_t error = package->Init(name);
-	if (error != B_OK)
-		return error;
+		status_t error = package->Init(name);
+		if (error != B_OK)
+			return error;
 
-	error = package->Load(fPackageSettings);
-	if (error != B_OK)
-		return error;
+		bool replaying = recording != NULL && recording->IsSet();
+		error = package->Load(fPackageSettings, recording);
+		if (error != B_OK) {
+			if (replaying) {
+				// The recording is broken -- parse the package instead.
+				ERROR("Failed to replay recorded content of package \"%s\": "
+					"%s\n", name, strerror(error));
+				recording->Unset();
+				continue;
+			}
+			return error;
+		}
 
-	_package = packageReference.Detach();
-	return B_OK;
+		_package = packageReference.Detach();
+		return B_OK;
+	}
 }
 
 
@@ -27,6 +27,7 @@
 
 
 class Directory;
+class PackageContentRecording;
 class PackageFSRoot;
 class PackagesDirectory;
 class UnpackingNode;
@@ -109,6 +110,7 @@ private:
 private:
 			struct ShineThroughDirectory;
 			struct ActivationChangeRequest;
+			struct InitialPackageLoader;
 
 private:
 			status_t			_LoadOldPackagesStates(
@@ -118,9 +120,11 @@ private:
 			status_t			_AddInitialPackagesFromActivationFile(
 									PackagesDirectory* packagesDirectory);
 			status_t			_AddInitialPackagesFromDirectory();
-			status_t			_LoadAndAddInitialPackage(
-									PackagesDirectory* packagesDirectory,
-									const char* name);
+			status_t			_LoadAndAddInitialPackages(
+									InitialPackageLoader& loader,
+									bool ignoreErrors);
+			status_t			_WriteSnapshot(
+									const InitialPackageLoader& loader);
 
 	inline	void				_AddPackage(Package* package);
 	inline	void				_RemovePackage(Package* package);
@@ -155,7 +159,9 @@ private:
 
 			status_t			_LoadPackage(
 									PackagesDirectory* packagesDirectory,
-									const char* name, Package*& _package);
+									const char* name, Package*& _package,
+									PackageContentRecording* recording
+										= NULL);
 
 			status_t			_ChangeActivation(
 									ActivationChangeRequest& request);
@@ -203,6 +209,10 @@ private:
 			IndexHashTable		fIndices;
 
 			ino_t				fNextNodeID;
+
+			int32				fInitialPackageLoaderThreads;
+			bool				fUseSnapshot;
+			bool				fPrintLoadTimes;
 };
 
 
@@ -66,6 +66,14 @@ uint32 calculate_crc32c(uint32 crc32c, const unsigned char *buffer,
 
 #endif
 
+#if (defined(__x86_64__) || defined(__i386__)) && __GNUC__ >= 4
+#	include <cpuid.h>
+#	define HARDWARE_CRC32C_X86
+#elif defined(__aarch64__) && defined(__ARM_FEATURE_CRC32)
+#	include <arm_acle.h>
+#	define HARDWARE_CRC32C_ARM
+#endif
+
 
 const uint32 crc32_tab[] = {
 	0x00000000, 0x77073096, 0xee0e612c, 0x990951ba, 0x076dc419, 0x706af48f,
@@ -761,11 +769,92 @@ multitable_crc32c(uint32 crc32c,
 	return (crc32c_sb8_64_bit(crc32c, buffer, length, to_even_word));
 }
 
+#ifdef HARDWARE_CRC32C_X86
+/*
+ * SSE4.2 has an instruction that calculates the CRC32C of up to eight bytes
+ * at a time; since it only uses general purpose registers, it can also be
+ * used in the kernel without saving the FPU state.
+ */
+static int sHasHardwareCRC32C = -1;
+
+static bool
+has_hardware_crc32c()
+{
+	if (sHasHardwareCRC32C < 0) {
+		unsigned int eax, ebx, ecx, edx;
+		sHasHardwareCRC32C = __get_cpuid(1, &eax, &ebx, &ecx, &edx) != 0
+			&& (ecx & bit_SSE4_2) != 0;
+	}
+	return sHasHardwareCRC32C != 0;
+}
+
+static uint32
+hardware_crc32c(uint32 crc32c,
+    const unsigned char *buffer,
+    unsigned int length)
+{
+	while (length > 0 && ((uintptr_t)buffer & 7) != 0) {
+		__asm__("crc32b %1, %0" : "+r" (crc32c) : "rm" (*buffer));
+		buffer++;
+		length--;
+	}
+#ifdef __x86_64__
+	uint64 crc64 = crc32c;
+	for (; length >= 8; buffer += 8, length -= 8) {
+		__asm__("crc32q %1, %0" : "+r" (crc64)
+			: "rm" (*(const uint64 *)buffer));
+	}
+	crc32c = (uint32)crc64;
+#endif
+	for (; length >= 4; buffer += 4, length -= 4) {
+		__asm__("crc32l %1, %0" : "+r" (crc32c)
+			: "rm" (*(const uint32 *)buffer));
+	}
+	for (; length > 0; buffer++, length--)
+		__asm__("crc32b %1, %0" : "+r" (crc32c) : "rm" (*buffer));
+
+	return (crc32c);
+}
+#endif	/* HARDWARE_CRC32C_X86 */
+
+#ifdef HARDWARE_CRC32C_ARM
+/*
+ * The CRC32 extension is optional in ARMv8.0, so it is only used when the
+ * compiler was told that the target supports it.
+ */
+static inline bool
+has_hardware_crc32c()
+{
+	return true;
+}
+
+static uint32
+hardware_crc32c(uint32 crc32c,
+    const unsigned char *buffer,
+    unsigned int length)
+{
+	while (length > 0 && ((uintptr_t)buffer & 7) != 0) {
+		crc32c = __crc32cb(crc32c, *buffer++);
+		length--;
+	}
+	for (; length >= 8; buffer += 8, length -= 8)
+		crc32c = __crc32cd(crc32c, *(const uint64 *)buffer);
+	for (; length > 0; buffer++, length--)
+		crc32c = __crc32cb(crc32c, *buffer);
+
+	return (crc32c);
+}
+#endif	/* HARDWARE_CRC32C_ARM */
+
 uint32
 calculate_crc32c(uint32 crc32c,
     const unsigned char *buffer,
     unsigned int length)
 {
+#if defined(HARDWARE_CRC32C_X86) || defined(HARDWARE_CRC32C_ARM)
+	if (has_hardware_crc32c())
+		return (hardware_crc32c(crc32c, buffer, length));
+#endif
 	if (length < 4) {
 		return (singletable_crc32c(crc32c, buffer, length));
 	} else {
@@ -448,6 +448,21 @@ tunnel_receive_data(net_device* _device, net_buffer** _buffer)
 }
 
 
+status_t
+tunnel_receive_data_batch(net_device* _device, net_buffer** buffers,
+	size_t* _count)
+{
+	tunnel_device* device = (tunnel_device*)_device;
+	ssize_t count = gStackModule->fifo_dequeue_buffers(&device->receive_queue,
+		0, B_INFINITE_TIMEOUT, buffers, *_count);
+	if (count < 0)
+		return count;
+
+	*_count = count;
+	return B_OK;
+}
+
+
 status_t
 tunnel_set_mtu(net_device* device, size_t mtu)
 {
@@ -505,6 +520,7 @@ net_device_module_info sTunModule = {
 	tunnel_set_media,
 	tunnel_add_multicast,
 	tunnel_remove_multicast,
+	tunnel_receive_data_batch,
 };
 
 module_dependency module_dependencies[] = {
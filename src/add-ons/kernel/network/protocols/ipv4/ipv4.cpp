@@ -1519,7 +1519,17 @@ ipv4_send_routed_data(net_protocol* _protocol, struct net_route* route,
 		header->header_length = sizeof(ipv4_header) / 4;
 		header->service_type = protocol ? protocol->service_type : 0;
 		header->total_length = htons(buffer->size);
-		header->id = htons(atomic_add(&sPacketID, 1));
+
+		// A TCP super-segment is split up into several packets before it is
+		// sent (see net_buffer::segment_size), and each of them needs its
+		// own ID. Since the size includes the headers, this may reserve one
+		// ID too many, but never too few.
+		int32 packetCount = 1;
+		if (buffer->segment_size != 0) {
+			packetCount = (buffer->size + buffer->segment_size - 1)
+				/ buffer->segment_size;
+		}
+		header->id = htons(atomic_add(&sPacketID, packetCount));
 		header->fragment_offset = 0;
 		if (protocol) {
 			header->time_to_live = (buffer->msg_flags & MSG_MCAST) != 0
@@ -1600,8 +1610,9 @@ ipv4_send_routed_data(net_protocol* _protocol, struct net_route* route,
 		ntohl(destination.sin_addr.s_addr));
 
 	uint32 mtu = route->mtu ? route->mtu : interface->device->mtu;
-	if (buffer->size > mtu) {
-		// we need to fragment the packet
+	if (buffer->size > mtu && buffer->segment_size == 0) {
+		// we need to fragment the packet (TCP super-segments are split into
+		// segments by the datalink layer instead)
 		return send_fragments(protocol, route, buffer, mtu);
 	}
 
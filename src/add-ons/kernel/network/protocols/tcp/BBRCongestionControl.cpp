@@ -0,0 +1,375 @@
+/*
+ * Copyright 2026, Haiku, Inc. All Rights Reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+/*!	BBR congestion control, after "BBR: Congestion-Based Congestion Control"
+	(Cardwell et al.) and draft-cardwell-iccrg-bbr-congestion-control.
+
+	BBR builds a model of the path out of the maximum delivery rate and the
+	minimum round trip time seen recently, and sizes the window to their
+	product, the bandwidth-delay product (BDP).
+
+	The stack does not pace its output, so all gains are applied to the
+	congestion window instead of the pacing rate: the window is kept at
+	gain * BDP plus a few segments of headroom for delayed and stretched
+	acknowledgments. Delivery rate samples are taken once per round trip,
+	as the data delivered during the round divided by its duration.
+*/
+
+
+#include "CongestionControl.h"
+
+#include <new>
+#include <stdint.h>
+#include <string.h>
+
+
+// gains are scaled by 256
+static const uint32 kUnit = 256;
+static const uint32 kHighGain = 739;
+	// 2/ln(2), the smallest gain that doubles the delivery rate per round
+static const uint32 kProbeGains[] = {320, 192, 256, 256, 256, 256, 256, 256};
+static const uint32 kProbeGainCount
+	= sizeof(kProbeGains) / sizeof(kProbeGains[0]);
+
+// length of the windowed maximum bandwidth filter in rounds
+static const uint32 kBandwidthRounds = 10;
+// the minimum round trip time expires after 10 seconds
+static const uint32 kMinRoundTripTimeLifetime = 10000;
+static const uint32 kProbeRoundTripTimeDuration = 200;
+static const uint32 kMinWindowSegments = 4;
+static const uint32 kHeadroomSegments = 3;
+// rounds without 25% bandwidth growth until the pipe is considered full
+static const uint32 kFullBandwidthRounds = 3;
+
+
+class BBRCongestionControl : public CongestionControl {
+public:
+								BBRCongestionControl(TCPEndpoint& endpoint);
+
+	virtual	const char*			Name() const;
+
+	virtual	void				Initialize();
+	virtual	void				Acknowledged(uint32 bytesAcknowledged,
+									int32 roundTripTime, bool inRecovery);
+	virtual	void				EnterRecovery(uint32 flightSize);
+	virtual	void				ExitRecovery();
+	virtual	void				RetransmitTimeout();
+
+private:
+	enum mode {
+		STARTUP,
+		DRAIN,
+		PROBE_BANDWIDTH,
+		PROBE_ROUND_TRIP_TIME
+	};
+
+			bool				_UpdateRound(uint32 bytesAcknowledged,
+									uint32 now);
+			bool				_UpdateMinRoundTripTime(int32 roundTripTime,
+									uint32 now);
+			void				_CheckFullBandwidth();
+			void				_UpdateMode(bool roundEnded,
+									bool minRoundTripTimeExpired, uint32 now);
+			uint64				_MaxBandwidth() const;
+			uint32				_TargetWindow(uint32 gain) const;
+			uint32				_Gain() const;
+
+private:
+			mode				fMode;
+
+			// round trip counting
+			tcp_sequence		fRoundEnd;
+			uint32				fRoundStart;
+			uint32				fRoundDelivered;
+			uint32				fRoundCount;
+
+			// bandwidth samples in bytes per second, per round
+			uint64				fBandwidth[kBandwidthRounds];
+
+			int32				fMinRoundTripTime;
+			uint32				fMinRoundTripTimeStamp;
+			uint32				fProbeRoundTripTimeDone;
+
+			uint64				fFullBandwidth;
+			uint32				fFullBandwidthCount;
+			bool				fFullBandwidthReached;
+
+			uint32				fCycleIndex;
+			uint32				fPriorWindow;
+};
+
+
+BBRCongestionControl::BBRCongestionControl(TCPEndpoint& endpoint)
+	:
+	CongestionControl(endpoint)
+{
+	Initialize();
+}
+
+
+const char*
+BBRCongestionControl::Name() const
+{
+	return "bbr";
+}
+
+
+void
+BBRCongestionControl::Initialize()
+{
+	fMode = STARTUP;
+	fRoundEnd = SendMax();
+	fRoundStart = Now();
+	fRoundDelivered = 0;
+	fRoundCount = 0;
+	memset(fBandwidth, 0, sizeof(fBandwidth));
+	fMinRoundTripTime = -1;
+	fMinRoundTripTimeStamp = fRoundStart;
+	fProbeRoundTripTimeDone = 0;
+	fFullBandwidth = 0;
+	fFullBandwidthCount = 0;
+	fFullBandwidthReached = false;
+	fCycleIndex = 0;
+	fPriorWindow = 0;
+}
+
+
+void
+BBRCongestionControl::Acknowledged(uint32 bytesAcknowledged,
+	int32 roundTripTime, bool inRecovery)
+{
+	uint32 now = Now();
+
+	bool roundEnded = _UpdateRound(bytesAcknowledged, now);
+	bool expired = _UpdateMinRoundTripTime(roundTripTime, now);
+	if (roundEnded)
+		_CheckFullBandwidth();
+	_UpdateMode(roundEnded, expired, now);
+
+	if (inRecovery) {
+		// the endpoint conserves packets during fast recovery
+		return;
+	}
+
+	uint32 window = Window();
+	uint32 minWindow = kMinWindowSegments * MaxSegmentSize();
+
+	if (fMode == PROBE_ROUND_TRIP_TIME) {
+		SetWindow(min_c(window, minWindow));
+		return;
+	}
+
+	uint32 target = _TargetWindow(_Gain());
+	if (target == 0 || !fFullBandwidthReached) {
+		// no model yet, or still in startup: grow like slow start
+		window += bytesAcknowledged;
+		if (target != 0 && fFullBandwidthReached && window > target)
+			window = target;
+	} else
+		window = min_c(window + bytesAcknowledged, target);
+
+	SetWindow(max_c(window, minWindow));
+}
+
+
+void
+BBRCongestionControl::EnterRecovery(uint32 flightSize)
+{
+	// BBR does not reduce its model on loss, only keeps the data in flight
+	// from growing until the loss is repaired
+	fPriorWindow = max_c(fPriorWindow, Window());
+	SetSlowStartThreshold(max_c(FlightSize(),
+		kMinWindowSegments * MaxSegmentSize()));
+}
+
+
+void
+BBRCongestionControl::ExitRecovery()
+{
+	SetWindow(max_c(Window(), fPriorWindow));
+	fPriorWindow = 0;
+}
+
+
+void
+BBRCongestionControl::RetransmitTimeout()
+{
+	// the window grows back to the model's BDP within a few round trips
+	fPriorWindow = 0;
+	SetWindow(MaxSegmentSize());
+}
+
+
+/*!	Counts the data delivered in the current round trip, and takes a
+	bandwidth sample when it ends. Returns whether it ended.
+*/
+bool
+BBRCongestionControl::_UpdateRound(uint32 bytesAcknowledged, uint32 now)
+{
+	fRoundDelivered += bytesAcknowledged;
+
+	if (SendUnacknowledged() < fRoundEnd)
+		return false;
+
+	uint32 duration = now - fRoundStart;
+	if (duration == 0) {
+		// too short to be measured, make the next round span this one
+		fRoundEnd = SendMax();
+		return false;
+	}
+
+	fRoundCount++;
+	fBandwidth[fRoundCount % kBandwidthRounds]
+		= (uint64)fRoundDelivered * 1000 / duration;
+
+	fRoundEnd = SendMax();
+	fRoundStart = now;
+	fRoundDelivered = 0;
+	return true;
+}
+
+
+/*!	Returns whether the minimum round trip time hasn't been confirmed for
+	too long; it is replaced by the current sample in this case.
+*/
+bool
+BBRCongestionControl::_UpdateMinRoundTripTime(int32 roundTripTime,
+	uint32 now)
+{
+	bool expired = fMinRoundTripTime >= 0
+		&& now - fMinRoundTripTimeStamp > kMinRoundTripTimeLifetime;
+
+	if (roundTripTime >= 0 && (fMinRoundTripTime < 0
+			|| roundTripTime <= fMinRoundTripTime || expired)) {
+		fMinRoundTripTime = max_c(roundTripTime, 1);
+		fMinRoundTripTimeStamp = now;
+	}
+
+	return expired;
+}
+
+
+//!	Startup is over when the bandwidth stopped growing by at least 25%.
+void
+BBRCongestionControl::_CheckFullBandwidth()
+{
+	if (fFullBandwidthReached)
+		return;
+
+	uint64 bandwidth = _MaxBandwidth();
+	if (bandwidth >= fFullBandwidth * 5 / 4) {
+		fFullBandwidth = bandwidth;
+		fFullBandwidthCount = 0;
+		return;
+	}
+
+	if (++fFullBandwidthCount >= kFullBandwidthRounds)
+		fFullBandwidthReached = true;
+}
+
+
+void
+BBRCongestionControl::_UpdateMode(bool roundEnded,
+	bool minRoundTripTimeExpired, uint32 now)
+{
+	switch (fMode) {
+		case STARTUP:
+			if (fFullBandwidthReached)
+				fMode = DRAIN;
+			break;
+
+		case DRAIN:
+			if (FlightSize() <= _TargetWindow(kUnit)) {
+				fMode = PROBE_BANDWIDTH;
+				fCycleIndex = 0;
+			}
+			break;
+
+		case PROBE_BANDWIDTH:
+			if (roundEnded)
+				fCycleIndex = (fCycleIndex + 1) % kProbeGainCount;
+			break;
+
+		case PROBE_ROUND_TRIP_TIME:
+			if (fProbeRoundTripTimeDone == 0
+				&& FlightSize() <= kMinWindowSegments * MaxSegmentSize()) {
+				// the queue has drained, hold the window for a while
+				fProbeRoundTripTimeDone = now + kProbeRoundTripTimeDuration;
+				if (fProbeRoundTripTimeDone == 0)
+					fProbeRoundTripTimeDone = 1;
+			} else if (fProbeRoundTripTimeDone != 0
+				&& (int32)(now - fProbeRoundTripTimeDone) >= 0) {
+				fMinRoundTripTimeStamp = now;
+				fProbeRoundTripTimeDone = 0;
+				fMode = fFullBandwidthReached ? PROBE_BANDWIDTH : STARTUP;
+				fCycleIndex = 0;
+				if (fPriorWindow != 0) {
+					SetWindow(max_c(Window(), fPriorWindow));
+					fPriorWindow = 0;
+				}
+			}
+			return;
+	}
+
+	if (minRoundTripTimeExpired) {
+		// the minimum round trip time might be outdated, drain the queue
+		// to measure it again
+		fMode = PROBE_ROUND_TRIP_TIME;
+		fProbeRoundTripTimeDone = 0;
+		fPriorWindow = max_c(fPriorWindow, Window());
+	}
+}
+
+
+uint64
+BBRCongestionControl::_MaxBandwidth() const
+{
+	uint64 bandwidth = 0;
+	for (uint32 i = 0; i < kBandwidthRounds; i++)
+		bandwidth = max_c(bandwidth, fBandwidth[i]);
+
+	return bandwidth;
+}
+
+
+//!	Returns \a gain times the estimated BDP, or 0 if there is no model yet.
+uint32
+BBRCongestionControl::_TargetWindow(uint32 gain) const
+{
+	uint64 bandwidth = _MaxBandwidth();
+	if (bandwidth == 0 || fMinRoundTripTime < 0)
+		return 0;
+
+	uint64 window = bandwidth * fMinRoundTripTime / 1000 * gain / kUnit
+		+ kHeadroomSegments * MaxSegmentSize();
+	if (window > UINT32_MAX)
+		return UINT32_MAX;
+
+	return max_c((uint32)window, kMinWindowSegments * MaxSegmentSize());
+}
+
+
+uint32
+BBRCongestionControl::_Gain() const
+{
+	switch (fMode) {
+		case STARTUP:
+			return kHighGain;
+		case PROBE_BANDWIDTH:
+			return kProbeGains[fCycleIndex];
+		case DRAIN:
+		case PROBE_ROUND_TRIP_TIME:
+		default:
+			return kUnit;
+	}
+}
+
+
+CongestionControl*
+create_bbr_congestion_control(TCPEndpoint& endpoint)
+{
+	return new(std::nothrow) BBRCongestionControl(endpoint);
+}
@@ -0,0 +1,228 @@
+/*
+ * Copyright 2026, Haiku, Inc. All Rights Reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+#include "CongestionControl.h"
+
+#include <new>
+#include <string.h>
+
+#include <driver_settings.h>
+#include <KernelExport.h>
+#include <OS.h>
+
+
+//#define TRACE_CONGESTION_CONTROL
+#ifdef TRACE_CONGESTION_CONTROL
+#	define TRACE(x...) dprintf("tcp: " x)
+#else
+#	define TRACE(x...) ;
+#endif
+
+
+struct congestion_control_algorithm {
+	const char*			name;
+	CongestionControl*	(*create)(TCPEndpoint& endpoint);
+};
+
+static const congestion_control_algorithm kAlgorithms[] = {
+	{"newreno", &create_new_reno_congestion_control},
+	{"cubic", &create_cubic_congestion_control},
+	{"bbr", &create_bbr_congestion_control},
+};
+static const size_t kAlgorithmCount
+	= sizeof(kAlgorithms) / sizeof(kAlgorithms[0]);
+
+static const congestion_control_algorithm* sDefaultAlgorithm = &kAlgorithms[0];
+
+
+class NewRenoCongestionControl : public CongestionControl {
+public:
+								NewRenoCongestionControl(TCPEndpoint& endpoint);
+
+	virtual	const char*			Name() const;
+	virtual	void				Acknowledged(uint32 bytesAcknowledged,
+									int32 roundTripTime, bool inRecovery);
+};
+
+
+static const congestion_control_algorithm*
+find_algorithm(const char* name)
+{
+	for (size_t i = 0; i < kAlgorithmCount; i++) {
+		if (strcmp(kAlgorithms[i].name, name) == 0)
+			return &kAlgorithms[i];
+	}
+
+	return NULL;
+}
+
+
+//	#pragma mark -
+
+
+CongestionControl::CongestionControl(TCPEndpoint& endpoint)
+	:
+	fEndpoint(endpoint)
+{
+}
+
+
+CongestionControl::~CongestionControl()
+{
+}
+
+
+void
+CongestionControl::Initialize()
+{
+}
+
+
+/*!	The default is the one of RFC 5681: half of the flight size, but at least
+	two segments.
+*/
+void
+CongestionControl::EnterRecovery(uint32 flightSize)
+{
+	SetSlowStartThreshold(max_c(flightSize / 2, 2 * MaxSegmentSize()));
+}
+
+
+/*!	Deflates the window that has been inflated during fast recovery, as
+	suggested by RFC 6582.
+*/
+void
+CongestionControl::ExitRecovery()
+{
+	SetWindow(min_c(SlowStartThreshold(),
+		max_c(FlightSize(), MaxSegmentSize()) + MaxSegmentSize()));
+}
+
+
+void
+CongestionControl::RetransmitTimeout()
+{
+	SetSlowStartThreshold(max_c(FlightSize() / 2, 2 * MaxSegmentSize()));
+	SetWindow(MaxSegmentSize());
+}
+
+
+/*static*/ uint32
+CongestionControl::Now()
+{
+	return system_time() / 1000;
+}
+
+
+//	#pragma mark - NewReno
+
+
+NewRenoCongestionControl::NewRenoCongestionControl(TCPEndpoint& endpoint)
+	:
+	CongestionControl(endpoint)
+{
+}
+
+
+const char*
+NewRenoCongestionControl::Name() const
+{
+	return "newreno";
+}
+
+
+void
+NewRenoCongestionControl::Acknowledged(uint32 bytesAcknowledged,
+	int32 roundTripTime, bool inRecovery)
+{
+	if (inRecovery)
+		return;
+
+	uint32 window = Window();
+	uint32 maxSegmentSize = MaxSegmentSize();
+
+	if (window < SlowStartThreshold()) {
+		SetWindow(window + min_c(bytesAcknowledged, maxSegmentSize));
+		return;
+	}
+
+	uint32 increment = maxSegmentSize * maxSegmentSize;
+	if (increment < window)
+		increment = 1;
+	else
+		increment /= window;
+
+	SetWindow(window + increment);
+}
+
+
+CongestionControl*
+create_new_reno_congestion_control(TCPEndpoint& endpoint)
+{
+	return new(std::nothrow) NewRenoCongestionControl(endpoint);
+}
+
+
+//	#pragma mark -
+
+
+/*!	Creates the congestion control algorithm \a name for the \a endpoint, or
+	the default one if \a name is \c NULL.
+*/
+status_t
+create_congestion_control(TCPEndpoint& endpoint, const char* name,
+	CongestionControl** _congestionControl)
+{
+	const congestion_control_algorithm* algorithm = sDefaultAlgorithm;
+	if (name != NULL) {
+		algorithm = find_algorithm(name);
+		if (algorithm == NULL)
+			return B_NAME_NOT_FOUND;
+	}
+
+	CongestionControl* congestionControl = algorithm->create(endpoint);
+	if (congestionControl == NULL)
+		return B_NO_MEMORY;
+
+	*_congestionControl = congestionControl;
+	return B_OK;
+}
+
+
+status_t
+set_default_congestion_control(const char* name)
+{
+	const congestion_control_algorithm* algorithm = find_algorithm(name);
+	if (algorithm == NULL)
+		return B_NAME_NOT_FOUND;
+
+	sDefaultAlgorithm = algorithm;
+	return B_OK;
+}
+
+
+/*!	Reads the default algorithm from the "congestion_control" parameter of
+	the "tcp" driver settings file.
+*/
+void
+init_congestion_control()
+{
+	sDefaultAlgorithm = &kAlgorithms[0];
+
+	void* handle = load_driver_settings("tcp");
+	if (handle == NULL)
+		return;
+
+	const char* name = get_driver_parameter(handle, "congestion_control",
+		NULL, NULL);
+	if (name != NULL && set_default_congestion_control(name) != B_OK) {
+		dprintf("tcp: unknown congestion control algorithm \"%s\"\n",
+			name);
+	}
+
+	TRACE("default congestion control: %s\n", sDefaultAlgorithm->name);
+	unload_driver_settings(handle);
+}
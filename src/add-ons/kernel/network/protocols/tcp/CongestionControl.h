@@ -0,0 +1,139 @@
+/*
+ * Copyright 2026, Haiku, Inc. All Rights Reserved.
+ * Distributed under the terms of the MIT License.
+ */
+#ifndef CONGESTION_CONTROL_H
+#define CONGESTION_CONTROL_H
+
+
+#include "TCPEndpoint.h"
+
+
+/*!	Base class of the congestion control algorithms.
+
+	The endpoint itself implements loss detection and recovery (fast
+	retransmit, limited transmit, SACK based recovery, or the NewReno window
+	inflation during fast recovery); the algorithm only decides how the
+	congestion window and the slow start threshold change on the events it
+	is told about. Both values remain part of the endpoint, so that an
+	algorithm can be replaced during the lifetime of a connection.
+
+	All hooks are called with the endpoint lock held.
+*/
+class CongestionControl {
+public:
+								CongestionControl(TCPEndpoint& endpoint);
+	virtual						~CongestionControl();
+
+	virtual	const char*			Name() const = 0;
+
+	//! Resets the algorithm's state; the initial window has already been set.
+	virtual	void				Initialize();
+
+	/*!	Called for every acknowledgment of new data. \a roundTripTime is
+		the round trip time measured with this acknowledgment in ms, or -1
+		if it didn't produce a sample.
+	*/
+	virtual	void				Acknowledged(uint32 bytesAcknowledged,
+									int32 roundTripTime, bool inRecovery) = 0;
+
+	/*!	Fast retransmit is about to enter fast recovery; must set the slow
+		start threshold the window is inflated from, or, with SACK, the
+		window itself is set to.
+	*/
+	virtual	void				EnterRecovery(uint32 flightSize);
+	virtual	void				ExitRecovery();
+	virtual	void				RetransmitTimeout();
+
+protected:
+	inline	uint32				Window() const;
+	inline	void				SetWindow(uint32 window);
+	inline	uint32				SlowStartThreshold() const;
+	inline	void				SetSlowStartThreshold(uint32 threshold);
+	inline	uint32				MaxSegmentSize() const;
+	inline	uint32				FlightSize() const;
+	inline	int32				SmoothedRoundTripTime() const;
+	inline	tcp_sequence		SendMax() const;
+	inline	tcp_sequence		SendUnacknowledged() const;
+
+	static	uint32				Now();
+
+protected:
+			TCPEndpoint&		fEndpoint;
+};
+
+
+uint32
+CongestionControl::Window() const
+{
+	return fEndpoint.fCongestionWindow;
+}
+
+
+void
+CongestionControl::SetWindow(uint32 window)
+{
+	fEndpoint.fCongestionWindow = window;
+}
+
+
+uint32
+CongestionControl::SlowStartThreshold() const
+{
+	return fEndpoint.fSlowStartThreshold;
+}
+
+
+void
+CongestionControl::SetSlowStartThreshold(uint32 threshold)
+{
+	fEndpoint.fSlowStartThreshold = threshold;
+}
+
+
+uint32
+CongestionControl::MaxSegmentSize() const
+{
+	return fEndpoint.fSendMaxSegmentSize;
+}
+
+
+uint32
+CongestionControl::FlightSize() const
+{
+	return (fEndpoint.fSendMax - fEndpoint.fSendUnacknowledged).Number();
+}
+
+
+int32
+CongestionControl::SmoothedRoundTripTime() const
+{
+	return fEndpoint.fSmoothedRoundTripTime;
+}
+
+
+tcp_sequence
+CongestionControl::SendMax() const
+{
+	return fEndpoint.fSendMax;
+}
+
+
+tcp_sequence
+CongestionControl::SendUnacknowledged() const
+{
+	return fEndpoint.fSendUnacknowledged;
+}
+
+
+CongestionControl* create_new_reno_congestion_control(TCPEndpoint& endpoint);
+CongestionControl* create_cubic_congestion_control(TCPEndpoint& endpoint);
+CongestionControl* create_bbr_congestion_control(TCPEndpoint& endpoint);
+
+status_t create_congestion_control(TCPEndpoint& endpoint, const char* name,
+	CongestionControl** _congestionControl);
+status_t set_default_congestion_control(const char* name);
+void init_congestion_control();
+
+
+#endif	// CONGESTION_CONTROL_H
@@ -0,0 +1,224 @@
+/*
+ * Copyright 2026, Haiku, Inc. All Rights Reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+/*!	CUBIC congestion control, as specified by RFC 9438.
+
+	Since there is no floating point in the kernel, the window is kept in
+	bytes, time in milliseconds, and the constants are scaled integers:
+	C = 0.4 segments/s^3, and beta = 717/1024 (~0.7) as in other
+	implementations.
+*/
+
+
+#include "CongestionControl.h"
+
+#include <new>
+#include <stdint.h>
+
+
+// multiplicative decrease factor, scaled by 1024
+static const uint64 kBeta = 717;
+// additive increase factor of the Reno-friendly region, 3 * (1 - beta)
+// / (1 + beta)
+static const uint64 kAlphaNumerator = 3 * (1024 - kBeta);
+static const uint64 kAlphaDenominator = 1024 + kBeta;
+// upper bound for |t - K| in ms, keeps the cubic term from overflowing
+static const uint64 kMaxOffset = 100000;
+
+
+class CubicCongestionControl : public CongestionControl {
+public:
+								CubicCongestionControl(TCPEndpoint& endpoint);
+
+	virtual	const char*			Name() const;
+
+	virtual	void				Initialize();
+	virtual	void				Acknowledged(uint32 bytesAcknowledged,
+									int32 roundTripTime, bool inRecovery);
+	virtual	void				EnterRecovery(uint32 flightSize);
+	virtual	void				RetransmitTimeout();
+
+private:
+			void				_CongestionEvent();
+			uint32				_Target(uint32 now) const;
+
+private:
+			uint32				fMaxWindow;
+			uint32				fOriginWindow;
+			uint32				fEpochStart;
+			uint32				fK;
+			uint32				fRenoWindow;
+			uint64				fRenoCredit;
+			uint64				fWindowCredit;
+};
+
+
+//!	Integer cube root, from "Hacker's Delight".
+static uint32
+cube_root(uint64 value)
+{
+	uint64 root = 0;
+	for (int shift = 63; shift >= 0; shift -= 3) {
+		root += root;
+		uint64 b = 3 * root * (root + 1) + 1;
+		if ((value >> shift) >= b) {
+			value -= b << shift;
+			root++;
+		}
+	}
+
+	return (uint32)root;
+}
+
+
+CubicCongestionControl::CubicCongestionControl(TCPEndpoint& endpoint)
+	:
+	CongestionControl(endpoint)
+{
+	Initialize();
+}
+
+
+const char*
+CubicCongestionControl::Name() const
+{
+	return "cubic";
+}
+
+
+void
+CubicCongestionControl::Initialize()
+{
+	fMaxWindow = 0;
+	fOriginWindow = 0;
+	fEpochStart = 0;
+	fK = 0;
+	fRenoWindow = 0;
+	fRenoCredit = 0;
+	fWindowCredit = 0;
+}
+
+
+void
+CubicCongestionControl::Acknowledged(uint32 bytesAcknowledged,
+	int32 roundTripTime, bool inRecovery)
+{
+	if (inRecovery)
+		return;
+
+	uint32 window = Window();
+	uint32 maxSegmentSize = MaxSegmentSize();
+
+	if (window < SlowStartThreshold()) {
+		SetWindow(window + min_c(bytesAcknowledged, maxSegmentSize));
+		return;
+	}
+
+	uint32 now = Now();
+	if (fEpochStart == 0) {
+		// first acknowledgment in congestion avoidance since the last
+		// congestion event
+		fEpochStart = now != 0 ? now : 1;
+		fRenoWindow = window;
+		fRenoCredit = 0;
+		fWindowCredit = 0;
+
+		if (window < fMaxWindow) {
+			// K = cbrt((W_max - cwnd) / C), in ms
+			fK = cube_root((uint64)(fMaxWindow - window) * 2500000000ULL
+				/ maxSegmentSize);
+			fOriginWindow = fMaxWindow;
+		} else {
+			fK = 0;
+			fOriginWindow = window;
+		}
+	}
+
+	// the estimated window of a Reno flow with the same average window
+	fRenoCredit += kAlphaNumerator * maxSegmentSize * bytesAcknowledged;
+	uint64 divisor = kAlphaDenominator * window;
+	fRenoWindow += fRenoCredit / divisor;
+	fRenoCredit %= divisor;
+
+	uint32 target = _Target(now);
+	if (target < fRenoWindow)
+		target = fRenoWindow;
+	if (target > window + window / 2)
+		target = window + window / 2;
+
+	if (target > window) {
+		fWindowCredit += (uint64)(target - window) * bytesAcknowledged;
+		SetWindow(window + fWindowCredit / window);
+		fWindowCredit %= window;
+	}
+}
+
+
+void
+CubicCongestionControl::EnterRecovery(uint32 flightSize)
+{
+	_CongestionEvent();
+}
+
+
+void
+CubicCongestionControl::RetransmitTimeout()
+{
+	_CongestionEvent();
+	SetWindow(MaxSegmentSize());
+}
+
+
+void
+CubicCongestionControl::_CongestionEvent()
+{
+	uint32 window = Window();
+
+	// fast convergence: release bandwidth for new flows if the window
+	// didn't grow back to its previous maximum
+	if (window < fMaxWindow)
+		fMaxWindow = (uint64)window * (1024 + kBeta) / 2048;
+	else
+		fMaxWindow = window;
+
+	SetSlowStartThreshold(max_c((uint32)(window * kBeta / 1024),
+		2 * MaxSegmentSize()));
+	fEpochStart = 0;
+}
+
+
+/*!	Returns W_cubic(t + RTT) in bytes, the window the cubic function wants
+	to reach one round trip from \a now.
+*/
+uint32
+CubicCongestionControl::_Target(uint32 now) const
+{
+	uint64 elapsed = now - fEpochStart;
+	int32 roundTripTime = SmoothedRoundTripTime();
+	if (roundTripTime > 0)
+		elapsed += roundTripTime;
+
+	uint64 offset = elapsed < fK ? fK - elapsed : elapsed - fK;
+	if (offset > kMaxOffset)
+		offset = kMaxOffset;
+
+	// C * offset^3 in bytes: 0.4 * (offset / 1000)^3 * MSS
+	uint64 delta = offset * offset * offset / 1000 * 4 * MaxSegmentSize()
+		/ 10000000;
+
+	if (elapsed < fK)
+		return delta < fOriginWindow ? fOriginWindow - delta : 0;
+
+	uint64 target = fOriginWindow + delta;
+	return target > UINT32_MAX ? UINT32_MAX : (uint32)target;
+}
+
+
+CongestionControl*
+create_cubic_congestion_control(TCPEndpoint& endpoint)
+{
+	return new(std::nothrow) CubicCongestionControl(endpoint);
+}
@@ -134,6 +134,47 @@ static const uint16 kLastReservedPort = 1023;
 static const uint16 kFirstEphemeralPort = 40000;
 
 
+struct EndpointManager::ConnectionShard {
+	ConnectionShard(EndpointManager* manager)
+		:
+		table(manager)
+	{
+		rw_lock_init(&lock, "TCP connections");
+	}
+
+	~ConnectionShard()
+	{
+		rw_lock_destroy(&lock);
+	}
+
+	rw_lock				lock;
+	ConnectionTable		table;
+};
+
+
+/*!	Returns whether both sockets agreed to share their port with SO_REUSEPORT.
+	Like on other systems, this is only allowed between sockets of the same
+	user, so that nobody can take over a share of another user's connections.
+*/
+static inline bool
+can_share_port(net_socket* first, net_socket* second)
+{
+	return (first->options & SO_REUSEPORT) != 0
+		&& (second->options & SO_REUSEPORT) != 0
+		&& first->owner_uid == second->owner_uid;
+}
+
+
+/*!	Spreads the bits of the rather weak address hashes, so that its upper
+	bits can be used to pick a shard, or a listener.
+*/
+static inline uint32
+mix_hash(size_t hash)
+{
+	return (uint32)hash * 0x9e3779b1;
+}
+
+
 ConnectionHashDefinition::ConnectionHashDefinition(EndpointManager* manager)
 	:
 	fManager(manager)
@@ -214,18 +255,60 @@ EndpointHashDefinition::GetLink(TCPEndpoint* endpoint) const
 //	#pragma mark -
 
 
+status_t
+ListenerGroup::Add(TCPEndpoint* endpoint)
+{
+	return fMembers.PushBack(endpoint);
+}
+
+
+void
+ListenerGroup::Remove(TCPEndpoint* endpoint)
+{
+	fMembers.Remove(endpoint);
+}
+
+
+/*!	Chooses the listener for a connection request with the given address
+	\a hash. The same connection always ends up at the same listener, as long
+	as the group doesn't change; listeners that are going away are skipped.
+*/
+TCPEndpoint*
+ListenerGroup::Select(uint32 hash) const
+{
+	int32 count = fMembers.Count();
+	int32 index = ((uint64)mix_hash(hash) * count) >> 32;
+
+	for (int32 i = 0; i < count; i++) {
+		TCPEndpoint* endpoint = fMembers.ElementAt((index + i) % count);
+		if (endpoint->State() == LISTEN)
+			return endpoint;
+	}
+
+	return fMembers.ElementAt(index);
+}
+
+
+//	#pragma mark -
+
+
 EndpointManager::EndpointManager(net_domain* domain)
 	:
 	fDomain(domain),
-	fConnectionHash(this),
 	fLastPort(kFirstEphemeralPort)
 {
 	rw_lock_init(&fLock, "TCP endpoint manager");
+
+	for (uint32 i = 0; i < kConnectionShardCount; i++)
+		fConnectionShards[i] = NULL;
 }
 
 
 EndpointManager::~EndpointManager()
 {
+	for (uint32 i = 0; i < kConnectionShardCount; i++)
+		delete fConnectionShards[i];
+
 	rw_lock_destroy(&fLock);
 }
 
@@ -233,25 +316,140 @@ EndpointManager::~EndpointManager()
 status_t
 EndpointManager::Init()
 {
-	status_t status = fConnectionHash.Init();
-	if (status == B_OK)
-		status = fEndpointHash.Init();
+	for (uint32 i = 0; i < kConnectionShardCount; i++) {
+		fConnectionShards[i] = new(std::nothrow) ConnectionShard(this);
+		if (fConnectionShards[i] == NULL)
+			return B_NO_MEMORY;
 
-	return status;
+		status_t status = fConnectionShards[i]->table.Init();
+		if (status != B_OK)
+			return status;
+	}
+
+	return fEndpointHash.Init();
 }
 
 
 //	#pragma mark - connections
 
 
+EndpointManager::ConnectionShard*
+EndpointManager::_ShardFor(const sockaddr* local, const sockaddr* peer) const
+{
+	uint32 hash = ConstSocketAddress(AddressModule(), local).HashPair(peer);
+	return fConnectionShards[mix_hash(hash) >> (32 - kConnectionShardBits)];
+}
+
+
+EndpointManager::ConnectionShard*
+EndpointManager::_ShardFor(TCPEndpoint* endpoint) const
+{
+	return _ShardFor(*endpoint->LocalAddress(), *endpoint->PeerAddress());
+}
+
+
 /*!	Returns the endpoint matching the connection.
-	You must hold the manager's lock when calling this method (either read or
-	write).
+	You must hold either the manager's lock, or the lock of the shard the
+	connection belongs to (either read or write).
 */
 TCPEndpoint*
 EndpointManager::_LookupConnection(const sockaddr* local, const sockaddr* peer)
 {
-	return fConnectionHash.Lookup(std::make_pair(local, peer));
+	return _ShardFor(local, peer)->table.Lookup(std::make_pair(local, peer));
+}
+
+
+/*!	Returns the endpoint matching the connection with a reference to its
+	socket, or \c NULL if there is none. If the connection is served by a
+	group of listeners, one of them is chosen by the \a hash of the
+	addresses of the incoming segment.
+	Only the lock of the shard is held during the lookup.
+*/
+TCPEndpoint*
+EndpointManager::_AcquireConnection(const sockaddr* local, const sockaddr* peer,
+	uint32 hash)
+{
+	ConnectionShard* shard = _ShardFor(local, peer);
+	ReadLocker _(shard->lock);
+
+	TCPEndpoint* endpoint = shard->table.Lookup(std::make_pair(local, peer));
+	if (endpoint == NULL)
+		return NULL;
+
+	if (endpoint->fListenerGroup != NULL)
+		endpoint = endpoint->fListenerGroup->Select(hash);
+
+	if (!gSocketModule->acquire_socket(endpoint->socket))
+		return NULL;
+
+	return endpoint;
+}
+
+
+/*!	Adds \a endpoint to the listeners of \a listener's local address.
+	You must have fLock write locked when calling this method.
+*/
+status_t
+EndpointManager::_JoinListenerGroup(TCPEndpoint* listener,
+	TCPEndpoint* endpoint)
+{
+	if (!can_share_port(listener->socket, endpoint->socket))
+		return EADDRINUSE;
+
+	ConnectionShard* shard = _ShardFor(listener);
+	WriteLocker _(shard->lock);
+
+	ListenerGroup* group = listener->fListenerGroup;
+	if (group == NULL) {
+		group = new(std::nothrow) ListenerGroup;
+		if (group == NULL)
+			return B_NO_MEMORY;
+
+		if (group->Add(listener) != B_OK || group->Add(endpoint) != B_OK) {
+			delete group;
+			return B_NO_MEMORY;
+		}
+
+		listener->fListenerGroup = group;
+	} else if (group->Add(endpoint) != B_OK)
+		return B_NO_MEMORY;
+
+	endpoint->PeerAddress().SetTo(*listener->PeerAddress());
+	endpoint->fListenerGroup = group;
+	return B_OK;
+}
+
+
+/*!	Removes \a endpoint from the connection table, and from its listener
+	group; if it was the group's representative in the table, the next
+	member takes its place.
+	You must have fLock write locked when calling this method.
+*/
+void
+EndpointManager::_RemoveConnection(TCPEndpoint* endpoint)
+{
+	ConnectionShard* shard = _ShardFor(endpoint);
+	WriteLocker _(shard->lock);
+
+	ListenerGroup* group = endpoint->fListenerGroup;
+	if (group == NULL) {
+		shard->table.Remove(endpoint);
+		return;
+	}
+
+	endpoint->fListenerGroup = NULL;
+
+	if (group->First() == endpoint) {
+		shard->table.RemoveUnchecked(endpoint);
+		group->Remove(endpoint);
+		shard->table.Insert(group->First());
+	} else
+		group->Remove(endpoint);
+
+	if (group->Count() == 1) {
+		group->First()->fListenerGroup = NULL;
+		delete group;
+	}
 }
 
 
@@ -277,10 +475,6 @@ EndpointManager::SetConnection(TCPEndpoint* endpoint, const sockaddr* _local,
 	if (_LookupConnection(*local, peer) != NULL)
 		return EADDRINUSE;
 
-	endpoint->LocalAddress().SetTo(*local);
-	endpoint->PeerAddress().SetTo(peer);
-	T(Connect(endpoint));
-
 	// BOpenHashTable doesn't support inserting duplicate objects. Since
 	// BOpenHashTable is a chained hash table where the items are required to
 	// be intrusive linked list nodes, inserting the same object twice will
@@ -289,14 +483,24 @@ EndpointManager::SetConnection(TCPEndpoint* endpoint, const sockaddr* _local,
 	// We need to makes sure to remove any existing copy of this endpoint
 	// object from the table in order to handle calling connect() on a closed
 	// socket to connect to a different remote (address, port) than it was
-	// originally used for.
+	// originally used for. This has to happen before its addresses change,
+	// as these determine the shard it is in.
 	//
 	// We use RemoveUnchecked here because we don't want the hash table to
 	// resize itself after this removal when we are planning to just add
 	// another.
-	fConnectionHash.RemoveUnchecked(endpoint);
+	ConnectionShard* shard = _ShardFor(endpoint);
+	WriteLocker shardLocker(shard->lock);
+	shard->table.RemoveUnchecked(endpoint);
+	shardLocker.Unlock();
 
-	fConnectionHash.Insert(endpoint);
+	endpoint->LocalAddress().SetTo(*local);
+	endpoint->PeerAddress().SetTo(peer);
+	T(Connect(endpoint));
+
+	shard = _ShardFor(endpoint);
+	shardLocker.SetTo(shard->lock, false);
+	shard->table.Insert(endpoint);
 	return B_OK;
 }
 
@@ -319,11 +523,16 @@ EndpointManager::SetPassive(TCPEndpoint* endpoint)
 	SocketAddressStorage passive(AddressModule());
 	passive.SetToEmpty();
 
-	if (_LookupConnection(*endpoint->LocalAddress(), *passive))
-		return EADDRINUSE;
+	TCPEndpoint* listener = _LookupConnection(*endpoint->LocalAddress(),
+		*passive);
+	if (listener != NULL)
+		return _JoinListenerGroup(listener, endpoint);
 
 	endpoint->PeerAddress().SetTo(*passive);
-	fConnectionHash.Insert(endpoint);
+
+	ConnectionShard* shard = _ShardFor(endpoint);
+	WriteLocker shardLocker(shard->lock);
+	shard->table.Insert(endpoint);
 	return B_OK;
 }
 
@@ -331,14 +540,13 @@ EndpointManager::SetPassive(TCPEndpoint* endpoint)
 TCPEndpoint*
 EndpointManager::FindConnection(sockaddr* local, sockaddr* peer)
 {
-	ReadLocker _(fLock);
+	uint32 hash = ConstSocketAddress(AddressModule(), local).HashPair(peer);
 
-	TCPEndpoint *endpoint = _LookupConnection(local, peer);
+	TCPEndpoint *endpoint = _AcquireConnection(local, peer, hash);
 	if (endpoint != NULL) {
 		TRACE(("TCP: Received packet corresponds to explicit endpoint %p\n",
 			endpoint));
-		if (gSocketModule->acquire_socket(endpoint->socket))
-			return endpoint;
+		return endpoint;
 	}
 
 	// no explicit endpoint exists, check for wildcard endpoints
@@ -346,24 +554,22 @@ EndpointManager::FindConnection(sockaddr* local, sockaddr* peer)
 	SocketAddressStorage wildcard(AddressModule());
 	wildcard.SetToEmpty();
 
-	endpoint = _LookupConnection(local, *wildcard);
+	endpoint = _AcquireConnection(local, *wildcard, hash);
 	if (endpoint != NULL) {
 		TRACE(("TCP: Received packet corresponds to wildcard endpoint %p\n",
 			endpoint));
-		if (gSocketModule->acquire_socket(endpoint->socket))
-			return endpoint;
+		return endpoint;
 	}
 
 	SocketAddressStorage localWildcard(AddressModule());
 	localWildcard.SetToEmpty();
 	localWildcard.SetPort(AddressModule()->get_port(local));
 
-	endpoint = _LookupConnection(*localWildcard, *wildcard);
+	endpoint = _AcquireConnection(*localWildcard, *wildcard, hash);
 	if (endpoint != NULL) {
 		TRACE(("TCP: Received packet corresponds to local wildcard endpoint "
 			"%p\n", endpoint));
-		if (gSocketModule->acquire_socket(endpoint->socket))
-			return endpoint;
+		return endpoint;
 	}
 
 	// no matching endpoint exists
@@ -448,6 +654,10 @@ EndpointManager::_BindToAddress(WriteLocker& locker, TCPEndpoint* endpoint,
 					break;
 				}
 
+				// listeners sharing their port all need to agree to it
+				if (can_share_port(endpoint->socket, user->socket))
+					continue;
+
 				if ((endpoint->socket->options & SO_REUSEADDR) == 0)
 					return EADDRINUSE;
 
@@ -537,7 +747,7 @@ EndpointManager::Unbind(TCPEndpoint* endpoint)
 	if (!fEndpointHash.Remove(endpoint))
 		panic("bound endpoint %p not in hash!", endpoint);
 
-	fConnectionHash.Remove(endpoint);
+	_RemoveConnection(endpoint);
 
 	(*endpoint->LocalAddress())->sa_len = 0;
 
@@ -590,18 +800,23 @@ EndpointManager::Dump() const
 	kprintf("%10s %21s %21s %8s %8s %12s\n", "address", "local", "peer",
 		"recv-q", "send-q", "state");
 
-	ConnectionTable::Iterator iterator = fConnectionHash.GetIterator();
+	for (uint32 i = 0; i < kConnectionShardCount; i++) {
+		ConnectionTable::Iterator iterator
+			= fConnectionShards[i]->table.GetIterator();
 
-	while (iterator.HasNext()) {
-		TCPEndpoint *endpoint = iterator.Next();
+		while (iterator.HasNext()) {
+			TCPEndpoint *endpoint = iterator.Next();
 
-		char localBuf[64], peerBuf[64];
-		endpoint->LocalAddress().AsString(localBuf, sizeof(localBuf), true);
-		endpoint->PeerAddress().AsString(peerBuf, sizeof(peerBuf), true);
+			char localBuf[64], peerBuf[64];
+			endpoint->LocalAddress().AsString(localBuf, sizeof(localBuf),
+				true);
+			endpoint->PeerAddress().AsString(peerBuf, sizeof(peerBuf), true);
 
-		kprintf("%p %21s %21s %8lu %8lu %12s\n", endpoint, localBuf, peerBuf,
-			endpoint->fReceiveQueue.Available(), endpoint->fSendQueue.Used(),
-			name_for_state(endpoint->State()));
+			kprintf("%p %21s %21s %8lu %8lu %12s%s\n", endpoint, localBuf,
+				peerBuf, endpoint->fReceiveQueue.Available(),
+				endpoint->fSendQueue.Used(), name_for_state(endpoint->State()),
+				endpoint->fListenerGroup != NULL ? " (group)" : "");
+		}
 	}
 }
 
@@ -19,6 +19,7 @@
 #include <util/DoublyLinkedList.h>
 #include <util/MultiHashTable.h>
 #include <util/OpenHashTable.h>
+#include <util/Vector.h>
 
 #include <utility>
 
@@ -66,6 +67,24 @@ public:
 };
 
 
+/*!	The endpoints listening on the same local address with SO_REUSEPORT.
+	Only the first member is in the connection table; connection requests
+	are spread among all of them by the hash of their addresses.
+*/
+class ListenerGroup {
+public:
+			status_t		Add(TCPEndpoint* endpoint);
+			void			Remove(TCPEndpoint* endpoint);
+
+			int32			Count() const { return fMembers.Count(); }
+			TCPEndpoint*	First() const { return fMembers.ElementAt(0); }
+			TCPEndpoint*	Select(uint32 hash) const;
+
+private:
+			Vector<TCPEndpoint*> fMembers;
+};
+
+
 class EndpointManager : public DoublyLinkedListLinkImpl<EndpointManager> {
 public:
 							EndpointManager(net_domain* domain);
@@ -96,8 +115,18 @@ public:
 			void			Dump() const;
 
 private:
+			struct ConnectionShard;
+
+			ConnectionShard* _ShardFor(const sockaddr* local,
+								const sockaddr* peer) const;
+			ConnectionShard* _ShardFor(TCPEndpoint* endpoint) const;
 			TCPEndpoint*	_LookupConnection(const sockaddr* local,
 								const sockaddr* peer);
+			TCPEndpoint*	_AcquireConnection(const sockaddr* local,
+								const sockaddr* peer, uint32 hash);
+			status_t		_JoinListenerGroup(TCPEndpoint* listener,
+								TCPEndpoint* endpoint);
+			void			_RemoveConnection(TCPEndpoint* endpoint);
 			status_t		_Bind(TCPEndpoint* endpoint,
 								const sockaddr* address);
 			status_t		_BindToAddress(WriteLocker& locker,
@@ -108,9 +137,16 @@ private:
 	typedef BOpenHashTable<ConnectionHashDefinition> ConnectionTable;
 	typedef MultiHashTable<EndpointHashDefinition> EndpointTable;
 
+	// The connection table is split into shards of their own lock, so that
+	// looking up the endpoints of incoming segments doesn't contend on a
+	// single lock. Changes are serialized by fLock, and additionally need
+	// the write lock of the shard they apply to.
+	static const uint32		kConnectionShardBits = 4;
+	static const uint32		kConnectionShardCount = 1 << kConnectionShardBits;
+
 	rw_lock					fLock;
 	net_domain*				fDomain;
-	ConnectionTable			fConnectionHash;
+	ConnectionShard*		fConnectionShards[kConnectionShardCount];
 	EndpointTable			fEndpointHash;
 	uint16					fLastPort;
 };
@@ -0,0 +1,263 @@
+/*
+ * Copyright 2026, Haiku, Inc. All Rights Reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+#include "SackScoreboard.h"
+
+#include <string.h>
+
+
+// number of duplicate acknowledgments, or segments SACKed above, that let
+// a segment be considered lost (RFC 6675 "DupThresh")
+static const int32 kDuplicateThreshold = 3;
+
+
+static inline bool
+time_before(uint32 a, uint32 b)
+{
+	return (int32)(a - b) < 0;
+}
+
+
+SackScoreboard::SackScoreboard()
+{
+	Reset();
+}
+
+
+void
+SackScoreboard::Reset()
+{
+	fCount = 0;
+	fSackedBytes = 0;
+	fLastSackTime = 0;
+}
+
+
+/*!	Adds the \a count SACK blocks of an acknowledgment, and forgets about
+	everything up to \a acknowledge. Blocks outside of the outstanding data
+	(including D-SACK blocks) are ignored.
+	Returns whether any data has been newly SACKed.
+*/
+bool
+SackScoreboard::Update(tcp_sequence acknowledge, tcp_sequence sendMax,
+	const tcp_sack* sacks, int count, uint32 now)
+{
+	RemoveUntil(acknowledge);
+
+	bool changed = false;
+	for (int i = 0; i < count; i++) {
+		tcp_sequence start = sacks[i].left_edge;
+		tcp_sequence end = sacks[i].right_edge;
+		if (end <= start || end <= acknowledge || end > sendMax)
+			continue;
+
+		if (start < acknowledge)
+			start = acknowledge;
+
+		_Insert(start, end, now, changed);
+	}
+
+	if (changed)
+		fLastSackTime = now;
+
+	return changed;
+}
+
+
+void
+SackScoreboard::RemoveUntil(tcp_sequence acknowledge)
+{
+	int32 count = 0;
+	while (count < fCount && fBlocks[count].end <= acknowledge) {
+		fSackedBytes -= (fBlocks[count].end - fBlocks[count].start).Number();
+		count++;
+	}
+
+	if (count > 0) {
+		fCount -= count;
+		memmove(&fBlocks[0], &fBlocks[count], fCount * sizeof(block));
+	}
+
+	if (fCount > 0 && fBlocks[0].start < acknowledge) {
+		fSackedBytes -= (acknowledge - fBlocks[0].start).Number();
+		fBlocks[0].start = acknowledge;
+	}
+}
+
+
+tcp_sequence
+SackScoreboard::HighestSacked() const
+{
+	return fCount > 0 ? fBlocks[fCount - 1].end : tcp_sequence(0);
+}
+
+
+/*!	Implements IsLost() of RFC 6675: \a sequence is lost, if DupThresh
+	discontiguous blocks, or more than (DupThresh - 1) * SMSS bytes have
+	been SACKed above it.
+*/
+bool
+SackScoreboard::IsLost(tcp_sequence sequence, uint32 maxSegmentSize) const
+{
+	uint32 sackedBytes = 0;
+	int32 blocks = 0;
+
+	for (int32 i = fCount; i-- > 0 && fBlocks[i].start > sequence;) {
+		sackedBytes += (fBlocks[i].end - fBlocks[i].start).Number();
+		blocks++;
+	}
+
+	return blocks >= kDuplicateThreshold
+		|| sackedBytes > (kDuplicateThreshold - 1) * maxSegmentSize;
+}
+
+
+/*!	Finds the first range at or after \a from that has not been SACKed, but
+	has SACKed data above it.
+*/
+bool
+SackScoreboard::NextHole(tcp_sequence from, tcp_sequence& _start,
+	tcp_sequence& _end) const
+{
+	tcp_sequence cursor = from;
+
+	for (int32 i = 0; i < fCount; i++) {
+		if (fBlocks[i].end <= cursor)
+			continue;
+
+		if (fBlocks[i].start > cursor) {
+			_start = cursor;
+			_end = fBlocks[i].start;
+			return true;
+		}
+
+		cursor = fBlocks[i].end;
+	}
+
+	return false;
+}
+
+
+/*!	Returns in \a _time when data above \a sequence has been SACKed for the
+	first time, and \c false if there is no such data.
+*/
+bool
+SackScoreboard::FirstSackedAbove(tcp_sequence sequence, uint32& _time) const
+{
+	bool found = false;
+
+	for (int32 i = fCount; i-- > 0 && fBlocks[i].start > sequence;) {
+		if (!found || time_before(fBlocks[i].time, _time))
+			_time = fBlocks[i].time;
+		found = true;
+	}
+
+	return found;
+}
+
+
+/*!	Implements SetPipe() of RFC 6675: the number of bytes presumed to be
+	still in the network. Data that is neither SACKed nor considered lost
+	counts once, and its retransmissions (up to \a highRetransmitted)
+	another time.
+*/
+uint32
+SackScoreboard::Pipe(tcp_sequence acknowledge, tcp_sequence sendMax,
+	tcp_sequence highRetransmitted, uint32 maxSegmentSize) const
+{
+	uint32 pipe = 0;
+	uint32 sackedAbove = fSackedBytes;
+	tcp_sequence cursor = acknowledge;
+
+	for (int32 i = 0; i <= fCount; i++) {
+		tcp_sequence end = i < fCount ? fBlocks[i].start : sendMax;
+
+		if (end > cursor) {
+			bool lost = fCount - i >= kDuplicateThreshold
+				|| sackedAbove > (kDuplicateThreshold - 1) * maxSegmentSize;
+			if (!lost)
+				pipe += (end - cursor).Number();
+
+			if (highRetransmitted > cursor) {
+				pipe += ((highRetransmitted < end ? highRetransmitted : end)
+					- cursor).Number();
+			}
+		}
+
+		if (i == fCount)
+			break;
+
+		sackedAbove -= (fBlocks[i].end - fBlocks[i].start).Number();
+		cursor = fBlocks[i].end;
+	}
+
+	return pipe;
+}
+
+
+void
+SackScoreboard::_Insert(tcp_sequence start, tcp_sequence end, uint32 now,
+	bool& _changed)
+{
+	// find the first block that overlaps with, or directly follows the range
+	int32 first = 0;
+	while (first < fCount && fBlocks[first].end < start)
+		first++;
+
+	int32 last = first;
+	uint32 mergedBytes = 0;
+	uint32 time = now;
+	while (last < fCount && fBlocks[last].start <= end) {
+		if (fBlocks[last].start < start)
+			start = fBlocks[last].start;
+		if (fBlocks[last].end > end)
+			end = fBlocks[last].end;
+		if (time_before(fBlocks[last].time, time))
+			time = fBlocks[last].time;
+
+		mergedBytes += (fBlocks[last].end - fBlocks[last].start).Number();
+		last++;
+	}
+
+	if (first == last) {
+		// this is a new block
+		if (fCount == kMaxBlocks) {
+			if (first == 0)
+				return;
+
+			_Remove(0);
+			first--;
+		}
+
+		memmove(&fBlocks[first + 1], &fBlocks[first],
+			(fCount - first) * sizeof(block));
+		fCount++;
+	} else if (last > first + 1) {
+		memmove(&fBlocks[first + 1], &fBlocks[last],
+			(fCount - last) * sizeof(block));
+		fCount -= last - first - 1;
+	}
+
+	fBlocks[first].start = start;
+	fBlocks[first].end = end;
+	fBlocks[first].time = time;
+
+	uint32 bytes = (end - start).Number();
+	if (bytes > mergedBytes) {
+		fSackedBytes += bytes - mergedBytes;
+		_changed = true;
+	}
+}
+
+
+void
+SackScoreboard::_Remove(int32 index)
+{
+	fSackedBytes -= (fBlocks[index].end - fBlocks[index].start).Number();
+	fCount--;
+	memmove(&fBlocks[index], &fBlocks[index + 1],
+		(fCount - index) * sizeof(block));
+}
@@ -0,0 +1,69 @@
+/*
+ * Copyright 2026, Haiku, Inc. All Rights Reserved.
+ * Distributed under the terms of the MIT License.
+ */
+#ifndef SACK_SCOREBOARD_H
+#define SACK_SCOREBOARD_H
+
+
+#include "tcp.h"
+
+
+/*!	The sender's view of the data the receiver has selectively acknowledged,
+	as described in RFC 6675. Only the ranges above the cumulative
+	acknowledgment are kept, sorted by sequence number.
+*/
+class SackScoreboard {
+public:
+								SackScoreboard();
+
+			void				Reset();
+
+			bool				Update(tcp_sequence acknowledge,
+									tcp_sequence sendMax, const tcp_sack* sacks,
+									int count, uint32 now);
+			void				RemoveUntil(tcp_sequence acknowledge);
+
+			bool				IsEmpty() const { return fCount == 0; }
+			tcp_sequence		HighestSacked() const;
+			uint32				SackedBytes() const { return fSackedBytes; }
+
+			bool				IsLost(tcp_sequence sequence,
+									uint32 maxSegmentSize) const;
+			bool				NextHole(tcp_sequence from,
+									tcp_sequence& _start,
+									tcp_sequence& _end) const;
+			bool				FirstSackedAbove(tcp_sequence sequence,
+									uint32& _time) const;
+			uint32				LastSackTime() const { return fLastSackTime; }
+			uint32				Pipe(tcp_sequence acknowledge,
+									tcp_sequence sendMax,
+									tcp_sequence highRetransmitted,
+									uint32 maxSegmentSize) const;
+
+private:
+	struct block {
+		tcp_sequence	start;
+		tcp_sequence	end;
+		uint32			time;
+			// when data in this block was first SACKed
+	};
+
+	// The receiver reports at most four blocks per segment, so this is
+	// plenty for all but extreme loss patterns; the lowest blocks are
+	// forgotten first, which only delays their holes' loss detection.
+	static const int32	kMaxBlocks = 32;
+
+			void				_Insert(tcp_sequence start, tcp_sequence end,
+									uint32 now, bool& _changed);
+			void				_Remove(int32 index);
+
+private:
+			block				fBlocks[kMaxBlocks];
+			int32				fCount;
+			uint32				fSackedBytes;
+			uint32				fLastSackTime;
+};
+
+
+#endif	// SACK_SCOREBOARD_H
@@ -35,6 +35,7 @@
 #include <util/AutoLock.h>
 #include <util/list.h>
 
+#include "CongestionControl.h"
 #include "EndpointManager.h"
 
 
@@ -323,6 +324,7 @@ enum {
 	FLAG_RECOVERY				= 0x40,
 	FLAG_OPTION_SACK_PERMITTED	= 0x80,
 	FLAG_AUTO_RECEIVE_BUFFER_SIZE = 0x100,
+	FLAG_LOSS_PROBE				= 0x200,
 };
 
 
@@ -422,6 +424,7 @@ state_needs_finish(int32 state)
 TCPEndpoint::TCPEndpoint(net_socket* socket)
 	:
 	ProtocolSocket(socket),
+	fListenerGroup(NULL),
 	fManager(NULL),
 	fOptions(0),
 	fSendWindowShift(0),
@@ -440,6 +443,9 @@ TCPEndpoint::TCPEndpoint(net_socket* socket)
 	fDuplicateAcknowledgeCount(0),
 	fPreviousFlightSize(0),
 	fRecover(0),
+	fHighRetransmitted(0),
+	fRescueRetransmitted(0),
+	fRetransmitTime(0),
 	fRoute(NULL),
 	fReceiveNext(0),
 	fReceiveMaxAdvertised(0),
@@ -454,6 +460,7 @@ TCPEndpoint::TCPEndpoint(net_socket* socket)
 	fReceivedTimestamp(0),
 	fCongestionWindow(0),
 	fSlowStartThreshold(0),
+	fCongestionControl(NULL),
 	fState(CLOSED),
 	fFlags(FLAG_OPTION_WINDOW_SCALE | FLAG_OPTION_TIMESTAMP
 		| FLAG_OPTION_SACK_PERMITTED | FLAG_AUTO_RECEIVE_BUFFER_SIZE)
@@ -471,6 +478,10 @@ TCPEndpoint::TCPEndpoint(net_socket* socket)
 		TCPEndpoint::_DelayedAcknowledgeTimer, this);
 	gStackModule->init_timer(&fTimeWaitTimer, TCPEndpoint::_TimeWaitTimer,
 		this);
+	gStackModule->init_timer(&fLossProbeTimer, TCPEndpoint::_LossProbeTimer,
+		this);
+
+	create_congestion_control(*this, NULL, &fCongestionControl);
 
 	T(APICall(this, "constructor"));
 }
@@ -498,14 +509,19 @@ TCPEndpoint::~TCPEndpoint()
 	gStackModule->wait_for_timer(&fPersistTimer);
 	gStackModule->wait_for_timer(&fDelayedAcknowledgeTimer);
 	gStackModule->wait_for_timer(&fTimeWaitTimer);
+	gStackModule->wait_for_timer(&fLossProbeTimer);
 
 	gDatalinkModule->put_route(Domain(), fRoute);
+	delete fCongestionControl;
 }
 
 
 status_t
 TCPEndpoint::InitCheck() const
 {
+	if (fCongestionControl == NULL)
+		return B_NO_MEMORY;
+
 	return B_OK;
 }
 
@@ -1085,6 +1101,20 @@ TCPEndpoint::SetReceiveBufferSize(size_t length)
 status_t
 TCPEndpoint::GetOption(int option, void* _value, int* _length)
 {
+	if (option == TCP_CONGESTION) {
+		if (*_length <= 0)
+			return B_BAD_VALUE;
+
+		char name[TCP_CA_NAME_MAX];
+		MutexLocker _(fLock);
+		strlcpy(name, fCongestionControl->Name(), sizeof(name));
+
+		// only copy the name itself, not the rest of the buffer
+		*_length = min_c(*_length, (int)strlen(name) + 1);
+		memcpy(_value, name, *_length);
+		return B_OK;
+	}
+
 	if (*_length != sizeof(int))
 		return B_BAD_VALUE;
 
@@ -1111,6 +1141,8 @@ TCPEndpoint::GetOption(int option, void* _value, int* _length)
 status_t
 TCPEndpoint::SetOption(int option, const void* _value, int length)
 {
+	if (option == TCP_CONGESTION)
+		return _SetCongestionControl((const char*)_value, length);
 	if (option != TCP_NODELAY)
 		return B_BAD_VALUE;
 
@@ -1129,6 +1161,38 @@ TCPEndpoint::SetOption(int option, const void* _value, int length)
 }
 
 
+/*!	Replaces the congestion control algorithm; the congestion window and slow
+	start threshold are kept, and just evolve differently from now on.
+*/
+status_t
+TCPEndpoint::_SetCongestionControl(const char* value, int length)
+{
+	if (length <= 0)
+		return B_BAD_VALUE;
+
+	// the name does not need to be null terminated
+	char name[TCP_CA_NAME_MAX];
+	length = min_c(length, (int)sizeof(name) - 1);
+	memcpy(name, value, length);
+	name[length] = '\0';
+
+	MutexLocker _(fLock);
+
+	if (strcmp(name, fCongestionControl->Name()) == 0)
+		return B_OK;
+
+	CongestionControl* congestionControl;
+	status_t status = create_congestion_control(*this, name,
+		&congestionControl);
+	if (status != B_OK)
+		return status;
+
+	delete fCongestionControl;
+	fCongestionControl = congestionControl;
+	return B_OK;
+}
+
+
 //	#pragma mark - misc
 
 
@@ -1204,6 +1268,8 @@ TCPEndpoint::_CancelConnectionTimers()
 	T(TimerSet(this, "persist", -1));
 	gStackModule->cancel_timer(&fDelayedAcknowledgeTimer);
 	T(TimerSet(this, "delayed ack", -1));
+	gStackModule->cancel_timer(&fLossProbeTimer);
+	T(TimerSet(this, "loss probe", -1));
 }
 
 
@@ -1309,22 +1375,32 @@ TCPEndpoint::_DuplicateAcknowledge(tcp_segment_header &segment)
 	if (fDuplicateAcknowledgeCount == 0)
 		fPreviousFlightSize = (fSendMax - fSendUnacknowledged).Number();
 
-	if (++fDuplicateAcknowledgeCount < 3) {
-		if (fSendQueue.Available(fSendMax) != 0 && fSendWindow != 0) {
-			fSendNext = fSendMax;
-			fCongestionWindow += fDuplicateAcknowledgeCount * fSendMaxSegmentSize;
-			_SendQueued();
-			TRACE("_DuplicateAcknowledge(): packet sent under limited transmit on receipt of dup ack");
-			fCongestionWindow -= fDuplicateAcknowledgeCount * fSendMaxSegmentSize;
+	if (_UsesSack()) {
+		fDuplicateAcknowledgeCount++;
+
+		if ((fFlags & FLAG_RECOVERY) != 0)
+			_SendSackRecovery();
+		else if ((fDuplicateAcknowledgeCount >= 3
+				|| _IsLost(fSendUnacknowledged))
+			&& (segment.acknowledge - 1) > fRecover) {
+			_EnterSackRecovery();
+		} else {
+			if (fDuplicateAcknowledgeCount < 3)
+				_LimitedTransmit();
+			_UpdateLossProbeTimer();
 		}
+		return;
 	}
 
+	if (++fDuplicateAcknowledgeCount < 3)
+		_LimitedTransmit();
+
 	if (fDuplicateAcknowledgeCount == 3) {
 		if ((segment.acknowledge - 1) > fRecover || (fCongestionWindow > fSendMaxSegmentSize &&
 			(fSendUnacknowledged - fPreviousHighestAcknowledge) <= 4 * fSendMaxSegmentSize)) {
 			fFlags |= FLAG_RECOVERY;
 			fRecover = fSendMax.Number() - 1;
-			fSlowStartThreshold = max_c(fPreviousFlightSize / 2, 2 * fSendMaxSegmentSize);
+			fCongestionControl->EnterRecovery(fPreviousFlightSize);
 			fCongestionWindow = fSlowStartThreshold + 3 * fSendMaxSegmentSize;
 			fSendNext = segment.acknowledge;
 			_SendQueued();
@@ -1342,6 +1418,297 @@ TCPEndpoint::_DuplicateAcknowledge(tcp_segment_header &segment)
 }
 
 
+//!	Sends new data on the first two duplicate acknowledgments (RFC 3042).
+void
+TCPEndpoint::_LimitedTransmit()
+{
+	if (fSendQueue.Available(fSendMax) == 0 || fSendWindow == 0)
+		return;
+
+	fSendNext = fSendMax;
+	fCongestionWindow += fDuplicateAcknowledgeCount * fSendMaxSegmentSize;
+	_SendQueued();
+	TRACE("_LimitedTransmit(): packet sent under limited transmit on receipt of dup ack");
+	fCongestionWindow -= fDuplicateAcknowledgeCount * fSendMaxSegmentSize;
+}
+
+
+/*!	Returns whether the peer's selective acknowledgments are used for loss
+	recovery, instead of NewReno's fast retransmit and fast recovery.
+*/
+bool
+TCPEndpoint::_UsesSack() const
+{
+	return (fFlags & FLAG_OPTION_SACK_PERMITTED) != 0
+		&& (fOptions & TCP_NOOPT) == 0;
+}
+
+
+/*!	The time in ms a segment may arrive out of order, after data sent after
+	it has been SACKed, before it is considered lost (RACK's "reo_wnd").
+*/
+uint32
+TCPEndpoint::_ReorderingWindow() const
+{
+	return max_c(fSmoothedRoundTripTime / 4, 1);
+}
+
+
+/*!	A hole in the scoreboard starting at \a sequence is lost, if either
+	enough data has been SACKed above it (RFC 6675), or data above it has
+	been SACKed longer than the reordering window ago (RFC 8985).
+*/
+bool
+TCPEndpoint::_IsLost(tcp_sequence sequence) const
+{
+	if (fSackScoreboard.IsLost(sequence, fSendMaxSegmentSize))
+		return true;
+
+	uint32 sackTime;
+	return fSmoothedRoundTripTime > 0
+		&& fSackScoreboard.FirstSackedAbove(sequence, sackTime)
+		&& tcp_diff_timestamp(sackTime) >= _ReorderingWindow();
+}
+
+
+/*!	Enters loss recovery as described in RFC 6675 section 5: the first
+	unacknowledged segment is retransmitted right away, and further holes
+	are filled as the pipe allows.
+*/
+void
+TCPEndpoint::_EnterSackRecovery()
+{
+	TRACE("_EnterSackRecovery(): una %" B_PRIu32 ", max %" B_PRIu32,
+		fSendUnacknowledged.Number(), fSendMax.Number());
+
+	fFlags |= FLAG_RECOVERY;
+	fFlags &= ~FLAG_LOSS_PROBE;
+	fRecover = fSendMax.Number() - 1;
+	gStackModule->cancel_timer(&fLossProbeTimer);
+
+	fCongestionControl->EnterRecovery(
+		(fSendMax - fSendUnacknowledged).Number());
+	fCongestionWindow = fSlowStartThreshold;
+
+	uint32 length = fSendMaxSegmentSize;
+	tcp_sequence start, end;
+	if (fSackScoreboard.NextHole(fSendUnacknowledged, start, end)
+		&& start == fSendUnacknowledged)
+		length = min_c(length, (end - start).Number());
+
+	fHighRetransmitted = fSendUnacknowledged;
+	if (_SendSegment(fSendUnacknowledged, length, true) != B_OK)
+		return;
+
+	fRescueRetransmitted = fHighRetransmitted;
+	_SendSackRecovery();
+}
+
+
+/*!	Sends as much as the congestion window allows during loss recovery,
+	following NextSeg() of RFC 6675: lost data first, then new data, and
+	finally a rescue retransmission of the tail of the window.
+*/
+void
+TCPEndpoint::_SendSackRecovery()
+{
+	if (fHighRetransmitted < fSendUnacknowledged)
+		fHighRetransmitted = fSendUnacknowledged;
+
+	// A retransmission that hasn't been acknowledged a round trip after it
+	// was sent, while later data was, is lost again (RFC 8985); start over
+	// with the first hole then.
+	if (fHighRetransmitted > fSendUnacknowledged && fSmoothedRoundTripTime > 0
+		&& (int32)(fSackScoreboard.LastSackTime() - fRetransmitTime)
+			>= fSmoothedRoundTripTime
+		&& tcp_diff_timestamp(fRetransmitTime)
+			>= fSmoothedRoundTripTime + _ReorderingWindow()) {
+		TRACE("_SendSackRecovery(): retransmission lost");
+		fHighRetransmitted = fSendUnacknowledged;
+	}
+
+	uint32 maxSegmentSize = fSendMaxSegmentSize;
+
+	while (fSackScoreboard.Pipe(fSendUnacknowledged, fSendMax,
+			fHighRetransmitted, maxSegmentSize) + maxSegmentSize
+				<= fCongestionWindow) {
+		// (1) retransmit the first hole above HighRxt that is lost
+		tcp_sequence start, end;
+		if (fSackScoreboard.NextHole(fHighRetransmitted, start, end)
+			&& _IsLost(start)) {
+			uint32 length = min_c((end - start).Number(), maxSegmentSize);
+			if (_SendSegment(start, length, true) != B_OK)
+				break;
+			continue;
+		}
+
+		// (2) send new data, as far as the receiver allows
+		uint32 available = fSendQueue.Available(fSendMax);
+		uint32 window = 0;
+		if (fSendUnacknowledged + fSendWindow > fSendMax)
+			window = (fSendUnacknowledged + fSendWindow - fSendMax).Number();
+		if ((available > 0 && window > 0) || (state_needs_finish(fState)
+				&& fSendMax == fSendQueue.LastSequence())) {
+			uint32 length = min_c(min_c(available, window), maxSegmentSize);
+			if (_SendSegment(fSendMax, length, false) != B_OK)
+				break;
+			continue;
+		}
+
+		// (4) retransmit the highest segment once per recovery, so that the
+		// ACK clock keeps going when the tail of the window has been lost
+		if (fSendUnacknowledged > fRescueRetransmitted
+			&& (fSackScoreboard.IsEmpty()
+				|| fSackScoreboard.HighestSacked() < fSendMax)) {
+			uint32 length = min_c((fSendMax - fSendUnacknowledged).Number(),
+				maxSegmentSize);
+			fRescueRetransmitted = fRecover + 1;
+
+			tcp_sequence highRetransmitted = fHighRetransmitted;
+			_SendSegment(fSendMax - length, length, true);
+			fHighRetransmitted = highRetransmitted;
+		}
+		break;
+	}
+}
+
+
+/*!	Sends \a length bytes of the send queue starting at \a start, or just
+	the FIN if that's all that is left there. Unlike _SendQueued(), this does
+	not touch fSendNext, and can therefore retransmit any part of the window.
+*/
+status_t
+TCPEndpoint::_SendSegment(tcp_sequence start, uint32 length, bool retransmit)
+{
+	if (fRoute == NULL || fState < ESTABLISHED)
+		return B_ERROR;
+
+	tcp_segment_header segment = _PrepareSendSegment();
+
+	length = min_c(length, fSendQueue.Available(start));
+	length = min_c(length, fSendMaxSegmentSize - tcp_options_length(segment));
+
+	if (start + length == fSendQueue.LastSequence()) {
+		if (state_needs_finish(fState))
+			segment.flags |= TCP_FLAG_FINISH;
+		if (length > 0)
+			segment.flags |= TCP_FLAG_PUSH;
+	}
+
+	if (length == 0 && (segment.flags & TCP_FLAG_FINISH) == 0)
+		return B_ENTRY_NOT_FOUND;
+
+	net_buffer* buffer = gBufferModule->create(256);
+	if (buffer == NULL)
+		return B_NO_MEMORY;
+
+	if (length > 0) {
+		status_t status = fSendQueue.Get(buffer, start, length);
+		if (status != B_OK) {
+			gBufferModule->free(buffer);
+			return status;
+		}
+	}
+
+	tcp_sequence sendNext = fSendNext;
+	fSendNext = start;
+
+	status_t status = _PrepareAndSend(segment, buffer, retransmit);
+	if (fSendNext < sendNext)
+		fSendNext = sendNext;
+	if (status != B_OK)
+		return status;
+
+	if (retransmit && start + length > fHighRetransmitted) {
+		if (start <= fSendUnacknowledged || fHighRetransmitted
+				<= fSendUnacknowledged)
+			fRetransmitTime = tcp_now();
+		fHighRetransmitted = start + length;
+	}
+
+	if (!gStackModule->is_timer_active(&fRetransmitTimer)) {
+		gStackModule->set_timer(&fRetransmitTimer, fRetransmitTimeout);
+		T(TimerSet(this, "retransmit", fRetransmitTimeout));
+	}
+
+	return B_OK;
+}
+
+
+/*!	Arms the loss probe timer, which serves two purposes (RFC 8985): with
+	SACKed data outstanding, it declares the holes below lost once the
+	reordering window has passed. Otherwise, it sends a tail loss probe
+	after two round trips without acknowledgment, so that losses at the
+	end of a flight are detected without waiting for the retransmit timeout.
+*/
+void
+TCPEndpoint::_UpdateLossProbeTimer()
+{
+	bigtime_t timeout = -1;
+
+	if (_UsesSack() && (fFlags & FLAG_RECOVERY) == 0
+		&& fState >= ESTABLISHED && fSmoothedRoundTripTime > 0
+		&& fSendUnacknowledged != fSendMax) {
+		if (!fSackScoreboard.IsEmpty())
+			timeout = _ReorderingWindow() * kTimestampFactor;
+		else if ((fFlags & FLAG_LOSS_PROBE) == 0) {
+			timeout = 2 * fSmoothedRoundTripTime * kTimestampFactor;
+			if ((fSendMax - fSendUnacknowledged).Number()
+					<= fSendMaxSegmentSize) {
+				// the probe's acknowledgment might be delayed
+				timeout += 2 * TCP_DELAYED_ACKNOWLEDGE_TIMEOUT;
+			}
+			if (timeout >= fRetransmitTimeout)
+				timeout = -1;
+		}
+	}
+
+	if (timeout < 0) {
+		gStackModule->cancel_timer(&fLossProbeTimer);
+		T(TimerSet(this, "loss probe", -1));
+		return;
+	}
+
+	gStackModule->set_timer(&fLossProbeTimer, timeout);
+	T(TimerSet(this, "loss probe", timeout));
+}
+
+
+void
+TCPEndpoint::_LossProbe()
+{
+	if (fState < ESTABLISHED || (fFlags & FLAG_RECOVERY) != 0
+		|| fSendUnacknowledged == fSendMax)
+		return;
+
+	if (!fSackScoreboard.IsEmpty()) {
+		tcp_sequence start, end;
+		if (fSackScoreboard.NextHole(fSendUnacknowledged, start, end)
+			&& _IsLost(start)
+			&& (fSendUnacknowledged.Number() - 1) > fRecover)
+			_EnterSackRecovery();
+		else
+			_UpdateLossProbeTimer();
+		return;
+	}
+
+	// Send a probe, new data if possible, or the last segment otherwise; its
+	// acknowledgment will tell which part of the window has been lost.
+	TRACE("_LossProbe(): sending tail loss probe");
+	fFlags |= FLAG_LOSS_PROBE;
+
+	uint32 available = fSendQueue.Available(fSendMax);
+	if (available > 0 && fSendUnacknowledged + fSendWindow > fSendMax
+		&& _SendSegment(fSendMax, min_c(available, fSendMaxSegmentSize),
+			false) == B_OK)
+		return;
+
+	uint32 length = min_c((fSendMax - fSendUnacknowledged).Number(),
+		fSendMaxSegmentSize);
+	_SendSegment(fSendMax - length, length, true);
+}
+
+
 void
 TCPEndpoint::_UpdateTimestamps(tcp_segment_header& segment,
 	size_t segmentLength)
@@ -1529,6 +1896,7 @@ TCPEndpoint::_PrepareReceivePath(tcp_segment_header& segment)
 
 	fSendMaxSegments = fCongestionWindow / fSendMaxSegmentSize;
 	fSlowStartThreshold = (uint32)segment.advertised_window << fSendWindowShift;
+	fCongestionControl->Initialize();
 }
 
 
@@ -1574,6 +1942,15 @@ TCPEndpoint::_Spawn(TCPEndpoint* parent, tcp_segment_header& segment,
 	fOptions = parent->fOptions;
 	fAcceptSemaphore = parent->fAcceptSemaphore;
 
+	CongestionControl* congestionControl;
+	if (strcmp(parent->fCongestionControl->Name(),
+			fCongestionControl->Name()) != 0
+		&& create_congestion_control(*this, parent->fCongestionControl->Name(),
+			&congestionControl) == B_OK) {
+		delete fCongestionControl;
+		fCongestionControl = congestionControl;
+	}
+
 	_PrepareReceivePath(segment);
 
 	// send SYN+ACK
@@ -1832,9 +2209,19 @@ TCPEndpoint::_Receive(tcp_segment_header& segment, net_buffer* buffer)
 		if (fSendMax < segment.acknowledge)
 			return DROP | IMMEDIATE_ACKNOWLEDGE;
 
+		bool sacked = false;
+		if ((segment.options & TCP_HAS_SACK) != 0 && _UsesSack()
+			&& segment.acknowledge >= fSendUnacknowledged) {
+			sacked = fSackScoreboard.Update(segment.acknowledge, fSendMax,
+				segment.sacks, segment.sackCount, tcp_now());
+		}
+
 		if (segment.acknowledge == fSendUnacknowledged) {
-			if (buffer->size == 0 && advertisedWindow == fSendWindow
-				&& (segment.flags & TCP_FLAG_FINISH) == 0 && fSendUnacknowledged != fSendMax) {
+			// a segment that SACKs new data is a duplicate acknowledgment
+			// as well, even if it carries data or updates the window
+			if (fSendUnacknowledged != fSendMax && (sacked
+				|| (buffer->size == 0 && advertisedWindow == fSendWindow
+					&& (segment.flags & TCP_FLAG_FINISH) == 0))) {
 				TRACE("Receive(): duplicate ack!");
 				_DuplicateAcknowledge(segment);
 			}
@@ -1843,12 +2230,11 @@ TCPEndpoint::_Receive(tcp_segment_header& segment, net_buffer* buffer)
 		} else {
 			// this segment acknowledges in flight data
 
-			if (fDuplicateAcknowledgeCount >= 3) {
+			if (fDuplicateAcknowledgeCount >= 3
+				|| (fFlags & FLAG_RECOVERY) != 0) {
 				// deflate the window.
 				if (segment.acknowledge > fRecover) {
-					uint32 flightSize = (fSendMax - fSendUnacknowledged).Number();
-					fCongestionWindow = min_c(fSlowStartThreshold,
-						max_c(flightSize, fSendMaxSegmentSize) + fSendMaxSegmentSize);
+					fCongestionControl->ExitRecovery();
 					fFlags &= ~FLAG_RECOVERY;
 				}
 			}
@@ -2127,6 +2513,9 @@ TCPEndpoint::_PrepareAndSend(tcp_segment_header& segment, net_buffer* buffer,
 	PeerAddress().CopyTo(buffer->destination);
 
 	uint32 size = buffer->size, segmentLength = size;
+	uint32 segmentCount = 1;
+	if (buffer->segment_size != 0)
+		segmentCount = (size + buffer->segment_size - 1) / buffer->segment_size;
 	segment.sequence = fSendNext.Number();
 
 	TRACE("_PrepareAndSend(): buffer %p (%" B_PRIu32 " bytes) address %s to "
@@ -2172,7 +2561,7 @@ TCPEndpoint::_PrepareAndSend(tcp_segment_header& segment, net_buffer* buffer,
 	fReceiveMaxAdvertised = fReceiveNext + segment.AdvertisedWindow(fReceiveWindowShift);
 
 	if (segmentLength != 0 && fState == ESTABLISHED)
-		--fSendMaxSegments;
+		fSendMaxSegments -= segmentCount;
 
 	if (fSendTime == 0 && !isRetransmit
 			&& (segmentLength != 0 || (segment.flags & TCP_FLAG_SYNCHRONIZE) != 0)) {
@@ -2316,6 +2705,19 @@ TCPEndpoint::_SendQueued(bool force)
 			- tcp_options_length(segment);
 		uint32 segmentLength = min_c(length, segmentMaxSize);
 
+		// Send as many full segments as we can at once; the super-segment is
+		// only split into individual segments when it leaves the host.
+		uint32 segmentCount = 1;
+		if (!force && !retransmit && length >= 2 * segmentMaxSize
+			&& fSendUrgentOffset <= fSendNext
+			&& (segment.flags & (TCP_FLAG_SYNCHRONIZE | TCP_FLAG_RESET)) == 0) {
+			segmentCount = min_c(length, TCP_MAX_OFFLOAD_SIZE) / segmentMaxSize;
+			if (fState == ESTABLISHED)
+				segmentCount = min_c(segmentCount, fSendMaxSegments);
+			if (segmentCount > 1)
+				segmentLength = segmentCount * segmentMaxSize;
+		}
+
 		if ((fSendNext + segmentLength) == fSendQueue.LastSequence() && !force) {
 			if (state_needs_finish(fState))
 				segment.flags |= TCP_FLAG_FINISH;
@@ -2324,8 +2726,9 @@ TCPEndpoint::_SendQueued(bool force)
 		}
 
 		// Determine if we should really send this segment
-		if (!force && !retransmit && !_ShouldSendSegment(segment, segmentLength,
-				segmentMaxSize, flightSize)) {
+		if (!force && !retransmit && !_ShouldSendSegment(segment,
+				min_c(segmentLength, segmentMaxSize), segmentMaxSize,
+				flightSize)) {
 			if (fSendQueue.Available()
 				&& !gStackModule->is_timer_active(&fPersistTimer)
 				&& !gStackModule->is_timer_active(&fRetransmitTimer))
@@ -2345,6 +2748,9 @@ TCPEndpoint::_SendQueued(bool force)
 			return status;
 		}
 
+		if (segmentCount > 1)
+			buffer->segment_size = segmentMaxSize;
+
 		sendWindow -= buffer->size;
 
 		status = _PrepareAndSend(segment, buffer, retransmit);
@@ -2357,6 +2763,7 @@ TCPEndpoint::_SendQueued(bool force)
 			gStackModule->set_timer(&fRetransmitTimer, fRetransmitTimeout);
 			T(TimerSet(this, "retransmit", fRetransmitTimeout));
 			shouldStartRetransmitTimer = false;
+			_UpdateLossProbeTimer();
 		}
 
 		length -= segmentLength;
@@ -2436,6 +2843,8 @@ TCPEndpoint::_Acknowledged(tcp_segment_header& segment)
 
 	if (fSendUnacknowledged < segment.acknowledge) {
 		fSendQueue.RemoveUntil(segment.acknowledge);
+		fSackScoreboard.RemoveUntil(segment.acknowledge);
+		fFlags &= ~FLAG_LOSS_PROBE;
 
 		uint32 bytesAcknowledged = segment.acknowledge - fSendUnacknowledged.Number();
 		fPreviousHighestAcknowledge = fSendUnacknowledged;
@@ -2448,25 +2857,28 @@ TCPEndpoint::_Acknowledged(tcp_segment_header& segment)
 			fRecover = segment.acknowledge - 1;
 		}
 
+		int32 roundTripTime = -1;
+		if (fFlags & FLAG_OPTION_TIMESTAMP) {
+			roundTripTime = tcp_diff_timestamp(segment.timestamp_reply);
+			_UpdateRoundTripTime(roundTripTime,
+				expectedSamples > 0 ? expectedSamples : 1);
+		} else if (fSendTime != 0 && fRoundTripStartSequence < segment.acknowledge) {
+			roundTripTime = tcp_diff_timestamp(fSendTime);
+			_UpdateRoundTripTime(roundTripTime, 1);
+			fSendTime = 0;
+		}
+
 		// the acknowledgment of the SYN/ACK MUST NOT increase the size of the congestion window
 		if (fSendUnacknowledged != fInitialSendSequence) {
-			if (fCongestionWindow < fSlowStartThreshold)
-				fCongestionWindow += min_c(bytesAcknowledged, fSendMaxSegmentSize);
-			else {
-				uint32 increment = fSendMaxSegmentSize * fSendMaxSegmentSize;
-
-				if (increment < fCongestionWindow)
-					increment = 1;
-				else
-					increment /= fCongestionWindow;
-
-				fCongestionWindow += increment;
-			}
-
+			fCongestionControl->Acknowledged(bytesAcknowledged, roundTripTime,
+				(fFlags & FLAG_RECOVERY) != 0);
 			fSendMaxSegments = UINT32_MAX;
 		}
 
-		if ((fFlags & FLAG_RECOVERY) != 0) {
+		if ((fFlags & FLAG_RECOVERY) != 0 && _UsesSack()) {
+			// the window is not inflated; the pipe decides what can be sent
+			_SendSackRecovery();
+		} else if ((fFlags & FLAG_RECOVERY) != 0) {
 			fSendNext = fSendUnacknowledged;
 			_SendQueued();
 			fCongestionWindow -= bytesAcknowledged;
@@ -2481,14 +2893,6 @@ TCPEndpoint::_Acknowledged(tcp_segment_header& segment)
 		if (fSendNext < fSendUnacknowledged)
 			fSendNext = fSendUnacknowledged;
 
-		if (fFlags & FLAG_OPTION_TIMESTAMP) {
-			_UpdateRoundTripTime(tcp_diff_timestamp(segment.timestamp_reply),
-				expectedSamples > 0 ? expectedSamples : 1);
-		} else if (fSendTime != 0 && fRoundTripStartSequence < segment.acknowledge) {
-			_UpdateRoundTripTime(tcp_diff_timestamp(fSendTime), 1);
-			fSendTime = 0;
-		}
-
 		if (fSendUnacknowledged == fSendMax) {
 			TRACE("all acknowledged, cancelling retransmission timer.");
 			gStackModule->cancel_timer(&fRetransmitTimer);
@@ -2500,6 +2904,8 @@ TCPEndpoint::_Acknowledged(tcp_segment_header& segment)
 			T(TimerSet(this, "retransmit", fRetransmitTimeout));
 		}
 
+		_UpdateLossProbeTimer();
+
 		if (is_writable(fState)) {
 			// notify threads waiting on the socket to become writable again
 			fSendCondition.NotifyAll();
@@ -2508,7 +2914,8 @@ TCPEndpoint::_Acknowledged(tcp_segment_header& segment)
 	}
 
 	// if there is data left to be sent, send it now
-	if (fSendQueue.Used() > 0)
+	if (fSendQueue.Used() > 0
+		&& ((fFlags & FLAG_RECOVERY) == 0 || !_UsesSack()))
 		_SendQueued();
 }
 
@@ -2522,8 +2929,12 @@ TCPEndpoint::_Retransmit()
 		fRetransmitTimeout = TCP_SYN_RETRANSMIT_TIMEOUT;
 		fCongestionWindow = fSendMaxSegmentSize;
 	} else {
-		_ResetSlowStart();
+		fCongestionControl->RetransmitTimeout();
 		fDuplicateAcknowledgeCount = 0;
+		// the receiver may have dropped SACKed data (RFC 6675, section 5.1)
+		fSackScoreboard.Reset();
+		fFlags &= ~FLAG_LOSS_PROBE;
+		gStackModule->cancel_timer(&fLossProbeTimer);
 		// Do exponential back off of the retransmit timeout
 		fRetransmitTimeout *= 2;
 		if (fRetransmitTimeout > TCP_MAX_RETRANSMIT_TIMEOUT)
@@ -2571,15 +2982,6 @@ TCPEndpoint::_UpdateRoundTripTime(int32 roundTripTime, int32 expectedSamples)
 }
 
 
-void
-TCPEndpoint::_ResetSlowStart()
-{
-	fSlowStartThreshold = max_c((fSendMax - fSendUnacknowledged).Number() / 2,
-		2 * fSendMaxSegmentSize);
-	fCongestionWindow = fSendMaxSegmentSize;
-}
-
-
 //	#pragma mark - timer
 
 
@@ -2633,6 +3035,20 @@ TCPEndpoint::_DelayedAcknowledgeTimer(net_timer* timer, void* _endpoint)
 }
 
 
+/*static*/ void
+TCPEndpoint::_LossProbeTimer(net_timer* timer, void* _endpoint)
+{
+	TCPEndpoint* endpoint = (TCPEndpoint*)_endpoint;
+	T(TimerTriggered(endpoint, "loss probe"));
+
+	MutexLocker locker(endpoint->fLock);
+	if (!locker.IsLocked() || gStackModule->is_timer_active(timer))
+		return;
+
+	endpoint->_LossProbe();
+}
+
+
 /*static*/ void
 TCPEndpoint::_TimeWaitTimer(net_timer* timer, void* _endpoint)
 {
@@ -2703,6 +3119,11 @@ TCPEndpoint::Dump() const
 		fLastAcknowledgeSent.Number());
 	kprintf("    initial sequence: %" B_PRIu32 "\n",
 		fInitialSendSequence.Number());
+	kprintf("    sacked: %" B_PRIu32 " bytes up to %" B_PRIu32 "\n",
+		fSackScoreboard.SackedBytes(),
+		fSackScoreboard.HighestSacked().Number());
+	kprintf("    high retransmitted: %" B_PRIu32 "\n",
+		fHighRetransmitted.Number());
 	kprintf("  receive\n");
 	kprintf("    window shift: %" B_PRIu8 "\n", fReceiveWindowShift);
 	kprintf("    next: %" B_PRIu32 "\n", fReceiveNext.Number());
@@ -2722,6 +3143,7 @@ TCPEndpoint::Dump() const
 	kprintf("  smoothed round trip time: %" B_PRId32 " (deviation %" B_PRId32 ")\n",
 		fSmoothedRoundTripTime, fRoundTripVariation);
 	kprintf("  retransmit timeout: %" B_PRId64 "\n", fRetransmitTimeout);
+	kprintf("  congestion control: %s\n", fCongestionControl->Name());
 	kprintf("  congestion window: %" B_PRIu32 "\n", fCongestionWindow);
 	kprintf("  slow start threshold: %" B_PRIu32 "\n", fSlowStartThreshold);
 }
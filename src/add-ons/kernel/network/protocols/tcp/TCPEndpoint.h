@@ -13,6 +13,7 @@
 
 #include "BufferQueue.h"
 #include "EndpointManager.h"
+#include "SackScoreboard.h"
 #include "tcp.h"
 
 #include <ProtocolUtilities.h>
@@ -26,6 +27,9 @@
 #include <stddef.h>
 
 
+class CongestionControl;
+
+
 class TCPEndpoint : public net_protocol, public ProtocolSocket {
 public:
 						TCPEndpoint(net_socket* socket);
@@ -83,6 +87,7 @@ private:
 			status_t	_SendAcknowledge(bool force = false);
 			status_t	_SendQueued(bool force = false);
 
+			status_t	_SetCongestionControl(const char* name, int length);
 			status_t	_Disconnect(bool closing);
 			ssize_t		_AvailableData() const;
 			void		_NotifyReader();
@@ -112,14 +117,25 @@ private:
 			void		_Acknowledged(tcp_segment_header& segment);
 			void		_Retransmit();
 			void		_UpdateRoundTripTime(int32 roundTripTime, int32 expectedSamples);
-			void		_ResetSlowStart();
 			void		_DuplicateAcknowledge(tcp_segment_header& segment);
+			void		_LimitedTransmit();
+
+			bool		_UsesSack() const;
+			uint32		_ReorderingWindow() const;
+			bool		_IsLost(tcp_sequence sequence) const;
+			void		_EnterSackRecovery();
+			void		_SendSackRecovery();
+			status_t	_SendSegment(tcp_sequence start, uint32 length,
+							bool retransmit);
+			void		_UpdateLossProbeTimer();
+			void		_LossProbe();
 
 	static	void		_TimeWaitTimer(net_timer* timer, void* _endpoint);
 	static	void		_RetransmitTimer(net_timer* timer, void* _endpoint);
 	static	void		_PersistTimer(net_timer* timer, void* _endpoint);
 	static	void		_DelayedAcknowledgeTimer(net_timer* timer,
 							void* _endpoint);
+	static	void		_LossProbeTimer(net_timer* timer, void* _endpoint);
 
 	static	status_t	_WaitForCondition(ConditionVariable& condition,
 							MutexLocker& locker, bigtime_t timeout);
@@ -127,7 +143,9 @@ private:
 private:
 	TCPEndpoint*	fConnectionHashLink;
 	TCPEndpoint*	fEndpointHashLink;
+	ListenerGroup*	fListenerGroup;
 	friend class	EndpointManager;
+	friend class	CongestionControl;
 	friend struct	ConnectionHashDefinition;
 	friend class	EndpointHashDefinition;
 
@@ -159,6 +177,12 @@ private:
 	uint32			fPreviousFlightSize;
 	uint32			fRecover;
 
+	// SACK based loss recovery (RFC 6675, RFC 8985)
+	SackScoreboard	fSackScoreboard;
+	tcp_sequence	fHighRetransmitted;
+	tcp_sequence	fRescueRetransmitted;
+	uint32			fRetransmitTime;
+
 	net_route		*fRoute;
 		// TODO: don't use a net_route, but a net_route_info!!!
 		// (the latter will automatically adapt to routing changes)
@@ -186,6 +210,7 @@ private:
 
 	uint32			fCongestionWindow;
 	uint32			fSlowStartThreshold;
+	CongestionControl* fCongestionControl;
 
 	tcp_state		fState;
 	uint32			fFlags;
@@ -195,6 +220,7 @@ private:
 	net_timer		fPersistTimer;
 	net_timer		fDelayedAcknowledgeTimer;
 	net_timer		fTimeWaitTimer;
+	net_timer		fLossProbeTimer;
 };
 
 #endif	// TCP_ENDPOINT_H
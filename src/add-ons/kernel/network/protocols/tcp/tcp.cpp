@@ -9,6 +9,7 @@
  */
 
 
+#include "CongestionControl.h"
 #include "EndpointManager.h"
 #include "TCPEndpoint.h"
 #include "tcp.h"
@@ -433,8 +434,14 @@ add_tcp_header(net_address_module_info* addressModule,
 		"win %u\n", buffer, segment.flags, segment.sequence,
 		segment.acknowledge, segment.urgent_offset, segment.advertised_window));
 
-	*TCPChecksumField(buffer) = Checksum::PseudoHeader(addressModule,
-		gBufferModule, buffer, IPPROTO_TCP);
+	if (buffer->segment_size != 0) {
+		// The checksums of super-segments are only computed once they are
+		// split up; they are not needed for local delivery.
+		*TCPChecksumField(buffer) = 0;
+	} else {
+		*TCPChecksumField(buffer) = Checksum::PseudoHeader(addressModule,
+			gBufferModule, buffer, IPPROTO_TCP);
+	}
 	buffer->buffer_flags |= NET_BUFFER_L4_CHECKSUM_VALID;
 
 	return B_OK;
@@ -778,6 +785,7 @@ static status_t
 tcp_init()
 {
 	rw_lock_init(&sEndpointManagersLock, "endpoint managers");
+	init_congestion_control();
 
 	status_t status = gStackModule->register_domain_protocols(AF_INET,
 		SOCK_STREAM, 0,
@@ -0,0 +1,273 @@
+/*
+ * Copyright 2026, Haiku, Inc. All Rights Reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+/*!	One's complement checksum as used by IP, TCP, UDP, and ICMP (RFC 1071).
+
+	Since 2^16 is congruent to 1 modulo 2^16 - 1, the sum can be computed
+	over 32 bit words in 64 bit accumulators, and only be folded to 16 bits
+	at the very end; this is also what allows the vector implementations
+	to simply add up their lanes. All implementations load the data in host
+	byte order, and therefore produce exactly the same result.
+
+	The best implementation the CPU supports is chosen when a checksum is
+	computed for the first time. The vector implementations are only
+	available on x86_64 and arm64, where the FPU state is saved on kernel
+	entry, and may therefore be used in the kernel, too.
+*/
+
+
+#include "checksum.h"
+
+#include <string.h>
+
+#include <ByteOrder.h>
+
+#if defined(__x86_64__) && __GNUC__ >= 5
+#	include <cpuid.h>
+#	include <immintrin.h>
+#	define CHECKSUM_X86_64
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+#	include <arm_neon.h>
+#	define CHECKSUM_NEON
+#endif
+
+
+static const checksum_implementation* sImplementation;
+
+
+static inline uint16
+fold_checksum(uint64 sum)
+{
+	while ((sum >> 16) != 0)
+		sum = (sum & 0xffff) + (sum >> 16);
+
+	return (uint16)sum;
+}
+
+
+/*!	Adds the contents of \a buffer to \a sum; \a buffer is expected to start
+	at an even offset of the checksummed data.
+*/
+static inline uint64
+add_to_sum(uint64 sum, const uint8* buffer, size_t length)
+{
+	while (length >= 8) {
+		uint32 words[2];
+		memcpy(words, buffer, sizeof(words));
+		sum += words[0];
+		sum += words[1];
+		buffer += 8;
+		length -= 8;
+	}
+
+	if (length >= 4) {
+		uint32 word;
+		memcpy(&word, buffer, sizeof(word));
+		sum += word;
+		buffer += 4;
+		length -= 4;
+	}
+
+	if (length >= 2) {
+		uint16 word;
+		memcpy(&word, buffer, sizeof(word));
+		sum += word;
+		buffer += 2;
+		length -= 2;
+	}
+
+	if (length != 0) {
+		// give the last byte its proper endian-aware treatment
+#if B_HOST_IS_LENDIAN
+		sum += *buffer;
+#else
+		sum += (uint16)*buffer << 8;
+#endif
+	}
+
+	return sum;
+}
+
+
+static bool
+generic_supported()
+{
+	return true;
+}
+
+
+static uint16
+generic_checksum(const uint8* buffer, size_t length)
+{
+	return fold_checksum(add_to_sum(0, buffer, length));
+}
+
+
+#ifdef CHECKSUM_X86_64
+
+
+static bool
+sse2_supported()
+{
+	// SSE2 is part of the x86_64 base architecture
+	return true;
+}
+
+
+static uint16
+sse2_checksum(const uint8* buffer, size_t length)
+{
+	const __m128i zero = _mm_setzero_si128();
+	__m128i sum0 = zero;
+	__m128i sum1 = zero;
+
+	for (; length >= 32; buffer += 32, length -= 32) {
+		__m128i a = _mm_loadu_si128((const __m128i*)buffer);
+		__m128i b = _mm_loadu_si128((const __m128i*)(buffer + 16));
+
+		sum0 = _mm_add_epi64(sum0, _mm_unpacklo_epi32(a, zero));
+		sum1 = _mm_add_epi64(sum1, _mm_unpackhi_epi32(a, zero));
+		sum0 = _mm_add_epi64(sum0, _mm_unpacklo_epi32(b, zero));
+		sum1 = _mm_add_epi64(sum1, _mm_unpackhi_epi32(b, zero));
+	}
+
+	uint64 lanes[2];
+	_mm_storeu_si128((__m128i*)lanes, _mm_add_epi64(sum0, sum1));
+	uint64 sum = lanes[0] + lanes[1];
+
+	return fold_checksum(add_to_sum(sum, buffer, length));
+}
+
+
+static bool
+avx2_supported()
+{
+	unsigned int eax, ebx, ecx, edx;
+	if (__get_cpuid(1, &eax, &ebx, &ecx, &edx) == 0
+		|| (ecx & bit_OSXSAVE) == 0 || (ecx & bit_AVX) == 0)
+		return false;
+
+	// the YMM state must also be enabled in XCR0
+	uint32 low, high;
+	__asm__ volatile("xgetbv" : "=a" (low), "=d" (high) : "c" (0));
+	if ((low & 0x6) != 0x6)
+		return false;
+
+	return __get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx) != 0
+		&& (ebx & bit_AVX2) != 0;
+}
+
+
+__attribute__((target("avx2")))
+static uint16
+avx2_checksum(const uint8* buffer, size_t length)
+{
+	const __m256i zero = _mm256_setzero_si256();
+	__m256i sum0 = zero;
+	__m256i sum1 = zero;
+
+	for (; length >= 64; buffer += 64, length -= 64) {
+		__m256i a = _mm256_loadu_si256((const __m256i*)buffer);
+		__m256i b = _mm256_loadu_si256((const __m256i*)(buffer + 32));
+
+		sum0 = _mm256_add_epi64(sum0, _mm256_unpacklo_epi32(a, zero));
+		sum1 = _mm256_add_epi64(sum1, _mm256_unpackhi_epi32(a, zero));
+		sum0 = _mm256_add_epi64(sum0, _mm256_unpacklo_epi32(b, zero));
+		sum1 = _mm256_add_epi64(sum1, _mm256_unpackhi_epi32(b, zero));
+	}
+
+	uint64 lanes[4];
+	_mm256_storeu_si256((__m256i*)lanes, _mm256_add_epi64(sum0, sum1));
+	uint64 sum = lanes[0] + lanes[1] + lanes[2] + lanes[3];
+
+	return fold_checksum(add_to_sum(sum, buffer, length));
+}
+
+
+#endif	// CHECKSUM_X86_64
+
+
+#ifdef CHECKSUM_NEON
+
+
+static bool
+neon_supported()
+{
+	// Advanced SIMD is mandatory on arm64
+	return true;
+}
+
+
+static uint16
+neon_checksum(const uint8* buffer, size_t length)
+{
+	uint64x2_t sum0 = vdupq_n_u64(0);
+	uint64x2_t sum1 = vdupq_n_u64(0);
+
+	for (; length >= 32; buffer += 32, length -= 32) {
+		// byte loads, as they have no alignment requirements
+		uint8x16_t a = vld1q_u8(buffer);
+		uint8x16_t b = vld1q_u8(buffer + 16);
+
+		sum0 = vpadalq_u32(sum0, vreinterpretq_u32_u8(a));
+		sum1 = vpadalq_u32(sum1, vreinterpretq_u32_u8(b));
+	}
+
+	uint64 sum = vaddvq_u64(vaddq_u64(sum0, sum1));
+
+	return fold_checksum(add_to_sum(sum, buffer, length));
+}
+
+
+#endif	// CHECKSUM_NEON
+
+
+//! Sorted by preference, the generic implementation has to come first.
+const checksum_implementation gChecksumImplementations[] = {
+	{"generic", &generic_supported, &generic_checksum},
+#ifdef CHECKSUM_X86_64
+	{"sse2", &sse2_supported, &sse2_checksum},
+	{"avx2", &avx2_supported, &avx2_checksum},
+#endif
+#ifdef CHECKSUM_NEON
+	{"neon", &neon_supported, &neon_checksum},
+#endif
+};
+
+const size_t gChecksumImplementationCount
+	= sizeof(gChecksumImplementations) / sizeof(gChecksumImplementations[0]);
+
+
+static inline const checksum_implementation*
+implementation()
+{
+	if (sImplementation == NULL) {
+		// Choosing an implementation twice doesn't harm, so we don't need
+		// to lock here
+		const checksum_implementation* best = &gChecksumImplementations[0];
+		for (size_t i = 1; i < gChecksumImplementationCount; i++) {
+			if (gChecksumImplementations[i].supported())
+				best = &gChecksumImplementations[i];
+		}
+
+		sImplementation = best;
+	}
+
+	return sImplementation;
+}
+
+
+// #pragma mark -
+
+
+/*!	Returns the unfinalized one's complement sum of \a length bytes at
+	\a buffer.
+*/
+uint16
+compute_checksum(uint8* buffer, size_t length)
+{
+	return implementation()->compute(buffer, length);
+}
@@ -0,0 +1,25 @@
+/*
+ * Copyright 2026, Haiku, Inc. All Rights Reserved.
+ * Distributed under the terms of the MIT License.
+ */
+#ifndef NET_CHECKSUM_H
+#define NET_CHECKSUM_H
+
+
+#include <SupportDefs.h>
+
+
+struct checksum_implementation {
+	const char*	name;
+	bool		(*supported)();
+	uint16		(*compute)(const uint8* buffer, size_t length);
+};
+
+extern const checksum_implementation gChecksumImplementations[];
+extern const size_t gChecksumImplementationCount;
+
+
+uint16		compute_checksum(uint8* buffer, size_t length);
+
+
+#endif	// NET_CHECKSUM_H
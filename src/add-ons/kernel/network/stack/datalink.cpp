@@ -28,6 +28,7 @@
 #include "domains.h"
 #include "interfaces.h"
 #include "routes.h"
+#include "segment_offload.h"
 #include "stack_private.h"
 #include "utility.h"
 
@@ -388,13 +389,16 @@ datalink_send_routed_data(struct net_route* route, net_buffer* buffer)
 		address->AcquireReference();
 		set_interface_address(buffer->interface_address, address);
 
+		// a super-segment does not need to be split up to be delivered
+		buffer->segment_size = 0;
+
 		if (atomic_get(&interface->DeviceInterface()->monitor_count) > 0)
 			device_interface_monitor_receive(interface->DeviceInterface(), buffer);
 
 		// this one goes back to the domain directly
 		const size_t packetSize = buffer->size;
-		status_t status = fifo_enqueue_buffer(
-			&interface->DeviceInterface()->receive_queue, buffer);
+		status_t status = device_interface_enqueue_buffer(
+			interface->DeviceInterface(), buffer);
 		update_device_send_stats(interface->DeviceInterface()->device,
 			status, packetSize);
 		return status;
@@ -413,6 +417,9 @@ datalink_send_routed_data(struct net_route* route, net_buffer* buffer)
 	// this goes out to the datalink protocols
 	domain_datalink* datalink
 		= interface->DomainDatalink(address->domain->family);
+	if (buffer->segment_size != 0)
+		return send_segments(datalink->first_protocol, buffer);
+
 	return datalink->first_info->send_data(datalink->first_protocol, buffer);
 }
 
@@ -10,18 +10,22 @@
 #include "device_interfaces.h"
 #include "domains.h"
 #include "interfaces.h"
+#include "segment_offload.h"
 #include "stack_private.h"
 #include "utility.h"
 
 #include <net_device.h>
 
 #include <lock.h>
+#include <smp.h>
 #include <util/AutoLock.h>
 
 #include <KernelExport.h>
 
 #include <net/if_dl.h>
 #include <netinet/in.h>
+#include <netinet/ip.h>
+#include <netinet/ip6.h>
 #include <new>
 #include <stdio.h>
 #include <stdlib.h>
@@ -36,14 +40,143 @@
 #endif
 
 
+// maximum number of buffers the reader and consumer threads handle at once
+static const size_t kReceiveBatchSize = 32;
+
+// receive queues (and consumer threads) per device interface
+static const uint32 kMaxReceiveQueues = 16;
+static const size_t kReceiveQueueSize = 16 * 1024 * 1024;
+static const size_t kMinReceiveQueueSize = 2 * 1024 * 1024;
+
+// the default key of Microsoft's RSS specification, as used by most NICs
+static const uint8 kFlowHashKey[40] = {
+	0x6d, 0x5a, 0x56, 0xda, 0x25, 0x5b, 0x0e, 0xc2,
+	0x41, 0x67, 0x25, 0x3d, 0x43, 0xa3, 0x8f, 0xb0,
+	0xd0, 0xca, 0x2b, 0xcb, 0xae, 0x7b, 0x30, 0xb4,
+	0x77, 0xcb, 0x2d, 0xa3, 0x80, 0x30, 0xf2, 0x0c,
+	0x6a, 0x42, 0xb7, 0x3b, 0xbe, 0xac, 0x01, 0xfa
+};
+
+
 static mutex sLock;
 static DeviceInterfaceList sInterfaces;
 static uint32 sDeviceIndex;
 
 
+static inline bool
+device_has_reader(net_device* device)
+{
+	return device->module->receive_data != NULL
+		|| device->module->receive_data_batch != NULL;
+}
+
+
+/*!	Computes the Toeplitz hash of \a data as specified for RSS; \a length
+	must not exceed 36 bytes (the size of an IPv6 4-tuple).
+*/
+static uint32
+toeplitz_hash(const uint8* data, size_t length)
+{
+	uint32 hash = 0;
+	uint32 window = (kFlowHashKey[0] << 24) | (kFlowHashKey[1] << 16)
+		| (kFlowHashKey[2] << 8) | kFlowHashKey[3];
+
+	for (size_t i = 0; i < length; i++) {
+		uint8 nextKey = kFlowHashKey[i + 4];
+		for (int32 bit = 7; bit >= 0; bit--) {
+			if ((data[i] & (1 << bit)) != 0)
+				hash ^= window;
+			window = (window << 1) | ((nextKey >> bit) & 1);
+		}
+	}
+
+	return hash;
+}
+
+
+/*!	Returns the flow hash of the buffer; if the device did not already provide
+	one, it is computed from the IP addresses, and the ports for unfragmented
+	TCP and UDP packets, so that all packets of a connection end up in the
+	same receive queue.
+	The buffer must either be deframed or have been delivered locally, ie.
+	start with the IP header.
+*/
+static uint32
+flow_hash(net_buffer* buffer)
+{
+	if ((buffer->buffer_flags & NET_BUFFER_FLOW_HASH_VALID) != 0)
+		return buffer->flow_hash;
+
+	int32 version = 0;
+	if (buffer->interface_address == NULL) {
+		if (buffer->type == B_NET_FRAME_TYPE_IPV4)
+			version = 4;
+		else if (buffer->type == B_NET_FRAME_TYPE_IPV6)
+			version = 6;
+	} else {
+		uint8 firstByte;
+		if (gNetBufferModule.read(buffer, 0, &firstByte, 1) == B_OK)
+			version = firstByte >> 4;
+	}
+
+	uint8 tuple[36];
+	size_t tupleLength = 0;
+	size_t headerLength = 0;
+
+	if (version == 4) {
+		ip header;
+		if (gNetBufferModule.read(buffer, 0, &header, sizeof(header)) != B_OK)
+			return 0;
+
+		memcpy(tuple, &header.ip_src, 4);
+		memcpy(tuple + 4, &header.ip_dst, 4);
+		tupleLength = 8;
+
+		if ((header.ip_p == IPPROTO_TCP || header.ip_p == IPPROTO_UDP)
+			&& (ntohs(header.ip_off) & (IP_MF | IP_OFFMASK)) == 0)
+			headerLength = header.ip_hl << 2;
+	} else if (version == 6) {
+		ip6_hdr header;
+		if (gNetBufferModule.read(buffer, 0, &header, sizeof(header)) != B_OK)
+			return 0;
+
+		memcpy(tuple, &header.ip6_src, 16);
+		memcpy(tuple + 16, &header.ip6_dst, 16);
+		tupleLength = 32;
+
+		if (header.ip6_nxt == IPPROTO_TCP || header.ip6_nxt == IPPROTO_UDP)
+			headerLength = sizeof(header);
+	} else
+		return 0;
+
+	// the source and destination ports come first in both TCP and UDP
+	if (headerLength != 0 && gNetBufferModule.read(buffer, headerLength,
+			tuple + tupleLength, 4) == B_OK)
+		tupleLength += 4;
+
+	buffer->flow_hash = toeplitz_hash(tuple, tupleLength);
+	buffer->buffer_flags |= NET_BUFFER_FLOW_HASH_VALID;
+	return buffer->flow_hash;
+}
+
+
+static inline net_device_receive_queue*
+receive_queue_for(net_device_interface* interface, net_buffer* buffer)
+{
+	if (interface->receive_queue_count == 1)
+		return &interface->receive_queues[0];
+
+	return &interface->receive_queues[
+		flow_hash(buffer) % interface->receive_queue_count];
+}
+
+
 /*!	A service thread for each device interface. It just reads as many packets
 	as available, deframes them, and puts them into the receive queue of the
 	device interface.
+	If the device supports it, a whole batch of packets is read at once, and
+	they are all put into the queue with a single lock round trip, which also
+	wakes up the consumer thread only once.
 */
 static status_t
 device_reader_thread(void* _interface)
@@ -52,31 +185,83 @@ device_reader_thread(void* _interface)
 	net_device* device = interface->device;
 	status_t status = B_OK;
 
+	net_buffer* buffers[kReceiveBatchSize];
+	size_t packetSizes[kReceiveBatchSize];
+
 	while ((device->flags & IFF_UP) != 0) {
-		net_buffer* buffer;
-		status = device->module->receive_data(device, &buffer);
+		size_t count = kReceiveBatchSize;
+		if (device->module->receive_data_batch != NULL) {
+			status = device->module->receive_data_batch(device, buffers,
+				&count);
+		} else {
+			status = device->module->receive_data(device, &buffers[0]);
+			count = 1;
+		}
+
 		if (status == B_OK) {
-			// feed device monitors
-			if (atomic_get(&interface->monitor_count) > 0)
-				device_interface_monitor_receive(interface, buffer);
+			size_t deframed = 0;
+			for (size_t i = 0; i < count; i++) {
+				net_buffer* buffer = buffers[i];
 
-			ASSERT(buffer->interface_address == NULL);
+				// feed device monitors
+				if (atomic_get(&interface->monitor_count) > 0)
+					device_interface_monitor_receive(interface, buffer);
 
-			if (interface->deframe_func(interface->device, buffer) != B_OK) {
-				gNetBufferModule.free(buffer);
-				atomic_add((int32*)&device->stats.receive.dropped, 1);
-				continue;
+				ASSERT(buffer->interface_address == NULL);
+
+				if (interface->deframe_func(interface->device, buffer)
+						!= B_OK) {
+					gNetBufferModule.free(buffer);
+					atomic_add((int32*)&device->stats.receive.dropped, 1);
+					continue;
+				}
+
+				packetSizes[deframed] = buffer->size;
+				buffers[deframed++] = buffer;
 			}
 
-			const size_t packetSize = buffer->size;
-			status = fifo_enqueue_buffer(&interface->receive_queue, buffer);
-			if (status == B_OK) {
-				atomic_add((int32*)&device->stats.receive.packets, 1);
-				atomic_add64((int64*)&device->stats.receive.bytes, packetSize);
-			} else {
-				gNetBufferModule.free(buffer);
-				atomic_add((int32*)&device->stats.receive.dropped, 1);
+			// Hand the buffers over to their receive queues; buffers
+			// belonging to the same queue are enqueued at once, keeping their
+			// order.
+			net_device_receive_queue* queues[kReceiveBatchSize];
+			for (size_t i = 0; i < deframed; i++)
+				queues[i] = receive_queue_for(interface, buffers[i]);
+
+			size_t packets = 0;
+			size_t bytes = 0;
+			size_t dropped = 0;
+			for (size_t first = 0; first < deframed; first++) {
+				net_device_receive_queue* queue = queues[first];
+				if (queue == NULL)
+					continue;
+
+				net_buffer* queueBuffers[kReceiveBatchSize];
+				size_t queueSizes[kReceiveBatchSize];
+				size_t queueCount = 0;
+				for (size_t i = first; i < deframed; i++) {
+					if (queues[i] != queue)
+						continue;
+
+					queueBuffers[queueCount] = buffers[i];
+					queueSizes[queueCount++] = packetSizes[i];
+					queues[i] = NULL;
+				}
+
+				size_t enqueued = fifo_enqueue_buffers(&queue->fifo,
+					queueBuffers, queueCount);
+				for (size_t i = 0; i < enqueued; i++)
+					bytes += queueSizes[i];
+				for (size_t i = enqueued; i < queueCount; i++)
+					gNetBufferModule.free(queueBuffers[i]);
+
+				packets += enqueued;
+				dropped += queueCount - enqueued;
 			}
+
+			atomic_add((int32*)&device->stats.receive.packets, packets);
+			atomic_add64((int64*)&device->stats.receive.bytes, bytes);
+			if (dropped > 0)
+				atomic_add((int32*)&device->stats.receive.dropped, dropped);
 		} else if (status == B_DEVICE_NOT_FOUND) {
 			device_removed(device);
 			return status;
@@ -93,29 +278,60 @@ device_reader_thread(void* _interface)
 }
 
 
+/*!	Takes all buffers (up to a maximum batch size) out of its receive queue
+	at once, and passes them on to the domain or the registered device
+	handlers. Consecutive segments of the same TCP connection are coalesced
+	before. Locally delivered buffers are passed on first, without the handler
+	list lock; the lock is then acquired once for all other buffers of the
+	batch.
+	There is one consumer thread per receive queue; since all packets of a
+	flow end up in the same queue, and are either all delivered locally or
+	not, they are still processed in order.
+*/
 static status_t
-device_consumer_thread(void* _interface)
+device_consumer_thread(void* _queue)
 {
-	net_device_interface* interface = (net_device_interface*)_interface;
+	net_device_receive_queue* queue = (net_device_receive_queue*)_queue;
+	net_device_interface* interface = queue->interface;
 	net_device* device = interface->device;
-	net_buffer* buffer;
+	net_buffer* buffers[kReceiveBatchSize];
 
 	while (atomic_get(&interface->ref_count) > 0) {
-		ssize_t status = fifo_dequeue_buffer(&interface->receive_queue, 0,
-			B_INFINITE_TIMEOUT, &buffer);
-		if (status != B_OK) {
-			if (status == B_INTERRUPTED)
+		ssize_t count = fifo_dequeue_buffers(&queue->fifo, 0,
+			B_INFINITE_TIMEOUT, buffers, kReceiveBatchSize);
+		if (count < 0) {
+			if (count == B_INTERRUPTED)
 				continue;
 			break;
 		}
 
-		if (buffer->interface_address != NULL) {
-			// If the interface is already specified, this buffer was
-			// delivered locally.
-			if (buffer->interface_address->domain->module->receive_data(buffer)
-					== B_OK)
-				buffer = NULL;
-		} else {
+		if (count > 1)
+			count = coalesce_segments(buffers, count);
+
+		// If the interface is already specified, a buffer was delivered
+		// locally, and goes directly to its domain; the others are kept
+		// for the device handlers.
+		ssize_t handlerCount = 0;
+		for (ssize_t i = 0; i < count; i++) {
+			net_buffer* buffer = buffers[i];
+			if (buffer->interface_address == NULL) {
+				buffers[handlerCount++] = buffer;
+				continue;
+			}
+
+			if (buffer->interface_address->domain->module->receive_data(
+					buffer) != B_OK)
+				gNetBufferModule.free(buffer);
+		}
+
+		if (handlerCount == 0)
+			continue;
+
+		ReadLocker locker(interface->receive_funcs_lock);
+
+		for (ssize_t i = 0; i < handlerCount; i++) {
+			net_buffer* buffer = buffers[i];
+
 			sockaddr_dl& linkAddress = *(sockaddr_dl*)buffer->source;
 			int32 genericType = buffer->type;
 			int32 specificType = B_NET_FRAME_TYPE(linkAddress.sdl_type,
@@ -125,24 +341,23 @@ device_consumer_thread(void* _interface)
 
 			// Find handler for this packet
 
-			RecursiveLocker locker(interface->receive_lock);
-
 			DeviceHandlerList::Iterator iterator
 				= interface->receive_funcs.GetIterator();
 			while (buffer != NULL && iterator.HasNext()) {
 				net_device_handler* handler = iterator.Next();
 
-				// If the handler returns B_OK, it consumed the buffer - first
-				// handler wins.
+				// If the handler returns B_OK, it consumed the buffer -
+				// first handler wins.
 				if ((handler->type == genericType
 						|| handler->type == specificType)
-					&& handler->func(handler->cookie, device, buffer) == B_OK)
+					&& handler->func(handler->cookie, device, buffer)
+						== B_OK)
 					buffer = NULL;
 			}
-		}
 
-		if (buffer != NULL)
-			gNetBufferModule.free(buffer);
+			if (buffer != NULL)
+				gNetBufferModule.free(buffer);
+		}
 	}
 
 	return B_OK;
@@ -176,6 +391,79 @@ find_device_interface(const char* name)
 }
 
 
+/*!	Shuts down the first \a count receive queues of the \a interface, and
+	waits for their consumer threads to be gone.
+*/
+static void
+uninit_receive_queues(net_device_interface* interface, uint32 count)
+{
+	for (uint32 i = 0; i < count; i++) {
+		net_device_receive_queue& queue = interface->receive_queues[i];
+		uninit_fifo(&queue.fifo);
+		if (queue.consumer_thread >= 0)
+			wait_for_thread(queue.consumer_thread, NULL);
+	}
+
+	delete[] interface->receive_queues;
+	interface->receive_queues = NULL;
+}
+
+
+static status_t
+init_receive_queues(net_device_interface* interface)
+{
+	net_device* device = interface->device;
+
+	uint32 count = min_c((uint32)smp_get_num_cpus(), kMaxReceiveQueues);
+	size_t queueSize = max_c(kReceiveQueueSize / count, kMinReceiveQueueSize);
+
+	interface->receive_queues
+		= new(std::nothrow) net_device_receive_queue[count];
+	if (interface->receive_queues == NULL)
+		return B_NO_MEMORY;
+
+	for (uint32 i = 0; i < count; i++) {
+		net_device_receive_queue& queue = interface->receive_queues[i];
+		queue.interface = interface;
+		queue.consumer_thread = -1;
+
+		char name[128];
+		if (count == 1)
+			snprintf(name, sizeof(name), "%s receive queue", device->name);
+		else {
+			snprintf(name, sizeof(name), "%s receive queue %" B_PRIu32,
+				device->name, i);
+		}
+
+		status_t status = init_fifo(&queue.fifo, name, queueSize);
+		if (status != B_OK) {
+			uninit_receive_queues(interface, i);
+			return status;
+		}
+
+		if (count == 1)
+			snprintf(name, sizeof(name), "%s consumer", device->name);
+		else {
+			snprintf(name, sizeof(name), "%s consumer %" B_PRIu32,
+				device->name, i);
+		}
+
+		queue.consumer_thread = spawn_kernel_thread(device_consumer_thread,
+			name, B_DISPLAY_PRIORITY, &queue);
+		if (queue.consumer_thread < B_OK) {
+			status = queue.consumer_thread;
+			queue.consumer_thread = -1;
+			uninit_receive_queues(interface, i + 1);
+			return status;
+		}
+		resume_thread(queue.consumer_thread);
+	}
+
+	interface->receive_queue_count = count;
+	return B_OK;
+}
+
+
 static net_device_interface*
 allocate_device_interface(net_device* device, net_device_module_info* module)
 {
@@ -184,14 +472,10 @@ allocate_device_interface(net_device* device, net_device_module_info* module)
 		return NULL;
 
 	recursive_lock_init(&interface->receive_lock, "device interface receive");
+	rw_lock_init(&interface->receive_funcs_lock,
+		"device interface receive funcs");
 	recursive_lock_init(&interface->monitor_lock, "device interface monitors");
 
-	char name[128];
-	snprintf(name, sizeof(name), "%s receive queue", device->name);
-
-	if (init_fifo(&interface->receive_queue, name, 16 * 1024 * 1024) < B_OK)
-		goto error1;
-
 	interface->device = device;
 	interface->up_count = 0;
 	interface->ref_count = 1;
@@ -199,15 +483,15 @@ allocate_device_interface(net_device* device, net_device_module_info* module)
 	interface->monitor_count = 0;
 	interface->deframe_func = NULL;
 	interface->deframe_ref_count = 0;
+	interface->reader_thread = -1;
 
-	snprintf(name, sizeof(name), "%s consumer", device->name);
-
-	interface->reader_thread   = -1;
-	interface->consumer_thread = spawn_kernel_thread(device_consumer_thread,
-		name, B_DISPLAY_PRIORITY, interface);
-	if (interface->consumer_thread < B_OK)
-		goto error2;
-	resume_thread(interface->consumer_thread);
+	if (init_receive_queues(interface) != B_OK) {
+		recursive_lock_destroy(&interface->receive_lock);
+		rw_lock_destroy(&interface->receive_funcs_lock);
+		recursive_lock_destroy(&interface->monitor_lock);
+		delete interface;
+		return NULL;
+	}
 
 	// TODO: proper interface index allocation
 	device->index = ++sDeviceIndex;
@@ -215,15 +499,6 @@ allocate_device_interface(net_device* device, net_device_module_info* module)
 
 	sInterfaces.Add(interface);
 	return interface;
-
-error2:
-	uninit_fifo(&interface->receive_queue);
-error1:
-	recursive_lock_destroy(&interface->receive_lock);
-	recursive_lock_destroy(&interface->monitor_lock);
-	delete interface;
-
-	return NULL;
 }
 
 
@@ -261,7 +536,13 @@ dump_device_interface(int argc, char** argv)
 	kprintf("ref_count:         %" B_PRId32 "\n", interface->ref_count);
 	kprintf("deframe_func:      %p\n", interface->deframe_func);
 	kprintf("deframe_ref_count: %" B_PRId32 "\n", interface->ref_count);
-	kprintf("consumer_thread:   %" B_PRId32 "\n", interface->consumer_thread);
+	kprintf("receive_queues:    %" B_PRIu32 "\n",
+		interface->receive_queue_count);
+	for (uint32 i = 0; i < interface->receive_queue_count; i++) {
+		net_device_receive_queue& queue = interface->receive_queues[i];
+		kprintf("  %p, consumer_thread %" B_PRId32 "\n", &queue.fifo,
+			queue.consumer_thread);
+	}
 
 	kprintf("monitor_count:     %" B_PRId32 "\n", interface->monitor_count);
 	kprintf("monitor_lock:      %p\n", &interface->monitor_lock);
@@ -272,7 +553,6 @@ dump_device_interface(int argc, char** argv)
 		kprintf("  %p\n", monitorIterator.Next());
 
 	kprintf("receive_lock:      %p\n", &interface->receive_lock);
-	kprintf("receive_queue:     %p\n", &interface->receive_queue);
 	kprintf("receive_funcs:\n");
 	DeviceHandlerList::Iterator handlerIterator
 		= interface->receive_funcs.GetIterator();
@@ -400,8 +680,7 @@ put_device_interface(struct net_device_interface* interface)
 	sInterfaces.Remove(interface);
 	locker.Unlock();
 
-	uninit_fifo(&interface->receive_queue);
-	wait_for_thread(interface->consumer_thread, NULL);
+	uninit_receive_queues(interface, interface->receive_queue_count);
 
 	net_device* device = interface->device;
 	const char* moduleName = device->module->info.name;
@@ -410,6 +689,7 @@ put_device_interface(struct net_device_interface* interface)
 	put_module(moduleName);
 
 	recursive_lock_destroy(&interface->monitor_lock);
+	rw_lock_destroy(&interface->receive_funcs_lock);
 	recursive_lock_destroy(&interface->receive_lock);
 	delete interface;
 }
@@ -514,6 +794,20 @@ device_interface_monitor_receive(net_device_interface* interface,
 }
 
 
+/*!	Puts the \a buffer into the receive queue of the \a interface that is
+	responsible for its flow. The buffer must already be deframed, or have its
+	interface address set for local delivery.
+	If this fails, the caller retains ownership of the buffer.
+*/
+status_t
+device_interface_enqueue_buffer(net_device_interface* interface,
+	net_buffer* buffer)
+{
+	return fifo_enqueue_buffer(&receive_queue_for(interface, buffer)->fifo,
+		buffer);
+}
+
+
 status_t
 up_device_interface(net_device_interface* interface)
 {
@@ -530,7 +824,7 @@ up_device_interface(net_device_interface* interface)
 	if (status != B_OK)
 		return status;
 
-	if (device->module->receive_data != NULL) {
+	if (device_has_reader(device)) {
 		// give the thread a nice name
 		char name[B_OS_NAME_LENGTH];
 		snprintf(name, sizeof(name), "%s reader", device->name);
@@ -543,7 +837,7 @@ up_device_interface(net_device_interface* interface)
 
 	device->flags |= IFF_UP;
 
-	if (device->module->receive_data != NULL)
+	if (device_has_reader(device))
 		resume_thread(interface->reader_thread);
 
 	interface->up_count = 1;
@@ -577,7 +871,7 @@ down_device_interface(net_device_interface* interface)
 
 	notify_device_monitors(interface, B_DEVICE_GOING_DOWN);
 
-	if (device->module->receive_data != NULL) {
+	if (device_has_reader(device)) {
 		thread_id readerThread = interface->reader_thread;
 
 		// make sure the reader thread is gone before shutting down the interface
@@ -686,6 +980,8 @@ register_device_handler(struct net_device* device, int32 type,
 	handler->func = receiveFunc;
 	handler->type = type;
 	handler->cookie = cookie;
+
+	WriteLocker funcsLocker(interface->receive_funcs_lock);
 	interface->receive_funcs.Add(handler);
 	return B_OK;
 }
@@ -711,7 +1007,10 @@ unregister_device_handler(struct net_device* device, int32 type)
 	while (net_device_handler* handler = iterator.Next()) {
 		if (handler->type == type) {
 			// found it
+			WriteLocker funcsLocker(interface->receive_funcs_lock);
 			iterator.Remove();
+			funcsLocker.Unlock();
+
 			delete handler;
 			return B_OK;
 		}
@@ -838,7 +1137,7 @@ device_enqueue_buffer(net_device* device, net_buffer* buffer)
 		return status;
 	}
 
-	status = fifo_enqueue_buffer(&interface->receive_queue, buffer);
+	status = device_interface_enqueue_buffer(interface, buffer);
 
 	put_device_interface(interface);
 	return status;
@@ -26,6 +26,14 @@ typedef DoublyLinkedList<net_device_handler> DeviceHandlerList;
 typedef DoublyLinkedList<net_device_monitor,
 	DoublyLinkedListCLink<net_device_monitor> > DeviceMonitorList;
 
+struct net_device_interface;
+
+struct net_device_receive_queue {
+	net_device_interface* interface;
+	thread_id			consumer_thread;
+	net_fifo			fifo;
+};
+
 struct net_device_interface : DoublyLinkedListLinkImpl<net_device_interface> {
 	struct net_device*	device;
 	thread_id			reader_thread;
@@ -43,9 +51,12 @@ struct net_device_interface : DoublyLinkedListLinkImpl<net_device_interface> {
 
 	DeviceHandlerList	receive_funcs;
 	recursive_lock		receive_lock;
+	rw_lock				receive_funcs_lock;
+		// only guards receive_funcs, so that the consumers can run in parallel
 
-	thread_id			consumer_thread;
-	net_fifo			receive_queue;
+	net_device_receive_queue* receive_queues;
+	uint32				receive_queue_count;
+		// one per CPU; buffers are distributed by their flow hash
 };
 
 typedef DoublyLinkedList<net_device_interface> DeviceInterfaceList;
@@ -63,6 +74,8 @@ struct net_device_interface* get_device_interface(const char* name,
 	bool create = true);
 void device_interface_monitor_receive(net_device_interface* interface,
 	net_buffer* buffer);
+status_t device_interface_enqueue_buffer(net_device_interface* interface,
+	net_buffer* buffer);
 status_t up_device_interface(net_device_interface* interface);
 void down_device_interface(net_device_interface* interface);
 
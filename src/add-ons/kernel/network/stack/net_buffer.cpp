@@ -42,6 +42,9 @@
 
 #define BUFFER_SIZE 2048
 	// maximum implementation derived buffer size is 65536
+#define LARGE_BUFFER_SIZE B_PAGE_SIZE
+	// used for appending larger amounts of data; since these buffers are
+	// page aligned, the data of each of their nodes is physically contiguous
 
 #define ENABLE_DEBUGGER_COMMANDS	1
 #define ENABLE_STATS				1
@@ -52,6 +55,16 @@
 
 #define DATA_NODE_READ_ONLY		0x1
 #define DATA_NODE_STORED_HEADER	0x2
+#define DATA_NODE_CHECKSUM		0x4
+	// data_node::checksum is valid for all of the node's data; it's set by
+	// checksum_data(), and dropped whenever the data is changed through this
+	// node. Like clones in
+	// general, cloned checksums rely on shared data not being changed.
+
+#define DATA_HEADER_EXTERNAL	0x1
+#define DATA_HEADER_LARGE		0x2
+
+#define MAX_EXTERNAL_NODE_SIZE	32768
 
 struct header_space {
 	uint16	size;
@@ -70,6 +83,12 @@ struct data_header {
 	uint8*			data_end;
 	header_space	space;
 	uint16			tail_space;
+	uint16			flags;
+};
+
+struct external_data_header : data_header {
+	void*			data;
+	void			(*free_data)(void* data);
 };
 
 struct data_node {
@@ -80,6 +99,7 @@ struct data_node {
 	uint8*			start;		// points to the start of the data
 	uint16			flags;
 	uint16			used;		// defines how much memory is used by this node
+	uint16			checksum;	// see DATA_NODE_CHECKSUM
 
 	uint16 HeaderSpace() const
 	{
@@ -149,10 +169,13 @@ struct net_buffer_private : net_buffer {
 #define DATA_HEADER_SIZE				_ALIGN(sizeof(data_header))
 #define DATA_NODE_SIZE					_ALIGN(sizeof(data_node))
 #define MAX_FREE_BUFFER_SIZE			(BUFFER_SIZE - DATA_HEADER_SIZE)
+#define MAX_FREE_LARGE_BUFFER_SIZE		(LARGE_BUFFER_SIZE - DATA_HEADER_SIZE)
 
 
 static object_cache* sNetBufferCache;
 static object_cache* sDataNodeCache;
+static object_cache* sLargeDataNodeCache;
+static object_cache* sExternalDataHeaderCache;
 
 
 static status_t append_data(net_buffer* buffer, const void* data, size_t size);
@@ -746,8 +769,16 @@ check_buffer_contents(net_buffer* buffer, size_t offset, net_buffer* source,
 #endif	// !PARANOID_BUFFER_CHECK
 
 
+static inline size_t
+data_header_size(data_header* header)
+{
+	return (header->flags & DATA_HEADER_LARGE) != 0
+		? LARGE_BUFFER_SIZE : BUFFER_SIZE;
+}
+
+
 static inline data_header*
-allocate_data_header()
+allocate_data_header(bool large)
 {
 #if ENABLE_STATS
 	int32 current = atomic_add(&sAllocatedDataHeaderCount, 1) + 1;
@@ -757,7 +788,8 @@ allocate_data_header()
 
 	atomic_add(&sEverAllocatedDataHeaderCount, 1);
 #endif
-	return (data_header*)object_cache_alloc(sDataNodeCache, 0);
+	return (data_header*)object_cache_alloc(
+		large ? sLargeDataNodeCache : sDataNodeCache, 0);
 }
 
 
@@ -779,11 +811,14 @@ allocate_net_buffer()
 static inline void
 free_data_header(data_header* header)
 {
+	if (header == NULL)
+		return;
+
 #if ENABLE_STATS
-	if (header != NULL)
-		atomic_add(&sAllocatedDataHeaderCount, -1);
+	atomic_add(&sAllocatedDataHeaderCount, -1);
 #endif
-	object_cache_free(sDataNodeCache, header, 0);
+	object_cache_free((header->flags & DATA_HEADER_LARGE) != 0
+		? sLargeDataNodeCache : sDataNodeCache, header, 0);
 }
 
 
@@ -799,9 +834,9 @@ free_net_buffer(net_buffer_private* buffer)
 
 
 static data_header*
-create_data_header(size_t headerSpace)
+create_data_header(size_t headerSpace, bool large = false)
 {
-	data_header* header = allocate_data_header();
+	data_header* header = allocate_data_header(large);
 	if (header == NULL)
 		return NULL;
 
@@ -811,8 +846,9 @@ create_data_header(size_t headerSpace)
 	header->space.size = headerSpace;
 	header->space.free = headerSpace;
 	header->data_end = (uint8*)header + DATA_HEADER_SIZE;
-	header->tail_space = (uint8*)header + BUFFER_SIZE - header->data_end
-		- headerSpace;
+	header->flags = large ? DATA_HEADER_LARGE : 0;
+	header->tail_space = (uint8*)header + data_header_size(header)
+		- header->data_end - headerSpace;
 	header->first_free = NULL;
 
 	TRACE(("%d:   create new data header %p\n", find_thread(NULL), header));
@@ -821,6 +857,36 @@ create_data_header(size_t headerSpace)
 }
 
 
+/*!	Creates a data header for data that lives outside of the buffer memory.
+	It owns the data, and will pass it to \a freeData when its last reference
+	is released.
+*/
+static data_header*
+create_external_data_header(void* data, void (*freeData)(void* data))
+{
+	external_data_header* header = (external_data_header*)object_cache_alloc(
+		sExternalDataHeaderCache, 0);
+	if (header == NULL)
+		return NULL;
+
+	header->ref_count = 1;
+	header->physical_address = 0;
+	header->space.size = 0;
+	header->space.free = 0;
+	header->data_end = NULL;
+	header->tail_space = 0;
+	header->first_free = NULL;
+	header->flags = DATA_HEADER_EXTERNAL;
+	header->data = data;
+	header->free_data = freeData;
+
+	TRACE(("%d:   create new external data header %p\n", find_thread(NULL),
+		header));
+	T2(CreateDataHeader(header));
+	return header;
+}
+
+
 static void
 release_data_header(data_header* header)
 {
@@ -830,6 +896,14 @@ release_data_header(data_header* header)
 		return;
 
 	TRACE(("%d:   free header %p\n", find_thread(NULL), header));
+
+	if ((header->flags & DATA_HEADER_EXTERNAL) != 0) {
+		external_data_header* external = (external_data_header*)header;
+		external->free_data(external->data);
+		object_cache_free(sExternalDataHeaderCache, external, 0);
+		return;
+	}
+
 	free_data_header(header);
 }
 
@@ -1076,6 +1150,8 @@ copy_metadata(net_buffer* destination, const net_buffer* source)
 
 	destination->msg_flags = source->msg_flags;
 	destination->buffer_flags = source->buffer_flags;
+	destination->flow_hash = source->flow_hash;
+	destination->segment_size = source->segment_size;
 	destination->interface_address = source->interface_address;
 	if (destination->interface_address != NULL)
 		((InterfaceAddress*)destination->interface_address)->AcquireReference();
@@ -1130,6 +1206,8 @@ create_buffer(size_t headerSpace)
 	buffer->offset = 0;
 	buffer->msg_flags = 0;
 	buffer->buffer_flags = 0;
+	buffer->flow_hash = 0;
+	buffer->segment_size = 0;
 	buffer->size = 0;
 
 	CHECK_BUFFER(buffer);
@@ -1416,8 +1494,10 @@ merge_buffer(net_buffer* _buffer, net_buffer* _with, bool after)
 		if (node == NULL)
 			break;
 
-		if ((uint8*)node > (uint8*)node->header
-			&& (uint8*)node < (uint8*)node->header + BUFFER_SIZE) {
+		if ((node->header->flags & DATA_HEADER_EXTERNAL) == 0
+			&& (uint8*)node > (uint8*)node->header
+			&& (uint8*)node
+				< (uint8*)node->header + data_header_size(node->header)) {
 			// The node is already in the buffer, we can just move it
 			// over to the new owner
 			list_remove_item(&with->buffers, node);
@@ -1486,6 +1566,7 @@ write_data(net_buffer* _buffer, size_t offset, const void* data, size_t size)
 
 	while (true) {
 		size_t written = min_c(size, node->used - offset);
+		node->flags &= ~DATA_NODE_CHECKSUM;
 		if (IS_USER_ADDRESS(data)) {
 			if (user_memcpy(node->start + offset, data, written) != B_OK)
 				return B_BAD_ADDRESS;
@@ -1613,6 +1694,7 @@ prepend_size(net_buffer* _buffer, size_t size, void** _contiguousBuffer)
 			node->SubtractHeaderSpace(willConsume);
 			node->start -= willConsume;
 			node->used += willConsume;
+			node->flags &= ~DATA_NODE_CHECKSUM;
 			bytesLeft -= willConsume;
 			sizePrepended += willConsume;
 		} while (bytesLeft > 0);
@@ -1634,6 +1716,7 @@ prepend_size(net_buffer* _buffer, size_t size, void** _contiguousBuffer)
 		node->SubtractHeaderSpace(size);
 		node->start -= size;
 		node->used += size;
+		node->flags &= ~DATA_NODE_CHECKSUM;
 
 		if (_contiguousBuffer)
 			*_contiguousBuffer = node->start;
@@ -1704,11 +1787,12 @@ append_size(net_buffer* _buffer, size_t size, void** _contiguousBuffer)
 		// we need to append at least one new buffer
 		uint32 previousTailSpace = node->TailSpace();
 		uint32 headerSpace = DATA_NODE_SIZE;
-		uint32 sizeUsed = MAX_FREE_BUFFER_SIZE - headerSpace;
 
 		// allocate space left in the node
 		node->SetTailSpace(0);
 		node->used += previousTailSpace;
+		if (previousTailSpace > 0)
+			node->flags &= ~DATA_NODE_CHECKSUM;
 		buffer->size += previousTailSpace;
 		uint32 sizeAdded = previousTailSpace;
 		SET_PARANOIA_CHECK(PARANOIA_SUSPICIOUS, buffer, &buffer->size,
@@ -1717,12 +1801,18 @@ append_size(net_buffer* _buffer, size_t size, void** _contiguousBuffer)
 		// allocate all buffers
 
 		while (sizeAdded < size) {
+			// Use large buffers unless the rest fits into a small one, so
+			// that large amounts of data end up in only a few nodes.
+			bool large = size - sizeAdded > MAX_FREE_BUFFER_SIZE - headerSpace;
+			uint32 sizeUsed = (large
+				? MAX_FREE_LARGE_BUFFER_SIZE : MAX_FREE_BUFFER_SIZE)
+				- headerSpace;
 			if (sizeAdded + sizeUsed > size) {
 				// last data_header and not all available space is used
 				sizeUsed = size - sizeAdded;
 			}
 
-			data_header* header = create_data_header(headerSpace);
+			data_header* header = create_data_header(headerSpace, large);
 			if (header == NULL) {
 				remove_trailer(buffer, sizeAdded);
 				return B_NO_MEMORY;
@@ -1767,6 +1857,7 @@ append_size(net_buffer* _buffer, size_t size, void** _contiguousBuffer)
 		*_contiguousBuffer = node->start + node->used;
 
 	node->used += size;
+	node->flags &= ~DATA_NODE_CHECKSUM;
 	buffer->size += size;
 	SET_PARANOIA_CHECK(PARANOIA_SUSPICIOUS, buffer, &buffer->size,
 		sizeof(buffer->size));
@@ -1849,6 +1940,7 @@ remove_header(net_buffer* _buffer, size_t bytes)
 		size_t cut = min_c(node->used, left);
 		node->offset = 0;
 		node->start += cut;
+		node->flags &= ~DATA_NODE_CHECKSUM;
 		if ((node->flags & DATA_NODE_STORED_HEADER) != 0)
 			buffer->stored_header_length += cut;
 		else
@@ -1913,6 +2005,7 @@ trim_data(net_buffer* _buffer, size_t newSize)
 	int32 diff = node->used + node->offset - newSize;
 	node->SetTailSpace(node->TailSpace() + diff);
 	node->used -= diff;
+	node->flags &= ~DATA_NODE_CHECKSUM;
 
 	if (node->used > 0)
 		node = (data_node*)list_get_next_item(&buffer->buffers, node);
@@ -1984,10 +2077,18 @@ append_cloned_data(net_buffer* _buffer, net_buffer* _source, uint32 offset,
 		if (list_is_empty(&buffer->buffers)) {
 			// take over stored offset
 			buffer->stored_header_length = source->stored_header_length;
-			clone->flags = node->flags | DATA_NODE_READ_ONLY;
+			clone->flags = (node->flags & ~DATA_NODE_CHECKSUM)
+				| DATA_NODE_READ_ONLY;
 		} else
 			clone->flags = DATA_NODE_READ_ONLY;
 
+		if (clone->used == node->used
+			&& (node->flags & DATA_NODE_CHECKSUM) != 0) {
+			// the clone references all of the node's data
+			clone->checksum = node->checksum;
+			clone->flags |= DATA_NODE_CHECKSUM;
+		}
+
 		list_add_item(&buffer->buffers, clone);
 
 		offset = 0;
@@ -2011,6 +2112,61 @@ append_cloned_data(net_buffer* _buffer, net_buffer* _source, uint32 offset,
 }
 
 
+/*!	Appends \a bytes of \a data to the buffer without copying them. The data
+	is referenced by read-only nodes that can be cloned like any other data;
+	once the last of them is gone, \a freeData is called with \a data.
+	The data is handed over to the buffer in any case: if this function
+	fails, \a freeData has already been called when it returns.
+*/
+static status_t
+append_external_data(net_buffer* _buffer, void* data, size_t bytes,
+	void (*freeData)(void* data))
+{
+	net_buffer_private* buffer = (net_buffer_private*)_buffer;
+	TRACE(("%d: append_external_data(buffer %p, data %p, bytes = %ld)\n",
+		find_thread(NULL), buffer, data, bytes));
+
+	ParanoiaChecker _(buffer);
+
+	data_header* header = create_external_data_header(data, freeData);
+	if (header == NULL) {
+		freeData(data);
+		return B_NO_MEMORY;
+	}
+
+	status_t status = B_OK;
+	size_t sizeAppended = 0;
+
+	while (sizeAppended < bytes) {
+		data_node* node = add_data_node(buffer, header);
+		if (node == NULL) {
+			remove_trailer(buffer, sizeAppended);
+			status = ENOBUFS;
+			break;
+		}
+
+		node->offset = buffer->size;
+		node->start = (uint8*)data + sizeAppended;
+		node->used = min_c(bytes - sizeAppended, MAX_EXTERNAL_NODE_SIZE);
+		node->flags = DATA_NODE_READ_ONLY;
+
+		list_add_item(&buffer->buffers, node);
+
+		buffer->size += node->used;
+		sizeAppended += node->used;
+	}
+
+	// the nodes have their own references
+	release_data_header(header);
+
+	CHECK_BUFFER(buffer);
+	SET_PARANOIA_CHECK(PARANOIA_SUSPICIOUS, buffer, &buffer->size,
+		sizeof(buffer->size));
+
+	return status;
+}
+
+
 void
 set_ancillary_data(net_buffer* buffer, ancillary_data_container* container)
 {
@@ -2206,6 +2362,9 @@ direct_access(net_buffer* _buffer, uint32 offset, size_t size,
 	if (size > node->used - offset)
 		return B_ERROR;
 
+	// the caller may change the data
+	node->flags &= ~DATA_NODE_CHECKSUM;
+
 	*_contiguousBuffer = node->start + offset;
 	return B_OK;
 }
@@ -2233,11 +2392,23 @@ checksum_data(net_buffer* _buffer, uint32 offset, size_t size, bool finalize)
 
 	while (true) {
 		size_t bytes = min_c(size, node->used - offset);
+		uint16 nodeSum;
+		if (bytes == node->used && (node->flags & DATA_NODE_CHECKSUM) != 0)
+			nodeSum = node->checksum;
+		else {
+			nodeSum = compute_checksum(node->start + offset, bytes);
+			if (bytes == node->used) {
+				// remember it in case the node is checksummed again
+				node->checksum = nodeSum;
+				node->flags |= DATA_NODE_CHECKSUM;
+			}
+		}
+
 		if ((offset + node->offset) & 1) {
 			// if we're at an uneven offset, we have to swap the checksum
-			sum += __swap_int16(compute_checksum(node->start + offset, bytes));
+			sum += __swap_int16(nodeSum);
 		} else
-			sum += compute_checksum(node->start + offset, bytes);
+			sum += nodeSum;
 
 		size -= bytes;
 		if (size == 0)
@@ -2327,6 +2498,24 @@ std_ops(int32 op, ...)
 				return B_NO_MEMORY;
 			}
 
+			sLargeDataNodeCache = create_object_cache_etc(
+				"large data node cache", LARGE_BUFFER_SIZE, B_PAGE_SIZE, 0, 0,
+				0, 0, NULL, NULL, NULL, NULL);
+			if (sLargeDataNodeCache == NULL) {
+				delete_object_cache(sNetBufferCache);
+				delete_object_cache(sDataNodeCache);
+				return B_NO_MEMORY;
+			}
+
+			sExternalDataHeaderCache = create_object_cache(
+				"external data header cache", sizeof(external_data_header), 0);
+			if (sExternalDataHeaderCache == NULL) {
+				delete_object_cache(sNetBufferCache);
+				delete_object_cache(sDataNodeCache);
+				delete_object_cache(sLargeDataNodeCache);
+				return B_NO_MEMORY;
+			}
+
 #if ENABLE_STATS
 			add_debugger_command_etc("net_buffer_stats", &dump_net_buffer_stats,
 				"Print net buffer statistics",
@@ -2348,6 +2537,8 @@ std_ops(int32 op, ...)
 #endif
 			delete_object_cache(sNetBufferCache);
 			delete_object_cache(sDataNodeCache);
+			delete_object_cache(sLargeDataNodeCache);
+			delete_object_cache(sExternalDataHeaderCache);
 			return B_OK;
 
 		default:
@@ -2405,5 +2596,7 @@ net_buffer_module_info gNetBufferModule = {
 	swap_addresses,
 
 	dump_buffer,	// dump
+
+	append_external_data,
 };
 
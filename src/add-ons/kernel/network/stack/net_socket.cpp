@@ -93,6 +93,7 @@ net_socket_private::net_socket_private()
 	first_protocol = NULL;
 	first_info = NULL;
 	options = 0;
+	owner_uid = 0;
 	linger = 0;
 	bound_to_device = 0;
 	error = 0;
@@ -420,6 +421,7 @@ socket_open(int family, int type, int protocol, net_socket** _socket)
 	}
 
 	socket->owner = team_get_current_team_id();
+	socket->owner_uid = geteuid();
 	socket->is_in_socket_list = true;
 
 	mutex_lock(&sSocketLock);
@@ -623,9 +625,11 @@ socket_spawn_pending(net_socket* _parent, net_socket** _socket)
 	// inherit parent's properties
 	socket->send = parent->send;
 	socket->receive = parent->receive;
-	socket->options = parent->options & (SO_KEEPALIVE | SO_DONTROUTE | SO_LINGER | SO_OOBINLINE);
+	socket->options = parent->options & (SO_KEEPALIVE | SO_DONTROUTE | SO_LINGER | SO_OOBINLINE
+		| SO_REUSEPORT);
 	socket->linger = parent->linger;
 	socket->owner = parent->owner;
+	socket->owner_uid = parent->owner_uid;
 	memcpy(&socket->address, &parent->address, parent->address.ss_len);
 	memcpy(&socket->peer, &parent->peer, parent->peer.ss_len);
 
@@ -1417,6 +1421,76 @@ socket_send(net_socket* socket, msghdr* header, const void* data, size_t length,
 }
 
 
+/*!	Like socket_send(), but passes the \a data on without copying it into
+	the net_buffer: it is referenced by the buffer (and any clone the protocol
+	keeps, for example for retransmission) until the last of them is gone, and
+	\a freeData is called then.
+	The data is handed over in any case. Protocols that don't use net_buffers,
+	or that need atomic messages, get a copy of the data instead.
+*/
+ssize_t
+socket_send_external(net_socket* socket, void* data, size_t length, int flags,
+	void (*freeData)(void* data))
+{
+	if (socket->first_info->send_data_no_buffer != NULL
+		|| (socket->first_info->flags & NET_PROTOCOL_ATOMIC_MESSAGES) != 0) {
+		ssize_t bytesSent = socket_send(socket, NULL, data, length, flags);
+		freeData(data);
+		return bytesSent;
+	}
+
+	const bool nosignal = ((flags & MSG_NOSIGNAL) != 0);
+	flags &= ~MSG_NOSIGNAL;
+
+	if (length > SSIZE_MAX) {
+		freeData(data);
+		return B_BAD_VALUE;
+	}
+
+	if (socket->peer.ss_len == 0) {
+		// we only support connected sockets
+		freeData(data);
+		return ENOTCONN;
+	}
+
+	net_buffer* buffer = gNetBufferModule.create(256);
+	if (buffer == NULL) {
+		freeData(data);
+		return ENOBUFS;
+	}
+
+	status_t status = gNetBufferModule.append_external(buffer, data, length,
+		freeData);
+	if (status != B_OK) {
+		gNetBufferModule.free(buffer);
+		return status;
+	}
+
+	buffer->msg_flags = flags;
+	memcpy(buffer->source, &socket->address, socket->address.ss_len);
+	memcpy(buffer->destination, &socket->peer, socket->peer.ss_len);
+
+	status = socket->first_info->send_data(socket->first_protocol, buffer);
+	if (status != B_OK) {
+		// we only send signals when called from userland
+		if (status == EPIPE && is_syscall() && !nosignal)
+			send_signal(find_thread(NULL), SIGPIPE);
+
+		size_t sizeAfterSend = buffer->size;
+		gNetBufferModule.free(buffer);
+
+		if (sizeAfterSend != length
+			&& (status == B_INTERRUPTED || status == B_WOULD_BLOCK)) {
+			// this appears to be a partial write
+			return length - sizeAfterSend;
+		}
+		return status;
+	}
+
+	return length;
+}
+
+
 status_t
 socket_set_option(net_socket* socket, int level, int option, const void* value,
 	int length)
@@ -1699,6 +1773,7 @@ net_socket_module_info gNetSocketModule = {
 	socket_listen,
 	socket_receive,
 	socket_send,
+	socket_send_external,
 	socket_setsockopt,
 	socket_shutdown,
 	socket_socketpair
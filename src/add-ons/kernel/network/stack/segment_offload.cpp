@@ -0,0 +1,406 @@
+/*
+ * Copyright 2026, Haiku, Inc. All Rights Reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+/*!	Generic segmentation and receive offload for TCP.
+
+	TCP may hand down a "super-segment" spanning several segments worth of
+	data; its net_buffer::segment_size tells the size of the individual
+	segments. It is only split up right before it is passed to the datalink
+	protocols of an interface; locally delivered super-segments are never
+	split at all.
+
+	On the receiving side, the device consumer threads coalesce in-order
+	segments of the same connection into a single buffer before they pass
+	them on to the protocols.
+*/
+
+
+#include "segment_offload.h"
+
+#include "stack_private.h"
+#include "utility.h"
+
+#include <NetUtilities.h>
+
+#include <netinet/in.h>
+#include <netinet/ip.h>
+#include <netinet/ip6.h>
+#include <netinet/tcp.h>
+#include <stddef.h>
+#include <string.h>
+
+
+// IPv4 header with options, or IPv6 header, plus TCP header with options
+static const size_t kMaxHeadersLength = 60 + 60;
+
+// TCP header flags (see RFC 793)
+static const uint8 kTCPFlagFinish = 0x01;
+static const uint8 kTCPFlagPush = 0x08;
+static const uint8 kTCPFlagAcknowledge = 0x10;
+
+
+struct segment_headers {
+	union {
+		uint8		data[kMaxHeadersLength];
+		uint32		alignment;
+	};
+	int32			version;
+	size_t			ip_length;
+	size_t			length;
+
+	ip*				IPv4()	{ return (ip*)data; }
+	ip6_hdr*		IPv6()	{ return (ip6_hdr*)data; }
+	tcphdr*			TCP()	{ return (tcphdr*)(data + ip_length); }
+};
+
+
+/*!	Reads the IP and TCP headers at the start of the \a buffer. Fails if the
+	buffer does not contain a complete, unfragmented TCP segment.
+*/
+static status_t
+read_segment_headers(net_buffer* buffer, segment_headers& headers)
+{
+	uint8 firstByte;
+	if (gNetBufferModule.read(buffer, 0, &firstByte, 1) != B_OK)
+		return B_BAD_DATA;
+
+	headers.version = firstByte >> 4;
+	if (headers.version == 4)
+		headers.ip_length = (firstByte & 0xf) << 2;
+	else if (headers.version == 6)
+		headers.ip_length = sizeof(ip6_hdr);
+	else
+		return B_BAD_DATA;
+
+	if (headers.ip_length < sizeof(ip)
+		|| buffer->size < headers.ip_length + sizeof(tcphdr)
+		|| gNetBufferModule.read(buffer, 0, headers.data,
+			headers.ip_length + sizeof(tcphdr)) != B_OK)
+		return B_BAD_DATA;
+
+	if (headers.version == 4) {
+		ip* header = headers.IPv4();
+		if (header->ip_p != IPPROTO_TCP
+			|| (ntohs(header->ip_off) & (IP_MF | IP_OFFMASK)) != 0)
+			return B_BAD_DATA;
+	} else if (headers.IPv6()->ip6_nxt != IPPROTO_TCP)
+		return B_BAD_DATA;
+
+	// the data offset is the upper half of the 13th byte
+	size_t tcpLength = (headers.data[headers.ip_length + 12] >> 4) << 2;
+	if (tcpLength < sizeof(tcphdr))
+		return B_BAD_DATA;
+
+	headers.length = headers.ip_length + tcpLength;
+	if (headers.length > buffer->size)
+		return B_BAD_DATA;
+
+	return gNetBufferModule.read(buffer, 0, headers.data, headers.length);
+}
+
+
+/*!	Returns the length of the IP packet according to its header. */
+static size_t
+packet_length(segment_headers& headers)
+{
+	if (headers.version == 4)
+		return ntohs(headers.IPv4()->ip_len);
+
+	return headers.ip_length + ntohs(headers.IPv6()->ip6_plen);
+}
+
+
+static void
+set_payload_length(segment_headers& headers, size_t payloadLength)
+{
+	if (headers.version == 4) {
+		ip* header = headers.IPv4();
+		header->ip_len = htons(headers.length + payloadLength);
+		header->ip_sum = 0;
+		header->ip_sum = checksum(headers.data, headers.ip_length);
+	} else {
+		headers.IPv6()->ip6_plen = htons(headers.length - headers.ip_length
+			+ payloadLength);
+	}
+}
+
+
+/*!	Computes the TCP checksum of the segment in \a buffer, including the
+	pseudo header. For a received segment, the result is zero if its checksum
+	is correct.
+*/
+static uint16
+tcp_checksum(net_buffer* buffer, segment_headers& headers)
+{
+	const uint8* addresses;
+	size_t addressesLength;
+	if (headers.version == 4) {
+		addresses = (const uint8*)&headers.IPv4()->ip_src;
+		addressesLength = 2 * sizeof(in_addr);
+	} else {
+		addresses = (const uint8*)&headers.IPv6()->ip6_src;
+		addressesLength = 2 * sizeof(in6_addr);
+	}
+
+	Checksum checksum;
+	for (size_t i = 0; i < addressesLength; i += 2) {
+		uint16 word;
+		memcpy(&word, addresses + i, sizeof(word));
+		checksum << word;
+	}
+
+	size_t tcpLength = buffer->size - headers.ip_length;
+	checksum << (uint16)htons(IPPROTO_TCP) << (uint16)htons(tcpLength)
+		<< (uint32)gNetBufferModule.checksum(buffer, headers.ip_length,
+			tcpLength, false);
+
+	return checksum;
+}
+
+
+//	#pragma mark - segmentation
+
+
+/*!	Splits the TCP super-segment \a buffer into segments of at most
+	net_buffer::segment_size bytes of data each, and sends them through the
+	datalink \a protocol.
+	Like with IP fragmentation, the last segment is sent using the \a buffer
+	itself, so the caller keeps ownership of it in case of an error.
+*/
+status_t
+send_segments(net_datalink_protocol* protocol, net_buffer* buffer)
+{
+	uint32 segmentSize = buffer->segment_size;
+	buffer->segment_size = 0;
+
+	segment_headers headers;
+	status_t status = read_segment_headers(buffer, headers);
+	if (status != B_OK)
+		return status;
+
+	status = gNetBufferModule.remove_header(buffer, headers.length);
+	if (status != B_OK)
+		return status;
+
+	tcphdr* tcp = headers.TCP();
+	uint32 sequence = ntohl(tcp->th_seq);
+	uint8 flags = tcp->th_flags;
+	// the IP protocol reserved consecutive IDs for all segments
+	uint16 id = headers.version == 4 ? ntohs(headers.IPv4()->ip_id) : 0;
+
+	while (true) {
+		bool lastSegment = buffer->size <= segmentSize;
+		uint32 length = lastSegment ? buffer->size : segmentSize;
+
+		net_buffer* segment = buffer;
+		if (!lastSegment) {
+			segment = gNetBufferModule.split(buffer, length);
+			if (segment == NULL)
+				return B_NO_MEMORY;
+		}
+
+		// only the last segment may end the data, or the connection
+		tcp->th_seq = htonl(sequence);
+		tcp->th_flags = lastSegment
+			? flags : flags & ~(kTCPFlagFinish | kTCPFlagPush);
+		tcp->th_sum = 0;
+		if (headers.version == 4)
+			headers.IPv4()->ip_id = htons(id++);
+		set_payload_length(headers, length);
+
+		status = gNetBufferModule.prepend(segment, headers.data,
+			headers.length);
+		if (status == B_OK) {
+			uint16 sum = tcp_checksum(segment, headers);
+			status = gNetBufferModule.write(segment,
+				headers.ip_length + offsetof(tcphdr, th_sum), &sum,
+				sizeof(sum));
+		}
+		if (status == B_OK)
+			status = protocol->module->send_data(protocol, segment);
+
+		if (lastSegment) {
+			// we don't own the last buffer, so we don't have to free it
+			break;
+		}
+
+		if (status != B_OK) {
+			gNetBufferModule.free(segment);
+			break;
+		}
+
+		sequence += length;
+	}
+
+	return status;
+}
+
+
+//	#pragma mark - coalescing
+
+
+/*!	Returns whether the \a buffer is a data segment that may be merged with
+	others, and validates its checksums, since they will not be valid anymore
+	afterwards.
+	Link layer padding is trimmed from the buffer, so that its size matches
+	the IP packet length, and can be used to compute the payload length.
+*/
+static bool
+is_coalescable(net_buffer* buffer, segment_headers& headers)
+{
+	if (buffer->interface_address != NULL
+		|| (buffer->type != B_NET_FRAME_TYPE_IPV4
+			&& buffer->type != B_NET_FRAME_TYPE_IPV6)
+		|| read_segment_headers(buffer, headers) != B_OK)
+		return false;
+
+	if (headers.version == 4 && headers.ip_length != sizeof(ip))
+		return false;
+
+	// Short frames are padded by Ethernet, and the padding must not become
+	// part of the data. Truncated packets are left to the IP layer.
+	size_t packetLength = packet_length(headers);
+	if (packetLength <= headers.length || packetLength > buffer->size)
+		return false;
+	if (packetLength < buffer->size
+		&& gNetBufferModule.trim(buffer, packetLength) != B_OK)
+		return false;
+
+	uint8 flags = headers.TCP()->th_flags;
+	if ((flags & ~kTCPFlagPush) != kTCPFlagAcknowledge)
+		return false;
+
+	if (headers.version == 4
+		&& (buffer->buffer_flags & NET_BUFFER_L3_CHECKSUM_VALID) == 0) {
+		if (checksum(headers.data, headers.ip_length) != 0)
+			return false;
+		buffer->buffer_flags |= NET_BUFFER_L3_CHECKSUM_VALID;
+	}
+	if ((buffer->buffer_flags & NET_BUFFER_L4_CHECKSUM_VALID) == 0) {
+		if (tcp_checksum(buffer, headers) != 0)
+			return false;
+		buffer->buffer_flags |= NET_BUFFER_L4_CHECKSUM_VALID;
+	}
+
+	return true;
+}
+
+
+/*!	Returns whether \a segment directly follows \a target in the same
+	connection, and they only differ in their data.
+*/
+static bool
+can_coalesce(net_buffer* target, segment_headers& targetHeaders,
+	net_buffer* segment, segment_headers& headers)
+{
+	if (headers.version != targetHeaders.version
+		|| headers.length != targetHeaders.length)
+		return false;
+
+	// the target may contain merged segments already, but its padding has
+	// been trimmed just like that of the segment
+	size_t targetDataLength = target->size - targetHeaders.length;
+	size_t dataLength = packet_length(headers) - headers.length;
+	if (targetHeaders.length + targetDataLength + dataLength > IP_MAXPACKET)
+		return false;
+
+	if (headers.version == 4) {
+		ip* targetIP = targetHeaders.IPv4();
+		ip* segmentIP = headers.IPv4();
+		if (targetIP->ip_src.s_addr != segmentIP->ip_src.s_addr
+			|| targetIP->ip_dst.s_addr != segmentIP->ip_dst.s_addr
+			|| targetIP->ip_tos != segmentIP->ip_tos
+			|| targetIP->ip_ttl != segmentIP->ip_ttl)
+			return false;
+	} else {
+		ip6_hdr* targetIP = targetHeaders.IPv6();
+		ip6_hdr* segmentIP = headers.IPv6();
+		if (targetIP->ip6_flow != segmentIP->ip6_flow
+			|| targetIP->ip6_hlim != segmentIP->ip6_hlim
+			|| memcmp(&targetIP->ip6_src, &segmentIP->ip6_src,
+				2 * sizeof(in6_addr)) != 0)
+			return false;
+	}
+
+	tcphdr* targetTCP = targetHeaders.TCP();
+	tcphdr* segmentTCP = headers.TCP();
+	if (targetTCP->th_sport != segmentTCP->th_sport
+		|| targetTCP->th_dport != segmentTCP->th_dport
+		|| targetTCP->th_ack != segmentTCP->th_ack
+		|| (targetTCP->th_flags & kTCPFlagPush) != 0
+		|| ntohl(segmentTCP->th_seq)
+			!= ntohl(targetTCP->th_seq) + targetDataLength)
+		return false;
+
+	// the options (timestamps, SACK blocks) must be the same, too
+	size_t optionsOffset = headers.ip_length + sizeof(tcphdr);
+	return memcmp(targetHeaders.data + optionsOffset,
+		headers.data + optionsOffset, headers.length - optionsOffset) == 0;
+}
+
+
+static void
+finish_coalescing(net_buffer* target, segment_headers& headers)
+{
+	set_payload_length(headers, target->size - headers.length);
+	gNetBufferModule.write(target, 0, headers.data, headers.length);
+}
+
+
+/*!	Merges in-order segments of the same TCP connection that directly follow
+	each other in the \a buffers array, so that they only need to go through
+	the protocols once.
+	The buffers must have been deframed. Returns the number of buffers left in
+	the array.
+*/
+ssize_t
+coalesce_segments(net_buffer** buffers, ssize_t count)
+{
+	net_buffer* target = NULL;
+	segment_headers targetHeaders;
+	bool merged = false;
+	ssize_t left = 0;
+
+	for (ssize_t i = 0; i < count; i++) {
+		net_buffer* buffer = buffers[i];
+		segment_headers headers;
+		bool coalescable = is_coalescable(buffer, headers);
+
+		if (target != NULL && coalescable
+			&& can_coalesce(target, targetHeaders, buffer, headers)
+			&& gNetBufferModule.remove_header(buffer, headers.length) == B_OK) {
+			if (gNetBufferModule.merge(target, buffer, true) == B_OK) {
+				// take over the flags (PSH) and window of the later segment
+				tcphdr* tcp = targetHeaders.TCP();
+				tcp->th_flags |= headers.TCP()->th_flags;
+				tcp->th_win = headers.TCP()->th_win;
+				merged = true;
+				continue;
+			}
+
+			// put the segment back together, and just keep it as it is
+			if (gNetBufferModule.prepend(buffer, headers.data, headers.length)
+					!= B_OK) {
+				gNetBufferModule.free(buffer);
+				continue;
+			}
+		}
+
+		if (merged)
+			finish_coalescing(target, targetHeaders);
+
+		buffers[left++] = buffer;
+		target = coalescable ? buffer : NULL;
+		if (coalescable)
+			targetHeaders = headers;
+		merged = false;
+	}
+
+	if (merged)
+		finish_coalescing(target, targetHeaders);
+
+	return left;
+}
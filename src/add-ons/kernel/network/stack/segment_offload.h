@@ -0,0 +1,17 @@
+/*
+ * Copyright 2026, Haiku, Inc. All Rights Reserved.
+ * Distributed under the terms of the MIT License.
+ */
+#ifndef SEGMENT_OFFLOAD_H
+#define SEGMENT_OFFLOAD_H
+
+
+#include <net_buffer.h>
+#include <net_datalink_protocol.h>
+
+
+status_t send_segments(net_datalink_protocol* protocol, net_buffer* buffer);
+ssize_t coalesce_segments(net_buffer** buffers, ssize_t count);
+
+
+#endif	// SEGMENT_OFFLOAD_H
@@ -971,6 +971,7 @@ net_stack_module_info gNetStackModule = {
 	uninit_fifo,
 	fifo_enqueue_buffer,
 	fifo_dequeue_buffer,
+	fifo_dequeue_buffers,
 	clear_fifo,
 	fifo_socket_enqueue_buffer,
 
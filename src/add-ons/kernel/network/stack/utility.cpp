@@ -98,39 +98,6 @@ UserBuffer::PadToNext(size_t length)
 // #pragma mark -
 
 
-uint16
-compute_checksum(uint8* _buffer, size_t length)
-{
-	uint16* buffer = (uint16*)_buffer;
-	uint32 sum = 0;
-
-	// TODO: unfold loop for speed
-	// TODO: write processor dependent version for speed
-	while (length >= 2) {
-		sum += *buffer++;
-		length -= 2;
-	}
-
-	if (length) {
-		// give the last byte it's proper endian-aware treatment
-#if B_HOST_IS_LENDIAN
-		sum += *(uint8*)buffer;
-#else
-		uint8 ordered[2];
-		ordered[0] = *(uint8*)buffer;
-		ordered[1] = 0;
-		sum += *(uint16*)ordered;
-#endif
-	}
-
-	while (sum >> 16) {
-		sum = (sum & 0xffff) + (sum >> 16);
-	}
-
-	return sum;
-}
-
-
 uint16
 checksum(uint8* buffer, size_t length)
 {
@@ -213,6 +180,26 @@ fifo_enqueue_buffer(net_fifo* fifo, net_buffer* buffer)
 }
 
 
+/*!	Enqueues the \a count buffers in order, stopping at the first one that
+	doesn't fit into the FIFO anymore. The FIFO lock is only acquired once.
+	Returns the number of buffers that have been enqueued; the caller keeps
+	ownership of the remaining ones.
+*/
+size_t
+fifo_enqueue_buffers(net_fifo* fifo, net_buffer** buffers, size_t count)
+{
+	MutexLocker locker(fifo->lock);
+
+	size_t enqueued = 0;
+	while (enqueued < count
+		&& base_fifo_enqueue_buffer(fifo, buffers[enqueued]) == B_OK) {
+		enqueued++;
+	}
+
+	return enqueued;
+}
+
+
 /*!	Gets the first buffer from the FIFO. If there is no buffer, it
 	will wait depending on the \a flags and \a timeout.
 	The following flags are supported:
@@ -280,6 +267,58 @@ fifo_dequeue_buffer(net_fifo* fifo, uint32 flags, bigtime_t timeout,
 }
 
 
+/*!	Like fifo_dequeue_buffer(), but gets up to \a count buffers at once. It
+	only waits for the first buffer, and returns whatever else is in the FIFO
+	at that time as well.
+	Only the MSG_DONTWAIT flag is supported.
+	Returns the number of buffers dequeued, or an error code.
+*/
+ssize_t
+fifo_dequeue_buffers(net_fifo* fifo, uint32 flags, bigtime_t timeout,
+	net_buffer** buffers, size_t count)
+{
+	if ((flags & ~MSG_DONTWAIT) != 0)
+		return EOPNOTSUPP;
+	if (count == 0)
+		return B_BAD_VALUE;
+
+	MutexLocker locker(fifo->lock);
+	const bool dontWait = (flags & MSG_DONTWAIT) != 0 || timeout == 0;
+
+	while (true) {
+		size_t dequeued = 0;
+		while (dequeued < count) {
+			net_buffer* buffer
+				= (net_buffer*)list_remove_head_item(&fifo->buffers);
+			if (buffer == NULL)
+				break;
+
+			fifo->current_bytes -= buffer->size;
+			buffers[dequeued++] = buffer;
+		}
+
+		if (dequeued > 0)
+			return dequeued;
+
+		if (!dontWait)
+			fifo->waiting++;
+
+		locker.Unlock();
+
+		if (dontWait)
+			return B_WOULD_BLOCK;
+
+		// we need to wait until a new buffer becomes available
+		status_t status = acquire_sem_etc(fifo->notify, 1,
+			B_CAN_INTERRUPT | B_RELATIVE_TIMEOUT, timeout);
+		if (status < B_OK)
+			return status;
+
+		locker.Lock();
+	}
+}
+
+
 status_t
 clear_fifo(net_fifo* fifo)
 {
@@ -11,6 +11,8 @@
 
 #include <net_stack.h>
 
+#include "checksum.h"
+
 
 class UserBuffer {
 public:
@@ -45,7 +47,6 @@ UserBuffer::UserBuffer(void* buffer, size_t size)
 
 
 // checksums
-uint16		compute_checksum(uint8* _buffer, size_t length);
 uint16		checksum(uint8* buffer, size_t length);
 
 // notifications
@@ -55,8 +56,12 @@ status_t	notify_socket(net_socket* socket, uint8 event, int32 value);
 status_t	init_fifo(net_fifo* fifo, const char *name, size_t maxBytes);
 void		uninit_fifo(net_fifo* fifo);
 status_t	fifo_enqueue_buffer(net_fifo* fifo, struct net_buffer* buffer);
+size_t		fifo_enqueue_buffers(net_fifo* fifo, struct net_buffer** buffers,
+				size_t count);
 ssize_t		fifo_dequeue_buffer(net_fifo* fifo, uint32 flags, bigtime_t timeout,
 				struct net_buffer** _buffer);
+ssize_t		fifo_dequeue_buffers(net_fifo* fifo, uint32 flags,
+				bigtime_t timeout, struct net_buffer** buffers, size_t count);
 status_t	clear_fifo(net_fifo* fifo);
 status_t	fifo_socket_enqueue_buffer(net_fifo* fifo, net_socket* socket,
 				uint8 event, net_buffer* buffer);
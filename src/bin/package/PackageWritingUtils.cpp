@@ -8,8 +8,12 @@
 
 #include <dirent.h>
 #include <errno.h>
+#include <fcntl.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 #include <package/hpkg/HPKGDefs.h>
 
@@ -48,3 +52,51 @@ add_current_directory_entries(BPackageWriter& packageWriter,
 
 	return B_OK;
 }
+
+
+/*!	Reads the compression dictionary file \a fileName. On success the caller
+	takes over ownership of the returned data and has to free() them.
+*/
+status_t
+read_compression_dictionary(const char* fileName, void*& _data, size_t& _size)
+{
+	FileDescriptorCloser fd(open(fileName, O_RDONLY));
+	if (!fd.IsSet()) {
+		fprintf(stderr, "Error: Failed to open dictionary file \"%s\": %s\n",
+			fileName, strerror(errno));
+		return errno;
+	}
+
+	struct stat st;
+	if (fstat(fd.Get(), &st) != 0) {
+		fprintf(stderr, "Error: Failed to stat dictionary file \"%s\": %s\n",
+			fileName, strerror(errno));
+		return errno;
+	}
+
+	const off_t maxSize
+		= BPackageKit::BHPKG::B_HPKG_MAX_COMPRESSION_DICTIONARY_SIZE;
+	if (st.st_size == 0 || st.st_size > maxSize) {
+		fprintf(stderr, "Error: Invalid dictionary file size (max. %" B_PRIdOFF
+			" bytes)\n", maxSize);
+		return B_BAD_VALUE;
+	}
+
+	void* data = malloc(st.st_size);
+	if (data == NULL) {
+		fprintf(stderr, "Error: Out of memory!\n");
+		return B_NO_MEMORY;
+	}
+	MemoryDeleter dataDeleter(data);
+
+	ssize_t bytesRead = read(fd.Get(), data, st.st_size);
+	if (bytesRead != st.st_size) {
+		fprintf(stderr, "Error: Failed to read dictionary file \"%s\": %s\n",
+			fileName, strerror(bytesRead < 0 ? errno : B_IO_ERROR));
+		return bytesRead < 0 ? errno : B_IO_ERROR;
+	}
+
+	_data = dataDeleter.Detach();
+	_size = st.st_size;
+	return B_OK;
+}
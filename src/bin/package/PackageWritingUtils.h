@@ -17,6 +17,8 @@ using BPackageKit::BHPKG::BPackageWriterListener;
 
 status_t	add_current_directory_entries(BPackageWriter& packageWriter,
 				BPackageWriterListener& listener, bool skipPackageInfo);
+status_t	read_compression_dictionary(const char* fileName, void*& _data,
+				size_t& _size);
 
 
 #endif	// PACKAGE_WRITING_UTILS_H
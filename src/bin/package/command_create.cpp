@@ -20,6 +20,8 @@
 #include <package/hpkg/HPKGDefs.h>
 #include <package/hpkg/PackageWriter.h>
 
+#include <AutoDeleter.h>
+
 #include "package.h"
 #include "PackageWriterListener.h"
 #include "PackageWritingUtils.h"
@@ -36,11 +38,14 @@ command_create(int argc, const char* const* argv)
 	const char* changeToDirectory = NULL;
 	const char* packageInfoFileName = NULL;
 	const char* installPath = NULL;
+	const char* dictionaryFileName = NULL;
 	bool isBuildPackage = false;
+	bool addTOCIndex = false;
 	bool quiet = false;
 	bool verbose = false;
 	int32 compressionLevel = BPackageKit::BHPKG::B_HPKG_COMPRESSION_LEVEL_BEST;
 	int32 compression = parse_compression_argument(NULL);
+	int32 threadCount = parse_thread_count_argument(NULL);
 
 	while (true) {
 		static struct option sLongOptions[] = {
@@ -51,7 +56,7 @@ command_create(int argc, const char* const* argv)
 		};
 
 		opterr = 0; // don't print errors
-		int c = getopt_long(argc, (char**)argv, "+b0123456789C:hi:I:z:qv",
+		int c = getopt_long(argc, (char**)argv, "+b0123456789C:d:hi:I:j:tz:qv",
 			sLongOptions, NULL);
 		if (c == -1)
 			break;
@@ -78,6 +83,10 @@ command_create(int argc, const char* const* argv)
 				changeToDirectory = optarg;
 				break;
 
+			case 'd':
+				dictionaryFileName = optarg;
+				break;
+
 			case 'h':
 				print_usage_and_exit(false);
 				break;
@@ -90,6 +99,14 @@ command_create(int argc, const char* const* argv)
 				installPath = optarg;
 				break;
 
+			case 'j':
+				threadCount = parse_thread_count_argument(optarg);
+				break;
+
+			case 't':
+				addTOCIndex = true;
+				break;
+
 			case 'z':
 				compression = parse_compression_argument(optarg);
 				break;
@@ -136,14 +153,30 @@ command_create(int argc, const char* const* argv)
 	// create package
 	BPackageWriterParameters writerParameters;
 	writerParameters.SetCompressionLevel(compressionLevel);
+	if (addTOCIndex)
+		writerParameters.SetFlags(BPackageKit::BHPKG::B_HPKG_WRITER_TOC_INDEX);
 	if (compressionLevel == 0) {
 		writerParameters.SetCompression(
 			BPackageKit::BHPKG::B_HPKG_COMPRESSION_NONE);
 	}
 
+	// read the compression dictionary, if given
+	void* dictionary = NULL;
+	size_t dictionarySize = 0;
+	if (dictionaryFileName != NULL && compressionLevel != 0) {
+		if (read_compression_dictionary(dictionaryFileName, dictionary,
+				dictionarySize) != B_OK) {
+			return 1;
+		}
+		compression = BPackageKit::BHPKG::B_HPKG_COMPRESSION_ZSTD_DICTIONARY;
+		writerParameters.SetCompressionDictionary(dictionary, dictionarySize);
+	}
+	MemoryDeleter dictionaryDeleter(dictionary);
+
 	if (compressionLevel == 0)
 		compression = BPackageKit::BHPKG::B_HPKG_COMPRESSION_NONE;
 	writerParameters.SetCompression(compression);
+	writerParameters.SetCompressionThreadCount(threadCount);
 
 	PackageWriterListener listener(verbose, quiet);
 	BPackageWriter packageWriter(&listener);
@@ -104,6 +104,12 @@ struct VersionPolicyV1 {
 		return BPackageKit::BHPKG::V1::BPackageDataReaderFactory(bufferPool)
 			.CreatePackageDataReader(heapReader, data, _reader);
 	}
+
+	static status_t FindEntry(PackageReader& packageReader, const char* path,
+		PackageContentHandler* handler)
+	{
+		return B_NOT_SUPPORTED;
+	}
 };
 
 struct VersionPolicyV2 {
@@ -157,6 +163,12 @@ struct VersionPolicyV2 {
 		return BPackageKit::BHPKG::BPackageDataReaderFactory()
 			.CreatePackageDataReader(heapReader, data, _reader);
 	}
+
+	static status_t FindEntry(PackageReader& packageReader, const char* path,
+		PackageContentHandler* handler)
+	{
+		return packageReader.FindEntry(path, handler);
+	}
 };
 
 
@@ -836,7 +848,22 @@ do_extract(const char* packageFileName, const char* changeToDirectory,
 		handler.SetPackageInfoFile(packageInfoFileName);
 
 	// extract
-	error = packageReader.ParseContent(&handler);
+	// If the package has a TOC index, look up explicitly specified entries
+	// directly instead of parsing the whole TOC.
+	error = B_NOT_SUPPORTED;
+	for (int i = 0; i < explicitEntryCount; i++) {
+		error = VersionPolicy::FindEntry(packageReader, explicitEntries[i],
+			&handler);
+		if (error == B_ENTRY_NOT_FOUND) {
+			// reported below
+			error = B_OK;
+		}
+		if (error != B_OK)
+			break;
+	}
+
+	if (error == B_NOT_SUPPORTED)
+		error = packageReader.ParseContent(&handler);
 	if (error != B_OK)
 		exit(1);
 
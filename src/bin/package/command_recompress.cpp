@@ -18,11 +18,13 @@
 #include <package/hpkg/PackageReader.h>
 #include <package/hpkg/PackageWriter.h>
 
+#include <AutoDeleter.h>
 #include <DataPositionIOWrapper.h>
 #include <FdIO.h>
 
 #include "package.h"
 #include "PackageWriterListener.h"
+#include "PackageWritingUtils.h"
 
 
 using BPackageKit::BHPKG::BPackageReader;
@@ -46,6 +48,8 @@ command_recompress(int argc, const char* const* argv)
 	bool verbose = false;
 	int32 compressionLevel = BPackageKit::BHPKG::B_HPKG_COMPRESSION_LEVEL_BEST;
 	int32 compression = parse_compression_argument(NULL);
+	int32 threadCount = parse_thread_count_argument(NULL);
+	const char* dictionaryFileName = NULL;
 
 	while (true) {
 		static struct option sLongOptions[] = {
@@ -56,7 +60,7 @@ command_recompress(int argc, const char* const* argv)
 		};
 
 		opterr = 0; // don't print errors
-		int c = getopt_long(argc, (char**)argv, "+0123456789:hz:qv",
+		int c = getopt_long(argc, (char**)argv, "+0123456789:d:hj:z:qv",
 			sLongOptions, NULL);
 		if (c == -1)
 			break;
@@ -75,10 +79,18 @@ command_recompress(int argc, const char* const* argv)
 				compressionLevel = c - '0';
 				break;
 
+			case 'd':
+				dictionaryFileName = optarg;
+				break;
+
 			case 'h':
 				print_usage_and_exit(false);
 				break;
 
+			case 'j':
+				threadCount = parse_thread_count_argument(optarg);
+				break;
+
 			case 'z':
 				compression = parse_compression_argument(optarg);
 				break;
@@ -123,9 +135,23 @@ command_recompress(int argc, const char* const* argv)
 
 	// write the output package
 	BPackageWriterParameters writerParameters;
+
+	void* dictionary = NULL;
+	size_t dictionarySize = 0;
+	if (dictionaryFileName != NULL && compressionLevel != 0) {
+		if (read_compression_dictionary(dictionaryFileName, dictionary,
+				dictionarySize) != B_OK) {
+			return 1;
+		}
+		compression = BPackageKit::BHPKG::B_HPKG_COMPRESSION_ZSTD_DICTIONARY;
+		writerParameters.SetCompressionDictionary(dictionary, dictionarySize);
+	}
+	MemoryDeleter dictionaryDeleter(dictionary);
+
 	if (compressionLevel == 0)
 		compression = BPackageKit::BHPKG::B_HPKG_COMPRESSION_NONE;
 	writerParameters.SetCompression(compression);
+	writerParameters.SetCompressionThreadCount(threadCount);
 	writerParameters.SetCompressionLevel(compressionLevel);
 
 	PackageWriterListener listener(verbose, quiet);
@@ -12,6 +12,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
 
 #include <package/hpkg/HPKGDefs.h>
 
@@ -56,6 +57,11 @@ static const char* kUsage =
 	"        -b         - Create an empty build package. Only the .PackageInfo will\n"
 	"                     be added.\n"
 	"        -C <dir>   - Change to directory <dir> before adding entries.\n"
+	"        -d <dict>  - Compress using zstd with the dictionary in file <dict>.\n"
+	"                     The dictionary is stored in the package. Packages that\n"
+	"                     contain many small files compress a lot better with a\n"
+	"                     dictionary trained (e.g. with \"zstd --train\") on\n"
+	"                     similar packages.\n"
 	"        -i <info>  - Use the package info file <info>. It will be added as\n"
 	"                     \".PackageInfo\", overriding a \".PackageInfo\" file,\n"
 	"                     existing.\n"
@@ -63,6 +69,10 @@ static const char* kUsage =
 	"                     an option only for use in package building. It will cause\n"
 	"                     the package .self link to point to <path>, which is useful\n"
 	"                     to redirect a \"make install\". Only allowed with -b.\n"
+	"        -j <count> - Compress using <count> threads. Defaults to the number\n"
+	"                     of CPUs. The package is the same regardless.\n"
+	"        -t         - Add a TOC index, which allows extracting single\n"
+	"                     entries without reading the whole TOC.\n"
 	"        -z <type>  - Specify compression method to use.\n"
 	"        -q         - Be quiet (don't show any output except for errors).\n"
 	"        -v         - Be verbose (show more info about created package).\n"
@@ -109,6 +119,9 @@ static const char* kUsage =
 	"\n"
 	"        -0 ... -9  - Use compression level 0 ... 9. 0 means no, 9 best\n"
 	"                     compression. Defaults to 9.\n"
+	"        -d <dict>  - Compress using zstd with the dictionary in file <dict>.\n"
+	"                     See \"create\".\n"
+	"        -j <count> - Compress using <count> threads. See \"create\".\n"
 	"        -z <type>  - Specify compression method to use.\n"
 	"        -q         - Be quiet (don't show any output except for errors).\n"
 	"        -v         - Be verbose (show more info about created package).\n"
@@ -149,6 +162,26 @@ parse_compression_argument(const char* arg)
 }
 
 
+int32
+parse_thread_count_argument(const char* arg)
+{
+	if (arg == NULL) {
+		// Default to the number of CPUs.
+		long cpuCount = sysconf(_SC_NPROCESSORS_ONLN);
+		return cpuCount > 0 ? (int32)cpuCount : 1;
+	}
+
+	char* end;
+	long count = strtol(arg, &end, 10);
+	if (*arg == '\0' || *end != '\0' || count < 1 || count > 256) {
+		fprintf(stderr, "error: invalid thread count '%s'\n", arg);
+		exit(1);
+	}
+
+	return (int32)count;
+}
+
+
 int
 main(int argc, const char* const* argv)
 {
@@ -0,0 +1,178 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+#include <errno.h>
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <Directory.h>
+#include <Entry.h>
+#include <File.h>
+#include <Path.h>
+#include <String.h>
+
+#include <package/ChecksumAccessors.h>
+#include <package/hpkg/RepositoryDelta.h>
+#include <package/hpkg/StandardErrorOutput.h>
+
+#include "package_repo.h"
+
+
+using namespace BPackageKit::BHPKG;
+using BPackageKit::BPrivate::GeneralFileChecksumAccessor;
+
+
+static const char* const kDefaultDeltaDirectory = "repo.deltas";
+
+
+static bool
+get_checksum(const char* fileName, BString& checksum)
+{
+	BEntry entry(fileName);
+	status_t error = GeneralFileChecksumAccessor(entry).GetChecksum(checksum);
+	if (error != B_OK) {
+		fprintf(stderr, "Error: Failed to compute the checksum of \"%s\": "
+			"%s\n", fileName, strerror(error));
+		return false;
+	}
+
+	return true;
+}
+
+
+int
+command_delta(int argc, const char* const* argv)
+{
+	const char* deltaDirectory = kDefaultDeltaDirectory;
+	bool quiet = false;
+
+	while (true) {
+		static struct option sLongOptions[] = {
+			{ "help", no_argument, 0, 'h' },
+			{ "quiet", no_argument, 0, 'q' },
+			{ 0, 0, 0, 0 }
+		};
+
+		opterr = 0; // don't print errors
+		int c = getopt_long(argc, (char**)argv, "+ho:q", sLongOptions, NULL);
+		if (c == -1)
+			break;
+
+		switch (c) {
+			case 'h':
+				print_usage_and_exit(false);
+				break;
+
+			case 'o':
+				deltaDirectory = optarg;
+				break;
+
+			case 'q':
+				quiet = true;
+				break;
+
+			default:
+				print_usage_and_exit(true);
+				break;
+		}
+	}
+
+	// At least two arguments should remain -- the new repository file name and
+	// one old repository file name.
+	if (optind + 2 > argc)
+		print_usage_and_exit(true);
+
+	const char* newRepositoryFileName = argv[optind++];
+
+	BFile newRepositoryFile(newRepositoryFileName, B_READ_ONLY);
+	status_t error = newRepositoryFile.InitCheck();
+	if (error != B_OK) {
+		fprintf(stderr, "Error: Failed to open repository file \"%s\": %s\n",
+			newRepositoryFileName, strerror(error));
+		return 1;
+	}
+
+	BString newChecksum;
+	if (!get_checksum(newRepositoryFileName, newChecksum))
+		return 1;
+
+	error = create_directory(deltaDirectory, 0755);
+	if (error != B_OK) {
+		fprintf(stderr, "Error: Failed to create directory \"%s\": %s\n",
+			deltaDirectory, strerror(error));
+		return 1;
+	}
+
+	BStandardErrorOutput errorOutput;
+	bool failed = false;
+
+	for (; optind < argc; optind++) {
+		const char* oldRepositoryFileName = argv[optind];
+
+		// the delta is named after the checksum of the repository file it
+		// applies to
+		BString oldChecksum;
+		if (!get_checksum(oldRepositoryFileName, oldChecksum)) {
+			failed = true;
+			continue;
+		}
+
+		if (oldChecksum == newChecksum) {
+			if (!quiet) {
+				printf("\"%s\" is identical to \"%s\", skipping\n",
+					oldRepositoryFileName, newRepositoryFileName);
+			}
+			continue;
+		}
+
+		BFile oldRepositoryFile(oldRepositoryFileName, B_READ_ONLY);
+		error = oldRepositoryFile.InitCheck();
+		if (error != B_OK) {
+			fprintf(stderr, "Error: Failed to open repository file \"%s\": "
+				"%s\n", oldRepositoryFileName, strerror(error));
+			failed = true;
+			continue;
+		}
+
+		BPath deltaPath;
+		error = deltaPath.SetTo(deltaDirectory, oldChecksum.String());
+		if (error != B_OK) {
+			fprintf(stderr, "Error: Failed to construct the delta path: %s\n",
+				strerror(error));
+			return 1;
+		}
+
+		BFile deltaFile(deltaPath.Path(),
+			B_WRITE_ONLY | B_CREATE_FILE | B_ERASE_FILE);
+		error = deltaFile.InitCheck();
+		if (error != B_OK) {
+			fprintf(stderr, "Error: Failed to create delta file \"%s\": %s\n",
+				deltaPath.Path(), strerror(error));
+			return 1;
+		}
+
+		error = BPackageKit::BHPKG::BPrivate::RepositoryDelta::Create(
+			&errorOutput, &oldRepositoryFile, &newRepositoryFile, &deltaFile);
+		if (error != B_OK) {
+			fprintf(stderr, "Error: Failed to create the delta from \"%s\" "
+				"to \"%s\"\n", oldRepositoryFileName, newRepositoryFileName);
+			deltaFile.Unset();
+			BEntry(deltaPath.Path()).Remove();
+			failed = true;
+			continue;
+		}
+
+		if (!quiet) {
+			off_t deltaSize = 0;
+			deltaFile.GetSize(&deltaSize);
+			printf("%s: %" B_PRIdOFF " bytes\n", deltaPath.Path(), deltaSize);
+		}
+	}
+
+	return failed ? 1 : 0;
+}
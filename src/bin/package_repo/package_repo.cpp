@@ -51,6 +51,17 @@ static const char* kUsage =
 	"    -v         - be verbose (list package attributes as encountered).\n"
 	"    -t         - Trust filenames in package-list-file to be canonical.\n"
 	"\n"
+	"  delta [ <options> ] <new-repo> <old-repo ...>\n"
+	"    Creates delta files updating each of the given <old-repo> files to\n"
+	"    <new-repo>. The delta files are named after the SHA-256 checksum of\n"
+	"    the respective <old-repo>. Published in the directory \"repo.deltas\"\n"
+	"    next to the repository file, they let clients refresh their\n"
+	"    repository cache without downloading the complete file.\n"
+	"\n"
+	"    -o <dir>   - Write the delta files to directory <dir> (default:\n"
+	"                 \"repo.deltas\").\n"
+	"    -q         - be quiet (don't show any output except for errors).\n"
+	"\n"
 	"Common Options:\n"
 	"  -h, --help   - Print this usage info.\n"
 ;
@@ -80,6 +91,9 @@ main(int argc, const char* const* argv)
 	if (strcmp(command, "update") == 0)
 		return command_update(argc - 1, argv + 1);
 
+	if (strcmp(command, "delta") == 0)
+		return command_delta(argc - 1, argv + 1);
+
 	if (strcmp(command, "help") == 0)
 		print_usage_and_exit(false);
 	else
@@ -11,9 +11,13 @@
 #include <stdlib.h>
 
 
+static const int32 kDefaultParallelDownloads = 4;
+
+
 CommonOptions::CommonOptions()
 	:
-	fDebugLevel(0)
+	fDebugLevel(0),
+	fParallelDownloads(kDefaultParallelDownloads)
 {
 }
 
@@ -39,6 +43,18 @@ CommonOptions::HandleOption(int option)
 			return true;
 		}
 
+		case OPTION_PARALLEL_DOWNLOADS:
+		{
+			char* end;
+			fParallelDownloads = strtol(optarg, &end, 0);
+			if (end == optarg || *end != '\0' || fParallelDownloads < 1) {
+				fprintf(stderr,
+					"*** invalid argument for option --parallel-downloads\n");
+				exit(1);
+			}
+			return true;
+		}
+
 		default:
 			return false;
 	}
@@ -11,7 +11,8 @@
 
 // common options
 enum {
-	OPTION_DEBUG	= 256,
+	OPTION_DEBUG				= 256,
+	OPTION_PARALLEL_DOWNLOADS	= 257,
 };
 
 
@@ -24,11 +25,14 @@ public:
 									{ return fDebugLevel; }
 			void				SetDebugLevel(int level)
 									{ fDebugLevel = level; }
+			int32				ParallelDownloads() const
+									{ return fParallelDownloads; }
 
 			bool				HandleOption(int option);
 
 private:
 			int32				fDebugLevel;
+			int32				fParallelDownloads;
 };
 
 
@@ -173,10 +173,14 @@ PackageManager::Warn(status_t error, const char* format, ...)
 void
 PackageManager::ProgressPackageDownloadStarted(const char* packageName)
 {
-	fShowProgress = isatty(STDOUT_FILENO);
-	fLastBytes = 0;
-	fLastRateCalcTime = system_time();
-	fDownloadRate = 0;
+	fDownloadSizes[packageName] = 0;
+
+	// If another download is already shown, this one's progress will be
+	// shown when that one is done.
+	if (!fProgressPackage.IsEmpty())
+		return;
+
+	_StartDownloadProgress(packageName);
 
 	if (fShowProgress) {
 		char percentString[32];
@@ -191,6 +195,13 @@ void
 PackageManager::ProgressPackageDownloadActive(const char* packageName,
 	float completionPercentage, off_t bytes, off_t totalBytes)
 {
+	fDownloadSizes[packageName] = bytes;
+
+	if (fProgressPackage.IsEmpty())
+		_StartDownloadProgress(packageName);
+	else if (fProgressPackage != packageName)
+		return;
+
 	if (bytes == totalBytes)
 		fLastBytes = totalBytes;
 	if (!fShowProgress)
@@ -272,12 +283,17 @@ PackageManager::ProgressPackageDownloadComplete(const char* packageName)
 		printf("\r\33[2K\r\x1B[0m");
 	}
 
+	off_t size = fDownloadSizes[packageName];
+	fDownloadSizes.erase(packageName);
+	if (fProgressPackage == packageName)
+		fProgressPackage.Truncate(0);
+
 	char byteBuffer[32];
 	char percentString[32];
 	fNumberFormat.FormatPercent(percentString, sizeof(percentString), 1.0);
 	// Make sure there is enough space for '100 %' percent format
 	printf("%6s %s [%s]\n", percentString, packageName,
-		string_for_size(fLastBytes, byteBuffer, sizeof(byteBuffer)));
+		string_for_size(size, byteBuffer, sizeof(byteBuffer)));
 	fflush(stdout);
 }
 
@@ -400,3 +416,14 @@ PackageManager::_PrintResult(InstalledRepository& installationRepository)
 // other information) should, however, be provided by the repository cache in
 // some way. Extend BPackageInfo? Create a BPackageFileInfo?
 }
+
+
+void
+PackageManager::_StartDownloadProgress(const char* packageName)
+{
+	fProgressPackage = packageName;
+	fShowProgress = isatty(STDOUT_FILENO);
+	fLastBytes = 0;
+	fLastRateCalcTime = system_time();
+	fDownloadRate = 0;
+}
@@ -10,6 +10,8 @@
 #define PACKAGE_MANAGER_H
 
 
+#include <map>
+
 #include <package/DaemonClient.h>
 #include <package/manager/PackageManager.h>
 
@@ -67,6 +69,8 @@ private:
 private:
 			void				_PrintResult(InstalledRepository&
 									installationRepository);
+			void				_StartDownloadProgress(
+									const char* packageName);
 
 private:
 			DecisionProvider	fDecisionProvider;
@@ -76,6 +80,11 @@ private:
 			bool				fInteractive;
 
 			bool				fShowProgress;
+			BString				fProgressPackage;
+									// the download the progress bar is shown
+									// for, if several run in parallel
+			std::map<BString, off_t> fDownloadSizes;
+									// bytes received so far per download
 			off_t				fLastBytes;
 			bigtime_t			fLastRateCalcTime;
 			float				fDownloadRate;
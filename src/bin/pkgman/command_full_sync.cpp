@@ -40,6 +40,8 @@ static const char* const kLongUsage =
 	"  -H, --home\n"
 	"    Synchronizes the packages in the user's home directory. Default is\n"
 	"    to synchronize the packages in the system directory.\n"
+	"  --parallel-downloads <count>\n"
+	"    Download up to <count> packages at the same time. The default is 4.\n"
 	"  -y\n"
 	"    Non-interactive mode. Automatically confirm changes, but fail when\n"
 	"    encountering problems.\n"
@@ -62,6 +64,8 @@ FullSyncCommand::Execute(int argc, const char* const* argv)
 			{ "debug", required_argument, 0, OPTION_DEBUG },
 			{ "help", no_argument, 0, 'h' },
 			{ "home", no_argument, 0, 'H' },
+			{ "parallel-downloads", required_argument, 0,
+				OPTION_PARALLEL_DOWNLOADS },
 			{ 0, 0, 0, 0 }
 		};
 
@@ -99,6 +103,7 @@ FullSyncCommand::Execute(int argc, const char* const* argv)
 	// perform the sync
 	PackageManager packageManager(location, interactive);
 	packageManager.SetDebugLevel(fCommonOptions.DebugLevel());
+	packageManager.SetDownloadConcurrency(fCommonOptions.ParallelDownloads());
 	packageManager.FullSync();
 
 	return 0;
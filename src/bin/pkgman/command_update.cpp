@@ -42,6 +42,8 @@ static const char* const kLongUsage =
 	"  -H, --home\n"
 	"    Update the packages in the user's home directory. Default is to\n"
 	"    update in the system directory.\n"
+	"  --parallel-downloads <count>\n"
+	"    Download up to <count> packages at the same time. The default is 4.\n"
 	"  -y\n"
 	"    Non-interactive mode. Automatically confirm changes, but fail when\n"
 	"    encountering problems.\n"
@@ -64,6 +66,8 @@ UpdateCommand::Execute(int argc, const char* const* argv)
 			{ "debug", required_argument, 0, OPTION_DEBUG },
 			{ "help", no_argument, 0, 'h' },
 			{ "home", no_argument, 0, 'H' },
+			{ "parallel-downloads", required_argument, 0,
+				OPTION_PARALLEL_DOWNLOADS },
 			{ 0, 0, 0, 0 }
 		};
 
@@ -101,6 +105,7 @@ UpdateCommand::Execute(int argc, const char* const* argv)
 	// perform the update
 	PackageManager packageManager(location, interactive);
 	packageManager.SetDebugLevel(fCommonOptions.DebugLevel());
+	packageManager.SetDownloadConcurrency(fCommonOptions.ParallelDownloads());
 	packageManager.Update(packages, packageCount);
 
 	return 0;
@@ -0,0 +1,124 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+#include <package/ApplyRepositoryDeltaJob.h>
+
+#include <File.h>
+
+#include <package/ChecksumAccessors.h>
+#include <package/Context.h>
+#include <package/hpkg/NoErrorOutput.h>
+#include <package/hpkg/RepositoryDelta.h>
+
+#include "FetchFileJob.h"
+
+
+namespace BPackageKit {
+
+namespace BPrivate {
+
+
+using BHPKG::BNoErrorOutput;
+using BHPKG::BPrivate::RepositoryDelta;
+
+
+ApplyRepositoryDeltaJob::ApplyRepositoryDeltaJob(const BContext& context,
+	const BString& title, const BString& deltaBaseURL,
+	const BEntry& repoCacheEntry, const BEntry& fetchedChecksumEntry,
+	const BEntry& targetEntry)
+	:
+	inherited(context, title),
+	fDeltaBaseURL(deltaBaseURL),
+	fRepoCacheEntry(repoCacheEntry),
+	fFetchedChecksumEntry(fetchedChecksumEntry),
+	fTargetEntry(targetEntry),
+	fApplied(false)
+{
+}
+
+
+ApplyRepositoryDeltaJob::~ApplyRepositoryDeltaJob()
+{
+}
+
+
+status_t
+ApplyRepositoryDeltaJob::Execute()
+{
+	// the delta is named after the checksum of the cache it applies to
+	BString checksum;
+	status_t result = GeneralFileChecksumAccessor(fRepoCacheEntry)
+		.GetChecksum(checksum);
+	if (result != B_OK)
+		return B_OK;
+
+	BEntry deltaEntry;
+	result = fContext.GetNewTempfile("repodelta-", &deltaEntry);
+	if (result != B_OK)
+		return B_OK;
+
+	// Most likely the repository doesn't have a delta for our cache, if
+	// fetching it fails. That's fine, the caller will fetch the complete
+	// repository file instead. The same goes for deltas that can't be
+	// applied, e.g. since the repository uses dictionary compression, which
+	// RepositoryDelta doesn't support.
+	FetchFileJob fetchDeltaJob(fContext, Title(),
+		BString(fDeltaBaseURL) << "/" << checksum, deltaEntry);
+	if (fetchDeltaJob.Run() == B_OK && _ApplyDelta(deltaEntry) == B_OK)
+		fApplied = true;
+
+	deltaEntry.Remove();
+	if (!fApplied)
+		fTargetEntry.Remove();
+
+	return B_OK;
+}
+
+
+status_t
+ApplyRepositoryDeltaJob::_ApplyDelta(const BEntry& deltaEntry)
+{
+	{
+		BFile repoCacheFile(&fRepoCacheEntry, B_READ_ONLY);
+		BFile deltaFile(&deltaEntry, B_READ_ONLY);
+		BFile targetFile(&fTargetEntry,
+			B_READ_WRITE | B_CREATE_FILE | B_ERASE_FILE);
+
+		status_t result = repoCacheFile.InitCheck();
+		if (result == B_OK)
+			result = deltaFile.InitCheck();
+		if (result == B_OK)
+			result = targetFile.InitCheck();
+		if (result != B_OK)
+			return result;
+
+		BNoErrorOutput errorOutput;
+		result = RepositoryDelta::Apply(&errorOutput, &repoCacheFile,
+			&deltaFile, &targetFile);
+		if (result != B_OK)
+			return result;
+	}
+
+	// The delta verifies that it produced what it was made for. Make sure
+	// that is what the repository currently has, too.
+	BString expectedChecksum;
+	BString checksum;
+	status_t result = ChecksumFileChecksumAccessor(fFetchedChecksumEntry)
+		.GetChecksum(expectedChecksum);
+	if (result == B_OK) {
+		result = GeneralFileChecksumAccessor(fTargetEntry)
+			.GetChecksum(checksum);
+	}
+	if (result != B_OK)
+		return result;
+
+	return checksum.ICompare(expectedChecksum) == 0 ? B_OK : B_BAD_DATA;
+}
+
+
+}	// namespace BPrivate
+
+}	// namespace BPackageKit
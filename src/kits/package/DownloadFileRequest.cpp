@@ -51,19 +51,24 @@ DownloadFileRequest::CreateInitialJobs()
 		return B_NO_INIT;
 
 	if (!FetchUtils::IsDownloadCompleted(BNode(&fTargetEntry))) {
-		// create the download job
+		// create the download job -- it verifies the checksum while the data
+		// arrive, so no separate validation job is needed
 		FetchFileJob* fetchJob = new (std::nothrow) FetchFileJob(fContext,
 			BString("Downloading ") << fFileURL, fFileURL, fTargetEntry);
 		if (fetchJob == NULL)
 			return B_NO_MEMORY;
 
+		fetchJob->SetExpectedChecksum(fChecksum);
+
 		if ((error = QueueJob(fetchJob)) != B_OK) {
 			delete fetchJob;
 			return error;
 		}
+
+		return B_OK;
 	}
 
-	// create the checksum validation job
+	// the file has been downloaded before, create the checksum validation job
 	if (fChecksum.IsEmpty())
 		return B_OK;
 
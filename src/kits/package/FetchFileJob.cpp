@@ -13,10 +13,14 @@
 #include "FetchFileJob.h"
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <sys/wait.h>
 
 #include <Path.h>
 
+#include <AutoDeleter.h>
+#include <SHA256.h>
+
 #ifdef HAIKU_TARGET_PLATFORM_HAIKU
 #	include <HttpRequest.h>
 #	include <UrlRequest.h>
@@ -34,6 +38,83 @@ namespace BPrivate {
 
 #ifdef HAIKU_TARGET_PLATFORM_HAIKU
 
+
+/*!	Passes the downloaded data on to the target file and computes its SHA256
+	checksum on the way, so the file doesn't have to be read again afterwards.
+*/
+class ChecksumOutput : public BDataIO {
+public:
+	ChecksumOutput(BDataIO* target)
+		:
+		fTarget(target)
+	{
+	}
+
+	virtual ssize_t Write(const void* buffer, size_t size)
+	{
+		ssize_t bytesWritten = fTarget->Write(buffer, size);
+		if (bytesWritten > 0)
+			fHash.Update(buffer, bytesWritten);
+		return bytesWritten;
+	}
+
+	SHA256& Hash()
+	{
+		return fHash;
+	}
+
+private:
+	BDataIO*	fTarget;
+	SHA256		fHash;
+};
+
+
+/*!	Feeds the first \a size bytes of the file into \a hash. Used to include
+	the part of the file that is already there when resuming a download.
+*/
+static status_t
+hash_file_data(const BEntry& entry, off_t size, SHA256& hash)
+{
+	if (size == 0)
+		return B_OK;
+
+	BFile file(&entry, B_READ_ONLY);
+	status_t result = file.InitCheck();
+	if (result != B_OK)
+		return result;
+
+	const size_t kBlockSize = 64 * 1024;
+	void* buffer = malloc(kBlockSize);
+	if (buffer == NULL)
+		return B_NO_MEMORY;
+	MemoryDeleter bufferDeleter(buffer);
+
+	while (size > 0) {
+		ssize_t bytesRead = file.Read(buffer, min_c((off_t)kBlockSize, size));
+		if (bytesRead < 0)
+			return bytesRead;
+		if (bytesRead == 0)
+			return B_IO_ERROR;
+
+		hash.Update(buffer, bytesRead);
+		size -= bytesRead;
+	}
+
+	return B_OK;
+}
+
+
+static BString
+checksum_string(SHA256& hash)
+{
+	BString checksum;
+	const uint8* digest = hash.Digest();
+	for (size_t i = 0; i < hash.DigestLength(); i++)
+		checksum << BString().SetToFormat("%02x", digest[i]);
+	return checksum;
+}
+
+
 FetchFileJob::FetchFileJob(const BContext& context, const BString& title,
 	const BString& fileURL, const BEntry& targetEntry)
 	:
@@ -87,6 +168,17 @@ FetchFileJob::DownloadTotalBytes() const
 }
 
 
+/*!	Sets the SHA256 checksum the downloaded file must have. The checksum is
+	computed while the data arrive and the job fails with \c B_BAD_DATA, if
+	it doesn't match.
+*/
+void
+FetchFileJob::SetExpectedChecksum(const BString& checksum)
+{
+	fExpectedChecksum = checksum;
+}
+
+
 status_t
 FetchFileJob::Execute()
 {
@@ -102,18 +194,38 @@ FetchFileJob::Execute()
 	}
 
 	do {
+		ChecksumOutput checksumOutput(&fTargetFile);
+		BDataIO* output = &fTargetFile;
+		if (!fExpectedChecksum.IsEmpty())
+			output = &checksumOutput;
+
 		BUrlRequest* request = BUrlProtocolRoster::MakeRequest(fFileURL.String(),
-			&fTargetFile, this);
+			output, this);
 		if (request == NULL)
 			return B_BAD_VALUE;
+		ObjectDeleter<BUrlRequest> requestDeleter(request);
 
 		// Try to resume the download where we left off
-		off_t currentPosition;
+		off_t currentPosition = 0;
+		fTargetFile.GetSize(&currentPosition);
+
 		BHttpRequest* http = dynamic_cast<BHttpRequest*>(request);
-		if (http != NULL && fTargetFile.GetSize(&currentPosition) == B_OK
-			&& currentPosition > 0) {
+		if (http != NULL && currentPosition > 0) {
 			http->SetRangeStart(currentPosition);
 			fTargetFile.Seek(0, SEEK_END);
+
+			// the checksum covers the data we already have as well
+			if (output == &checksumOutput) {
+				result = hash_file_data(fTargetEntry, currentPosition,
+					checksumOutput.Hash());
+				if (result != B_OK)
+					return result;
+			}
+		} else if (currentPosition > 0) {
+			// Other protocols can't resume, so start over
+			fTargetFile.SetSize(0);
+			fTargetFile.Seek(0, SEEK_SET);
+			currentPosition = 0;
 		}
 
 		thread_id thread = request->Run();
@@ -125,6 +237,17 @@ FetchFileJob::Execute()
 			// returned by the server was probably not part of the file.
 			fTargetFile.SetSize(currentPosition);
 		}
+
+		if (fError == B_OK && !fExpectedChecksum.IsEmpty()) {
+			BString checksum = checksum_string(checksumOutput.Hash());
+			if (fExpectedChecksum.ICompare(checksum) != 0) {
+				BString error = BString("Checksum error:\n")
+					<< "expected '"	<< fExpectedChecksum << "'\n"
+					<< "got      '" << checksum << "'";
+				SetErrorString(error);
+				return B_BAD_DATA;
+			}
+		}
 	} while (fError == B_IO_ERROR || fError == B_DEV_TIMEOUT);
 
 	if (fError == B_OK) {
@@ -276,6 +399,17 @@ FetchFileJob::DownloadTotalBytes() const
 }
 
 
+/*!	Sets the SHA256 checksum the downloaded file must have. The checksum is
+	computed while the data arrive and the job fails with \c B_BAD_DATA, if
+	it doesn't match.
+*/
+void
+FetchFileJob::SetExpectedChecksum(const BString& checksum)
+{
+	fExpectedChecksum = checksum;
+}
+
+
 status_t
 FetchFileJob::Execute()
 {
@@ -50,6 +50,8 @@ public:
 			off_t				DownloadBytes() const;
 			off_t				DownloadTotalBytes() const;
 
+			void				SetExpectedChecksum(const BString& checksum);
+
 #ifdef HAIKU_TARGET_PLATFORM_HAIKU
 	virtual void	DownloadProgress(BUrlRequest*,
 						off_t bytesReceived, off_t bytesTotal);
@@ -69,6 +71,7 @@ private:
 			float				fDownloadProgress;
 			off_t				fBytes;
 			off_t				fTotalBytes;
+			BString				fExpectedChecksum;
 };
 
 
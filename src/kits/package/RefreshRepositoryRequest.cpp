@@ -16,6 +16,7 @@
 #include <JobQueue.h>
 
 #include <package/ActivateRepositoryCacheJob.h>
+#include <package/ApplyRepositoryDeltaJob.h>
 #include <package/ChecksumAccessors.h>
 #include <package/ValidateChecksumJob.h>
 #include <package/RepositoryCache.h>
@@ -38,7 +39,9 @@ BRefreshRepositoryRequest::BRefreshRepositoryRequest(const BContext& context,
 	const BRepositoryConfig& repoConfig)
 	:
 	inherited(context),
-	fRepoConfig(repoConfig)
+	fRepoConfig(repoConfig),
+	fValidateChecksumJob(NULL),
+	fApplyDeltaJob(NULL)
 {
 }
 
@@ -115,11 +118,60 @@ BRefreshRepositoryRequest::JobSucceeded(BSupportKit::BJob* job)
 		// the remote repo cache has a different checksum, we fetch it
 		fValidateChecksumJob = NULL;
 			// don't re-trigger fetching if anything goes wrong, fail instead
-		_FetchRepositoryCache();
+
+		// if we have a cache already, try to update it with a delta first
+		if (_ApplyRepositoryDelta() != B_OK)
+			_FetchRepositoryCache();
+	} else if (job == fApplyDeltaJob) {
+		bool applied = fApplyDeltaJob->Applied();
+		fApplyDeltaJob = NULL;
+
+		if (applied)
+			_ActivateRepositoryCache(fUpdatedRepoCache, NULL);
+		else
+			_FetchRepositoryCache();
 	}
 }
 
 
+status_t
+BRefreshRepositoryRequest::_ApplyRepositoryDelta()
+{
+	BRepositoryCache repoCache;
+	BPackageRoster roster;
+	status_t result = roster.GetRepositoryCache(fRepoConfig.Name(),
+		&repoCache);
+	if (result != B_OK)
+		return result;
+	if (!repoCache.Entry().Exists())
+		return B_ENTRY_NOT_FOUND;
+
+	result = fContext.GetNewTempfile("repocache-", &fUpdatedRepoCache);
+	if (result != B_OK)
+		return result;
+
+	// The deltas are named after the checksum of the cache they apply to. If
+	// there is none for our cache, we'll fetch the complete cache instead.
+	BString deltaBaseURL
+		= BString(fRepoConfig.BaseURL()) << "/" << "repo.deltas";
+	BString title = B_TRANSLATE("Fetching repository delta from %url");
+	title.ReplaceAll("%url", fRepoConfig.BaseURL());
+	ApplyRepositoryDeltaJob* applyDeltaJob
+		= new (std::nothrow) ApplyRepositoryDeltaJob(fContext, title,
+			deltaBaseURL, repoCache.Entry(), fFetchedChecksumFile,
+			fUpdatedRepoCache);
+	if (applyDeltaJob == NULL)
+		return B_NO_MEMORY;
+	if ((result = QueueJob(applyDeltaJob)) != B_OK) {
+		delete applyDeltaJob;
+		return result;
+	}
+	fApplyDeltaJob = applyDeltaJob;
+
+	return B_OK;
+}
+
+
 status_t
 BRefreshRepositoryRequest::_FetchRepositoryCache()
 {
@@ -160,10 +212,17 @@ BRefreshRepositoryRequest::_FetchRepositoryCache()
 		return result;
 	}
 
-	// job activating the cache
+	return _ActivateRepositoryCache(tempRepoCache, validateChecksumJob);
+}
+
+
+status_t
+BRefreshRepositoryRequest::_ActivateRepositoryCache(
+	const BEntry& repoCacheEntry, BSupportKit::BJob* dependency)
+{
 	BPath targetRepoCachePath;
 	BPackageRoster roster;
-	result = fRepoConfig.IsUserSpecific()
+	status_t result = fRepoConfig.IsUserSpecific()
 		? roster.GetUserRepositoryCachePath(&targetRepoCachePath, true)
 		: roster.GetCommonRepositoryCachePath(&targetRepoCachePath, true);
 	if (result != B_OK)
@@ -172,10 +231,11 @@ BRefreshRepositoryRequest::_FetchRepositoryCache()
 	ActivateRepositoryCacheJob* activateJob
 		= new (std::nothrow) ActivateRepositoryCacheJob(fContext,
 			BString("Activating repository cache for ") << fRepoConfig.Name(),
-			tempRepoCache, fRepoConfig.Name(), targetDirectory);
+			repoCacheEntry, fRepoConfig.Name(), targetDirectory);
 	if (activateJob == NULL)
 		return B_NO_MEMORY;
-	activateJob->AddDependency(validateChecksumJob);
+	if (dependency != NULL)
+		activateJob->AddDependency(dependency);
 	if ((result = QueueJob(activateJob)) != B_OK) {
 		delete activateJob;
 		return result;
@@ -10,6 +10,7 @@
 #include <package/RemoveRepositoryJob.h>
 
 #include <Entry.h>
+#include <Path.h>
 
 #include <package/Context.h>
 #include <package/PackageRoster.h>
@@ -65,6 +66,14 @@ RemoveRepositoryJob::Execute()
 	BRepositoryCache repoCache;
 	if (roster.GetRepositoryCache(fRepositoryName, &repoCache) == B_OK) {
 		BEntry repoCacheEntry = repoCache.Entry();
+
+		// also remove the solver's cache of the repository, if any
+		BPath repoCachePath;
+		if (repoCacheEntry.GetPath(&repoCachePath) == B_OK) {
+			BString solvCachePath = BString(repoCachePath.Path()) << ".solv";
+			BEntry(solvCachePath.String()).Remove();
+		}
+
 		if ((result = repoCacheEntry.Remove()) != B_OK)
 			return result;
 	}
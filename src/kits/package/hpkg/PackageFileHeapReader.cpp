@@ -30,7 +30,8 @@ PackageFileHeapReader::PackageFileHeapReader(BErrorOutput* errorOutput,
 	:
 	PackageFileHeapAccessorBase(errorOutput, file, heapOffset,
 		decompressionAlgorithm),
-	fOffsets()
+	fOffsets(),
+	fChunkCache(NULL)
 {
 	fCompressedHeapSize = compressedHeapSize;
 	fUncompressedHeapSize = uncompressedHeapSize;
@@ -166,8 +167,34 @@ PackageFileHeapReader::ReadAndDecompressChunk(size_t chunkIndex,
 		? fUncompressedHeapSize - (uint64)chunkIndex * kChunkSize
 		: kChunkSize;
 
-	return ReadAndDecompressChunkData(offset, compressedSize, uncompressedSize,
-		compressedDataBuffer, uncompressedDataBuffer, scratchBuffer);
+	if (fChunkCache == NULL || compressedSize == uncompressedSize) {
+		return ReadAndDecompressChunkData(offset, compressedSize,
+			uncompressedSize, compressedDataBuffer, uncompressedDataBuffer,
+			scratchBuffer);
+	}
+
+	if (fChunkCache->GetChunk(chunkIndex, uncompressedDataBuffer,
+			uncompressedSize)) {
+		return B_OK;
+	}
+
+	status_t error = ReadAndDecompressChunkData(offset, compressedSize,
+		uncompressedSize, compressedDataBuffer, uncompressedDataBuffer,
+		scratchBuffer);
+	if (error == B_OK) {
+		fChunkCache->PutChunk(chunkIndex, uncompressedDataBuffer,
+			uncompressedSize);
+	}
+
+	return error;
+}
+
+
+// #pragma mark - ChunkCache
+
+
+PackageFileHeapReader::ChunkCache::~ChunkCache()
+{
 }
 
 
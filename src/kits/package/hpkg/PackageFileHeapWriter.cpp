@@ -6,6 +6,8 @@
 
 #include <package/hpkg/PackageFileHeapWriter.h>
 
+#include <pthread.h>
+
 #include <algorithm>
 #include <new>
 
@@ -24,6 +26,9 @@
 // minimum length of data we require before trying to compress them
 static const size_t kCompressionSizeThreshold = 64;
 
+// number of chunks that can be queued for compression per thread
+static const int32 kQueuedChunksPerThread = 2;
+
 
 namespace BPackageKit {
 
@@ -194,6 +199,223 @@ private:
 };
 
 
+/*!	Compresses a chunk's data into the given buffer, which must be at least
+	\a size bytes large. Returns \c B_BUFFER_OVERFLOW, if compressing doesn't
+	save any space. Doesn't print any errors, so it can be used by the
+	compression threads.
+*/
+static status_t
+compress_chunk(CompressionAlgorithmOwner* compressionAlgorithm,
+	const void* data, size_t size, void* compressedDataBuffer,
+	size_t& _compressedSize)
+{
+	const iovec uncompressed = { (void*)data, size };
+	iovec compressed = { compressedDataBuffer, size };
+	status_t error = compressionAlgorithm->algorithm->CompressBuffer(
+		uncompressed, compressed, compressionAlgorithm->parameters);
+	if (error != B_OK)
+		return error;
+
+	// only use compressed data when we've actually saved space
+	if (compressed.iov_len == size)
+		return B_BUFFER_OVERFLOW;
+
+	_compressedSize = compressed.iov_len;
+	return B_OK;
+}
+
+
+struct PackageFileHeapWriter::CompressionJob {
+	void*		uncompressedData;
+	void*		compressedData;
+	size_t		uncompressedSize;
+	size_t		compressedSize;
+	status_t	error;
+	bool		done;
+};
+
+
+/*!	Compresses complete chunks on a set of threads.
+	The chunks are queued in heap order and the heap writer writes them back
+	in the same order, so the heap is byte-identical to the one we get when
+	compressing the chunks one after another. The compression algorithm's
+	CompressBuffer() must be safe to call concurrently, which is the case for
+	the ones we support.
+*/
+struct PackageFileHeapWriter::CompressionPipeline {
+	CompressionPipeline(CompressionAlgorithmOwner* compressionAlgorithm)
+		:
+		fCompressionAlgorithm(compressionAlgorithm),
+		fThreads(NULL),
+		fThreadCount(0),
+		fJobs(NULL),
+		fJobCount(0),
+		fFirstJob(0),
+		fQueuedJobCount(0),
+		fUnclaimedJobCount(0),
+		fTerminating(false)
+	{
+		pthread_mutex_init(&fLock, NULL);
+		pthread_cond_init(&fJobQueuedCondition, NULL);
+		pthread_cond_init(&fJobDoneCondition, NULL);
+	}
+
+	~CompressionPipeline()
+	{
+		pthread_mutex_lock(&fLock);
+		fTerminating = true;
+		pthread_cond_broadcast(&fJobQueuedCondition);
+		pthread_mutex_unlock(&fLock);
+
+		for (int32 i = 0; i < fThreadCount; i++)
+			pthread_join(fThreads[i], NULL);
+		delete[] fThreads;
+
+		for (int32 i = 0; i < fJobCount; i++) {
+			free(fJobs[i].uncompressedData);
+			free(fJobs[i].compressedData);
+		}
+		delete[] fJobs;
+
+		pthread_cond_destroy(&fJobDoneCondition);
+		pthread_cond_destroy(&fJobQueuedCondition);
+		pthread_mutex_destroy(&fLock);
+	}
+
+	status_t Init(int32 threadCount)
+	{
+		fJobCount = threadCount * kQueuedChunksPerThread;
+		fJobs = new(std::nothrow) CompressionJob[fJobCount];
+		fThreads = new(std::nothrow) pthread_t[threadCount];
+		if (fJobs == NULL || fThreads == NULL) {
+			fJobCount = 0;
+			return B_NO_MEMORY;
+		}
+
+		for (int32 i = 0; i < fJobCount; i++) {
+			fJobs[i].uncompressedData = NULL;
+			fJobs[i].compressedData = NULL;
+		}
+
+		for (int32 i = 0; i < fJobCount; i++) {
+			fJobs[i].uncompressedData = malloc(kChunkSize);
+			fJobs[i].compressedData = malloc(kChunkSize);
+			if (fJobs[i].uncompressedData == NULL
+				|| fJobs[i].compressedData == NULL) {
+				return B_NO_MEMORY;
+			}
+		}
+
+		for (; fThreadCount < threadCount; fThreadCount++) {
+			if (pthread_create(&fThreads[fThreadCount], NULL, &_ThreadEntry,
+					this) != 0) {
+				return B_NO_MORE_THREADS;
+			}
+		}
+
+		return B_OK;
+	}
+
+	bool IsEmpty() const
+	{
+		return fQueuedJobCount == 0;
+	}
+
+	bool IsFull() const
+	{
+		return fQueuedJobCount == fJobCount;
+	}
+
+	CompressionJob& NextFreeJob()
+	{
+		return fJobs[(fFirstJob + fQueuedJobCount) % fJobCount];
+	}
+
+	void QueueJob()
+	{
+		CompressionJob& job = NextFreeJob();
+		job.done = false;
+
+		pthread_mutex_lock(&fLock);
+		fQueuedJobCount++;
+		fUnclaimedJobCount++;
+		pthread_cond_signal(&fJobQueuedCondition);
+		pthread_mutex_unlock(&fLock);
+	}
+
+	CompressionJob* FirstJob(bool wait)
+	{
+		CompressionJob& job = fJobs[fFirstJob];
+
+		pthread_mutex_lock(&fLock);
+		while (wait && !job.done)
+			pthread_cond_wait(&fJobDoneCondition, &fLock);
+		bool done = job.done;
+		pthread_mutex_unlock(&fLock);
+
+		return done ? &job : NULL;
+	}
+
+	void RemoveFirstJob()
+	{
+		pthread_mutex_lock(&fLock);
+		fFirstJob = (fFirstJob + 1) % fJobCount;
+		fQueuedJobCount--;
+		pthread_mutex_unlock(&fLock);
+	}
+
+private:
+	static void* _ThreadEntry(void* data)
+	{
+		((CompressionPipeline*)data)->_Thread();
+		return NULL;
+	}
+
+	void _Thread()
+	{
+		pthread_mutex_lock(&fLock);
+
+		for (;;) {
+			while (fUnclaimedJobCount == 0 && !fTerminating)
+				pthread_cond_wait(&fJobQueuedCondition, &fLock);
+			if (fTerminating)
+				break;
+
+			// The jobs are claimed in queue order, so the unclaimed ones are
+			// the last ones in the queue.
+			CompressionJob& job = fJobs[(fFirstJob + fQueuedJobCount
+				- fUnclaimedJobCount) % fJobCount];
+			fUnclaimedJobCount--;
+			pthread_mutex_unlock(&fLock);
+
+			job.error = compress_chunk(fCompressionAlgorithm,
+				job.uncompressedData, job.uncompressedSize, job.compressedData,
+				job.compressedSize);
+
+			pthread_mutex_lock(&fLock);
+			job.done = true;
+			pthread_cond_signal(&fJobDoneCondition);
+		}
+
+		pthread_mutex_unlock(&fLock);
+	}
+
+private:
+	CompressionAlgorithmOwner*	fCompressionAlgorithm;
+	pthread_mutex_t				fLock;
+	pthread_cond_t				fJobQueuedCondition;
+	pthread_cond_t				fJobDoneCondition;
+	pthread_t*					fThreads;
+	int32						fThreadCount;
+	CompressionJob*				fJobs;
+	int32						fJobCount;
+	int32						fFirstJob;
+	int32						fQueuedJobCount;
+	int32						fUnclaimedJobCount;
+	bool						fTerminating;
+};
+
+
 PackageFileHeapWriter::PackageFileHeapWriter(BErrorOutput* errorOutput,
 	BPositionIO* file, off_t heapOffset,
 	CompressionAlgorithmOwner* compressionAlgorithm,
@@ -205,7 +427,12 @@ PackageFileHeapWriter::PackageFileHeapWriter(BErrorOutput* errorOutput,
 	fCompressedDataBuffer(NULL),
 	fPendingDataSize(0),
 	fOffsets(),
-	fCompressionAlgorithm(compressionAlgorithm)
+	fCompressionAlgorithm(compressionAlgorithm),
+	fDictionary(NULL),
+	fDictionarySize(0),
+	fCompressionPipeline(NULL),
+	fCompressionThreadCount(1),
+	fWriteSynchronously(false)
 {
 	if (fCompressionAlgorithm != NULL)
 		fCompressionAlgorithm->AcquireReference();
@@ -254,6 +481,21 @@ PackageFileHeapWriter::Reinit(PackageFileHeapReader* heapReader)
 }
 
 
+void
+PackageFileHeapWriter::SetDictionary(const void* dictionary, size_t size)
+{
+	fDictionary = dictionary;
+	fDictionarySize = dictionary != NULL ? size : 0;
+}
+
+
+void
+PackageFileHeapWriter::SetCompressionThreadCount(int32 count)
+{
+	fCompressionThreadCount = std::max(count, (int32)1);
+}
+
+
 status_t
 PackageFileHeapWriter::AddData(BDataReader& dataReader, off_t size,
 	uint64& _offset)
@@ -281,7 +523,7 @@ PackageFileHeapWriter::AddData(BDataReader& dataReader, off_t size,
 		readOffset += toCopy;
 
 		if (fPendingDataSize == kChunkSize) {
-			error = _FlushPendingData();
+			error = _QueuePendingData();
 			if (error != B_OK)
 				return error;
 		}
@@ -321,6 +563,11 @@ PackageFileHeapWriter::RemoveDataRanges(
 	if (status != B_OK)
 		throw status_t(status);
 
+	// Chunks must not be queued for compression while we're at it. We need to
+	// know where the next chunk will be written, so we don't overwrite chunks
+	// we haven't read yet.
+	fWriteSynchronously = true;
+
 	// We potentially have to recompress all data from the first affected chunk
 	// to the end (minus the removed ranges, of course). As a basic algorithm we
 	// can use our usual data writing strategy, i.e. read a chunk, decompress it
@@ -432,6 +679,8 @@ PackageFileHeapWriter::RemoveDataRanges(
 	// buffer.
 	if (chunkBuffer.IsEmpty())
 		_UnwriteLastPartialChunk();
+
+	fWriteSynchronously = false;
 }
 
 
@@ -452,8 +701,6 @@ PackageFileHeapWriter::Finish()
 	// We don't need to write the last chunk size, since it is implied by the
 	// total size minus the sum of all other chunk sizes.
 	ssize_t offsetCount = fOffsets.Count();
-	if (offsetCount < 2)
-		return B_OK;
 
 	// Convert the offsets to 16 bit sizes and write them. We use the (no longer
 	// used) pending data buffer for the conversion.
@@ -473,6 +720,13 @@ PackageFileHeapWriter::Finish()
 			return error;
 	}
 
+	// the compression dictionary follows the chunk sizes table
+	if (fDictionary != NULL) {
+		error = _WriteDataUncompressed(fDictionary, fDictionarySize);
+		if (error != B_OK)
+			return error;
+	}
+
 	return B_OK;
 }
 
@@ -491,6 +745,13 @@ PackageFileHeapWriter::ReadAndDecompressChunk(size_t chunkIndex,
 		return B_OK;
 	}
 
+	if (chunkIndex >= (size_t)fOffsets.Count()) {
+		// The chunk is still queued for compression.
+		status_t error = _WriteQueuedChunks();
+		if (error != B_OK)
+			return error;
+	}
+
 	uint64 offset = fOffsets[chunkIndex];
 	size_t compressedSize = chunkIndex + 1 == (size_t)fOffsets.Count()
 		? fCompressedHeapSize - offset
@@ -504,6 +765,9 @@ PackageFileHeapWriter::ReadAndDecompressChunk(size_t chunkIndex,
 void
 PackageFileHeapWriter::_Uninit()
 {
+	delete fCompressionPipeline;
+	fCompressionPipeline = NULL;
+
 	free(fPendingDataBuffer);
 	free(fCompressedDataBuffer);
 	fPendingDataBuffer = NULL;
@@ -514,10 +778,12 @@ PackageFileHeapWriter::_Uninit()
 status_t
 PackageFileHeapWriter::_FlushPendingData()
 {
-	if (fPendingDataSize == 0)
-		return B_OK;
+	// the queued chunks precede the pending data
+	status_t error = _WriteQueuedChunks();
+	if (error != B_OK || fPendingDataSize == 0)
+		return error;
 
-	status_t error = _WriteChunk(fPendingDataBuffer, fPendingDataSize, true);
+	error = _WriteChunk(fPendingDataBuffer, fPendingDataSize, true);
 	if (error == B_OK)
 		fPendingDataSize = 0;
 
@@ -525,6 +791,102 @@ PackageFileHeapWriter::_FlushPendingData()
 }
 
 
+/*!	Like _FlushPendingData(), but when compressing with multiple threads, only
+	queues the pending data for compression. The pending data buffer is
+	swapped with the one of the queued chunk.
+*/
+status_t
+PackageFileHeapWriter::_QueuePendingData()
+{
+	if (fCompressionPipeline == NULL && fCompressionThreadCount > 1
+		&& fCompressionAlgorithm != NULL) {
+		// lazily start the compression threads, so small packages don't need
+		// them at all
+		CompressionPipeline* pipeline = new(std::nothrow) CompressionPipeline(
+			fCompressionAlgorithm);
+		if (pipeline == NULL
+			|| pipeline->Init(fCompressionThreadCount) != B_OK) {
+			// not fatal, just compress the chunks ourselves
+			delete pipeline;
+			pipeline = NULL;
+			fCompressionThreadCount = 1;
+		}
+		fCompressionPipeline = pipeline;
+	}
+
+	if (fCompressionPipeline == NULL || fWriteSynchronously)
+		return _FlushPendingData();
+
+	// write the chunks already compressed and make room in the queue
+	status_t error;
+	do {
+		error = _WriteQueuedChunk(fCompressionPipeline->IsFull());
+	} while (error == B_OK);
+	if (error != B_WOULD_BLOCK && error != B_ENTRY_NOT_FOUND)
+		return error;
+
+	CompressionJob& job = fCompressionPipeline->NextFreeJob();
+	std::swap(job.uncompressedData, fPendingDataBuffer);
+	job.uncompressedSize = fPendingDataSize;
+	fCompressionPipeline->QueueJob();
+
+	fPendingDataSize = 0;
+	return B_OK;
+}
+
+
+/*!	Writes the first chunk queued for compression to the file.
+	Returns \c B_ENTRY_NOT_FOUND, if no chunk is queued, and \c B_WOULD_BLOCK,
+	if \a wait is \c false and the chunk hasn't been compressed yet.
+*/
+status_t
+PackageFileHeapWriter::_WriteQueuedChunk(bool wait)
+{
+	if (fCompressionPipeline == NULL || fCompressionPipeline->IsEmpty())
+		return B_ENTRY_NOT_FOUND;
+
+	CompressionJob* job = fCompressionPipeline->FirstJob(wait);
+	if (job == NULL)
+		return B_WOULD_BLOCK;
+
+	// the job is done with either way
+	fCompressionPipeline->RemoveFirstJob();
+
+	// add offset
+	if (!fOffsets.Add(fCompressedHeapSize)) {
+		fErrorOutput->PrintError("Out of memory!\n");
+		return B_NO_MEMORY;
+	}
+
+	// Write the compressed data, or the uncompressed data, if compressing
+	// didn't save any space -- just like _WriteChunk().
+	if (job->error == B_OK)
+		return _WriteDataUncompressed(job->compressedData, job->compressedSize);
+
+	if (job->error != B_BUFFER_OVERFLOW) {
+		fErrorOutput->PrintError("Failed to compress chunk data: %s\n",
+			strerror(job->error));
+		return job->error;
+	}
+
+	return _WriteDataUncompressed(job->uncompressedData, job->uncompressedSize);
+}
+
+
+/*!	Waits for all chunks queued for compression and writes them to the file.
+*/
+status_t
+PackageFileHeapWriter::_WriteQueuedChunks()
+{
+	status_t error;
+	do {
+		error = _WriteQueuedChunk(true);
+	} while (error == B_OK);
+
+	return error == B_ENTRY_NOT_FOUND ? B_OK : error;
+}
+
+
 status_t
 PackageFileHeapWriter::_WriteChunk(const void* data, size_t size,
 	bool mayCompress)
@@ -563,11 +925,9 @@ PackageFileHeapWriter::_WriteDataCompressed(const void* data, size_t size)
 	if (fCompressionAlgorithm == NULL)
 		return B_BUFFER_OVERFLOW;
 
-	const iovec uncompressed = { (void*)data, size };
-	iovec compressed = { fCompressedDataBuffer, size };
-	status_t error = fCompressionAlgorithm->algorithm->CompressBuffer(
-		uncompressed, compressed,
-		fCompressionAlgorithm->parameters);
+	size_t compressedSize;
+	status_t error = compress_chunk(fCompressionAlgorithm, data, size,
+		fCompressedDataBuffer, compressedSize);
 	if (error != B_OK) {
 		if (error != B_BUFFER_OVERFLOW) {
 			fErrorOutput->PrintError("Failed to compress chunk data: %s\n",
@@ -576,11 +936,7 @@ PackageFileHeapWriter::_WriteDataCompressed(const void* data, size_t size)
 		return error;
 	}
 
-	// only use compressed data when we've actually saved space
-	if (compressed.iov_len == size)
-		return B_BUFFER_OVERFLOW;
-
-	return _WriteDataUncompressed(fCompressedDataBuffer, compressed.iov_len);
+	return _WriteDataUncompressed(fCompressedDataBuffer, compressedSize);
 }
 
 
@@ -82,6 +82,17 @@ BPackageReader::ParseContent(BLowLevelPackageContentHandler* contentHandler)
 }
 
 
+status_t
+BPackageReader::FindEntry(const char* path,
+	BPackageContentHandler* contentHandler)
+{
+	if (fImpl == NULL)
+		return B_NO_INIT;
+
+	return fImpl->FindEntry(path, contentHandler);
+}
+
+
 BPositionIO*
 BPackageReader::PackageFile() const
 {
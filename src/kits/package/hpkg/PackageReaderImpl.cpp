@@ -20,6 +20,7 @@
 
 #include <ByteOrder.h>
 
+#include <AutoDeleter.h>
 #include <FdIO.h>
 
 #include <package/hpkg/HPKGDefsPrivate.h>
@@ -300,13 +301,148 @@ struct PackageReaderImpl::RootAttributeHandler : PackageAttributeHandler {
 };
 
 
+// #pragma mark - IndexedAncestorAttributeHandler
+
+
+/*!	Attribute handler for the attributes of an ancestor directory of an entry
+	found via the TOC index. Only the attributes preceding the ancestor's child
+	entries are parsed, so encountering a child entry is an error.
+*/
+struct PackageReaderImpl::IndexedAncestorAttributeHandler : AttributeHandler {
+	IndexedAncestorAttributeHandler(BPackageEntry* entry)
+		:
+		fEntry(entry),
+		fNotified(false)
+	{
+	}
+
+	virtual status_t HandleAttribute(AttributeHandlerContext* context,
+		uint8 id, const AttributeValue& value, AttributeHandler** _handler)
+	{
+		switch (id) {
+			case B_HPKG_ATTRIBUTE_ID_FILE_TYPE:
+				if (value.unsignedInt != B_HPKG_FILE_TYPE_DIRECTORY) {
+					context->errorOutput->PrintError("Error: Invalid package: "
+						"\"%s\" is not a directory\n", fEntry->Name());
+					return B_BAD_DATA;
+				}
+				return B_OK;
+
+			case B_HPKG_ATTRIBUTE_ID_FILE_PERMISSIONS:
+				fEntry->SetPermissions(value.unsignedInt);
+				return B_OK;
+
+			case B_HPKG_ATTRIBUTE_ID_FILE_ATIME:
+				fEntry->SetAccessTime(value.unsignedInt);
+				return B_OK;
+
+			case B_HPKG_ATTRIBUTE_ID_FILE_MTIME:
+				fEntry->SetModifiedTime(value.unsignedInt);
+				return B_OK;
+
+			case B_HPKG_ATTRIBUTE_ID_FILE_CRTIME:
+				fEntry->SetCreationTime(value.unsignedInt);
+				return B_OK;
+
+			case B_HPKG_ATTRIBUTE_ID_FILE_ATIME_NANOS:
+				fEntry->SetAccessTimeNanos(value.unsignedInt);
+				return B_OK;
+
+			case B_HPKG_ATTRIBUTE_ID_FILE_MTIME_NANOS:
+				fEntry->SetModifiedTimeNanos(value.unsignedInt);
+				return B_OK;
+
+			case B_HPKG_ATTRIBUTE_ID_FILE_CRTIM_NANOS:
+				fEntry->SetCreationTimeNanos(value.unsignedInt);
+				return B_OK;
+
+			case B_HPKG_ATTRIBUTE_ID_FILE_ATTRIBUTE:
+			{
+				status_t error = Notify(context);
+				if (error != B_OK)
+					return error;
+
+				if (_handler != NULL) {
+					*_handler = new(context) AttributeAttributeHandler(
+						fEntry, value.string);
+					if (*_handler == NULL)
+						return B_NO_MEMORY;
+					return B_OK;
+				} else {
+					BPackageEntryAttribute attribute(value.string);
+					return context->packageContentHandler->HandleEntryAttribute(
+						fEntry, &attribute);
+				}
+			}
+
+			case B_HPKG_ATTRIBUTE_ID_DIRECTORY_ENTRY:
+				context->errorOutput->PrintError("Error: Invalid TOC index "
+					"entry\n");
+				return B_BAD_DATA;
+		}
+
+		return AttributeHandler::HandleAttribute(context, id, value, _handler);
+	}
+
+	/*!	Passes the entry to the content handler, unless that happened
+		already.
+	*/
+	status_t Notify(AttributeHandlerContext* context)
+	{
+		if (fNotified)
+			return B_OK;
+
+		fNotified = true;
+		return context->packageContentHandler->HandleEntry(fEntry);
+	}
+
+private:
+	BPackageEntry*	fEntry;
+	bool			fNotified;
+};
+
+
+// #pragma mark - IndexedEntryAttributeHandler
+
+
+/*!	Root attribute handler for parsing an entry found via the TOC index; its
+	path has been checked before.
+*/
+struct PackageReaderImpl::IndexedEntryAttributeHandler : AttributeHandler {
+	IndexedEntryAttributeHandler(BPackageEntry* parentEntry)
+		:
+		fParentEntry(parentEntry)
+	{
+	}
+
+	virtual status_t HandleAttribute(AttributeHandlerContext* context,
+		uint8 id, const AttributeValue& value, AttributeHandler** _handler)
+	{
+		if (id != B_HPKG_ATTRIBUTE_ID_DIRECTORY_ENTRY || _handler == NULL)
+			return B_OK;
+
+		return EntryAttributeHandler::Create(context, fParentEntry,
+			value.string, *_handler);
+	}
+
+private:
+	BPackageEntry*	fParentEntry;
+};
+
+
 // #pragma mark - PackageReaderImpl
 
 
 PackageReaderImpl::PackageReaderImpl(BErrorOutput* errorOutput)
 	:
 	inherited("package", errorOutput),
-	fTOCSection("TOC")
+	fHeapOffset(0),
+	fHeapSize(0),
+	fTotalSize(0),
+	fTOCSection("TOC"),
+	fTOCIndexOffset(0),
+	fTOCIndexEntryCount(0),
+	fTOCIndexChecked(false)
 {
 }
 
@@ -354,7 +490,16 @@ PackageReaderImpl::Init(BPositionIO* file, bool keepFile, uint32 flags,
 		B_HPKG_MINOR_VERSION>(file, keepFile, header, flags);
 	if (error != B_OK)
 		return error;
+	fHeapOffset = B_BENDIAN_TO_HOST_INT16(header.header_size);
 	fHeapSize = UncompressedHeapSize();
+	fTotalSize = B_BENDIAN_TO_HOST_INT64(header.total_size);
+
+	// If there's anything following the heap, it may be a TOC index. We check
+	// lazily, when it is needed.
+	fTOCIndexOffset = fHeapOffset
+		+ B_BENDIAN_TO_HOST_INT64(header.heap_size_compressed);
+	fTOCIndexEntryCount = 0;
+	fTOCIndexChecked = false;
 
 	// init package attributes section
 	error = InitSection(fPackageAttributesSection, fHeapSize,
@@ -426,9 +571,100 @@ PackageReaderImpl::ParseContent(BLowLevelPackageContentHandler* contentHandler)
 }
 
 
+/*!	Looks up the entry with the given \a path via the package's TOC index and
+	passes it and all its descendants to \a contentHandler, just like
+	ParseContent() would. Only the part of the TOC belonging to the entry is
+	read and parsed, though. The entry's ancestor directories are passed to the
+	content handler as well, with their attributes, but without any of their
+	other children. Package attributes are not passed to the content handler.
+	\return \c B_NOT_SUPPORTED, if the package doesn't have a TOC index. The
+		caller has to fall back to ParseContent() in this case.
+	\return \c B_ENTRY_NOT_FOUND, if the package doesn't contain the entry.
+*/
+status_t
+PackageReaderImpl::FindEntry(const char* path,
+	BPackageContentHandler* contentHandler)
+{
+	status_t error = _InitTOCIndex();
+	if (error != B_OK)
+		return error;
+
+	// split the path into its components
+	char* pathBuffer = strdup(path);
+	if (pathBuffer == NULL)
+		return B_NO_MEMORY;
+	MemoryDeleter pathBufferDeleter(pathBuffer);
+
+	int32 maxComponentCount = 1;
+	for (const char* slash = strchr(path, '/'); slash != NULL;
+			slash = strchr(slash + 1, '/')) {
+		maxComponentCount++;
+	}
+
+	char** components = new(std::nothrow) char*[maxComponentCount];
+	BPackageEntry** ancestors
+		= new(std::nothrow) BPackageEntry*[maxComponentCount];
+	ArrayDeleter<char*> componentsDeleter(components);
+	ArrayDeleter<BPackageEntry*> ancestorsDeleter(ancestors);
+	if (components == NULL || ancestors == NULL)
+		return B_NO_MEMORY;
+
+	int32 componentCount = 0;
+	char* nextComponent;
+	for (char* component = pathBuffer; component != NULL;
+			component = nextComponent) {
+		nextComponent = strchr(component, '/');
+		if (nextComponent != NULL)
+			*nextComponent++ = '\0';
+
+		if (component[0] == '\0')
+			continue;
+		if (strcmp(component, ".") == 0 || strcmp(component, "..") == 0)
+			return B_BAD_VALUE;
+
+		components[componentCount++] = component;
+	}
+
+	if (componentCount == 0)
+		return B_BAD_VALUE;
+
+	AttributeHandlerContext context(ErrorOutput(), contentHandler,
+		B_HPKG_SECTION_PACKAGE_TOC,
+		MinorFormatVersion() > B_HPKG_MINOR_VERSION);
+
+	int32 notifiedAncestorCount = 0;
+	return _FindEntry(&context, NULL, ancestors, components, componentCount, 0,
+		kTOCIndexRootPathHash, notifiedAncestorCount);
+}
+
+
+/*!	Returns the location of the package's TOC index in the package file.
+	\return \c B_NOT_SUPPORTED, if the package doesn't have a TOC index.
+*/
+status_t
+PackageReaderImpl::GetTOCIndex(off_t& _offset, off_t& _size)
+{
+	status_t error = _InitTOCIndex();
+	if (error != B_OK)
+		return error;
+
+	_offset = fTOCIndexOffset;
+	_size = fTotalSize - fTOCIndexOffset;
+	return B_OK;
+}
+
+
 status_t
 PackageReaderImpl::_PrepareSections()
 {
+	// FindEntry() may have read parts of the TOC already
+	if (fTOCSection.data != NULL) {
+		delete[] fTOCSection.strings;
+		fTOCSection.strings = NULL;
+		delete[] fTOCSection.data;
+		fTOCSection.data = NULL;
+	}
+
 	status_t error = PrepareSection(fTOCSection);
 	if (error != B_OK)
 		return error;
@@ -531,6 +767,416 @@ PackageReaderImpl::ReadAttributeValue(uint8 type, uint8 encoding,
 }
 
 
+status_t
+PackageReaderImpl::_InitTOCIndex()
+{
+	if (fTOCIndexChecked)
+		return fTOCIndexEntryCount > 0 ? B_OK : B_NOT_SUPPORTED;
+
+	fTOCIndexChecked = true;
+
+	if (fTOCIndexOffset > fTotalSize
+		|| fTotalSize - fTOCIndexOffset < sizeof(hpkg_toc_index_footer)) {
+		return B_NOT_SUPPORTED;
+	}
+
+	// Read and check the footer. Since the index is optional, anything we
+	// don't understand just means there's no index.
+	hpkg_toc_index_footer footer;
+	if (File()->ReadAtExactly(fTotalSize - sizeof(footer), &footer,
+			sizeof(footer)) != B_OK) {
+		return B_NOT_SUPPORTED;
+	}
+
+	uint64 entryCount = B_BENDIAN_TO_HOST_INT64(footer.entry_count);
+	uint64 indexSize = fTotalSize - fTOCIndexOffset - sizeof(footer);
+	if (B_BENDIAN_TO_HOST_INT32(footer.magic) != B_HPKG_TOC_INDEX_MAGIC
+		|| B_BENDIAN_TO_HOST_INT16(footer.footer_size) != sizeof(footer)
+		|| B_BENDIAN_TO_HOST_INT16(footer.version) != B_HPKG_TOC_INDEX_VERSION
+		|| B_BENDIAN_TO_HOST_INT64(footer.toc_length)
+			!= fTOCSection.uncompressedLength
+		|| entryCount == 0
+		|| indexSize / sizeof(hpkg_toc_index_entry) != entryCount
+		|| indexSize % sizeof(hpkg_toc_index_entry) != 0) {
+		return B_NOT_SUPPORTED;
+	}
+
+	fTOCIndexEntryCount = entryCount;
+	return B_OK;
+}
+
+
+status_t
+PackageReaderImpl::_ReadTOCIndexEntry(uint64 index,
+	hpkg_toc_index_entry& _entry)
+{
+	status_t error = ReadBuffer(
+		fTOCIndexOffset + index * sizeof(hpkg_toc_index_entry), &_entry,
+		sizeof(_entry));
+	if (error != B_OK)
+		return error;
+
+	_entry.path_hash = B_BENDIAN_TO_HOST_INT64(_entry.path_hash);
+	_entry.offset = B_BENDIAN_TO_HOST_INT64(_entry.offset);
+	_entry.length = B_BENDIAN_TO_HOST_INT64(_entry.length);
+	_entry.attributes_length = B_BENDIAN_TO_HOST_INT64(
+		_entry.attributes_length);
+	_entry.parent_offset = B_BENDIAN_TO_HOST_INT64(_entry.parent_offset);
+	return B_OK;
+}
+
+
+/*!	Binary searches the TOC index for the first entry with the given path
+	hash, and returns its index (or where it would have to be inserted).
+*/
+status_t
+PackageReaderImpl::_FindTOCIndexEntry(uint64 pathHash, uint64& _index)
+{
+	uint64 lower = 0;
+	uint64 upper = fTOCIndexEntryCount;
+	while (lower < upper) {
+		uint64 mid = lower + (upper - lower) / 2;
+		hpkg_toc_index_entry indexEntry;
+		status_t error = _ReadTOCIndexEntry(mid, indexEntry);
+		if (error != B_OK)
+			return error;
+
+		if (indexEntry.path_hash < pathHash)
+			lower = mid + 1;
+		else
+			upper = mid;
+	}
+
+	_index = lower;
+	return B_OK;
+}
+
+
+/*!	Checks whether the TOC index entry \a entry refers to an entry named
+	\a name. Only the beginning of its attribute containing the name is read.
+	\return \c B_ENTRY_NOT_FOUND, if the name doesn't match.
+*/
+status_t
+PackageReaderImpl::_CheckTOCIndexEntryName(const hpkg_toc_index_entry& entry,
+	const char* name)
+{
+	// The attribute tag and a string table index are LEB128 encoded, and
+	// thus 10 bytes long at most; an inline string matches only if it has
+	// the length of the name.
+	size_t nameLength = strlen(name);
+	status_t error = _PrepareTOCRange(entry.offset,
+		std::min(entry.length, (uint64)(2 * 10 + nameLength + 1)));
+	if (error != B_OK)
+		return error;
+
+	fTOCSection.currentOffset = entry.offset;
+	SetCurrentSection(&fTOCSection);
+
+	uint8 id;
+	AttributeValue value;
+	error = ReadAttribute(id, value);
+	if (error != B_OK)
+		return error;
+
+	if (id != B_HPKG_ATTRIBUTE_ID_DIRECTORY_ENTRY
+		|| value.type != B_HPKG_ATTRIBUTE_TYPE_STRING
+		|| strcmp(value.string, name) != 0) {
+		return B_ENTRY_NOT_FOUND;
+	}
+
+	return B_OK;
+}
+
+
+/*!	Checks whether the ancestors of the TOC index entry \a entry are named
+	like the first \a ancestorCount path \a components, i.e. whether the
+	entry's path matches up to its own name. The parent entries are followed
+	via their offsets, and their index entries are returned in
+	\a ancestorEntries.
+	\return \c B_ENTRY_NOT_FOUND, if the path doesn't match.
+*/
+status_t
+PackageReaderImpl::_CheckTOCIndexEntryAncestors(
+	const hpkg_toc_index_entry& entry, char** components, int32 ancestorCount,
+	hpkg_toc_index_entry* ancestorEntries)
+{
+	uint64 parentOffset = entry.parent_offset;
+	for (int32 i = ancestorCount - 1; i >= 0; i--) {
+		if (parentOffset == kTOCIndexNoParentOffset)
+			return B_ENTRY_NOT_FOUND;
+
+		// find the parent's index entry
+		uint64 pathHash = kTOCIndexRootPathHash;
+		for (int32 k = 0; k <= i; k++) {
+			pathHash = toc_index_path_hash(pathHash, components[k],
+				strlen(components[k]));
+		}
+
+		uint64 index;
+		status_t error = _FindTOCIndexEntry(pathHash, index);
+		if (error != B_OK)
+			return error;
+
+		hpkg_toc_index_entry parentEntry;
+		bool found = false;
+		for (; index < fTOCIndexEntryCount; index++) {
+			error = _ReadTOCIndexEntry(index, parentEntry);
+			if (error != B_OK)
+				return error;
+			if (parentEntry.path_hash != pathHash)
+				break;
+			if (parentEntry.offset == parentOffset) {
+				found = true;
+				break;
+			}
+		}
+
+		if (!found)
+			return B_ENTRY_NOT_FOUND;
+
+		error = _CheckTOCIndexEntryName(parentEntry, components[i]);
+		if (error != B_OK)
+			return error;
+
+		ancestorEntries[i] = parentEntry;
+		parentOffset = parentEntry.parent_offset;
+	}
+
+	return parentOffset == kTOCIndexNoParentOffset ? B_OK : B_ENTRY_NOT_FOUND;
+}
+
+
+/*!	Creates the ancestor entry for path component \a index and recurses, until
+	the last component is reached, which is then looked up in the TOC index.
+	The ancestors have to live on the stack for the whole lookup, since the
+	found entry refers to them.
+*/
+status_t
+PackageReaderImpl::_FindEntry(AttributeHandlerContext* context,
+	BPackageEntry* parentEntry, BPackageEntry** ancestors, char** components,
+	int32 componentCount, int32 index, uint64 pathHash,
+	int32& _notifiedAncestorCount)
+{
+	const char* name = components[index];
+	pathHash = toc_index_path_hash(pathHash, name, strlen(name));
+
+	if (index == componentCount - 1) {
+		return _FindIndexedEntry(context, parentEntry, ancestors, components,
+			index, pathHash, _notifiedAncestorCount);
+	}
+
+	BPackageEntry entry(parentEntry, name);
+	entry.SetType(S_IFDIR);
+	entry.SetPermissions(B_HPKG_DEFAULT_DIRECTORY_PERMISSIONS);
+	ancestors[index] = &entry;
+
+	status_t error = _FindEntry(context, &entry, ancestors, components,
+		componentCount, index + 1, pathHash, _notifiedAncestorCount);
+
+	if (index < _notifiedAncestorCount) {
+		status_t doneError
+			= context->packageContentHandler->HandleEntryDone(&entry);
+		if (error == B_OK)
+			error = doneError;
+	}
+
+	return error;
+}
+
+
+status_t
+PackageReaderImpl::_FindIndexedEntry(AttributeHandlerContext* context,
+	BPackageEntry* parentEntry, BPackageEntry** ancestors, char** components,
+	int32 ancestorCount, uint64 pathHash, int32& _notifiedAncestorCount)
+{
+	uint64 first;
+	status_t error = _FindTOCIndexEntry(pathHash, first);
+	if (error != B_OK)
+		return error;
+
+	hpkg_toc_index_entry* ancestorEntries = NULL;
+	if (ancestorCount > 0) {
+		ancestorEntries
+			= new(std::nothrow) hpkg_toc_index_entry[ancestorCount];
+		if (ancestorEntries == NULL)
+			return B_NO_MEMORY;
+	}
+	ArrayDeleter<hpkg_toc_index_entry> ancestorEntriesDeleter(ancestorEntries);
+
+	// try all entries with a matching hash; since the hash may collide,
+	// the whole path has to be checked
+	hpkg_toc_index_entry indexEntry;
+	bool found = false;
+	for (uint64 i = first; i < fTOCIndexEntryCount; i++) {
+		error = _ReadTOCIndexEntry(i, indexEntry);
+		if (error != B_OK)
+			return error;
+		if (indexEntry.path_hash != pathHash)
+			break;
+
+		error = _CheckTOCIndexEntryName(indexEntry, components[ancestorCount]);
+		if (error == B_OK) {
+			error = _CheckTOCIndexEntryAncestors(indexEntry, components,
+				ancestorCount, ancestorEntries);
+		}
+		if (error == B_ENTRY_NOT_FOUND)
+			continue;
+		if (error != B_OK)
+			return error;
+
+		found = true;
+		break;
+	}
+
+	if (!found)
+		return B_ENTRY_NOT_FOUND;
+
+	// pass the ancestors with their attributes to the content handler
+	for (int32 i = 0; i < ancestorCount; i++) {
+		error = _NotifyIndexedAncestor(context, ancestorEntries[i],
+			ancestors[i]);
+		if (error != B_OK)
+			return error;
+
+		_notifiedAncestorCount++;
+	}
+
+	// parse the entry itself
+	error = _PrepareTOCRange(indexEntry.offset, indexEntry.length);
+	if (error != B_OK)
+		return error;
+
+	fTOCSection.currentOffset = indexEntry.offset;
+	SetCurrentSection(&fTOCSection);
+
+	IndexedEntryAttributeHandler rootAttributeHandler(parentEntry);
+	rootAttributeHandler.SetLevel(0);
+	ClearAttributeHandlerStack();
+	PushAttributeHandler(&rootAttributeHandler);
+
+	error = ParseAttribute(context);
+	if (error == B_OK
+		&& fTOCSection.currentOffset != indexEntry.offset + indexEntry.length) {
+		ErrorOutput()->PrintError("Error: Invalid TOC index entry\n");
+		error = B_BAD_DATA;
+	}
+
+	// clean up
+	if (error != B_OK)
+		context->ErrorOccurred();
+	while (AttributeHandler* handler = PopAttributeHandler()) {
+		if (handler != &rootAttributeHandler)
+			handler->Delete(context);
+	}
+
+	return error;
+}
+
+
+/*!	Reads the attributes of the ancestor directory \a entry, which the TOC
+	index entry \a indexEntry refers to, and passes the entry and its file
+	attributes to the content handler. Its child entries are not read.
+*/
+status_t
+PackageReaderImpl::_NotifyIndexedAncestor(AttributeHandlerContext* context,
+	const hpkg_toc_index_entry& indexEntry, BPackageEntry* entry)
+{
+	if (indexEntry.attributes_length > indexEntry.length) {
+		ErrorOutput()->PrintError("Error: Invalid TOC index entry\n");
+		return B_BAD_DATA;
+	}
+
+	status_t error = _PrepareTOCRange(indexEntry.offset,
+		indexEntry.attributes_length);
+	if (error != B_OK)
+		return error;
+
+	fTOCSection.currentOffset = indexEntry.offset;
+	SetCurrentSection(&fTOCSection);
+
+	// skip the entry attribute itself, its name has been checked already
+	uint8 id;
+	AttributeValue value;
+	error = ReadAttribute(id, value);
+	if (error != B_OK)
+		return error;
+
+	IndexedAncestorAttributeHandler attributeHandler(entry);
+	attributeHandler.SetLevel(1);
+	ClearAttributeHandlerStack();
+	PushAttributeHandler(&attributeHandler);
+
+	// the children are parsed one by one, as the range ends before the
+	// child entries, not with the end of the children
+	uint64 end = indexEntry.offset + indexEntry.attributes_length;
+	while (error == B_OK && fTOCSection.currentOffset < end)
+		error = ParseAttribute(context);
+
+	if (error == B_OK && fTOCSection.currentOffset != end) {
+		ErrorOutput()->PrintError("Error: Invalid TOC index entry\n");
+		error = B_BAD_DATA;
+	}
+
+	if (error == B_OK)
+		error = attributeHandler.Notify(context);
+
+	// clean up
+	if (error != B_OK)
+		context->ErrorOccurred();
+	while (AttributeHandler* handler = PopAttributeHandler()) {
+		if (handler != &attributeHandler)
+			handler->Delete(context);
+	}
+
+	return error;
+}
+
+
+/*!	Reads the given range of the TOC section. Unless the TOC has been read
+	completely already, the section buffer is allocated and the strings
+	subsection is read and parsed first.
+*/
+status_t
+PackageReaderImpl::_PrepareTOCRange(uint64 offset, uint64 length)
+{
+	if (offset < fTOCSection.stringsLength
+		|| offset > fTOCSection.uncompressedLength
+		|| length > fTOCSection.uncompressedLength - offset) {
+		ErrorOutput()->PrintError("Error: Invalid TOC index entry\n");
+		return B_BAD_DATA;
+	}
+
+	if (fTOCSection.data == NULL) {
+		// zero it, since _CheckTOCIndexEntryAncestors() may look beyond the
+		// ranges read
+		fTOCSection.data
+			= new(std::nothrow) uint8[fTOCSection.uncompressedLength]();
+		if (fTOCSection.data == NULL) {
+			ErrorOutput()->PrintError("Error: Out of memory!\n");
+			return B_NO_MEMORY;
+		}
+
+		status_t error = HeapReader()->ReadData(fTOCSection.offset,
+			fTOCSection.data, fTOCSection.stringsLength);
+		if (error == B_OK) {
+			fTOCSection.currentOffset = 0;
+			SetCurrentSection(&fTOCSection);
+			error = ParseStrings();
+		}
+		if (error != B_OK) {
+			delete[] fTOCSection.strings;
+			fTOCSection.strings = NULL;
+			delete[] fTOCSection.data;
+			fTOCSection.data = NULL;
+			return error;
+		}
+	}
+
+	return HeapReader()->ReadData(fTOCSection.offset + offset,
+		fTOCSection.data + offset, length);
+}
+
+
 status_t
 PackageReaderImpl::_GetTOCBuffer(size_t size, const void*& _buffer)
 {
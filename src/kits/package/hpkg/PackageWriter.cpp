@@ -23,7 +23,10 @@ BPackageWriterParameters::BPackageWriterParameters()
 	:
 	fFlags(0),
 	fCompression(B_HPKG_COMPRESSION_ZLIB),
-	fCompressionLevel(B_HPKG_COMPRESSION_LEVEL_BEST)
+	fCompressionLevel(B_HPKG_COMPRESSION_LEVEL_BEST),
+	fCompressionDictionary(NULL),
+	fCompressionDictionarySize(0),
+	fCompressionThreadCount(1)
 {
 }
 
@@ -75,6 +78,43 @@ BPackageWriterParameters::SetCompressionLevel(int32 compressionLevel)
 }
 
 
+const void*
+BPackageWriterParameters::CompressionDictionary() const
+{
+	return fCompressionDictionary;
+}
+
+
+size_t
+BPackageWriterParameters::CompressionDictionarySize() const
+{
+	return fCompressionDictionarySize;
+}
+
+
+void
+BPackageWriterParameters::SetCompressionDictionary(const void* dictionary,
+	size_t size)
+{
+	fCompressionDictionary = dictionary;
+	fCompressionDictionarySize = size;
+}
+
+
+int32
+BPackageWriterParameters::CompressionThreadCount() const
+{
+	return fCompressionThreadCount;
+}
+
+
+void
+BPackageWriterParameters::SetCompressionThreadCount(int32 count)
+{
+	fCompressionThreadCount = count;
+}
+
+
 // #pragma mark - BPackageWriter
 
 
@@ -32,6 +32,7 @@
 #include <package/hpkg/PackageData.h>
 #include <package/hpkg/PackageDataReader.h>
 
+#include <Array.h>
 #include <AutoDeleter.h>
 #include <AutoDeleterPosix.h>
 #include <RangeArray.h>
@@ -60,6 +61,20 @@ namespace BHPKG {
 namespace BPrivate {
 
 
+// #pragma mark - TOCIndexEntryLess
+
+
+struct TOCIndexEntryLess {
+	bool operator()(const hpkg_toc_index_entry& a,
+		const hpkg_toc_index_entry& b) const
+	{
+		if (a.path_hash != b.path_hash)
+			return a.path_hash < b.path_hash;
+		return a.offset < b.offset;
+	}
+};
+
+
 // #pragma mark - Attributes
 
 
@@ -444,6 +459,7 @@ PackageWriterImpl::PackageWriterImpl(BPackageWriterListener* listener)
 	inherited("package", listener),
 	fListener(listener),
 	fHeapRangesToRemove(NULL),
+	fTOCIndex(NULL),
 	fRootEntry(NULL),
 	fRootAttribute(NULL),
 	fTopAttribute(NULL),
@@ -455,6 +471,7 @@ PackageWriterImpl::PackageWriterImpl(BPackageWriterListener* listener)
 PackageWriterImpl::~PackageWriterImpl()
 {
 	delete fHeapRangesToRemove;
+	delete fTOCIndex;
 	delete fRootAttribute;
 	delete fRootEntry;
 }
@@ -659,6 +676,8 @@ PackageWriterImpl::_Init(BPositionIO* file, bool keepFile, const char* fileName,
 	fTopAttribute = fRootAttribute;
 
 	fHeapRangesToRemove = new RangeArray<uint64>;
+	if ((Flags() & B_HPKG_WRITER_TOC_INDEX) != 0)
+		fTOCIndex = new Array<hpkg_toc_index_entry>;
 
 	// in update mode, parse the TOC
 	if ((Flags() & B_HPKG_WRITER_UPDATE_PACKAGE) != 0) {
@@ -670,6 +689,15 @@ PackageWriterImpl::_Init(BPositionIO* file, bool keepFile, const char* fileName,
 
 		fHeapOffset = packageReader.HeapOffset();
 
+		// keep the TOC index, if the package has one
+		off_t tocIndexOffset;
+		off_t tocIndexSize;
+		if (fTOCIndex == NULL
+			&& packageReader.GetTOCIndex(tocIndexOffset, tocIndexSize)
+				== B_OK) {
+			fTOCIndex = new Array<hpkg_toc_index_entry>;
+		}
+
 		PackageContentHandler handler(fRootAttribute, fListener, fStringCache);
 
 		result = packageReader.ParseContent(&handler);
@@ -677,8 +705,10 @@ PackageWriterImpl::_Init(BPositionIO* file, bool keepFile, const char* fileName,
 			return result;
 
 		// While the compression level can change, we have to reuse the
-		// compression algorithm at least.
+		// compression algorithm (and dictionary) at least.
 		SetCompression(B_BENDIAN_TO_HOST_INT16(header.heap_compression));
+		SetCompressionDictionary(packageReader.HeapDictionary(),
+			packageReader.HeapDictionarySize());
 
 		result = InitHeapReader(fHeapOffset);
 		if (result != B_OK)
@@ -740,6 +770,8 @@ PackageWriterImpl::_Finish()
 	header.heap_size_compressed = B_HOST_TO_BENDIAN_INT64(compressedHeapSize);
 	header.heap_size_uncompressed = B_HOST_TO_BENDIAN_INT64(
 		fHeapWriter->UncompressedHeapSize());
+	header.heap_dictionary_size = B_HOST_TO_BENDIAN_INT32(
+		fHeapWriter->DictionarySize());
 
 	// Truncate the file to the size it is supposed to have. In update mode, it
 	// can be greater when one or more files are shrunk. In creation mode it
@@ -752,6 +784,10 @@ PackageWriterImpl::_Finish()
 		return errno;
 	}
 
+	// append the TOC index, if requested
+	if (fTOCIndex != NULL)
+		totalSize += _WriteTOCIndex(totalSize, tocLength);
+
 	fListener->OnPackageSizeInfo(fHeaderSize, compressedHeapSize, tocLength,
 		attributesLength, totalSize);
 
@@ -788,6 +824,13 @@ PackageWriterImpl::_Recompress(BPositionIO* inputFile)
 		return error;
 	}
 
+	// The TOC index doesn't depend on the heap compression, so it can be
+	// copied as is.
+	off_t tocIndexOffset;
+	off_t tocIndexSize;
+	if (reader.GetTOCIndex(tocIndexOffset, tocIndexSize) != B_OK)
+		tocIndexSize = 0;
+
 	// Update some header fields, assuming no compression. We'll rewrite the
 	// header later, should compression have been used. Doing it this way allows
 	// for streaming an uncompressed package.
@@ -795,13 +838,16 @@ PackageWriterImpl::_Recompress(BPositionIO* inputFile)
 		= reader.RawHeapReader()->UncompressedHeapSize();
 	uint64 compressedHeapSize = uncompressedHeapSize;
 
-	off_t totalSize = fHeapWriter->HeapOffset() + (off_t)compressedHeapSize;
+	off_t totalSize = fHeapWriter->HeapOffset() + (off_t)compressedHeapSize
+		+ tocIndexSize;
 
 	header.heap_compression = B_HOST_TO_BENDIAN_INT16(
 		Parameters().Compression());
 	header.heap_chunk_size = B_HOST_TO_BENDIAN_INT32(fHeapWriter->ChunkSize());
 	header.heap_size_uncompressed
 		= B_HOST_TO_BENDIAN_INT64(uncompressedHeapSize);
+	header.heap_dictionary_size
+		= B_HOST_TO_BENDIAN_INT32(fHeapWriter->DictionarySize());
 
 	if (Parameters().Compression() == B_HPKG_COMPRESSION_NONE) {
 		header.heap_size_compressed
@@ -824,10 +870,32 @@ PackageWriterImpl::_Recompress(BPositionIO* inputFile)
 	if (error != B_OK)
 		return error;
 
+	// copy the TOC index
+	if (tocIndexSize > 0) {
+		off_t offset = fHeapWriter->HeapOffset()
+			+ (off_t)fHeapWriter->CompressedHeapSize();
+		uint8 buffer[4096];
+		for (off_t copied = 0; copied < tocIndexSize;) {
+			size_t toCopy = std::min((off_t)sizeof(buffer),
+				tocIndexSize - copied);
+			error = inputFile->ReadAtExactly(tocIndexOffset + copied, buffer,
+				toCopy);
+			if (error != B_OK) {
+				fListener->PrintError("Failed to read TOC index: %s\n",
+					strerror(error));
+				return error;
+			}
+
+			RawWriteBuffer(buffer, toCopy, offset + copied);
+			copied += toCopy;
+		}
+	}
+
 	// If compression is enabled, update and write the header.
 	if (Parameters().Compression() != B_HPKG_COMPRESSION_NONE) {
 		compressedHeapSize = fHeapWriter->CompressedHeapSize();
-		totalSize = fHeapWriter->HeapOffset() + (off_t)compressedHeapSize;
+		totalSize = fHeapWriter->HeapOffset() + (off_t)compressedHeapSize
+			+ tocIndexSize;
 		header.heap_size_compressed = B_HOST_TO_BENDIAN_INT64(compressedHeapSize);
 		header.total_size = B_HOST_TO_BENDIAN_INT64(totalSize);
 
@@ -1333,7 +1401,10 @@ PackageWriterImpl::_WriteTOC(hpkg_header& header, uint64& _length)
 
 	// main TOC section
 	uint64 mainOffset = fHeapWriter->UncompressedHeapSize();
-	_WriteAttributeChildren(fRootAttribute);
+	if (fTOCIndex != NULL)
+		fTOCIndex->MakeEmpty();
+	_WriteAttributeChildren(fRootAttribute, startOffset,
+		kTOCIndexRootPathHash, kTOCIndexNoParentOffset);
 
 	// notify the listener
 	uint64 endOffset = fHeapWriter->UncompressedHeapSize();
@@ -1351,25 +1422,121 @@ PackageWriterImpl::_WriteTOC(hpkg_header& header, uint64& _length)
 }
 
 
-void
-PackageWriterImpl::_WriteAttributeChildren(Attribute* attribute)
+/*!	Writes the children of \a attribute. For each entry the offset and length
+	of its attribute relative to the TOC start \a tocOffset is recorded for the
+	TOC index. \a pathHash and \a parentOffset are the path hash and the
+	attribute offset of the entry the children belong to, i.e. \a attribute
+	itself, if it is an entry.
+	Child entries are written after all other children, so that the attributes
+	of an entry can be read without its children. Returns the heap offset at
+	which the child entries start.
+*/
+uint64
+PackageWriterImpl::_WriteAttributeChildren(Attribute* attribute,
+	uint64 tocOffset, uint64 pathHash, uint64 parentOffset)
 {
-	DoublyLinkedList<Attribute>::Iterator it
-		= attribute->children.GetIterator();
-	while (Attribute* child = it.Next()) {
-		// write tag
-		uint8 encoding = child->value.ApplicableEncoding();
-		WriteUnsignedLEB128(compose_attribute_tag(child->id,
-			child->value.type, encoding, !child->children.IsEmpty()));
+	uint64 entriesOffset = 0;
+
+	for (int32 pass = 0; pass < 2; pass++) {
+		bool writeEntries = pass == 1;
+		if (writeEntries)
+			entriesOffset = fHeapWriter->UncompressedHeapSize();
+
+		DoublyLinkedList<Attribute>::Iterator it
+			= attribute->children.GetIterator();
+		while (Attribute* child = it.Next()) {
+			bool isEntry = child->id == B_HPKG_ATTRIBUTE_ID_DIRECTORY_ENTRY
+				&& child->value.type == B_HPKG_ATTRIBUTE_TYPE_STRING;
+			if (isEntry != writeEntries)
+				continue;
+
+			uint64 childOffset = fHeapWriter->UncompressedHeapSize();
+			uint64 childPathHash = pathHash;
+			if (isEntry) {
+				const char* name = child->value.string->string;
+				childPathHash = toc_index_path_hash(pathHash, name,
+					strlen(name));
+			}
 
-		// write value
-		WriteAttributeValue(child->value, encoding);
+			// write tag
+			uint8 encoding = child->value.ApplicableEncoding();
+			WriteUnsignedLEB128(compose_attribute_tag(child->id,
+				child->value.type, encoding, !child->children.IsEmpty()));
 
-		if (!child->children.IsEmpty())
-			_WriteAttributeChildren(child);
+			// write value
+			WriteAttributeValue(child->value, encoding);
+
+			uint64 childEntriesOffset = fHeapWriter->UncompressedHeapSize();
+			if (!child->children.IsEmpty()) {
+				childEntriesOffset = _WriteAttributeChildren(child, tocOffset,
+					childPathHash,
+					isEntry ? childOffset - tocOffset : parentOffset);
+			}
+
+			if (isEntry && fTOCIndex != NULL) {
+				hpkg_toc_index_entry indexEntry;
+				indexEntry.path_hash = childPathHash;
+				indexEntry.offset = childOffset - tocOffset;
+				indexEntry.length = fHeapWriter->UncompressedHeapSize()
+					- childOffset;
+				indexEntry.attributes_length = childEntriesOffset
+					- childOffset;
+				indexEntry.parent_offset = parentOffset;
+				if (!fTOCIndex->Add(indexEntry))
+					throw std::bad_alloc();
+			}
+		}
 	}
 
 	WriteUnsignedLEB128(0);
+	return entriesOffset;
+}
+
+
+/*!	Writes the TOC index collected while writing the TOC to the file at
+	\a offset, i.e. right after the heap. Returns the number of bytes written.
+*/
+off_t
+PackageWriterImpl::_WriteTOCIndex(off_t offset, uint64 tocLength)
+{
+	int32 entryCount = fTOCIndex->Count();
+	if (entryCount == 0)
+		return 0;
+
+	hpkg_toc_index_entry* entries = fTOCIndex->Elements();
+	std::sort(entries, entries + entryCount, TOCIndexEntryLess());
+
+	// write the entries in chunks
+	const int32 kBufferEntryCount = 256;
+	hpkg_toc_index_entry buffer[kBufferEntryCount];
+	off_t startOffset = offset;
+	for (int32 i = 0; i < entryCount;) {
+		int32 toWrite = std::min(entryCount - i, kBufferEntryCount);
+		for (int32 k = 0; k < toWrite; k++, i++) {
+			buffer[k].path_hash = B_HOST_TO_BENDIAN_INT64(entries[i].path_hash);
+			buffer[k].offset = B_HOST_TO_BENDIAN_INT64(entries[i].offset);
+			buffer[k].length = B_HOST_TO_BENDIAN_INT64(entries[i].length);
+			buffer[k].attributes_length
+				= B_HOST_TO_BENDIAN_INT64(entries[i].attributes_length);
+			buffer[k].parent_offset
+				= B_HOST_TO_BENDIAN_INT64(entries[i].parent_offset);
+		}
+
+		RawWriteBuffer(buffer, toWrite * sizeof(hpkg_toc_index_entry), offset);
+		offset += toWrite * sizeof(hpkg_toc_index_entry);
+	}
+
+	// write the footer
+	hpkg_toc_index_footer footer;
+	footer.magic = B_HOST_TO_BENDIAN_INT32(B_HPKG_TOC_INDEX_MAGIC);
+	footer.footer_size = B_HOST_TO_BENDIAN_INT16(sizeof(footer));
+	footer.version = B_HOST_TO_BENDIAN_INT16(B_HPKG_TOC_INDEX_VERSION);
+	footer.toc_length = B_HOST_TO_BENDIAN_INT64(tocLength);
+	footer.entry_count = B_HOST_TO_BENDIAN_INT64(entryCount);
+	RawWriteBuffer(&footer, sizeof(footer), offset);
+	offset += sizeof(footer);
+
+	return offset - startOffset;
 }
 
 
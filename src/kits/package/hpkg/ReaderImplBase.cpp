@@ -809,6 +809,8 @@ ReaderImplBase::ReaderImplBase(const char* fileType, BErrorOutput* errorOutput)
 	fOwnsFile(false),
 	fRawHeapReader(NULL),
 	fHeapReader(NULL),
+	fHeapDictionary(NULL),
+	fHeapDictionarySize(0),
 	fCurrentSection(NULL)
 {
 }
@@ -820,6 +822,8 @@ ReaderImplBase::~ReaderImplBase()
 	if (fRawHeapReader != fHeapReader)
 		delete fRawHeapReader;
 
+	free(fHeapDictionary);
+
 	if (fOwnsFile)
 		delete fFile;
 }
@@ -846,7 +850,66 @@ ReaderImplBase::DetachHeapReader(PackageFileHeapReader*& _rawHeapReader)
 
 status_t
 ReaderImplBase::InitHeapReader(uint32 compression, uint32 chunkSize,
-	off_t offset, uint64 compressedSize, uint64 uncompressedSize)
+	off_t offset, uint64 compressedSize, uint64 uncompressedSize,
+	uint32 dictionarySize)
+{
+	// The dictionary (if any) is stored at the end of the heap. Older writers
+	// didn't initialize the field, so ignore it for other compressions.
+	if (compression == B_HPKG_COMPRESSION_ZSTD_DICTIONARY) {
+		if (dictionarySize == 0
+			|| dictionarySize > B_HPKG_MAX_COMPRESSION_DICTIONARY_SIZE
+			|| dictionarySize > compressedSize) {
+			fErrorOutput->PrintError("Error: Invalid heap dictionary size (%"
+				B_PRIu32 ")\n", dictionarySize);
+			return B_BAD_DATA;
+		}
+
+		fHeapDictionary = malloc(dictionarySize);
+		if (fHeapDictionary == NULL)
+			return B_NO_MEMORY;
+		fHeapDictionarySize = dictionarySize;
+
+		compressedSize -= dictionarySize;
+		status_t error = ReadBuffer(offset + compressedSize, fHeapDictionary,
+			dictionarySize);
+		if (error != B_OK)
+			return error;
+	}
+
+	DecompressionAlgorithmOwner* decompressionAlgorithm = NULL;
+	status_t error = CreateDecompressionAlgorithm(compression, fHeapDictionary,
+		fHeapDictionarySize, decompressionAlgorithm);
+	if (error != B_OK)
+		return error;
+	BReference<DecompressionAlgorithmOwner> decompressionAlgorithmReference(
+		decompressionAlgorithm, true);
+
+	fRawHeapReader = new(std::nothrow) PackageFileHeapReader(fErrorOutput,
+		fFile, offset, compressedSize, uncompressedSize,
+		decompressionAlgorithm);
+	if (fRawHeapReader == NULL)
+		return B_NO_MEMORY;
+
+	error = fRawHeapReader->Init();
+	if (error != B_OK)
+		return error;
+
+	error = CreateCachedHeapReader(fRawHeapReader, fHeapReader);
+	if (error != B_OK) {
+		if (error != B_NOT_SUPPORTED)
+			return error;
+
+		fHeapReader = fRawHeapReader;
+	}
+
+	return B_OK;
+}
+
+
+status_t
+ReaderImplBase::CreateDecompressionAlgorithm(uint32 compression,
+	const void* dictionary, size_t dictionarySize,
+	DecompressionAlgorithmOwner*& _algorithm)
 {
 	DecompressionAlgorithmOwner* decompressionAlgorithm = NULL;
 	BReference<DecompressionAlgorithmOwner> decompressionAlgorithmReference;
@@ -866,39 +929,36 @@ ReaderImplBase::InitHeapReader(uint32 compression, uint32 chunkSize,
 			}
 			break;
 		case B_HPKG_COMPRESSION_ZSTD:
+		case B_HPKG_COMPRESSION_ZSTD_DICTIONARY:
+		{
+			BZstdDecompressionParameters* parameters
+				= new(std::nothrow) BZstdDecompressionParameters;
 			decompressionAlgorithm = DecompressionAlgorithmOwner::Create(
-				new(std::nothrow) BZstdCompressionAlgorithm,
-				new(std::nothrow) BZstdDecompressionParameters);
+				new(std::nothrow) BZstdCompressionAlgorithm, parameters);
 			decompressionAlgorithmReference.SetTo(decompressionAlgorithm, true);
 			if (decompressionAlgorithm == NULL
 				|| decompressionAlgorithm->algorithm == NULL
 				|| decompressionAlgorithm->parameters == NULL) {
 				return B_NO_MEMORY;
 			}
+
+			if (compression == B_HPKG_COMPRESSION_ZSTD_DICTIONARY) {
+				status_t error = parameters->SetDictionary(dictionary,
+					dictionarySize);
+				if (error != B_OK) {
+					fErrorOutput->PrintError("Error: Failed to load heap "
+						"dictionary: %s\n", strerror(error));
+					return error;
+				}
+			}
 			break;
+		}
 		default:
 			fErrorOutput->PrintError("Error: Invalid heap compression\n");
 			return B_BAD_DATA;
 	}
 
-	fRawHeapReader = new(std::nothrow) PackageFileHeapReader(fErrorOutput,
-		fFile, offset, compressedSize, uncompressedSize,
-		decompressionAlgorithm);
-	if (fRawHeapReader == NULL)
-		return B_NO_MEMORY;
-
-	status_t error = fRawHeapReader->Init();
-	if (error != B_OK)
-		return error;
-
-	error = CreateCachedHeapReader(fRawHeapReader, fHeapReader);
-	if (error != B_OK) {
-		if (error != B_NOT_SUPPORTED)
-			return error;
-
-		fHeapReader = fRawHeapReader;
-	}
-
+	_algorithm = decompressionAlgorithmReference.Detach();
 	return B_OK;
 }
 
@@ -1113,6 +1173,76 @@ ReaderImplBase::ParseAttributeTree(AttributeHandlerContext* context,
 }
 
 
+/*!	Parses a single attribute including its children at the current offset
+	of the current section and passes it to the current attribute handler.
+*/
+status_t
+ReaderImplBase::ParseAttribute(AttributeHandlerContext* context)
+{
+	uint8 id;
+	AttributeValue value;
+	bool hasChildren;
+	uint64 tag;
+
+	status_t error = _ReadAttribute(id, value, &hasChildren, &tag);
+	if (error != B_OK)
+		return error;
+
+	if (tag == 0) {
+		fErrorOutput->PrintError("Error: Invalid %s section: expected "
+			"attribute\n", fCurrentSection->name);
+		return B_BAD_DATA;
+	}
+
+	AttributeHandler* childHandler = NULL;
+	error = CurrentAttributeHandler()->HandleAttribute(context, id, value,
+		hasChildren ? &childHandler : NULL);
+	if (error != B_OK || !hasChildren)
+		return error;
+
+	// parse children
+	if (childHandler == NULL) {
+		childHandler = new(context) IgnoreAttributeHandler;
+		if (childHandler == NULL) {
+			fErrorOutput->PrintError("Error: Out of memory!\n");
+			return B_NO_MEMORY;
+		}
+	}
+
+	childHandler->SetLevel(1);
+	PushAttributeHandler(childHandler);
+
+	// _ParseAttributeTree() pops the child handler when done, but leaves
+	// deleting it to us.
+	error = _ParseAttributeTree(context);
+	if (error != B_OK)
+		return error;
+
+	return childHandler->Delete(context);
+}
+
+
+/*!	Reads the ID and value of the attribute at the current offset of the
+	current section, but not its children.
+*/
+status_t
+ReaderImplBase::ReadAttribute(uint8& _id, AttributeValue& _value)
+{
+	uint64 tag;
+	status_t error = _ReadAttribute(_id, _value, NULL, &tag);
+	if (error != B_OK)
+		return error;
+
+	if (tag == 0) {
+		fErrorOutput->PrintError("Error: Invalid %s section: expected "
+			"attribute\n", fCurrentSection->name);
+		return B_BAD_DATA;
+	}
+
+	return B_OK;
+}
+
+
 status_t
 ReaderImplBase::_Init(BPositionIO* file, bool keepFile)
 {
@@ -0,0 +1,793 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+#include <package/hpkg/RepositoryDelta.h>
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <new>
+
+#include <ByteOrder.h>
+#include <DataIO.h>
+
+#include <AutoDeleter.h>
+#include <SHA256.h>
+#include <ZlibCompressionAlgorithm.h>
+#include <ZstdCompressionAlgorithm.h>
+
+#include <package/hpkg/ErrorOutput.h>
+#include <package/hpkg/HPKGDefsPrivate.h>
+#include <package/hpkg/PackageFileHeapReader.h>
+#include <package/hpkg/PackageFileHeapWriter.h>
+#include <package/hpkg/RepositoryReaderImpl.h>
+
+
+namespace BPackageKit {
+
+namespace BHPKG {
+
+namespace BPrivate {
+
+
+// commands
+enum {
+	kCommandCopy	= 1,
+		// uint64 base heap offset, uint32 size
+	kCommandAdd		= 2
+		// uint32 size, followed by the data
+};
+
+
+// size of the blocks of the base heap that are indexed for finding matches
+static const size_t kBlockSize = 32;
+
+// maximum number of base blocks with the same hash that are checked
+static const int32 kMaxMatchCandidates = 16;
+
+static const uint32 kHashMultiplier = 0x01000193;
+
+// sanity limit for the uncompressed heap sizes
+static const uint64 kMaxHeapSize = 256 * 1024 * 1024;
+
+static const size_t kChecksumBufferSize = 64 * 1024;
+
+
+struct BlockEntry {
+	uint32	hash;
+	uint32	index;
+
+	bool operator<(const BlockEntry& other) const
+	{
+		return hash < other.hash
+			|| (hash == other.hash && index < other.index);
+	}
+};
+
+
+struct RepositoryHeap {
+	hpkg_repo_header	header;
+	uint8*				data;
+	size_t				size;
+
+	RepositoryHeap()
+		:
+		data(NULL),
+		size(0)
+	{
+	}
+
+	~RepositoryHeap()
+	{
+		free(data);
+	}
+
+	status_t Read(BErrorOutput* errorOutput, BPositionIO* file)
+	{
+		RepositoryReaderImpl reader(errorOutput);
+		status_t error = reader.Init(file, false);
+		if (error != B_OK)
+			return error;
+
+		error = file->ReadAtExactly(0, &header, sizeof(header));
+		if (error != B_OK)
+			return error;
+
+		uint64 heapSize = reader.UncompressedHeapSize();
+		if (heapSize > kMaxHeapSize) {
+			errorOutput->PrintError("Error: The repository's heap is too "
+				"large\n");
+			return B_NOT_SUPPORTED;
+		}
+
+		data = (uint8*)malloc(std::max(heapSize, (uint64)1));
+		if (data == NULL)
+			return B_NO_MEMORY;
+		size = heapSize;
+
+		return reader.RawHeapReader()->ReadData(0, data, size);
+	}
+};
+
+
+static uint32
+block_hash(const uint8* data)
+{
+	uint32 hash = 0;
+	for (size_t i = 0; i < kBlockSize; i++)
+		hash = hash * kHashMultiplier + data[i];
+	return hash;
+}
+
+
+static status_t
+compute_checksum(BPositionIO* file, uint8* checksum)
+{
+	off_t fileSize;
+	status_t error = file->GetSize(&fileSize);
+	if (error != B_OK)
+		return error;
+
+	void* buffer = malloc(kChecksumBufferSize);
+	if (buffer == NULL)
+		return B_NO_MEMORY;
+	MemoryDeleter bufferDeleter(buffer);
+
+	SHA256 sha;
+	off_t offset = 0;
+	while (offset < fileSize) {
+		size_t toRead = (size_t)std::min((off_t)kChecksumBufferSize,
+			fileSize - offset);
+		error = file->ReadAtExactly(offset, buffer, toRead);
+		if (error != B_OK)
+			return error;
+
+		sha.Update(buffer, toRead);
+		offset += toRead;
+	}
+
+	memcpy(checksum, sha.Digest(), SHA_DIGEST_LENGTH);
+	return B_OK;
+}
+
+
+static status_t
+create_compression_algorithms(uint16 compression, uint32 level,
+	BReference<CompressionAlgorithmOwner>& _compressionAlgorithm,
+	BReference<DecompressionAlgorithmOwner>& _decompressionAlgorithm)
+{
+	CompressionAlgorithmOwner* compressionAlgorithm = NULL;
+	DecompressionAlgorithmOwner* decompressionAlgorithm = NULL;
+
+	switch (compression) {
+		case B_HPKG_COMPRESSION_NONE:
+			return B_OK;
+		case B_HPKG_COMPRESSION_ZLIB:
+			compressionAlgorithm = CompressionAlgorithmOwner::Create(
+				new(std::nothrow) BZlibCompressionAlgorithm,
+				new(std::nothrow) BZlibCompressionParameters(
+					(level / float(B_HPKG_COMPRESSION_LEVEL_BEST))
+						* B_ZLIB_COMPRESSION_BEST));
+			decompressionAlgorithm = DecompressionAlgorithmOwner::Create(
+				new(std::nothrow) BZlibCompressionAlgorithm,
+				new(std::nothrow) BZlibDecompressionParameters);
+			break;
+		case B_HPKG_COMPRESSION_ZSTD:
+			compressionAlgorithm = CompressionAlgorithmOwner::Create(
+				new(std::nothrow) BZstdCompressionAlgorithm,
+				new(std::nothrow) BZstdCompressionParameters(
+					(level / float(B_HPKG_COMPRESSION_LEVEL_BEST))
+						* B_ZSTD_COMPRESSION_BEST));
+			decompressionAlgorithm = DecompressionAlgorithmOwner::Create(
+				new(std::nothrow) BZstdCompressionAlgorithm,
+				new(std::nothrow) BZstdDecompressionParameters);
+			break;
+		default:
+			// B_HPKG_COMPRESSION_ZSTD_DICTIONARY is rejected by
+			// check_target_compression() already.
+			return B_NOT_SUPPORTED;
+	}
+
+	_compressionAlgorithm.SetTo(compressionAlgorithm, true);
+	_decompressionAlgorithm.SetTo(decompressionAlgorithm, true);
+
+	if (compressionAlgorithm == NULL
+		|| compressionAlgorithm->algorithm == NULL
+		|| compressionAlgorithm->parameters == NULL
+		|| decompressionAlgorithm == NULL
+		|| decompressionAlgorithm->algorithm == NULL
+		|| decompressionAlgorithm->parameters == NULL) {
+		return B_NO_MEMORY;
+	}
+
+	return B_OK;
+}
+
+
+/*!	Checks whether the heap of the target repository with the given (big
+	endian) \a header can be reproduced by recompressing it.
+	That's not the case with B_HPKG_COMPRESSION_ZSTD_DICTIONARY, since the
+	dictionary is trained on the heap's contents, and would have to be
+	transferred as well. Deltas are not supported for such repositories, so
+	clients download the complete repository file instead.
+*/
+static status_t
+check_target_compression(BErrorOutput* errorOutput,
+	const hpkg_repo_header& header)
+{
+	uint16 compression = B_BENDIAN_TO_HOST_INT16(header.heap_compression);
+	if (compression == B_HPKG_COMPRESSION_ZSTD_DICTIONARY
+		|| header.heap_dictionary_size != 0) {
+		errorOutput->PrintError("Error: Deltas are not supported for "
+			"repositories with a dictionary compressed heap\n");
+		return B_NOT_SUPPORTED;
+	}
+
+	return B_OK;
+}
+
+
+/*!	Writes a repository file with the given (big endian) header and heap, the
+	heap being compressed with the given level. Fails with B_BAD_DATA, if the
+	result doesn't match the header.
+*/
+static status_t
+write_repository(BErrorOutput* errorOutput, const hpkg_repo_header& header,
+	const uint8* heap, size_t heapSize, uint32 compressionLevel,
+	BPositionIO* file)
+{
+	if (B_BENDIAN_TO_HOST_INT64(header.heap_size_uncompressed) != heapSize)
+		return B_BAD_DATA;
+	if (B_BENDIAN_TO_HOST_INT32(header.heap_chunk_size)
+			!= PackageFileHeapWriter::kChunkSize
+		|| header.heap_dictionary_size != 0) {
+		return B_NOT_SUPPORTED;
+	}
+
+	BReference<CompressionAlgorithmOwner> compressionAlgorithm;
+	BReference<DecompressionAlgorithmOwner> decompressionAlgorithm;
+	status_t error = create_compression_algorithms(
+		B_BENDIAN_TO_HOST_INT16(header.heap_compression), compressionLevel,
+		compressionAlgorithm, decompressionAlgorithm);
+	if (error != B_OK)
+		return error;
+
+	PackageFileHeapWriter heapWriter(errorOutput, file, sizeof(header),
+		compressionAlgorithm.Get(), decompressionAlgorithm.Get());
+	try {
+		heapWriter.Init();
+		heapWriter.AddDataThrows(heap, heapSize);
+	} catch (std::bad_alloc&) {
+		return B_NO_MEMORY;
+	} catch (status_t status) {
+		return status;
+	}
+
+	error = heapWriter.Finish();
+	if (error != B_OK)
+		return error;
+
+	uint64 totalSize = sizeof(header) + heapWriter.CompressedHeapSize();
+	if ((uint64)heapWriter.CompressedHeapSize()
+			!= B_BENDIAN_TO_HOST_INT64(header.heap_size_compressed)
+		|| totalSize != B_BENDIAN_TO_HOST_INT64(header.total_size)) {
+		return B_BAD_DATA;
+	}
+
+	error = file->WriteAtExactly(0, &header, sizeof(header));
+	if (error != B_OK)
+		return error;
+
+	return file->SetSize(totalSize);
+}
+
+
+static status_t
+write_copy_command(BMallocIO& commands, uint64 offset, uint32 size)
+{
+	uint8 buffer[13];
+	buffer[0] = kCommandCopy;
+	offset = B_HOST_TO_BENDIAN_INT64(offset);
+	size = B_HOST_TO_BENDIAN_INT32(size);
+	memcpy(buffer + 1, &offset, sizeof(offset));
+	memcpy(buffer + 9, &size, sizeof(size));
+	return commands.WriteExactly(buffer, sizeof(buffer));
+}
+
+
+static status_t
+write_add_command(BMallocIO& commands, const uint8* data, size_t size)
+{
+	if (size == 0)
+		return B_OK;
+
+	uint8 buffer[5];
+	buffer[0] = kCommandAdd;
+	uint32 bigEndianSize = B_HOST_TO_BENDIAN_INT32((uint32)size);
+	memcpy(buffer + 1, &bigEndianSize, sizeof(bigEndianSize));
+
+	status_t error = commands.WriteExactly(buffer, sizeof(buffer));
+	if (error == B_OK)
+		error = commands.WriteExactly(data, size);
+	return error;
+}
+
+
+/*!	Describes \a target in terms of blocks copied from \a base and literal
+	data. The base is indexed in blocks of kBlockSize bytes, which are looked
+	up at every position of the target via a rolling hash. Matches are
+	extended in both directions as far as possible.
+*/
+static status_t
+compute_commands(const uint8* base, size_t baseSize, const uint8* target,
+	size_t targetSize, BMallocIO& commands)
+{
+	// index the base's blocks
+	size_t blockCount = baseSize / kBlockSize;
+	BlockEntry* blocks = (BlockEntry*)malloc(
+		sizeof(BlockEntry) * std::max(blockCount, (size_t)1));
+	if (blocks == NULL)
+		return B_NO_MEMORY;
+	MemoryDeleter blocksDeleter(blocks);
+
+	for (size_t i = 0; i < blockCount; i++) {
+		blocks[i].hash = block_hash(base + i * kBlockSize);
+		blocks[i].index = i;
+	}
+	std::sort(blocks, blocks + blockCount);
+
+	// factor of the byte leaving the rolling hash window
+	uint32 outFactor = 1;
+	for (size_t i = 1; i < kBlockSize; i++)
+		outFactor *= kHashMultiplier;
+
+	size_t literalStart = 0;
+	size_t position = 0;
+	uint32 hash = 0;
+	bool hashValid = false;
+	while (position + kBlockSize <= targetSize) {
+		if (!hashValid) {
+			hash = block_hash(target + position);
+			hashValid = true;
+		}
+
+		// find the longest match among the blocks with the same hash
+		size_t matchOffset = 0;
+		size_t matchSize = 0;
+		size_t matchBack = 0;
+
+		BlockEntry key;
+		key.hash = hash;
+		key.index = 0;
+		const BlockEntry* entry = std::lower_bound(blocks, blocks + blockCount,
+			key);
+		for (int32 i = 0; i < kMaxMatchCandidates
+				&& entry < blocks + blockCount && entry->hash == hash;
+				i++, entry++) {
+			size_t offset = (size_t)entry->index * kBlockSize;
+			if (memcmp(base + offset, target + position, kBlockSize) != 0)
+				continue;
+
+			size_t size = kBlockSize;
+			while (offset + size < baseSize && position + size < targetSize
+				&& base[offset + size] == target[position + size]) {
+				size++;
+			}
+
+			size_t back = 0;
+			while (back < position - literalStart && back < offset
+				&& base[offset - back - 1] == target[position - back - 1]) {
+				back++;
+			}
+
+			if (size + back > matchSize + matchBack) {
+				matchOffset = offset;
+				matchSize = size;
+				matchBack = back;
+			}
+		}
+
+		if (matchSize == 0) {
+			// roll the hash over to the next position
+			if (position + kBlockSize < targetSize) {
+				hash = (hash - target[position] * outFactor) * kHashMultiplier
+					+ target[position + kBlockSize];
+			}
+			position++;
+			continue;
+		}
+
+		status_t error = write_add_command(commands, target + literalStart,
+			position - matchBack - literalStart);
+		if (error == B_OK) {
+			error = write_copy_command(commands, matchOffset - matchBack,
+				matchSize + matchBack);
+		}
+		if (error != B_OK)
+			return error;
+
+		position += matchSize;
+		literalStart = position;
+		hashValid = false;
+	}
+
+	return write_add_command(commands, target + literalStart,
+		targetSize - literalStart);
+}
+
+
+static status_t
+apply_commands(const uint8* commands, size_t commandsSize, const uint8* base,
+	size_t baseSize, uint8* target, size_t targetSize)
+{
+	const uint8* commandsEnd = commands + commandsSize;
+	size_t position = 0;
+
+	while (commands < commandsEnd) {
+		switch (*commands++) {
+			case kCommandCopy:
+			{
+				if (commandsEnd - commands < 12)
+					return B_BAD_DATA;
+
+				uint64 offset;
+				uint32 size;
+				memcpy(&offset, commands, sizeof(offset));
+				memcpy(&size, commands + 8, sizeof(size));
+				offset = B_BENDIAN_TO_HOST_INT64(offset);
+				size = B_BENDIAN_TO_HOST_INT32(size);
+				commands += 12;
+
+				if (offset > baseSize || size > baseSize - offset
+					|| size > targetSize - position) {
+					return B_BAD_DATA;
+				}
+
+				memcpy(target + position, base + offset, size);
+				position += size;
+				break;
+			}
+
+			case kCommandAdd:
+			{
+				if (commandsEnd - commands < 4)
+					return B_BAD_DATA;
+
+				uint32 size;
+				memcpy(&size, commands, sizeof(size));
+				size = B_BENDIAN_TO_HOST_INT32(size);
+				commands += 4;
+
+				if (size > (size_t)(commandsEnd - commands)
+					|| size > targetSize - position) {
+					return B_BAD_DATA;
+				}
+
+				memcpy(target + position, commands, size);
+				commands += size;
+				position += size;
+				break;
+			}
+
+			default:
+				return B_BAD_DATA;
+		}
+	}
+
+	return position == targetSize ? B_OK : B_BAD_DATA;
+}
+
+
+// #pragma mark - RepositoryDelta
+
+
+/*!	Creates a delta that turns \a baseFile into \a targetFile and writes it to
+	\a deltaFile.
+	Fails with B_NOT_SUPPORTED, if the target's heap can't be reproduced by
+	recompressing it, e.g. when it was written with a compression library
+	version that behaves differently, or with a compression dictionary.
+*/
+/*static*/ status_t
+RepositoryDelta::Create(BErrorOutput* errorOutput, BPositionIO* baseFile,
+	BPositionIO* targetFile, BDataIO* deltaFile)
+{
+	RepositoryHeap base;
+	status_t error = base.Read(errorOutput, baseFile);
+	if (error != B_OK)
+		return error;
+
+	RepositoryHeap target;
+	error = target.Read(errorOutput, targetFile);
+	if (error != B_OK)
+		return error;
+
+	error = check_target_compression(errorOutput, target.header);
+	if (error != B_OK)
+		return error;
+
+	// read the complete target file for comparison
+	off_t targetFileSize;
+	error = targetFile->GetSize(&targetFileSize);
+	if (error != B_OK)
+		return error;
+	if (targetFileSize > (off_t)kMaxHeapSize)
+		return B_NOT_SUPPORTED;
+
+	uint8* targetFileData = (uint8*)malloc(targetFileSize);
+	if (targetFileData == NULL)
+		return B_NO_MEMORY;
+	MemoryDeleter targetFileDataDeleter(targetFileData);
+
+	error = targetFile->ReadAtExactly(0, targetFileData, targetFileSize);
+	if (error != B_OK)
+		return error;
+
+	// Find the compression level that reproduces the target file. The
+	// default level is the most likely one, so start with that.
+	int32 compressionLevel = B_HPKG_COMPRESSION_LEVEL_BEST;
+	for (; compressionLevel >= B_HPKG_COMPRESSION_LEVEL_NONE;
+			compressionLevel--) {
+		BMallocIO output;
+		error = write_repository(errorOutput, target.header, target.data,
+			target.size, compressionLevel, &output);
+		if (error == B_BAD_DATA)
+			continue;
+		if (error != B_OK)
+			break;
+
+		if (output.BufferLength() == (size_t)targetFileSize
+			&& memcmp(output.Buffer(), targetFileData, targetFileSize) == 0) {
+			break;
+		}
+	}
+
+	if (compressionLevel < B_HPKG_COMPRESSION_LEVEL_NONE)
+		error = B_NOT_SUPPORTED;
+	if (error != B_OK) {
+		errorOutput->PrintError("Error: Failed to reproduce the target "
+			"repository file by recompressing its heap: %s\n",
+			strerror(error));
+		return error;
+	}
+
+	// compute the commands
+	BMallocIO commands;
+	error = compute_commands(base.data, base.size, target.data, target.size,
+		commands);
+	if (error != B_OK)
+		return error;
+
+	// verify them
+	{
+		uint8* heap = (uint8*)malloc(std::max(target.size, (size_t)1));
+		if (heap == NULL)
+			return B_NO_MEMORY;
+		MemoryDeleter heapDeleter(heap);
+
+		error = apply_commands((const uint8*)commands.Buffer(),
+			commands.BufferLength(), base.data, base.size, heap, target.size);
+		if (error != B_OK || memcmp(heap, target.data, target.size) != 0) {
+			errorOutput->PrintError("Error: The computed delta doesn't "
+				"reproduce the target repository's heap\n");
+			return B_ERROR;
+		}
+	}
+
+	// compress the commands, unless that doesn't help
+	size_t commandsSize = commands.BufferLength();
+	void* compressedCommands = malloc(std::max(commandsSize, (size_t)1));
+	if (compressedCommands == NULL)
+		return B_NO_MEMORY;
+	MemoryDeleter compressedCommandsDeleter(compressedCommands);
+
+	iovec input = { (void*)commands.Buffer(), commandsSize };
+	iovec output = { compressedCommands, commandsSize };
+	BZlibCompressionParameters compressionParameters(B_ZLIB_COMPRESSION_BEST);
+	uint16 commandsCompression = B_HPKG_COMPRESSION_ZLIB;
+	if (BZlibCompressionAlgorithm().CompressBuffer(input, output,
+			&compressionParameters) != B_OK
+		|| output.iov_len >= commandsSize) {
+		commandsCompression = B_HPKG_COMPRESSION_NONE;
+		output = input;
+	}
+
+	// compute the checksums
+	hpkg_repo_delta_header header;
+	memset(&header, 0, sizeof(header));
+
+	error = compute_checksum(baseFile, header.base_checksum);
+	if (error == B_OK)
+		error = compute_checksum(targetFile, header.target_checksum);
+	if (error != B_OK)
+		return error;
+
+	// write the delta
+	header.magic = B_HOST_TO_BENDIAN_INT32(B_HPKG_REPO_DELTA_MAGIC);
+	header.header_size = B_HOST_TO_BENDIAN_INT16((uint16)sizeof(header));
+	header.version = B_HOST_TO_BENDIAN_INT16(B_HPKG_REPO_DELTA_VERSION);
+	header.total_size = B_HOST_TO_BENDIAN_INT64(sizeof(header)
+		+ sizeof(hpkg_repo_header) + output.iov_len);
+	header.base_heap_size = B_HOST_TO_BENDIAN_INT64(base.size);
+	header.target_heap_size = B_HOST_TO_BENDIAN_INT64(target.size);
+	header.target_compression_level
+		= B_HOST_TO_BENDIAN_INT32(compressionLevel);
+	header.commands_compression
+		= B_HOST_TO_BENDIAN_INT16(commandsCompression);
+	header.commands_size_compressed = B_HOST_TO_BENDIAN_INT64(output.iov_len);
+	header.commands_size_uncompressed = B_HOST_TO_BENDIAN_INT64(commandsSize);
+
+	error = deltaFile->WriteExactly(&header, sizeof(header));
+	if (error == B_OK)
+		error = deltaFile->WriteExactly(&target.header, sizeof(target.header));
+	if (error == B_OK)
+		error = deltaFile->WriteExactly(output.iov_base, output.iov_len);
+	if (error != B_OK) {
+		errorOutput->PrintError("Error: Failed to write the delta: %s\n",
+			strerror(error));
+		return error;
+	}
+
+	return B_OK;
+}
+
+
+/*!	Applies the delta \a deltaFile to \a baseFile and writes the resulting
+	repository file to \a targetFile.
+	Fails with B_MISMATCHED_VALUES, if the delta doesn't apply to the base,
+	and with B_NOT_SUPPORTED, if the target uses dictionary compression. In
+	either case, the caller has to download the complete target file.
+*/
+/*static*/ status_t
+RepositoryDelta::Apply(BErrorOutput* errorOutput, BPositionIO* baseFile,
+	BPositionIO* deltaFile, BPositionIO* targetFile)
+{
+	// read and check the header
+	hpkg_repo_delta_header header;
+	status_t error = deltaFile->ReadAtExactly(0, &header, sizeof(header));
+	if (error != B_OK) {
+		errorOutput->PrintError("Error: Failed to read the delta header: "
+			"%s\n", strerror(error));
+		return error;
+	}
+
+	off_t deltaFileSize;
+	error = deltaFile->GetSize(&deltaFileSize);
+	if (error != B_OK)
+		return error;
+
+	uint64 baseHeapSize = B_BENDIAN_TO_HOST_INT64(header.base_heap_size);
+	uint64 targetHeapSize = B_BENDIAN_TO_HOST_INT64(header.target_heap_size);
+	uint32 compressionLevel
+		= B_BENDIAN_TO_HOST_INT32(header.target_compression_level);
+	uint16 commandsCompression
+		= B_BENDIAN_TO_HOST_INT16(header.commands_compression);
+	uint64 commandsCompressedSize
+		= B_BENDIAN_TO_HOST_INT64(header.commands_size_compressed);
+	uint64 commandsSize
+		= B_BENDIAN_TO_HOST_INT64(header.commands_size_uncompressed);
+
+	if (B_BENDIAN_TO_HOST_INT32(header.magic) != B_HPKG_REPO_DELTA_MAGIC
+		|| B_BENDIAN_TO_HOST_INT16(header.header_size) != sizeof(header)
+		|| B_BENDIAN_TO_HOST_INT16(header.version)
+			!= B_HPKG_REPO_DELTA_VERSION
+		|| B_BENDIAN_TO_HOST_INT64(header.total_size)
+			!= (uint64)deltaFileSize
+		|| baseHeapSize > kMaxHeapSize || targetHeapSize > kMaxHeapSize
+		|| compressionLevel > B_HPKG_COMPRESSION_LEVEL_BEST
+		|| commandsSize > 2 * kMaxHeapSize
+		|| commandsCompressedSize != (uint64)deltaFileSize - sizeof(header)
+			- sizeof(hpkg_repo_header)
+		|| (commandsCompression != B_HPKG_COMPRESSION_NONE
+			&& commandsCompression != B_HPKG_COMPRESSION_ZLIB)
+		|| (commandsCompression == B_HPKG_COMPRESSION_NONE
+			&& commandsCompressedSize != commandsSize)) {
+		errorOutput->PrintError("Error: Invalid repository delta file\n");
+		return B_BAD_DATA;
+	}
+
+	// check whether the delta is for the base
+	uint8 checksum[SHA_DIGEST_LENGTH];
+	error = compute_checksum(baseFile, checksum);
+	if (error != B_OK)
+		return error;
+	if (memcmp(checksum, header.base_checksum, sizeof(checksum)) != 0) {
+		errorOutput->PrintError("Error: The delta doesn't apply to the "
+			"repository file\n");
+		return B_MISMATCHED_VALUES;
+	}
+
+	RepositoryHeap base;
+	error = base.Read(errorOutput, baseFile);
+	if (error != B_OK)
+		return error;
+	if (base.size != baseHeapSize) {
+		errorOutput->PrintError("Error: The delta doesn't apply to the "
+			"repository file\n");
+		return B_MISMATCHED_VALUES;
+	}
+
+	hpkg_repo_header targetHeader;
+	error = deltaFile->ReadAtExactly(sizeof(header), &targetHeader,
+		sizeof(targetHeader));
+	if (error != B_OK)
+		return error;
+
+	error = check_target_compression(errorOutput, targetHeader);
+	if (error != B_OK)
+		return error;
+
+	// read the commands
+	void* commands = malloc(std::max(commandsSize, (uint64)1));
+	if (commands == NULL)
+		return B_NO_MEMORY;
+	MemoryDeleter commandsDeleter(commands);
+
+	if (commandsCompression == B_HPKG_COMPRESSION_NONE) {
+		error = deltaFile->ReadAtExactly(
+			sizeof(header) + sizeof(targetHeader), commands, commandsSize);
+	} else {
+		void* compressedCommands
+			= malloc(std::max(commandsCompressedSize, (uint64)1));
+		if (compressedCommands == NULL)
+			return B_NO_MEMORY;
+		MemoryDeleter compressedCommandsDeleter(compressedCommands);
+
+		error = deltaFile->ReadAtExactly(
+			sizeof(header) + sizeof(targetHeader), compressedCommands,
+			commandsCompressedSize);
+		if (error == B_OK) {
+			iovec input = { compressedCommands, commandsCompressedSize };
+			iovec output = { commands, commandsSize };
+			error = BZlibCompressionAlgorithm().DecompressBuffer(input,
+				output);
+			if (error == B_OK && output.iov_len != commandsSize)
+				error = B_BAD_DATA;
+		}
+	}
+	if (error != B_OK) {
+		errorOutput->PrintError("Error: Failed to read the delta commands: "
+			"%s\n", strerror(error));
+		return error;
+	}
+
+	// build the target heap
+	uint8* heap = (uint8*)malloc(std::max(targetHeapSize, (uint64)1));
+	if (heap == NULL)
+		return B_NO_MEMORY;
+	MemoryDeleter heapDeleter(heap);
+
+	error = apply_commands((const uint8*)commands, commandsSize, base.data,
+		base.size, heap, targetHeapSize);
+	if (error != B_OK) {
+		errorOutput->PrintError("Error: Invalid repository delta commands\n");
+		return error;
+	}
+
+	// write the target file and check that we got what we wanted
+	error = write_repository(errorOutput, targetHeader, heap, targetHeapSize,
+		compressionLevel, targetFile);
+	if (error == B_OK)
+		error = compute_checksum(targetFile, checksum);
+	if (error == B_OK
+		&& memcmp(checksum, header.target_checksum, sizeof(checksum)) != 0) {
+		error = B_BAD_DATA;
+	}
+	if (error != B_OK) {
+		errorOutput->PrintError("Error: Failed to reproduce the target "
+			"repository file: %s\n", strerror(error));
+		return error;
+	}
+
+	return B_OK;
+}
+
+
+}	// namespace BPrivate
+
+}	// namespace BHPKG
+
+}	// namespace BPackageKit
@@ -301,6 +301,8 @@ RepositoryWriterImpl::_Finish()
 	header.heap_size_compressed = B_HOST_TO_BENDIAN_INT64(compressedHeapSize);
 	header.heap_size_uncompressed = B_HOST_TO_BENDIAN_INT64(
 		fHeapWriter->UncompressedHeapSize());
+	header.heap_dictionary_size = B_HOST_TO_BENDIAN_INT32(
+		fHeapWriter->DictionarySize());
 
 	fListener->OnRepositoryDone(sizeof(header), infoLength,
 		fRepositoryInfo->LicenseNames().CountStrings(), fPackageCount,
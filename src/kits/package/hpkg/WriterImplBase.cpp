@@ -230,7 +230,9 @@ WriterImplBase::WriterImplBase(const char* fileType, BErrorOutput* errorOutput)
 	fParameters(),
 	fFile(NULL),
 	fOwnsFile(false),
-	fFinished(false)
+	fFinished(false),
+	fCompressionDictionary(NULL),
+	fCompressionDictionarySize(0)
 {
 }
 
@@ -243,6 +245,8 @@ WriterImplBase::~WriterImplBase()
 	delete fDecompressionAlgorithm;
 	delete fDecompressionParameters;
 
+	free(fCompressionDictionary);
+
 	if (fOwnsFile)
 		delete fFile;
 
@@ -262,6 +266,11 @@ WriterImplBase::Init(BPositionIO* file, bool keepFile, const char* fileName,
 	if (fPackageStringCache.Init() != B_OK)
 		throw std::bad_alloc();
 
+	// copy the dictionary, the writer may need it longer than the caller keeps
+	// it around
+	SetCompressionDictionary(parameters.CompressionDictionary(),
+		parameters.CompressionDictionarySize());
+
 	if (file == NULL) {
 		if (fileName == NULL)
 			return B_BAD_VALUE;
@@ -329,16 +338,22 @@ WriterImplBase::InitHeapReader(size_t headerSize)
 			}
 			break;
 		case B_HPKG_COMPRESSION_ZSTD:
+		case B_HPKG_COMPRESSION_ZSTD_DICTIONARY:
+		{
+			BZstdCompressionParameters* compressionParameters
+				= new(std::nothrow) BZstdCompressionParameters(
+					(fParameters.CompressionLevel() / float(B_HPKG_COMPRESSION_LEVEL_BEST))
+						* B_ZSTD_COMPRESSION_BEST);
 			compressionAlgorithm = CompressionAlgorithmOwner::Create(
 				new(std::nothrow) BZstdCompressionAlgorithm,
-				new(std::nothrow) BZstdCompressionParameters(
-					(fParameters.CompressionLevel() / float(B_HPKG_COMPRESSION_LEVEL_BEST))
-						* B_ZSTD_COMPRESSION_BEST));
+				compressionParameters);
 			compressionAlgorithmReference.SetTo(compressionAlgorithm, true);
 
+			BZstdDecompressionParameters* decompressionParameters
+				= new(std::nothrow) BZstdDecompressionParameters;
 			decompressionAlgorithm = DecompressionAlgorithmOwner::Create(
 				new(std::nothrow) BZstdCompressionAlgorithm,
-				new(std::nothrow) BZstdDecompressionParameters);
+				decompressionParameters);
 			decompressionAlgorithmReference.SetTo(decompressionAlgorithm, true);
 
 			if (compressionAlgorithm == NULL
@@ -349,7 +364,35 @@ WriterImplBase::InitHeapReader(size_t headerSize)
 				|| decompressionAlgorithm->parameters == NULL) {
 				throw std::bad_alloc();
 			}
+
+			if (fParameters.Compression() == B_HPKG_COMPRESSION_ZSTD_DICTIONARY) {
+				if (fCompressionDictionary == NULL) {
+					fErrorOutput->PrintError(
+						"Error: No compression dictionary specified\n");
+					return B_BAD_VALUE;
+				}
+				if (fCompressionDictionarySize
+						> B_HPKG_MAX_COMPRESSION_DICTIONARY_SIZE) {
+					fErrorOutput->PrintError("Error: The compression "
+						"dictionary is too large (max. %d bytes)\n",
+						B_HPKG_MAX_COMPRESSION_DICTIONARY_SIZE);
+					return B_BAD_VALUE;
+				}
+
+				status_t error = compressionParameters->SetDictionary(
+					fCompressionDictionary, fCompressionDictionarySize);
+				if (error == B_OK) {
+					error = decompressionParameters->SetDictionary(
+						fCompressionDictionary, fCompressionDictionarySize);
+				}
+				if (error != B_OK) {
+					fErrorOutput->PrintError("Error: Failed to load the "
+						"compression dictionary: %s\n", strerror(error));
+					return error;
+				}
+			}
 			break;
+		}
 		default:
 			fErrorOutput->PrintError("Error: Invalid heap compression\n");
 			return B_BAD_VALUE;
@@ -359,6 +402,13 @@ WriterImplBase::InitHeapReader(size_t headerSize)
 	fHeapWriter = new PackageFileHeapWriter(fErrorOutput, fFile, headerSize,
 		compressionAlgorithm, decompressionAlgorithm);
 	fHeapWriter->Init();
+	fHeapWriter->SetCompressionThreadCount(
+		fParameters.CompressionThreadCount());
+
+	if (fParameters.Compression() == B_HPKG_COMPRESSION_ZSTD_DICTIONARY) {
+		fHeapWriter->SetDictionary(fCompressionDictionary,
+			fCompressionDictionarySize);
+	}
 
 	return B_OK;
 }
@@ -371,6 +421,24 @@ WriterImplBase::SetCompression(uint32 compression)
 }
 
 
+void
+WriterImplBase::SetCompressionDictionary(const void* dictionary, size_t size)
+{
+	void* dictionaryCopy = NULL;
+	if (dictionary != NULL && size > 0) {
+		dictionaryCopy = malloc(size);
+		if (dictionaryCopy == NULL)
+			throw std::bad_alloc();
+		memcpy(dictionaryCopy, dictionary, size);
+	} else
+		size = 0;
+
+	free(fCompressionDictionary);
+	fCompressionDictionary = dictionaryCopy;
+	fCompressionDictionarySize = size;
+}
+
+
 void
 WriterImplBase::RegisterPackageInfo(PackageAttributeList& attributeList,
 	const BPackageInfo& packageInfo)
@@ -12,8 +12,10 @@
 
 #include <glob.h>
 
+#include <Autolock.h>
 #include <Catalog.h>
 #include <Directory.h>
+#include <StackOrHeapArray.h>
 #include <package/CommitTransactionResult.h>
 #include <package/DownloadFileRequest.h>
 #include <package/PackageRoster.h>
@@ -52,6 +54,44 @@ namespace BManager {
 namespace BPrivate {
 
 
+struct BPackageManager::DownloadItem {
+	BSolverPackage*	package;
+	BEntry			entry;
+	BString			url;
+	BPath			reusedPath;
+	bool			reusingDownload;
+	status_t		error;
+
+	DownloadItem(BSolverPackage* package, const BEntry& entry,
+		const BString& url)
+		:
+		package(package),
+		entry(entry),
+		url(url),
+		reusingDownload(false),
+		error(B_OK)
+	{
+	}
+};
+
+
+struct BPackageManager::DownloadQueue {
+	BPackageManager*	manager;
+	DownloadItemList&	items;
+	int32				nextItem;
+	int32				failed;
+
+	DownloadQueue(BPackageManager* manager, DownloadItemList& items)
+		:
+		manager(manager),
+		items(items),
+		nextItem(0),
+		failed(0)
+	{
+	}
+};
+
+
 // #pragma mark - BPackageManager
 
 
@@ -60,6 +100,8 @@ BPackageManager::BPackageManager(BPackageInstallationLocation location,
 	UserInteractionHandler* userInteractionHandler)
 	:
 	fDebugLevel(0),
+	fDownloadConcurrency(1),
+	fJobStateLock("package manager job state"),
 	fLocation(location),
 	fSolver(NULL),
 	fSystemRepository(new (std::nothrow) InstalledRepository("system",
@@ -156,6 +198,20 @@ BPackageManager::SetDebugLevel(int32 level)
 }
 
 
+/*!	Sets how many packages may be downloaded at the same time. The default
+	is 1. With more than one, the UserInteractionHandler's download and
+	checksum progress hooks are called from several threads, although never
+	concurrently, and the calls for different packages may interleave.
+	DownloadPackage() on the other hand is called concurrently, so a subclass
+	that overrides it must only enable this if its version is thread safe.
+*/
+void
+BPackageManager::SetDownloadConcurrency(int32 concurrency)
+{
+	fDownloadConcurrency = max_c(concurrency, 1);
+}
+
+
 void
 BPackageManager::Install(const char* const* packages, int packageCount)
 {
@@ -379,6 +435,8 @@ BPackageManager::InstallationRepository()
 void
 BPackageManager::JobStarted(BSupportKit::BJob* job)
 {
+	BAutolock locker(fJobStateLock);
+
 	if (dynamic_cast<FetchFileJob*>(job) != NULL) {
 		FetchFileJob* fetchJob = (FetchFileJob*)job;
 		fUserInteractionHandler->ProgressPackageDownloadStarted(
@@ -393,6 +451,8 @@ BPackageManager::JobStarted(BSupportKit::BJob* job)
 void
 BPackageManager::JobProgress(BSupportKit::BJob* job)
 {
+	BAutolock locker(fJobStateLock);
+
 	if (dynamic_cast<FetchFileJob*>(job) != NULL) {
 		FetchFileJob* fetchJob = (FetchFileJob*)job;
 		fUserInteractionHandler->ProgressPackageDownloadActive(
@@ -405,6 +465,8 @@ BPackageManager::JobProgress(BSupportKit::BJob* job)
 void
 BPackageManager::JobSucceeded(BSupportKit::BJob* job)
 {
+	BAutolock locker(fJobStateLock);
+
 	if (dynamic_cast<FetchFileJob*>(job) != NULL) {
 		FetchFileJob* fetchJob = (FetchFileJob*)job;
 		fUserInteractionHandler->ProgressPackageDownloadComplete(
@@ -547,7 +609,8 @@ BPackageManager::_PreparePackageChanges(
 	if (error != B_OK)
 		DIE(error, "Failed to create transaction");
 
-	// download the new packages and prepare the transaction
+	// prepare the transaction and collect the packages to download
+	DownloadItemList downloads(20);
 	for (int32 i = 0; BSolverPackage* package = packagesToActivate.ItemAt(i);
 		i++) {
 		// get package URL and target entry
@@ -564,7 +627,16 @@ BPackageManager::_PreparePackageChanges(
 		RemoteRepository* remoteRepository
 			= dynamic_cast<RemoteRepository*>(package->Repository());
 		if (remoteRepository != NULL) {
-			bool reusingDownload = false;
+			// queue the package for download (this will resume the download
+			// if the file already exists)
+			BString url = remoteRepository->Config().PackagesURL();
+			url << '/' << fileName;
+
+			DownloadItem* item = new DownloadItem(package, entry, url);
+			if (!downloads.AddItem(item)) {
+				delete item;
+				throw std::bad_alloc();
+			}
 
 			// Check for matching files in already existing transaction
 			// directories
@@ -593,7 +665,8 @@ BPackageManager::_PreparePackageChanges(
 					path.Append(fileName);
 					if (bestFile != NULL && BCopyEngine().CopyEntry(bestFile,
 						path.Path()) == B_OK) {
-						reusingDownload = true;
+						item->reusedPath = path;
+						item->reusingDownload = true;
 						printf("Re-using download '%s' from previous "
 							"transaction%s\n", bestFile,
 							FetchUtils::IsDownloadCompleted(
@@ -602,34 +675,6 @@ BPackageManager::_PreparePackageChanges(
 					globfree(&globbuf);
 				}
 			}
-
-			// download the package (this will resume the download if the
-			// file already exists)
-			BString url = remoteRepository->Config().PackagesURL();
-			url << '/' << fileName;
-
-			status_t error;
-retryDownload:
-			error = DownloadPackage(url, entry,
-				package->Info().Checksum());
-			if (error != B_OK) {
-				if (error == B_BAD_DATA || error == ERANGE) {
-					// B_BAD_DATA is returned when there is a checksum
-					// mismatch. Make sure this download is not re-used.
-					entry.Remove();
-
-					if (reusingDownload) {
-						// Maybe the download we reused had some problem.
-						// Try again, this time without reusing the download.
-						printf("\nPrevious download '%s' was invalid. Redownloading.\n",
-							path.Path());
-						reusingDownload = false;
-						goto retryDownload;
-					}
-				}
-				DIE(error, "Failed to download package %s",
-					package->Info().Name().String());
-			}
 		} else if (package->Repository() != &installationRepository) {
 			// clone the existing package
 			LocalRepository* localRepository
@@ -648,6 +693,9 @@ retryDownload:
 		}
 	}
 
+	// download the new packages
+	_DownloadPackages(downloads);
+
 	for (int32 i = 0; BSolverPackage* package = packagesToDeactivate.ItemAt(i);
 		i++) {
 		// add package to transaction
@@ -659,6 +707,115 @@ retryDownload:
 }
 
 
+/*!	Downloads the given packages, using up to fDownloadConcurrency threads
+	(including the calling one). Dies with the error of the first package that
+	failed to download.
+*/
+void
+BPackageManager::_DownloadPackages(DownloadItemList& items)
+{
+	int32 itemCount = items.CountItems();
+	if (itemCount == 0)
+		return;
+
+	DownloadQueue queue(this, items);
+
+	int32 threadCount = min_c(fDownloadConcurrency, itemCount) - 1;
+	BStackOrHeapArray<thread_id, 8> threads(max_c(threadCount, 1));
+	if (!threads.IsValid())
+		throw std::bad_alloc();
+
+	int32 threadsStarted = 0;
+	for (int32 i = 0; i < threadCount; i++) {
+		thread_id thread = spawn_thread(&_DownloadThreadEntry,
+			"package download", B_NORMAL_PRIORITY, &queue);
+		if (thread < 0)
+			break;
+		threads[threadsStarted++] = thread;
+		resume_thread(thread);
+	}
+
+	_DownloadQueuedPackages(queue);
+
+	for (int32 i = 0; i < threadsStarted; i++)
+		wait_for_thread(threads[i], NULL);
+
+	for (int32 i = 0; DownloadItem* item = items.ItemAt(i); i++) {
+		if (item->error != B_OK) {
+			DIE(item->error, "Failed to download package %s",
+				item->package->Info().Name().String());
+		}
+	}
+}
+
+
+/*static*/ status_t
+BPackageManager::_DownloadThreadEntry(void* data)
+{
+	DownloadQueue* queue = (DownloadQueue*)data;
+	queue->manager->_DownloadQueuedPackages(*queue);
+	return B_OK;
+}
+
+
+void
+BPackageManager::_DownloadQueuedPackages(DownloadQueue& queue)
+{
+	int32 itemCount = queue.items.CountItems();
+	while (atomic_get(&queue.failed) == 0) {
+		int32 index = atomic_add(&queue.nextItem, 1);
+		if (index >= itemCount)
+			break;
+
+		DownloadItem* item = queue.items.ItemAt(index);
+		item->error = _DownloadPackage(*item);
+		if (item->error != B_OK) {
+			// don't start any further downloads
+			atomic_set(&queue.failed, 1);
+		}
+	}
+}
+
+
+/*!	Downloads a single package. May be called from any download thread, so
+	errors are returned rather than thrown.
+*/
+status_t
+BPackageManager::_DownloadPackage(DownloadItem& item)
+{
+	while (true) {
+		status_t error;
+		try {
+			error = DownloadPackage(item.url, item.entry,
+				item.package->Info().Checksum());
+		} catch (BFatalErrorException& exception) {
+			error = exception.Error();
+		} catch (std::bad_alloc&) {
+			error = B_NO_MEMORY;
+		} catch (...) {
+			error = B_ERROR;
+		}
+
+		if (error == B_BAD_DATA || error == ERANGE) {
+			// B_BAD_DATA is returned when there is a checksum
+			// mismatch. Make sure this download is not re-used.
+			item.entry.Remove();
+
+			if (item.reusingDownload) {
+				// Maybe the download we reused had some problem.
+				// Try again, this time without reusing the download.
+				printf("\nPrevious download '%s' was invalid. Redownloading.\n",
+					item.reusedPath.Path());
+				item.reusingDownload = false;
+				continue;
+			}
+		}
+
+		return error;
+	}
+}
+
+
 void
 BPackageManager::_CommitPackageChanges(Transaction& transaction)
 {
@@ -873,6 +1030,10 @@ BPackageManager::_NextSpecificInstallationLocation()
 }
 
 
+/*!	Downloads a package file and verifies its checksum. If more than one
+	download may run at the same time (cf. SetDownloadConcurrency()), this
+	method is called from several threads concurrently.
+*/
 status_t
 BPackageManager::DownloadPackage(const BString& fileURL,
 	const BEntry& targetEntry, const BString& checksum)
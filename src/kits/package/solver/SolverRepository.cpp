@@ -28,7 +28,8 @@ BSolverRepository::BSolverRepository()
 	fPriority(0),
 	fIsInstalled(false),
 	fPackages(kInitialPackageListSize),
-	fChangeCount(0)
+	fChangeCount(0),
+	fRepositoryCacheEntry()
 {
 }
 
@@ -39,7 +40,8 @@ BSolverRepository::BSolverRepository(const BString& name)
 	fPriority(0),
 	fIsInstalled(false),
 	fPackages(kInitialPackageListSize),
-	fChangeCount(0)
+	fChangeCount(0),
+	fRepositoryCacheEntry()
 {
 	SetTo(name);
 }
@@ -51,7 +53,8 @@ BSolverRepository::BSolverRepository(BPackageInstallationLocation location)
 	fPriority(0),
 	fIsInstalled(false),
 	fPackages(kInitialPackageListSize),
-	fChangeCount(0)
+	fChangeCount(0),
+	fRepositoryCacheEntry()
 {
 	SetTo(location);
 }
@@ -63,7 +66,8 @@ BSolverRepository::BSolverRepository(BAllInstallationLocations)
 	fPriority(0),
 	fIsInstalled(false),
 	fPackages(kInitialPackageListSize),
-	fChangeCount(0)
+	fChangeCount(0),
+	fRepositoryCacheEntry()
 {
 	SetTo(B_ALL_INSTALLATION_LOCATIONS);
 }
@@ -75,7 +79,8 @@ BSolverRepository::BSolverRepository(const BRepositoryConfig& config)
 	fPriority(0),
 	fIsInstalled(false),
 	fPackages(kInitialPackageListSize),
-	fChangeCount(0)
+	fChangeCount(0),
+	fRepositoryCacheEntry()
 {
 	SetTo(config);
 }
@@ -159,6 +164,7 @@ BSolverRepository::SetTo(const BRepositoryConfig& config)
 		}
 	}
 
+	fRepositoryCacheEntry = cache.Entry();
 	return B_OK;
 }
 
@@ -184,6 +190,7 @@ BSolverRepository::SetTo(const BRepositoryCache& cache)
 		}
 	}
 
+	fRepositoryCacheEntry = cache.Entry();
 	return B_OK;
 }
 
@@ -196,6 +203,7 @@ BSolverRepository::Unset()
 	fIsInstalled = false;
 	fPackages.MakeEmpty();
 	fChangeCount++;
+	fRepositoryCacheEntry.Unset();
 }
 
 
@@ -275,6 +283,7 @@ BSolverRepository::AddPackage(const BPackageInfo& info,
 	}
 
 	fChangeCount++;
+	fRepositoryCacheEntry.Unset();
 
 	if (_package != NULL)
 		*_package = package;
@@ -310,6 +319,7 @@ BSolverRepository::RemovePackage(BSolverPackage* package)
 		return false;
 
 	fChangeCount++;
+	fRepositoryCacheEntry.Unset();
 	return true;
 }
 
@@ -332,4 +342,16 @@ BSolverRepository::ChangeCount() const
 }
 
 
+/*!	Returns the repository cache file the packages have been loaded from, if
+	the repository has been set to one and the packages haven't been changed
+	since.
+	The solver uses it to cache its own representation of the packages.
+*/
+const BEntry&
+BSolverRepository::RepositoryCacheEntry() const
+{
+	return fRepositoryCacheEntry;
+}
+
+
 }	// namespace BPackageKit
@@ -10,7 +10,12 @@
 #include "LibsolvSolver.h"
 
 #include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include <sys/utsname.h>
+#include <unistd.h>
 
 #include <new>
 
@@ -18,9 +23,13 @@
 #include <solv/poolarch.h>
 #include <solv/repo.h>
 #include <solv/repo_haiku.h>
+#include <solv/repo_solv.h>
+#include <solv/repo_write.h>
 #include <solv/selection.h>
 #include <solv/solverdebug.h>
 
+#include <Path.h>
+
 #include <package/PackageResolvableExpression.h>
 #include <package/RepositoryCache.h>
 #include <package/solver/SolverPackage.h>
@@ -31,6 +40,7 @@
 #include <package/solver/SolverResult.h>
 
 #include <AutoDeleter.h>
+#include <AutoDeleterPosix.h>
 #include <ObjectList.h>
 
 
@@ -38,6 +48,56 @@
 // abort()s. Obviously that isn't good behavior for a library.
 
 
+// The libsolv representation of a repository's packages is cached in a file
+// next to the repository cache. It is only used while the stat data of the
+// repository cache still match the ones it was created from. The repository
+// cache is only ever replaced as a whole, so that is cheap and sufficient.
+static const char* const kSolvCacheSuffix = ".solv";
+static const uint32 kSolvCacheMagic = 'hslv';
+static const uint32 kSolvCacheVersion = 2;
+
+
+struct solv_cache_key {
+	uint64	device;
+	uint64	node;
+	uint64	size;
+	int64	modified_seconds;
+	int64	modified_nanoseconds;
+
+	bool operator==(const solv_cache_key& other) const
+	{
+		return device == other.device && node == other.node
+			&& size == other.size
+			&& modified_seconds == other.modified_seconds
+			&& modified_nanoseconds == other.modified_nanoseconds;
+	}
+};
+
+
+struct solv_cache_header {
+	uint32			magic;
+	uint32			version;
+	uint32			package_count;
+	uint32			reserved;
+	solv_cache_key	key;
+		// stat data of the repository cache file
+};
+
+
+static status_t
+get_solv_cache_path(const BEntry& repositoryCacheEntry, BString& _path)
+{
+	BPath path;
+	status_t error = repositoryCacheEntry.GetPath(&path);
+	if (error != B_OK)
+		return error;
+
+	_path = path.Path();
+	_path << kSolvCacheSuffix;
+	return B_OK;
+}
+
+
 BSolver*
 BPackageKit::create_solver()
 {
@@ -106,6 +166,26 @@ struct LibsolvSolver::RepositoryInfo {
 		fChangeCount = fRepository->ChangeCount();
 	}
 
+	status_t GetRepositoryCacheKey(solv_cache_key& _key) const
+	{
+		const BEntry& entry = fRepository->RepositoryCacheEntry();
+		if (entry.InitCheck() != B_OK)
+			return B_ENTRY_NOT_FOUND;
+
+		struct stat st;
+		status_t error = entry.GetStat(&st);
+		if (error != B_OK)
+			return error;
+
+		memset(&_key, 0, sizeof(_key));
+		_key.device = st.st_dev;
+		_key.node = st.st_ino;
+		_key.size = st.st_size;
+		_key.modified_seconds = st.st_mtim.tv_sec;
+		_key.modified_nanoseconds = st.st_mtim.tv_nsec;
+		return B_OK;
+	}
+
 private:
 	BSolverRepository*	fRepository;
 	Repo*				fSolvRepo;
@@ -748,21 +828,19 @@ LibsolvSolver::_AddRepositories()
 		repo->priority = -1 - repository->Priority();
 		repo->appdata = (void*)repositoryInfo;
 
-		int32 packageCount = repository->CountPackages();
-		for (int32 k = 0; k < packageCount; k++) {
-			BSolverPackage* package = repository->PackageAt(k);
-			Id solvableId = repo_add_haiku_package_info(repo, package->Info(),
-				REPO_REUSE_REPODATA | REPO_NO_INTERNALIZE);
+		// Use the cached libsolv representation of the repository's packages,
+		// if it is still up-to-date, otherwise create and cache it.
+		solv_cache_key key;
+		bool haveKey = repositoryInfo->GetRepositoryCacheKey(key) == B_OK;
 
-			try {
-				fSolvablePackages[solvableId] = package;
-				fPackageSolvables[package] = solvableId;
-			} catch (std::bad_alloc&) {
-				return B_NO_MEMORY;
-			}
-		}
+		if (!haveKey || !_LoadSolvCache(repositoryInfo, key)) {
+			error = _AddRepositoryPackages(repositoryInfo);
+			if (error != B_OK)
+				return error;
 
-		repo_internalize(repo);
+			if (haveKey)
+				_WriteSolvCache(repositoryInfo, key);
+		}
 
 		if (repository->IsInstalled()) {
 			fInstalledRepository = repositoryInfo;
@@ -779,6 +857,156 @@ LibsolvSolver::_AddRepositories()
 }
 
 
+status_t
+LibsolvSolver::_AddRepositoryPackages(RepositoryInfo* repositoryInfo)
+{
+	BSolverRepository* repository = repositoryInfo->Repository();
+	Repo* repo = repositoryInfo->SolvRepo();
+
+	int32 packageCount = repository->CountPackages();
+	for (int32 i = 0; i < packageCount; i++) {
+		BSolverPackage* package = repository->PackageAt(i);
+		Id solvableId = repo_add_haiku_package_info(repo, package->Info(),
+			REPO_REUSE_REPODATA | REPO_NO_INTERNALIZE);
+
+		try {
+			fSolvablePackages[solvableId] = package;
+			fPackageSolvables[package] = solvableId;
+		} catch (std::bad_alloc&) {
+			return B_NO_MEMORY;
+		}
+	}
+
+	repo_internalize(repo);
+	return B_OK;
+}
+
+
+/*!	Adds the repository's packages from its solv cache file, if the file
+	was created from the repository cache with the given key. The solvables in the
+	file are in the same order as the repository's packages.
+*/
+bool
+LibsolvSolver::_LoadSolvCache(RepositoryInfo* repositoryInfo,
+	const solv_cache_key& key)
+{
+	BSolverRepository* repository = repositoryInfo->Repository();
+	Repo* repo = repositoryInfo->SolvRepo();
+
+	BString path;
+	if (get_solv_cache_path(repository->RepositoryCacheEntry(), path) != B_OK)
+		return false;
+
+	FileDescriptorCloser fd(open(path.String(), O_RDONLY));
+	if (!fd.IsSet())
+		return false;
+
+	struct stat st;
+	if (fstat(fd.Get(), &st) != 0
+		|| st.st_size <= (off_t)sizeof(solv_cache_header)) {
+		return false;
+	}
+
+	void* data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd.Get(), 0);
+	if (data == MAP_FAILED)
+		return false;
+
+	const solv_cache_header* header = (const solv_cache_header*)data;
+	int32 packageCount = repository->CountPackages();
+	bool matches = header->magic == kSolvCacheMagic
+		&& header->version == kSolvCacheVersion
+		&& header->package_count == (uint32)packageCount
+		&& header->key == key;
+
+	int result = -1;
+	if (matches) {
+		FILE* file = fmemopen((uint8*)data + sizeof(solv_cache_header),
+			st.st_size - sizeof(solv_cache_header), "r");
+		if (file != NULL) {
+			result = repo_add_solv(repo, file, 0);
+			fclose(file);
+		}
+	}
+
+	munmap(data, st.st_size);
+
+	if (result != 0 || repo->nsolvables != packageCount) {
+		repo_empty(repo, 1);
+		return false;
+	}
+
+	// check the solvables against the packages before mapping them
+	int32 index = 0;
+	Id solvableId;
+	Solvable* solvable;
+	FOR_REPO_SOLVABLES(repo, solvableId, solvable) {
+		BSolverPackage* package = repository->PackageAt(index++);
+		if (package == NULL
+			|| package->Name() != pool_id2str(fPool, solvable->name)) {
+			repo_empty(repo, 1);
+			return false;
+		}
+	}
+
+	index = 0;
+	FOR_REPO_SOLVABLES(repo, solvableId, solvable) {
+		BSolverPackage* package = repository->PackageAt(index++);
+		try {
+			fSolvablePackages[solvableId] = package;
+			fPackageSolvables[package] = solvableId;
+		} catch (std::bad_alloc&) {
+			// the caller will add the packages the normal way
+			for (int32 i = 0; i < index; i++) {
+				fSolvablePackages.erase(repo->start + i);
+				fPackageSolvables.erase(repository->PackageAt(i));
+			}
+			repo_empty(repo, 1);
+			return false;
+		}
+	}
+
+	return true;
+}
+
+
+/*!	Writes the libsolv representation of the repository's packages to its
+	solv cache file. Failing to do so is not an error, the file is just a
+	cache.
+*/
+void
+LibsolvSolver::_WriteSolvCache(RepositoryInfo* repositoryInfo,
+	const solv_cache_key& key)
+{
+	BSolverRepository* repository = repositoryInfo->Repository();
+
+	BString path;
+	if (get_solv_cache_path(repository->RepositoryCacheEntry(), path) != B_OK)
+		return;
+
+	// write to a temporary file first, so no one reads an incomplete file
+	BString tempPath(path);
+	tempPath << ".new";
+
+	FILE* file = fopen(tempPath.String(), "w");
+	if (file == NULL)
+		return;
+
+	solv_cache_header header;
+	memset(&header, 0, sizeof(header));
+	header.magic = kSolvCacheMagic;
+	header.version = kSolvCacheVersion;
+	header.package_count = repository->CountPackages();
+	header.key = key;
+
+	bool success = fwrite(&header, sizeof(header), 1, file) == 1
+		&& repo_write(repositoryInfo->SolvRepo(), file) == 0;
+	success = fclose(file) == 0 && success;
+
+	if (!success || rename(tempPath.String(), path.String()) != 0)
+		unlink(tempPath.String());
+}
+
+
 LibsolvSolver::RepositoryInfo*
 LibsolvSolver::_InstalledRepository() const
 {
@@ -24,6 +24,8 @@ namespace BPackageKit {
 	class BSolverPackage;
 }
 
+struct solv_cache_key;
+
 
 class LibsolvSolver : public BSolver {
 public:
@@ -95,6 +97,13 @@ private:
 
 			bool				_HaveRepositoriesChanged() const;
 			status_t			_AddRepositories();
+			status_t			_AddRepositoryPackages(
+									RepositoryInfo* repositoryInfo);
+			bool				_LoadSolvCache(RepositoryInfo* repositoryInfo,
+									const solv_cache_key& key);
+			void				_WriteSolvCache(
+									RepositoryInfo* repositoryInfo,
+									const solv_cache_key& key);
 			RepositoryInfo*		_InstalledRepository() const;
 			RepositoryInfo*		_GetRepositoryInfo(
 									BSolverRepository* repository) const;
@@ -69,7 +69,7 @@ watch_node(const node_ref* node, uint32 flags, BMessenger target)
 	// mount watching
 	if (flags & B_WATCH_MOUNT) {
 		status_t status = _kern_start_watching((dev_t)-1, (ino_t)-1,
-			B_WATCH_MOUNT, port, token);
+			B_WATCH_MOUNT | (flags & B_WATCH_COALESCE), port, token);
 		if (status < B_OK)
 			return status;
 
@@ -77,7 +77,7 @@ watch_node(const node_ref* node, uint32 flags, BMessenger target)
 	}
 
 	// node watching
-	if (flags != 0) {
+	if ((flags & ~B_WATCH_COALESCE) != 0) {
 		if (node == NULL)
 			return B_BAD_VALUE;
 
@@ -42,7 +42,8 @@ BQuery::BQuery()
 	fLive(false),
 	fPort(B_ERROR),
 	fToken(0),
-	fQueryFd(-1)
+	fQueryFd(-1),
+	fFlags(0)
 {
 }
 
@@ -74,6 +75,7 @@ BQuery::Clear()
 	fLive = false;
 	fPort = B_ERROR;
 	fToken = 0;
+	fFlags = 0;
 	return error;
 }
 
@@ -232,6 +234,18 @@ BQuery::SetTarget(BMessenger messenger)
 }
 
 
+// Sets additional flags for opening the query.
+status_t
+BQuery::SetFlags(uint32 flags)
+{
+	if (_HasFetched())
+		return B_NOT_ALLOWED;
+
+	fFlags = flags;
+	return B_OK;
+}
+
+
 // Gets whether the query associated with this object is live.
 bool
 BQuery::IsLive() const
@@ -240,6 +254,14 @@ BQuery::IsLive() const
 }
 
 
+// Gets the flags set with SetFlags().
+uint32
+BQuery::Flags() const
+{
+	return fFlags;
+}
+
+
 // Fills out buffer with the predicate string assigned to the BQuery object.
 status_t
 BQuery::GetPredicate(char* buffer, size_t length)
@@ -311,7 +333,8 @@ BQuery::Fetch()
 	_ParseDates(parsedPredicate);
 
 	fQueryFd = _kern_open_query(fDevice, parsedPredicate.String(),
-		parsedPredicate.Length(), fLive ? B_LIVE_QUERY : 0, fPort, fToken);
+		parsedPredicate.Length(), (fLive ? B_LIVE_QUERY : 0) | fFlags, fPort,
+		fToken);
 	if (fQueryFd < 0)
 		return fQueryFd;
 
@@ -50,13 +50,17 @@ BZstdCompressionParameters::BZstdCompressionParameters(
 	:
 	BCompressionParameters(),
 	fCompressionLevel(compressionLevel),
-	fBufferSize(kDefaultBufferSize)
+	fBufferSize(kDefaultBufferSize),
+	fDictionary(NULL)
 {
 }
 
 
 BZstdCompressionParameters::~BZstdCompressionParameters()
 {
+#ifdef B_ZSTD_COMPRESSION_SUPPORT
+	ZSTD_freeCDict(fDictionary);
+#endif
 }
 
 
@@ -88,19 +92,43 @@ BZstdCompressionParameters::SetBufferSize(size_t size)
 }
 
 
+status_t
+BZstdCompressionParameters::SetDictionary(const void* dictionary, size_t size)
+{
+#ifdef B_ZSTD_COMPRESSION_SUPPORT
+	ZSTD_CDict* newDictionary = NULL;
+	if (dictionary != NULL && size > 0) {
+		newDictionary = ZSTD_createCDict(dictionary, size, fCompressionLevel);
+		if (newDictionary == NULL)
+			return B_NO_MEMORY;
+	}
+
+	ZSTD_freeCDict(fDictionary);
+	fDictionary = newDictionary;
+	return B_OK;
+#else
+	return B_NOT_SUPPORTED;
+#endif
+}
+
+
 // #pragma mark - BZstdDecompressionParameters
 
 
 BZstdDecompressionParameters::BZstdDecompressionParameters()
 	:
 	BDecompressionParameters(),
-	fBufferSize(kDefaultBufferSize)
+	fBufferSize(kDefaultBufferSize),
+	fDictionary(NULL)
 {
 }
 
 
 BZstdDecompressionParameters::~BZstdDecompressionParameters()
 {
+#ifdef ZSTD_ENABLED
+	ZSTD_freeDDict(fDictionary);
+#endif
 }
 
 
@@ -118,6 +146,27 @@ BZstdDecompressionParameters::SetBufferSize(size_t size)
 }
 
 
+status_t
+BZstdDecompressionParameters::SetDictionary(const void* dictionary,
+	size_t size)
+{
+#ifdef ZSTD_ENABLED
+	ZSTD_DDict* newDictionary = NULL;
+	if (dictionary != NULL && size > 0) {
+		newDictionary = ZSTD_createDDict(dictionary, size);
+		if (newDictionary == NULL)
+			return B_NO_MEMORY;
+	}
+
+	ZSTD_freeDDict(fDictionary);
+	fDictionary = newDictionary;
+	return B_OK;
+#else
+	return B_NOT_SUPPORTED;
+#endif
+}
+
+
 // #pragma mark - CompressionStrategy
 
 
@@ -138,7 +187,12 @@ struct BZstdCompressionAlgorithm::CompressionStrategy {
 		}
 
 		*stream = ZSTD_createCStream();
-		return ZSTD_initCStream(*stream, compressionLevel);
+		size_t zstdError = ZSTD_initCStream(*stream, compressionLevel);
+		if (!ZSTD_isError(zstdError) && parameters != NULL
+			&& parameters->Dictionary() != NULL) {
+			zstdError = ZSTD_CCtx_refCDict(*stream, parameters->Dictionary());
+		}
+		return zstdError;
 	}
 
 	static void Uninit(ZSTD_CStream *stream)
@@ -172,10 +226,15 @@ struct BZstdCompressionAlgorithm::DecompressionStrategy {
 	static const bool kNeedsFinalFlush = false;
 
 	static size_t Init(ZSTD_DStream **stream,
-		const BZstdDecompressionParameters* /*parameters*/)
+		const BZstdDecompressionParameters* parameters)
 	{
 		*stream = ZSTD_createDStream();
-		return ZSTD_initDStream(*stream);
+		size_t zstdError = ZSTD_initDStream(*stream);
+		if (!ZSTD_isError(zstdError) && parameters != NULL
+			&& parameters->Dictionary() != NULL) {
+			zstdError = ZSTD_DCtx_refDDict(*stream, parameters->Dictionary());
+		}
+		return zstdError;
 	}
 
 	static void Uninit(ZSTD_DStream *stream)
@@ -379,8 +438,20 @@ BZstdCompressionAlgorithm::CompressBuffer(const iovec& input, iovec& output,
 		? zstdParameters->CompressionLevel()
 		: B_ZSTD_COMPRESSION_DEFAULT;
 
-	size_t zstdError = ZSTD_compress(output.iov_base, output.iov_len,
-		input.iov_base, input.iov_len, compressionLevel);
+	size_t zstdError;
+	if (zstdParameters != NULL && zstdParameters->Dictionary() != NULL) {
+		ZSTD_CCtx* cctx = ZSTD_createCCtx();
+		if (cctx == NULL)
+			return B_NO_MEMORY;
+		CObjectDeleter<ZSTD_CCtx, size_t, ZSTD_freeCCtx> cctxDeleter(cctx);
+
+		zstdError = ZSTD_compress_usingCDict(cctx,
+			output.iov_base, output.iov_len,
+			input.iov_base, input.iov_len, zstdParameters->Dictionary());
+	} else {
+		zstdError = ZSTD_compress(output.iov_base, output.iov_len,
+			input.iov_base, input.iov_len, compressionLevel);
+	}
 	if (ZSTD_isError(zstdError))
 		return _TranslateZstdError(zstdError);
 
@@ -397,6 +468,13 @@ BZstdCompressionAlgorithm::DecompressBuffer(const iovec& input, iovec& output,
 	const BDecompressionParameters* parameters, iovec* scratch)
 {
 #ifdef ZSTD_ENABLED
+	const BZstdDecompressionParameters* zstdParameters
+#ifdef _BOOT_MODE
+		= static_cast<const BZstdDecompressionParameters*>(parameters);
+#else
+		= dynamic_cast<const BZstdDecompressionParameters*>(parameters);
+#endif
+
 	ZSTD_DCtx* dctx;
 	CObjectDeleter<ZSTD_DCtx, size_t, ZSTD_freeDCtx> dctxDeleter;
 #if defined(ZSTD_STATIC_LINKING_ONLY)
@@ -406,9 +484,16 @@ BZstdCompressionAlgorithm::DecompressBuffer(const iovec& input, iovec& output,
 #endif
 		dctxDeleter.SetTo(dctx = ZSTD_createDCtx());
 
-	size_t zstdError = ZSTD_decompressDCtx(dctx,
-		output.iov_base, output.iov_len,
-		input.iov_base, input.iov_len);
+	size_t zstdError;
+	if (zstdParameters != NULL && zstdParameters->Dictionary() != NULL) {
+		zstdError = ZSTD_decompress_usingDDict(dctx,
+			output.iov_base, output.iov_len,
+			input.iov_base, input.iov_len, zstdParameters->Dictionary());
+	} else {
+		zstdError = ZSTD_decompressDCtx(dctx,
+			output.iov_base, output.iov_len,
+			input.iov_base, input.iov_len);
+	}
 	if (ZSTD_isError(zstdError))
 		return _TranslateZstdError(zstdError);
 
@@ -2944,6 +2944,14 @@ iflib_rxd_pkt_get(iflib_rxq_t rxq, if_rxd_info_t ri)
 	m->m_pkthdr.ether_vtag = ri->iri_vtag;
 	m->m_pkthdr.flowid = ri->iri_flowid;
 	M_HASHTYPE_SET(m, ri->iri_rsstype);
+#ifdef __HAIKU__
+	if (ri->iri_rsstype == M_HASHTYPE_NONE
+		&& rxq->ifr_ctx->ifc_softc_ctx.isc_nrxqsets > 1) {
+		/* Let the stack spread the packets like the receive queues do */
+		m->m_pkthdr.flowid = ri->iri_qsidx;
+		M_HASHTYPE_SET(m, M_HASHTYPE_OPAQUE);
+	}
+#endif
 	m->m_pkthdr.csum_flags = ri->iri_csum_flags;
 	m->m_pkthdr.csum_data = ri->iri_csum_data;
 	return (m);
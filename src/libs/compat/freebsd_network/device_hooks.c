@@ -109,9 +109,8 @@ compat_free(void *cookie)
 
 
 static status_t
-compat_receive(void *cookie, net_buffer **_buffer)
+compat_receive_etc(struct ifnet *ifp, net_buffer **_buffer, bool wait)
 {
-	struct ifnet *ifp = cookie;
 	uint32 semFlags = B_CAN_INTERRUPT;
 	status_t status;
 	struct mbuf *mb;
@@ -121,7 +120,7 @@ compat_receive(void *cookie, net_buffer **_buffer)
 	if ((ifp->flags & DEVICE_CLOSED) != 0)
 		return B_INTERRUPTED;
 
-	if (ifp->flags & DEVICE_NON_BLOCK)
+	if (!wait || (ifp->flags & DEVICE_NON_BLOCK) != 0)
 		semFlags |= B_RELATIVE_TIMEOUT;
 
 	do {
@@ -156,6 +155,11 @@ compat_receive(void *cookie, net_buffer **_buffer)
 		buffer->buffer_flags |= NET_BUFFER_L3_CHECKSUM_VALID;
 	if ((mb->m_pkthdr.csum_flags & CSUM_L4_VALID) != 0)
 		buffer->buffer_flags |= NET_BUFFER_L4_CHECKSUM_VALID;
+	if (M_HASHTYPE_GET(mb) != M_HASHTYPE_NONE) {
+		// the stack uses this to distribute the packets to its receive queues
+		buffer->flow_hash = mb->m_pkthdr.flowid;
+		buffer->buffer_flags |= NET_BUFFER_FLOW_HASH_VALID;
+	}
 
 	*_buffer = buffer;
 	m_freem(mb);
@@ -163,6 +167,36 @@ compat_receive(void *cookie, net_buffer **_buffer)
 }
 
 
+static status_t
+compat_receive(void *cookie, net_buffer **_buffer)
+{
+	return compat_receive_etc((struct ifnet *)cookie, _buffer, true);
+}
+
+
+/*!	Waits for the first buffer only, and then collects all other buffers that
+	are already queued, so that a burst of packets costs only one wake-up of
+	the reader.
+*/
+static status_t
+compat_receive_buffers(void *cookie, ether_receive_net_buffers_t *request)
+{
+	struct ifnet *ifp = cookie;
+	uint32 count = 0;
+	status_t status = B_OK;
+
+	while (count < request->count) {
+		status = compat_receive_etc(ifp, &request->buffers[count], count == 0);
+		if (status != B_OK)
+			break;
+		count++;
+	}
+
+	request->count = count;
+	return count > 0 ? B_OK : status;
+}
+
+
 static status_t
 compat_send(void *cookie, net_buffer *buffer)
 {
@@ -346,6 +380,14 @@ compat_control(void *cookie, uint32 op, void *arg, size_t length)
 				return B_BAD_ADDRESS;
 			return compat_receive(cookie, (net_buffer**)arg);
 
+		case ETHER_RECEIVE_NET_BUFFERS:
+			if (arg == NULL || length < sizeof(ether_receive_net_buffers_t))
+				return B_BAD_DATA;
+			if (!IS_KERNEL_ADDRESS(arg))
+				return B_BAD_ADDRESS;
+			return compat_receive_buffers(cookie,
+				(ether_receive_net_buffers_t*)arg);
+
 		case SIOCGIFSTATS:
 		{
 			struct ifreq_stats stats;
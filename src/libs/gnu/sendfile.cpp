@@ -0,0 +1,28 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+#include <sys/sendfile.h>
+
+#include <errno.h>
+#include <pthread.h>
+
+#include <syscall_utils.h>
+#include <syscalls.h>
+
+
+ssize_t
+sendfile(int outFD, int inFD, off_t* offset, size_t count)
+{
+	// without an offset, the file position is used and updated
+	if (offset == NULL)
+		RETURN_AND_SET_ERRNO_TEST_CANCEL(_kern_sendfile(outFD, inFD, -1, count));
+
+	ssize_t bytesSent = _kern_sendfile(outFD, inFD, *offset, count);
+	if (bytesSent > 0)
+		*offset += bytesSent;
+
+	RETURN_AND_SET_ERRNO_TEST_CANCEL(bytesSent);
+}
@@ -127,6 +127,10 @@ CommitTransactionHandler::CommitTransactionHandler(Volume* volume,
 	fOldStateDirectoryName(),
 	fTransactionDirectoryRef(),
 	fFirstBootProcessing(false),
+	fPackagesDirectory(),
+	fPackagesToDeactivateMoves(),
+	fPackagesToActivateMoves(),
+	fRootDirectory(),
 	fWritableFilesDirectory(),
 	fAddedGroups(),
 	fAddedUsers(),
@@ -413,8 +417,16 @@ CommitTransactionHandler::_ReadPackagesToActivate(
 void
 CommitTransactionHandler::_ApplyChanges()
 {
+	bigtime_t startTime = system_time();
+	int32 activatedCount = fPackagesToActivate.CountItems();
+	size_t deactivatedCount = fPackagesToDeactivate.size();
+
 	if (!fFirstBootProcessing)
 	{
+		// resolve the entries of all packages to move, before anything is
+		// changed
+		_PlanPackageMoves();
+
 		// create an old state directory
 		_CreateOldStateDirectory();
 
@@ -424,6 +436,9 @@ CommitTransactionHandler::_ApplyChanges()
 		// move packages to activate to packages directory
 		_AddPackagesToActivate();
 
+		// create users, groups, and writable files for the new packages
+		_PreparePackagesToActivate();
+
 		// run pre-uninstall scripts, before their packages vanish.
 		_RunPreUninstallScripts();
 
@@ -446,6 +461,12 @@ CommitTransactionHandler::_ApplyChanges()
 	fRemovedPackages.clear();
 	fPackagesToActivate.MakeEmpty(false);
 	fPackagesToDeactivate.clear();
+	fPackagesToActivateMoves.clear();
+	fPackagesToDeactivateMoves.clear();
+
+	INFORM("CommitTransactionHandler::_ApplyChanges(): activated %" B_PRId32
+		", deactivated %zu packages in %" B_PRId64 " us\n", activatedCount,
+		deactivatedCount, system_time() - startTime);
 }
 
 
@@ -533,31 +554,75 @@ CommitTransactionHandler::_CreateOldStateDirectory()
 }
 
 
+/*!	Resolves the entries of all package files that have to be moved and
+	checks that they exist. Since nothing has been changed at that point, a
+	problem with any of the packages fails the transaction without having to
+	revert anything. The moves themselves are done afterwards in one go by
+	_RemovePackagesToDeactivate() and _AddPackagesToActivate().
+*/
 void
-CommitTransactionHandler::_RemovePackagesToDeactivate()
+CommitTransactionHandler::_PlanPackageMoves()
 {
-	if (fPackagesToDeactivate.empty())
-		return;
+	fPackagesToDeactivateMoves.clear();
+	fPackagesToActivateMoves.clear();
 
 	for (PackageSet::const_iterator it = fPackagesToDeactivate.begin();
 		it != fPackagesToDeactivate.end(); ++it) {
 		Package* package = *it;
-
-		// When deactivating (or updating) a system package, don't do that live.
-		if (_IsSystemPackage(package))
-			fVolumeStateIsActive = false;
-
 		if (fPackagesAlreadyRemoved.find(package)
 				!= fPackagesAlreadyRemoved.end()) {
-			fRemovedPackages.insert(package);
 			continue;
 		}
 
 		// get a BEntry for the package
 		NotOwningEntryRef entryRef(package->EntryRef());
 
-		BEntry entry;
-		status_t error = entry.SetTo(&entryRef);
+		PackageMove move;
+		move.package = package;
+		status_t error = move.entry.SetTo(&entryRef);
+		if (error == B_OK && !move.entry.Exists())
+			error = B_ENTRY_NOT_FOUND;
+		if (error != B_OK) {
+			ERROR("Failed to get package entry for %s: %s\n",
+				package->FileName().String(), strerror(error));
+			throw Exception(B_TRANSACTION_FAILED_TO_GET_ENTRY_PATH)
+				.SetPath1(package->FileName())
+				.SetPackageName(package->FileName())
+				.SetSystemError(error);
+		}
+
+		fPackagesToDeactivateMoves.push_back(move);
+	}
+
+	if (fPackagesToActivate.IsEmpty())
+		return;
+
+	// open packages directory
+	status_t error = fPackagesDirectory.SetTo(&fVolume->PackagesDirectoryRef());
+	if (error != B_OK) {
+		ERROR("Failed to open packages directory: %s\n", strerror(error));
+		throw Exception(B_TRANSACTION_FAILED_TO_OPEN_DIRECTORY)
+			.SetPath1("<packages>")
+			.SetSystemError(error);
+	}
+
+	int32 count = fPackagesToActivate.CountItems();
+	for (int32 i = 0; i < count; i++) {
+		Package* package = fPackagesToActivate.ItemAt(i);
+		if (fPackagesAlreadyAdded.find(package)
+				!= fPackagesAlreadyAdded.end()) {
+			continue;
+		}
+
+		// get a BEntry for the package
+		NotOwningEntryRef entryRef(fTransactionDirectoryRef,
+			package->FileName());
+
+		PackageMove move;
+		move.package = package;
+		error = move.entry.SetTo(&entryRef);
+		if (error == B_OK && !move.entry.Exists())
+			error = B_ENTRY_NOT_FOUND;
 		if (error != B_OK) {
 			ERROR("Failed to get package entry for %s: %s\n",
 				package->FileName().String(), strerror(error));
@@ -567,17 +632,46 @@ CommitTransactionHandler::_RemovePackagesToDeactivate()
 				.SetSystemError(error);
 		}
 
+		fPackagesToActivateMoves.push_back(move);
+	}
+}
+
+
+void
+CommitTransactionHandler::_RemovePackagesToDeactivate()
+{
+	if (fPackagesToDeactivate.empty())
+		return;
+
+	for (PackageSet::const_iterator it = fPackagesToDeactivate.begin();
+		it != fPackagesToDeactivate.end(); ++it) {
+		Package* package = *it;
+
+		// When deactivating (or updating) a system package, don't do that live.
+		if (_IsSystemPackage(package))
+			fVolumeStateIsActive = false;
+
+		if (fPackagesAlreadyRemoved.find(package)
+				!= fPackagesAlreadyRemoved.end()) {
+			fRemovedPackages.insert(package);
+		}
+	}
+
+	for (PackageMoveList::iterator it = fPackagesToDeactivateMoves.begin();
+		it != fPackagesToDeactivateMoves.end(); ++it) {
+		Package* package = it->package;
+
 		// move entry
 		fRemovedPackages.insert(package);
 
-		error = entry.MoveTo(&fOldStateDirectory);
+		status_t error = it->entry.MoveTo(&fOldStateDirectory);
 		if (error != B_OK) {
 			fRemovedPackages.erase(package);
 			ERROR("Failed to move old package %s from packages directory: %s\n",
 				package->FileName().String(), strerror(error));
 			throw Exception(B_TRANSACTION_FAILED_TO_MOVE_FILE)
 				.SetPath1(
-					_GetPath(FSUtils::Entry(entryRef), package->FileName()))
+					_GetPath(FSUtils::Entry(it->entry), package->FileName()))
 				.SetPath2(_GetPath(
 					FSUtils::Entry(fOldStateDirectory),
 					fOldStateDirectoryName))
@@ -597,47 +691,26 @@ CommitTransactionHandler::_AddPackagesToActivate()
 	if (fPackagesToActivate.IsEmpty())
 		return;
 
-	// open packages directory
-	BDirectory packagesDirectory;
-	status_t error
-		= packagesDirectory.SetTo(&fVolume->PackagesDirectoryRef());
-	if (error != B_OK) {
-		ERROR("Failed to open packages directory: %s\n", strerror(error));
-		throw Exception(B_TRANSACTION_FAILED_TO_OPEN_DIRECTORY)
-			.SetPath1("<packages>")
-			.SetSystemError(error);
-	}
-
 	int32 count = fPackagesToActivate.CountItems();
 	for (int32 i = 0; i < count; i++) {
 		Package* package = fPackagesToActivate.ItemAt(i);
 		if (fPackagesAlreadyAdded.find(package)
 				!= fPackagesAlreadyAdded.end()) {
 			fAddedPackages.insert(package);
-			_PreparePackageToActivate(package);
-			continue;
 		}
+	}
 
-		// get a BEntry for the package
-		NotOwningEntryRef entryRef(fTransactionDirectoryRef,
-			package->FileName());
-		BEntry entry;
-		error = entry.SetTo(&entryRef);
-		if (error != B_OK) {
-			ERROR("Failed to get package entry for %s: %s\n",
-				package->FileName().String(), strerror(error));
-			throw Exception(B_TRANSACTION_FAILED_TO_GET_ENTRY_PATH)
-				.SetPath1(package->FileName())
-				.SetPackageName(package->FileName())
-				.SetSystemError(error);
-		}
+	for (PackageMoveList::iterator it = fPackagesToActivateMoves.begin();
+		it != fPackagesToActivateMoves.end(); ++it) {
+		Package* package = it->package;
+		BEntry& entry = it->entry;
 
 		// move entry
 		fAddedPackages.insert(package);
 
-		error = entry.MoveTo(&packagesDirectory);
+		status_t error = entry.MoveTo(&fPackagesDirectory);
 		if (error == B_FILE_EXISTS) {
-			error = _AssertEntriesAreEqual(entry, &packagesDirectory);
+			error = _AssertEntriesAreEqual(entry, &fPackagesDirectory);
 			if (error == B_OK) {
 				// Packages are identical, no need to move.
 				// If the entry is not removed however, it will prevent
@@ -657,10 +730,12 @@ CommitTransactionHandler::_AddPackagesToActivate()
 			ERROR("Failed to move new package %s to packages directory: %s\n",
 				package->FileName().String(), strerror(error));
 			throw Exception(B_TRANSACTION_FAILED_TO_MOVE_FILE)
-				.SetPath1(
-					_GetPath(FSUtils::Entry(entryRef), package->FileName()))
+				.SetPath1(_GetPath(
+					FSUtils::Entry(fTransactionDirectoryRef,
+						package->FileName()),
+					package->FileName()))
 				.SetPath2(_GetPath(
-					FSUtils::Entry(packagesDirectory),
+					FSUtils::Entry(fPackagesDirectory),
 					"packages"))
 				.SetSystemError(error);
 		}
@@ -671,12 +746,23 @@ CommitTransactionHandler::_AddPackagesToActivate()
 
 		// also add the package to the volume
 		fVolumeState->AddPackage(package);
-
-		_PreparePackageToActivate(package);
 	}
 }
 
 
+/*!	Adds the users and groups and the global writable files of all packages
+	to activate. Done only after all package files have been moved, so that
+	the file system operations aren't interleaved with the package moves.
+*/
+void
+CommitTransactionHandler::_PreparePackagesToActivate()
+{
+	int32 count = fPackagesToActivate.CountItems();
+	for (int32 i = 0; i < count; i++)
+		_PreparePackageToActivate(fPackagesToActivate.ItemAt(i));
+}
+
+
 void
 CommitTransactionHandler::_PrepareFirstBootPackages()
 {
@@ -841,14 +927,16 @@ CommitTransactionHandler::_AddGlobalWritableFiles(Package* package)
 
 	// Open the root directory of the installation location where we will
 	// extract the files -- that's the volume's root directory.
-	BDirectory rootDirectory;
-	status_t error = rootDirectory.SetTo(&fVolume->RootDirectoryRef());
-	if (error != B_OK) {
-		throw Exception(B_TRANSACTION_FAILED_TO_OPEN_DIRECTORY)
-			.SetPath1(_GetPath(
-				FSUtils::Entry(fVolume->RootDirectoryRef()),
-				"<packagefs root>"))
-			.SetSystemError(error);
+	status_t error;
+	if (fRootDirectory.InitCheck() != B_OK) {
+		error = fRootDirectory.SetTo(&fVolume->RootDirectoryRef());
+		if (error != B_OK) {
+			throw Exception(B_TRANSACTION_FAILED_TO_OPEN_DIRECTORY)
+				.SetPath1(_GetPath(
+					FSUtils::Entry(fVolume->RootDirectoryRef()),
+					"<packagefs root>"))
+				.SetSystemError(error);
+		}
 	}
 
 	// Open writable-files directory in the administrative directory.
@@ -877,7 +965,7 @@ CommitTransactionHandler::_AddGlobalWritableFiles(Package* package)
 	for (int32 i = 0; const BGlobalWritableFileInfo* file = files.ItemAt(i);
 		i++) {
 		if (file->IsIncluded()) {
-			_AddGlobalWritableFile(package, *file, rootDirectory,
+			_AddGlobalWritableFile(package, *file, fRootDirectory,
 				extractedFilesDirectory);
 		}
 	}
@@ -11,6 +11,7 @@
 
 #include <set>
 #include <string>
+#include <vector>
 
 #include <Directory.h>
 
@@ -66,6 +67,13 @@ private:
 
 			struct TransactionIssueBuilder;
 
+			struct PackageMove {
+				Package*	package;
+				BEntry		entry;
+					// the package file's current entry
+			};
+			typedef std::vector<PackageMove> PackageMoveList;
+
 private:
 			void				_GetPackagesToDeactivate(
 									const BActivationTransaction& transaction);
@@ -73,8 +81,10 @@ private:
 									const BActivationTransaction& transaction);
 			void				_ApplyChanges();
 			void				_CreateOldStateDirectory();
+			void				_PlanPackageMoves();
 			void				_RemovePackagesToDeactivate();
 			void				_AddPackagesToActivate();
+			void				_PreparePackagesToActivate();
 
 			void				_PreparePackageToActivate(Package* package);
 			void				_AddGroup(Package* package,
@@ -176,6 +186,10 @@ private:
 			BString				fOldStateDirectoryName;
 			node_ref			fTransactionDirectoryRef;
 			bool				fFirstBootProcessing;
+			BDirectory			fPackagesDirectory;
+			PackageMoveList		fPackagesToDeactivateMoves;
+			PackageMoveList		fPackagesToActivateMoves;
+			BDirectory			fRootDirectory;
 			BDirectory			fWritableFilesDirectory;
 			StringSet			fAddedGroups;
 			StringSet			fAddedUsers;
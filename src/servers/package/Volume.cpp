@@ -157,6 +157,7 @@ Volume::Volume(BLooper* looper)
 	fPendingNodeMonitorEventsLock("pending node monitor events"),
 	fPendingNodeMonitorEvents(),
 	fNodeMonitorEventHandleTime(0),
+	fNodeMonitorEventHandlingScheduled(false),
 	fPackagesToBeActivated(),
 	fPackagesToBeDeactivated(),
 	fLocationInfoReply(B_MESSAGE_GET_INSTALLATION_LOCATION_INFO_REPLY),
@@ -667,9 +668,16 @@ Volume::MessageReceived(BMessage* message)
 		}
 
 		case kHandleNodeMonitorEvents:
+			fNodeMonitorEventHandlingScheduled = false;
 			if (fListener != NULL) {
-				if (system_time() >= fNodeMonitorEventHandleTime)
+				bigtime_t now = system_time();
+				if (now >= fNodeMonitorEventHandleTime) {
 					fListener->VolumeNodeMonitorEventOccurred(this);
+				} else {
+					// more events arrived in the meantime
+					_ScheduleNodeMonitorEventHandling(
+						fNodeMonitorEventHandleTime - now);
+				}
 			}
 			break;
 
@@ -907,9 +915,22 @@ Volume::_QueueNodeMonitorEvent(const BString& name, bool wasCreated)
 
 	fNodeMonitorEventHandleTime
 		= system_time() + kNodeMonitorEventHandlingDelay;
+	if (!fNodeMonitorEventHandlingScheduled)
+		_ScheduleNodeMonitorEventHandling(kNodeMonitorEventHandlingDelay);
+}
+
+
+/*!	Starts a message runner delivering a kHandleNodeMonitorEvents message after
+	\a delay. Only one is pending at a time -- when it fires early, because
+	further events have been queued, it is restarted for the remaining time.
+	Moving many packages at once thus doesn't create a runner per event.
+*/
+void
+Volume::_ScheduleNodeMonitorEventHandling(bigtime_t delay)
+{
 	BMessage message(kHandleNodeMonitorEvents);
-	BMessageRunner::StartSending(this, &message, kNodeMonitorEventHandlingDelay,
-		1);
+	fNodeMonitorEventHandlingScheduled = BMessageRunner::StartSending(this,
+		&message, delay, 1) == B_OK;
 }
 
 
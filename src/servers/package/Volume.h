@@ -153,6 +153,8 @@ private:
 			void				_HandleEntryMoved(const BMessage* message);
 			void				_QueueNodeMonitorEvent(const BString& name,
 									bool wasCreated);
+			void				_ScheduleNodeMonitorEventHandling(
+									bigtime_t delay);
 
 			void				_PackagesEntryCreated(const char* name);
 			void				_PackagesEntryRemoved(const char* name);
@@ -203,6 +205,7 @@ private:
 			BLocker				fPendingNodeMonitorEventsLock;
 			NodeMonitorEventList fPendingNodeMonitorEvents;
 			bigtime_t			fNodeMonitorEventHandleTime;
+			bool				fNodeMonitorEventHandlingScheduled;
 			PackageSet			fPackagesToBeActivated;
 			PackageSet			fPackagesToBeDeactivated;
 			BMessage			fLocationInfoReply;
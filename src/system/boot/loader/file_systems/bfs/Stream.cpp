@@ -292,6 +292,33 @@ Stream::FindBlockRun(off_t pos, block_run& run, off_t& offset)
 }
 
 
+status_t
+Stream::ReadInlineData(off_t pos, uint8* buffer, size_t length)
+{
+	// The small data region is not part of the Stream object, so we have to
+	// read the whole inode block
+	CachedBlock cached(fVolume);
+	const bfs_inode* node = (const bfs_inode*)cached.SetTo(inode_num);
+	if (node == NULL)
+		return B_IO_ERROR;
+
+	const small_data* smallData = node->small_data_start;
+	while (!smallData->IsLast(node)) {
+		if (*smallData->Name() == INLINE_DATA_NAME
+			&& smallData->NameSize() == INLINE_DATA_NAME_LENGTH) {
+			if (pos + (off_t)length > smallData->DataSize())
+				return B_BAD_DATA;
+
+			memcpy(buffer, smallData->Data() + pos, length);
+			return B_OK;
+		}
+		smallData = smallData->Next();
+	}
+
+	return B_BAD_DATA;
+}
+
+
 status_t
 Stream::ReadAt(off_t pos, uint8* buffer, size_t* _length)
 {
@@ -309,6 +336,12 @@ Stream::ReadAt(off_t pos, uint8* buffer, size_t* _length)
 	if (pos + (off_t)length > data.Size())
 		length = data.Size() - pos;
 
+	if ((Flags() & INODE_INLINE_DATA) != 0) {
+		// the file data is stored in the inode's small_data section
+		*_length = length;
+		return ReadInlineData(pos, buffer, length);
+	}
+
 	block_run run;
 	off_t offset;
 	if (FindBlockRun(pos, run, offset) < B_OK) {
@@ -41,6 +41,7 @@ class Stream : public bfs_inode {
 
 	private:
 		status_t GetNextSmallData(const small_data **_smallData) const;
+		status_t ReadInlineData(off_t pos, uint8 *buffer, size_t length);
 
 		Volume	&fVolume;
 };
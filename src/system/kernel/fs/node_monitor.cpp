@@ -13,6 +13,7 @@
 #include <stdlib.h>
 
 #include <AppDefs.h>
+#include <KernelExport.h>
 #include <NodeMonitor.h>
 
 #include <fd.h>
@@ -151,6 +152,8 @@ class NodeMonitorService : public NotificationService {
 		void _GetInterestedVolumeListeners(dev_t device, uint32 flags,
 			interested_monitor_listener_list *interestedListeners,
 			int32 &interestedListenerCount);
+		bool _CoalesceEvent(monitor_listener *listener,
+			const KMessage &message);
 		status_t _SendNotificationMessage(KMessage &message,
 			interested_monitor_listener_list *interestedListeners,
 			int32 interestedListenerCount);
@@ -221,6 +224,498 @@ class NodeMonitorService : public NotificationService {
 static NodeMonitorService sNodeMonitorService;
 
 
+//	#pragma mark - EventCoalescer
+
+
+static const int32 kMaxCoalescedEvents = 64;
+static const int32 kMaxCoalescedSize = 4096;
+	// must comfortably fit into the messaging area
+
+// Live queries whose updates are coalesced get their own token, which is
+// passed to the file system instead of the one of the target handler. That
+// way, their updates can be told apart from those of other queries with the
+// same target. Handler tokens are never negative, except for the special
+// B_PREFERRED_TOKEN (-2) and B_NULL_TOKEN (-1) values.
+static const int32 kFirstQueryToken = INT32_MIN;
+static const int32 kLastQueryToken = -3;
+
+struct coalesced_event : DoublyLinkedListLinkImpl<coalesced_event> {
+	KMessage			message;
+};
+
+typedef DoublyLinkedList<coalesced_event> CoalescedEventList;
+
+struct coalescing_target {
+	coalescing_target*	hash_link;
+	port_id				port;
+	int32				token;
+	uint32				what;
+	int32				message_token;
+		// the token the messages are delivered to
+	bool				query;
+	void*				query_cookie;
+	CoalescedEventList	events;
+	int32				event_count;
+	int32				events_size;
+};
+
+/*!	Collects the notifications for listeners that asked for it (via
+	B_WATCH_COALESCE, or B_QUERY_COALESCE_UPDATES), and delivers them in a
+	single B_EVENTS_COALESCED message per target every 100 ms, or as soon as
+	too many have accumulated.
+	On the way, redundant events are merged: consecutive stat changes of the
+	same node are combined, repeated attribute changes are only reported
+	once, and an entry that was added to a live query and removed again
+	before it has been reported is dropped completely.
+	Node monitor listeners are identified by their target, live queries by
+	the token returned by AddQuery().
+*/
+class EventCoalescer {
+	public:
+		EventCoalescer();
+
+		status_t InitCheck();
+
+		status_t AddEvent(port_id port, int32 token, const KMessage& event,
+			bool queryUpdate);
+
+		status_t AddQuery(port_id port, int32 token, int32& _queryToken);
+		void SetQueryCookie(port_id port, int32 queryToken, void* cookie);
+		void RemoveQuery(port_id port, int32 queryToken);
+		void RemoveQuery(void* cookie);
+
+		void Flush();
+
+	private:
+		coalescing_target* _TargetFor(port_id port, int32 token, uint32 what,
+			bool create);
+		bool _Coalesce(coalescing_target* target, const KMessage& event);
+		void _RemoveEvent(coalescing_target* target, coalesced_event* event);
+		void _Flush(coalescing_target* target);
+		void _RemoveQuery(coalescing_target* target);
+		void _PutTarget(coalescing_target* target);
+
+		static void _FlushDaemon(void* self, int iteration);
+
+		struct target_hash_key {
+			port_id	port;
+			int32	token;
+			uint32	what;
+		};
+
+		struct HashDefinition {
+			typedef target_hash_key* KeyType;
+			typedef	coalescing_target ValueType;
+
+			size_t HashKey(target_hash_key* key) const
+				{ return _Hash(key->port, key->token, key->what); }
+			size_t Hash(coalescing_target* target) const
+				{ return _Hash(target->port, target->token, target->what); }
+
+			bool Compare(target_hash_key* key, coalescing_target* target) const
+			{
+				return key->port == target->port
+					&& key->token == target->token
+					&& key->what == target->what;
+			}
+
+			coalescing_target*& GetLink(coalescing_target* target) const
+				{ return target->hash_link; }
+
+			uint32 _Hash(port_id port, int32 token, uint32 what) const
+			{
+				return ((uint32)port << 16) ^ (uint32)token ^ what;
+			}
+		};
+
+		typedef BOpenHashTable<HashDefinition> TargetHash;
+
+		mutex				fLock;
+		TargetHash			fTargets;
+		int32				fPendingTargets;
+		int32				fNextQueryToken;
+};
+
+static EventCoalescer sEventCoalescer;
+
+
+static bool
+same_entry(const KMessage& a, const KMessage& b)
+{
+	const char* nameA = a.GetString("name", "");
+	const char* nameB = b.GetString("name", "");
+
+	return a.GetInt32("device", -1) == b.GetInt32("device", -1)
+		&& a.GetInt64("node", -1) == b.GetInt64("node", -1)
+		&& a.GetInt64("directory", -1) == b.GetInt64("directory", -1)
+		&& strcmp(nameA, nameB) == 0;
+}
+
+
+static bool
+same_message(const KMessage& a, const KMessage& b)
+{
+	return a.ContentSize() == b.ContentSize()
+		&& memcmp(a.Buffer(), b.Buffer(), a.ContentSize()) == 0;
+}
+
+
+EventCoalescer::EventCoalescer()
+	:
+	fPendingTargets(0),
+	fNextQueryToken(kFirstQueryToken)
+{
+	mutex_init(&fLock, "event coalescer");
+}
+
+
+status_t
+EventCoalescer::InitCheck()
+{
+	status_t status = fTargets.Init();
+	if (status != B_OK)
+		return status;
+
+	return register_kernel_daemon(&_FlushDaemon, this, 1);
+}
+
+
+/*!	Adds the \a event to the events pending for the given target.
+	For query updates, \a token must have been returned by AddQuery() before,
+	or else \c B_ENTRY_NOT_FOUND is returned, and the caller has to deliver
+	the event itself.
+*/
+status_t
+EventCoalescer::AddEvent(port_id port, int32 token, const KMessage& event,
+	bool queryUpdate)
+{
+	MutexLocker _(fLock);
+
+	coalescing_target* target = _TargetFor(port, token, event.What(),
+		!queryUpdate);
+	if (target == NULL)
+		return queryUpdate ? B_ENTRY_NOT_FOUND : B_NO_MEMORY;
+
+	if (_Coalesce(target, event))
+		return B_OK;
+
+	int32 size = event.ContentSize();
+	if (target->event_count >= kMaxCoalescedEvents
+		|| target->events_size + size > kMaxCoalescedSize)
+		_Flush(target);
+
+	coalesced_event* coalescedEvent = new(std::nothrow) coalesced_event;
+	status_t status = coalescedEvent != NULL
+		? coalescedEvent->message.SetTo(event.Buffer(), size,
+			KMessage::KMESSAGE_CLONE_BUFFER)
+		: B_NO_MEMORY;
+	if (status != B_OK) {
+		delete coalescedEvent;
+
+		if (!target->query) {
+			_PutTarget(target);
+			return status;
+		}
+
+		// The caller doesn't know where to deliver query updates, so we have
+		// to do it, after the pending events to keep their order.
+		_Flush(target);
+
+		messaging_target messagingTarget;
+		messagingTarget.port = target->port;
+		messagingTarget.token = target->message_token;
+		send_message(&event, &messagingTarget, 1);
+		return B_OK;
+	}
+
+	if (target->event_count == 0)
+		fPendingTargets++;
+
+	target->events.Add(coalescedEvent);
+	target->event_count++;
+	target->events_size += size;
+	return B_OK;
+}
+
+
+/*!	Lets the updates of a live query sent to the given target be coalesced.
+	The file system has to be passed the returned \a _queryToken instead of
+	\a token, and the query's cookie has to be set via SetQueryCookie() once
+	it has been opened.
+*/
+status_t
+EventCoalescer::AddQuery(port_id port, int32 token, int32& _queryToken)
+{
+	MutexLocker _(fLock);
+
+	int32 queryToken = fNextQueryToken;
+	if (queryToken > kLastQueryToken)
+		return B_BUSY;
+
+	coalescing_target* target = _TargetFor(port, queryToken, B_QUERY_UPDATE,
+		true);
+	if (target == NULL)
+		return B_NO_MEMORY;
+
+	fNextQueryToken++;
+	target->message_token = token;
+	target->query = true;
+
+	_queryToken = queryToken;
+	return B_OK;
+}
+
+
+void
+EventCoalescer::SetQueryCookie(port_id port, int32 queryToken, void* cookie)
+{
+	MutexLocker _(fLock);
+
+	coalescing_target* target = _TargetFor(port, queryToken, B_QUERY_UPDATE,
+		false);
+	if (target != NULL)
+		target->query_cookie = cookie;
+}
+
+
+/*!	Removes the query that has been added with AddQuery(), but whose cookie
+	has not been set yet.
+*/
+void
+EventCoalescer::RemoveQuery(port_id port, int32 queryToken)
+{
+	MutexLocker _(fLock);
+
+	coalescing_target* target = _TargetFor(port, queryToken, B_QUERY_UPDATE,
+		false);
+	if (target != NULL && target->query)
+		_RemoveQuery(target);
+}
+
+
+void
+EventCoalescer::RemoveQuery(void* cookie)
+{
+	MutexLocker _(fLock);
+
+	TargetHash::Iterator iterator = fTargets.GetIterator();
+	while (coalescing_target* target = iterator.Next()) {
+		if (target->query && target->query_cookie == cookie) {
+			_RemoveQuery(target);
+			return;
+		}
+	}
+}
+
+
+/*!	Delivers all pending events. */
+void
+EventCoalescer::Flush()
+{
+	MutexLocker _(fLock);
+
+	if (fPendingTargets == 0)
+		return;
+
+	TargetHash::Iterator iterator = fTargets.GetIterator();
+	while (coalescing_target* target = iterator.Next()) {
+		_Flush(target);
+
+		if (!target->query) {
+			fTargets.RemoveUnchecked(target);
+			delete target;
+		}
+	}
+}
+
+
+coalescing_target*
+EventCoalescer::_TargetFor(port_id port, int32 token, uint32 what, bool create)
+{
+	target_hash_key key;
+	key.port = port;
+	key.token = token;
+	key.what = what;
+
+	coalescing_target* target = fTargets.Lookup(&key);
+	if (target != NULL || !create)
+		return target;
+
+	target = new(std::nothrow) coalescing_target;
+	if (target == NULL)
+		return NULL;
+
+	target->port = port;
+	target->token = token;
+	target->what = what;
+	target->message_token = token;
+	target->query = false;
+	target->query_cookie = NULL;
+	target->event_count = 0;
+	target->events_size = 0;
+
+	fTargets.Insert(target);
+	return target;
+}
+
+
+/*!	Tries to merge the \a event into the ones already pending for the
+	\a target, without changing the order in which the listener learns about
+	the changes. Returns \c true if there is nothing left to add.
+*/
+bool
+EventCoalescer::_Coalesce(coalescing_target* target, const KMessage& event)
+{
+	int32 opcode = event.GetInt32("opcode", -1);
+
+	switch (opcode) {
+		case B_STAT_CHANGED:
+		{
+			// only merge with the last event, so that the stat change is not
+			// reported before any other event that happened in between
+			coalesced_event* pending = target->events.Last();
+			if (event.What() != B_NODE_MONITOR || pending == NULL)
+				return false;
+
+			KMessage& message = pending->message;
+			if (message.GetInt32("opcode", -1) != B_STAT_CHANGED
+				|| message.GetInt32("device", -1)
+					!= event.GetInt32("device", -1)
+				|| message.GetInt64("node", -1) != event.GetInt64("node", -1))
+				return false;
+
+			// only keep the interim flag if both updates were interim
+			uint32 pendingFields = message.GetInt32("fields", 0);
+			uint32 fields = event.GetInt32("fields", 0);
+			uint32 interim = pendingFields & fields & B_STAT_INTERIM_UPDATE;
+			fields = ((pendingFields | fields) & ~B_STAT_INTERIM_UPDATE)
+				| interim;
+			return message.SetInt32("fields", fields) == B_OK;
+		}
+
+		case B_ATTR_CHANGED:
+		{
+			// these are only a hint to have another look at the node, so
+			// we only need to report them once
+			CoalescedEventList::Iterator iterator
+				= target->events.GetIterator();
+			while (coalesced_event* pending = iterator.Next()) {
+				if (same_message(pending->message, event))
+					return true;
+			}
+			return false;
+		}
+
+		case B_ENTRY_REMOVED:
+		{
+			if (event.What() != B_QUERY_UPDATE)
+				return false;
+
+			// If the entry has been added since the last time it was
+			// reported, the listener doesn't need to know about it: drop the
+			// addition, and anything that happened to the entry since.
+			// Earlier events must still be delivered, though.
+			coalesced_event* created = NULL;
+			CoalescedEventList::ReverseIterator iterator
+				= target->events.GetReverseIterator();
+			while (coalesced_event* pending = iterator.Next()) {
+				if (!same_entry(pending->message, event))
+					continue;
+				if (pending->message.GetInt32("opcode", -1)
+						== B_ENTRY_CREATED) {
+					created = pending;
+					break;
+				}
+			}
+			if (created == NULL)
+				return false;
+
+			coalesced_event* pending = created;
+			while (pending != NULL) {
+				coalesced_event* next = target->events.GetNext(pending);
+				if (same_entry(pending->message, event))
+					_RemoveEvent(target, pending);
+				pending = next;
+			}
+			return true;
+		}
+	}
+
+	return false;
+}
+
+
+void
+EventCoalescer::_RemoveEvent(coalescing_target* target,
+	coalesced_event* event)
+{
+	target->events.Remove(event);
+	target->event_count--;
+	target->events_size -= event->message.ContentSize();
+	delete event;
+
+	if (target->event_count == 0)
+		fPendingTargets--;
+}
+
+
+void
+EventCoalescer::_Flush(coalescing_target* target)
+{
+	if (target->event_count == 0)
+		return;
+
+	KMessage message;
+	message.SetTo(target->what);
+	message.AddInt32("opcode", B_EVENTS_COALESCED);
+
+	while (coalesced_event* event = target->events.RemoveHead()) {
+		message.AddData("events", B_MESSAGE_TYPE, event->message.Buffer(),
+			event->message.ContentSize(), false);
+		delete event;
+	}
+
+	target->event_count = 0;
+	target->events_size = 0;
+	fPendingTargets--;
+
+	messaging_target messagingTarget;
+	messagingTarget.port = target->port;
+	messagingTarget.token = target->message_token;
+
+	send_message(&message, &messagingTarget, 1);
+}
+
+
+void
+EventCoalescer::_RemoveQuery(coalescing_target* target)
+{
+	// deliver what is left before the application goes away
+	_Flush(target);
+
+	fTargets.Remove(target);
+	delete target;
+}
+
+
+/*!	Deletes the \a target in case it is no longer needed. */
+void
+EventCoalescer::_PutTarget(coalescing_target* target)
+{
+	if (target->event_count == 0 && !target->query) {
+		fTargets.Remove(target);
+		delete target;
+	}
+}
+
+
+/*static*/ void
+EventCoalescer::_FlushDaemon(void* self, int iteration)
+{
+	((EventCoalescer*)self)->Flush();
+}
+
+
 /*!	\brief Notifies the listener of a live query that an entry has been added
   		   to or removed from or updated and still in the query (for whatever
   		   reason).
@@ -252,6 +747,9 @@ notify_query_entry_event(int32 opcode, port_id port, int32 token,
 	message.AddInt64("node", node);
 	message.AddString("name", name);
 
+	if (sEventCoalescer.AddEvent(port, token, message, true) == B_OK)
+		return B_OK;
+
 	// send the message
 	messaging_target target;
 	target.port = port;
@@ -607,7 +1105,8 @@ NodeMonitorService::_SendNotificationMessage(KMessage &message,
 		MonitorListenerList::Iterator iterator = list->iterator;
 		do {
 			monitor_listener *listener = iterator.Current();
-			if (listener->flags & list->flags)
+			if ((listener->flags & list->flags) != 0
+				&& !_CoalesceEvent(listener, message))
 				listener->listener->EventOccurred(*this, &message);
 		} while (iterator.Next() != NULL);
 	}
@@ -626,6 +1125,27 @@ NodeMonitorService::_SendNotificationMessage(KMessage &message,
 }
 
 
+/*!	Passes the \a message on to the event coalescer if the \a listener asked
+	for it. Returns \c true if the listener does not need to be notified
+	anymore.
+*/
+bool
+NodeMonitorService::_CoalesceEvent(monitor_listener *listener,
+	const KMessage &message)
+{
+	if ((listener->flags & B_WATCH_COALESCE) == 0)
+		return false;
+
+	UserNodeListener* userListener
+		= dynamic_cast<UserNodeListener*>(listener->listener);
+	if (userListener == NULL)
+		return false;
+
+	return sEventCoalescer.AddEvent(userListener->Port(),
+		userListener->Token(), message, false) == B_OK;
+}
+
+
 /*!	\brief Resolves the device/directory node pair to the node it's covered
 	by, if any.
 */
@@ -1098,9 +1618,12 @@ node_monitor_init(void)
 {
 	new(&sNodeMonitorSender) UserMessagingMessageSender();
 	new(&sNodeMonitorService) NodeMonitorService();
+	new(&sEventCoalescer) EventCoalescer();
 
 	if (sNodeMonitorService.InitCheck() < B_OK)
 		panic("initializing node monitor failed\n");
+	if (sEventCoalescer.InitCheck() < B_OK)
+		panic("initializing node monitor event coalescer failed\n");
 
 	return B_OK;
 }
@@ -1138,6 +1661,43 @@ add_node_listener(dev_t device, ino_t node, uint32 flags,
 }
 
 
+/*!	Lets the updates of a live query be coalesced before they are sent to the
+	given target. The file system has to be passed the returned
+	\a _queryToken instead of \a token when opening the query. Once it is
+	open, its cookie has to be set via set_coalesced_query_cookie().
+*/
+status_t
+start_coalescing_query_updates(port_id port, int32 token, int32* _queryToken)
+{
+	return sEventCoalescer.AddQuery(port, token, *_queryToken);
+}
+
+
+void
+set_coalesced_query_cookie(port_id port, int32 queryToken, void* cookie)
+{
+	sEventCoalescer.SetQueryCookie(port, queryToken, cookie);
+}
+
+
+/*!	Stops coalescing the updates of a query that could not be opened. */
+void
+cancel_coalescing_query_updates(port_id port, int32 queryToken)
+{
+	sEventCoalescer.RemoveQuery(port, queryToken);
+}
+
+
+/*!	Stops coalescing the updates of the query identified by \a cookie, if
+	they are coalesced at all, and delivers the pending ones.
+*/
+void
+stop_coalescing_query_updates(void* cookie)
+{
+	sEventCoalescer.RemoveQuery(cookie);
+}
+
+
 //	#pragma mark - public kernel API
 
 
@@ -8,7 +8,10 @@
 #include <sys/socket.h>
 
 #include <errno.h>
+#include <fcntl.h>
 #include <limits.h>
+#include <stdlib.h>
+#include <sys/stat.h>
 
 #include <module.h>
 
@@ -32,6 +35,7 @@
 #define MAX_SOCKET_ADDRESS_LENGTH	(sizeof(sockaddr_storage))
 #define MAX_SOCKET_OPTION_LENGTH	128
 #define MAX_ANCILLARY_DATA_LENGTH	1024
+#define SENDFILE_CHUNK_SIZE			(64 * 1024)
 
 #define GET_SOCKET_FD_OR_RETURN(fd, kernel, descriptor)	\
 	do {												\
@@ -580,6 +584,88 @@ common_sendmsg(int fd, const struct msghdr *message, int flags, bool kernel)
 }
 
 
+/*!	Sends \a length bytes of the regular file \a fd, starting at \a pos, or
+	at the current file position if \a pos is -1, over the socket.
+	The file is read in chunks that are directly passed on to the stack, so
+	that the data never has to be copied to or from userland, and is not copied
+	again when it is put into the net_buffers.
+*/
+static ssize_t
+common_sendfile(int socketFD, int fd, off_t pos, size_t length, bool kernel)
+{
+	if (pos < -1)
+		return B_BAD_VALUE;
+
+	file_descriptor* descriptor;
+	GET_SOCKET_FD_OR_RETURN(socketFD, kernel, descriptor);
+	FileDescriptorPutter _(descriptor);
+
+	FileDescriptorPutter file(get_fd(get_current_io_context(kernel), fd));
+	if (!file.IsSet())
+		return B_FILE_ERROR;
+
+	if ((file->open_mode & O_RWMASK) == O_WRONLY || file->ops->fd_read == NULL)
+		return B_FILE_ERROR;
+
+	struct stat stat;
+	if (file->ops->fd_read_stat == NULL
+		|| file->ops->fd_read_stat(file.Get(), &stat) != B_OK
+		|| !S_ISREG(stat.st_mode)) {
+		return B_BAD_VALUE;
+	}
+
+	bool movePosition = false;
+	if (pos == -1) {
+		pos = file->pos;
+		movePosition = true;
+	}
+
+	if (length > SSIZE_MAX)
+		length = SSIZE_MAX;
+
+	ssize_t bytesSent = 0;
+	status_t status = B_OK;
+
+	while ((size_t)bytesSent < length) {
+		size_t chunkSize = min_c(length - bytesSent, SENDFILE_CHUNK_SIZE);
+		void* chunk = malloc(chunkSize);
+		if (chunk == NULL) {
+			status = B_NO_MEMORY;
+			break;
+		}
+
+		status = file->ops->fd_read(file.Get(), pos + bytesSent, chunk,
+			&chunkSize);
+		if (status != B_OK || chunkSize == 0) {
+			// an error, or the end of the file
+			free(chunk);
+			break;
+		}
+
+		// The stack takes over the chunk, and frees it when it no longer needs
+		// the data, ie. for TCP once it has been acknowledged.
+		ssize_t sent = sStackInterface->send_external(FD_SOCKET(descriptor),
+			chunk, chunkSize, 0, &free);
+		if (sent < 0) {
+			status = sent;
+			break;
+		}
+
+		bytesSent += sent;
+		if ((size_t)sent < chunkSize)
+			break;
+	}
+
+	if (bytesSent == 0 && status != B_OK)
+		return status;
+
+	if (movePosition)
+		file->pos = pos + bytesSent;
+
+	return bytesSent;
+}
+
+
 static status_t
 common_getsockopt(int fd, int level, int option, void *value,
 	socklen_t *_length, bool kernel)
@@ -1157,6 +1243,14 @@ _user_sendmsg(int socket, const struct msghdr *userMessage, int flags)
 }
 
 
+ssize_t
+_user_sendfile(int socket, int fd, off_t pos, size_t length)
+{
+	SyscallRestartWrapper<ssize_t> result;
+	return result = common_sendfile(socket, fd, pos, length, false);
+}
+
+
 status_t
 _user_getsockopt(int socket, int level, int option, void *userValue,
 	socklen_t *_length)
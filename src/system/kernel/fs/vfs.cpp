@@ -26,6 +26,7 @@
 #include <fs_attr.h>
 #include <fs_info.h>
 #include <fs_interface.h>
+#include <fs_query.h>
 #include <fs_volume.h>
 #include <NodeMonitor.h>
 #include <OS.h>
@@ -7292,10 +7293,29 @@ query_open(dev_t device, const char* query, uint32 flags, port_id port,
 		goto error;
 	}
 
-	status = FS_MOUNT_CALL(mount, open_query, query, flags, port, token,
+	// Coalescing the updates is done here, the file system doesn't need to
+	// know about it. It gets a token of its own for the query, though, so
+	// that its updates can be told apart from those of other queries.
+	bool coalesce;
+	coalesce = (flags & B_LIVE_QUERY) != 0
+		&& (flags & B_QUERY_COALESCE_UPDATES) != 0;
+	flags &= ~B_QUERY_COALESCE_UPDATES;
+
+	int32 queryToken;
+	queryToken = token;
+	if (coalesce) {
+		status = start_coalescing_query_updates(port, token, &queryToken);
+		if (status != B_OK)
+			goto error;
+	}
+
+	status = FS_MOUNT_CALL(mount, open_query, query, flags, port, queryToken,
 		&cookie);
 	if (status != B_OK)
-		goto error;
+		goto error_cancel;
+
+	if (coalesce)
+		set_coalesced_query_cookie(port, queryToken, cookie);
 
 	// get fd for the index directory
 	int fd;
@@ -7309,6 +7329,10 @@ query_open(dev_t device, const char* query, uint32 flags, port_id port,
 	FS_MOUNT_CALL(mount, close_query, cookie);
 	FS_MOUNT_CALL(mount, free_query_cookie, cookie);
 
+error_cancel:
+	if (coalesce)
+		cancel_coalescing_query_updates(port, queryToken);
+
 error:
 	put_mount(mount);
 	return status;
@@ -7322,10 +7346,12 @@ query_close(struct file_descriptor* descriptor)
 
 	FUNCTION(("query_close(descriptor = %p)\n", descriptor));
 
+	status_t status = B_OK;
 	if (HAS_FS_MOUNT_CALL(mount, close_query))
-		return FS_MOUNT_CALL(mount, close_query, descriptor->cookie);
+		status = FS_MOUNT_CALL(mount, close_query, descriptor->cookie);
 
-	return B_OK;
+	stop_coalescing_query_updates(descriptor->cookie);
+	return status;
 }
 
 
@@ -30,7 +30,7 @@ main(int argc, char **argv)
 	puts("");
 
 	printf(OFFSETOF(bfs_inode, inode_size));
-	printf(OFFSETOF(bfs_inode, etc));
+	printf(OFFSETOF(bfs_inode, checksum));
 	printf(OFFSETOF(bfs_inode, data));
 
 	return 0;
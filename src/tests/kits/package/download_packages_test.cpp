@@ -0,0 +1,328 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+/*!	Checks that BPackageManager::DownloadPackage() verifies the checksum of
+	the data it downloads, and that it can be called from several threads at
+	the same time, as done for parallel downloads, without the progress hooks
+	of the UserInteractionHandler ever being entered concurrently.
+	Uses file:// URLs, so no network access is needed.
+*/
+
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <Entry.h>
+#include <File.h>
+#include <OS.h>
+#include <String.h>
+
+#include <package/manager/PackageManager.h>
+
+#include <SHA256.h>
+
+
+using BPackageKit::B_PACKAGE_INSTALLATION_LOCATION_HOME;
+using BPackageKit::BManager::BPrivate::BPackageManager;
+
+
+static const int32 kFileCount = 8;
+static const size_t kFileSize = 256 * 1024;
+
+static int sFailures = 0;
+
+
+#define CHECK(condition) \
+	do { \
+		if (!(condition)) { \
+			printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, \
+				#condition); \
+			sFailures++; \
+		} \
+	} while (false)
+
+
+/*!	Counts the download hooks called, and how many of them ran at the same
+	time.
+*/
+class CountingInteractionHandler
+	: public BPackageManager::UserInteractionHandler {
+public:
+	CountingInteractionHandler()
+		:
+		fActive(0),
+		fMaxActive(0),
+		fCompleted(0)
+	{
+	}
+
+	virtual void ProgressPackageDownloadStarted(const char* packageName)
+	{
+		_Enter();
+		_Leave();
+	}
+
+	virtual void ProgressPackageDownloadActive(const char* packageName,
+		float completionPercentage, off_t bytes, off_t totalBytes)
+	{
+		_Enter();
+		_Leave();
+	}
+
+	virtual void ProgressPackageDownloadComplete(const char* packageName)
+	{
+		_Enter();
+		fCompleted++;
+		_Leave();
+	}
+
+	int32 MaxActive() const
+	{
+		return fMaxActive;
+	}
+
+	int32 Completed() const
+	{
+		return fCompleted;
+	}
+
+private:
+	void _Enter()
+	{
+		int32 active = atomic_add(&fActive, 1) + 1;
+		if (active > fMaxActive)
+			fMaxActive = active;
+
+		// give the other threads a chance to come in as well
+		snooze(1000);
+	}
+
+	void _Leave()
+	{
+		atomic_add(&fActive, -1);
+	}
+
+private:
+	int32	fActive;
+	int32	fMaxActive;
+	int32	fCompleted;
+};
+
+
+class TestPackageManager : public BPackageManager {
+public:
+	TestPackageManager(UserInteractionHandler* handler)
+		:
+		BPackageManager(B_PACKAGE_INSTALLATION_LOCATION_HOME,
+			&fInstallationInterface, handler)
+	{
+	}
+
+private:
+	ClientInstallationInterface	fInstallationInterface;
+};
+
+
+struct DownloadItem {
+	TestPackageManager*	manager;
+	BString				url;
+	BString				checksum;
+	BString				target;
+	status_t			error;
+};
+
+
+static DownloadItem sItems[kFileCount];
+static int32 sNextItem;
+
+
+static BString
+checksum_for(const void* data, size_t size)
+{
+	SHA256 hash;
+	hash.Update(data, size);
+
+	BString checksum;
+	const uint8* digest = hash.Digest();
+	for (size_t i = 0; i < hash.DigestLength(); i++)
+		checksum << BString().SetToFormat("%02x", digest[i]);
+	return checksum;
+}
+
+
+static void
+write_file(const char* path, const void* data, size_t size)
+{
+	BFile file(path, B_CREATE_FILE | B_ERASE_FILE | B_WRITE_ONLY);
+	CHECK(file.InitCheck() == B_OK);
+	CHECK(file.Write(data, size) == (ssize_t)size);
+}
+
+
+static bool
+file_equals(const char* path, const void* data, size_t size)
+{
+	BFile file(path, B_READ_ONLY);
+	off_t fileSize;
+	if (file.GetSize(&fileSize) != B_OK || fileSize != (off_t)size)
+		return false;
+
+	char* buffer = (char*)malloc(size);
+	if (buffer == NULL)
+		return false;
+
+	bool equal = file.Read(buffer, size) == (ssize_t)size
+		&& memcmp(buffer, data, size) == 0;
+	free(buffer);
+	return equal;
+}
+
+
+static status_t
+download_packages(void*)
+{
+	for (;;) {
+		int32 index = atomic_add(&sNextItem, 1);
+		if (index >= kFileCount)
+			break;
+
+		DownloadItem& item = sItems[index];
+		item.error = item.manager->DownloadPackage(item.url,
+			BEntry(item.target.String()), item.checksum);
+	}
+
+	return B_OK;
+}
+
+
+static void
+test_checksum(const char* directory, TestPackageManager& manager,
+	const char* data)
+{
+	BString source;
+	source.SetToFormat("%s/source.hpkg", directory);
+	BString target;
+	target.SetToFormat("%s/target.hpkg", directory);
+	BString url;
+	url.SetToFormat("file://%s", source.String());
+
+	write_file(source.String(), data, kFileSize);
+	BString checksum = checksum_for(data, kFileSize);
+
+	CHECK(manager.DownloadPackage(url, BEntry(target.String()), checksum)
+		== B_OK);
+	CHECK(file_equals(target.String(), data, kFileSize));
+	unlink(target.String());
+
+	// the checksum is compared case insensitively
+	BString upperChecksum = checksum;
+	upperChecksum.ToUpper();
+	CHECK(manager.DownloadPackage(url, BEntry(target.String()), upperChecksum)
+		== B_OK);
+	unlink(target.String());
+
+	// a mismatch is reported as B_BAD_DATA
+	BString badChecksum = checksum_for(data, kFileSize - 1);
+	CHECK(manager.DownloadPackage(url, BEntry(target.String()), badChecksum)
+		== B_BAD_DATA);
+	unlink(target.String());
+
+	// A file:// download can't be resumed, so the data already in the
+	// target file must neither end up in the file, nor in the checksum.
+	write_file(target.String(), "garbage", 7);
+	CHECK(manager.DownloadPackage(url, BEntry(target.String()), checksum)
+		== B_OK);
+	CHECK(file_equals(target.String(), data, kFileSize));
+	unlink(target.String());
+
+	unlink(source.String());
+}
+
+
+static void
+test_parallel(const char* directory, TestPackageManager& manager,
+	CountingInteractionHandler& handler, char* data)
+{
+	for (int32 i = 0; i < kFileCount; i++) {
+		DownloadItem& item = sItems[i];
+		data[0] = (char)i;
+
+		BString source;
+		source.SetToFormat("%s/source-%" B_PRId32 ".hpkg", directory, i);
+		write_file(source.String(), data, kFileSize);
+
+		item.manager = &manager;
+		item.url.SetToFormat("file://%s", source.String());
+		item.target.SetToFormat("%s/target-%" B_PRId32 ".hpkg", directory, i);
+		item.checksum = checksum_for(data, kFileSize);
+		item.error = B_ERROR;
+	}
+
+	thread_id threads[kFileCount];
+	for (int32 i = 0; i < kFileCount; i++) {
+		threads[i] = spawn_thread(&download_packages, "package download",
+			B_NORMAL_PRIORITY, NULL);
+		CHECK(threads[i] >= 0);
+		resume_thread(threads[i]);
+	}
+
+	for (int32 i = 0; i < kFileCount; i++)
+		wait_for_thread(threads[i], NULL);
+
+	for (int32 i = 0; i < kFileCount; i++) {
+		DownloadItem& item = sItems[i];
+		data[0] = (char)i;
+
+		CHECK(item.error == B_OK);
+		CHECK(file_equals(item.target.String(), data, kFileSize));
+
+		unlink(item.target.String());
+		unlink(item.url.String() + strlen("file://"));
+	}
+
+	CHECK(handler.Completed() == kFileCount);
+	CHECK(handler.MaxActive() == 1);
+}
+
+
+int
+main()
+{
+	char directory[] = "/tmp/download-packages-XXXXXX";
+	if (mkdtemp(directory) == NULL) {
+		fprintf(stderr, "Failed to create test directory: %s\n",
+			strerror(errno));
+		return 1;
+	}
+
+	char* data = (char*)malloc(kFileSize);
+	if (data == NULL) {
+		fprintf(stderr, "Out of memory\n");
+		return 1;
+	}
+	for (size_t i = 0; i < kFileSize; i++)
+		data[i] = (char)(i * 7 + i / 251);
+
+	CountingInteractionHandler handler;
+	TestPackageManager manager(&handler);
+
+	test_checksum(directory, manager, data);
+	test_parallel(directory, manager, handler, data);
+
+	free(data);
+	rmdir(directory);
+
+	if (sFailures != 0) {
+		printf("%d checks failed\n", sFailures);
+		return 1;
+	}
+
+	printf("all checks passed\n");
+	return 0;
+}
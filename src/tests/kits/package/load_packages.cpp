@@ -0,0 +1,210 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+/*!	Parses the table of contents of a set of packages the same way packagefs
+	does at mount time, using a given number of threads, and prints how long
+	it took. Useful to check how well loading the initial packages scales
+	with the number of threads, e.g. using a synthetic package set created
+	with the "package" tool.
+*/
+
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <OS.h>
+
+#include <package/hpkg/PackageContentHandler.h>
+#include <package/hpkg/PackageReader.h>
+#include <package/hpkg/StandardErrorOutput.h>
+
+
+using namespace BPackageKit::BHPKG;
+
+
+static const int32 kMaxThreads = 64;
+
+
+struct CountingContentHandler : BPackageContentHandler {
+	CountingContentHandler()
+		:
+		fEntryCount(0),
+		fAttributeCount(0)
+	{
+	}
+
+	virtual status_t HandleEntry(BPackageEntry* entry)
+	{
+		fEntryCount++;
+		return B_OK;
+	}
+
+	virtual status_t HandleEntryAttribute(BPackageEntry* entry,
+		BPackageEntryAttribute* attribute)
+	{
+		fAttributeCount++;
+		return B_OK;
+	}
+
+	virtual status_t HandleEntryDone(BPackageEntry* entry)
+	{
+		return B_OK;
+	}
+
+	virtual status_t HandlePackageAttribute(
+		const BPackageInfoAttributeValue& value)
+	{
+		return B_OK;
+	}
+
+	virtual void HandleErrorOccurred()
+	{
+	}
+
+	int64	fEntryCount;
+	int64	fAttributeCount;
+};
+
+
+struct PackageItem {
+	const char*	path;
+	status_t	error;
+	int64		entryCount;
+	bigtime_t	loadTime;
+};
+
+
+static PackageItem* sItems;
+static int32 sItemCount;
+static int32 sNextItem;
+
+
+static status_t
+load_packages(void*)
+{
+	BStandardErrorOutput errorOutput;
+
+	for (;;) {
+		int32 index = atomic_add(&sNextItem, 1);
+		if (index >= sItemCount)
+			break;
+
+		PackageItem& item = sItems[index];
+		bigtime_t startTime = system_time();
+
+		BPackageReader reader(&errorOutput);
+		item.error = reader.Init(item.path);
+		if (item.error == B_OK) {
+			CountingContentHandler handler;
+			item.error = reader.ParseContent(&handler);
+			item.entryCount = handler.fEntryCount;
+		}
+
+		item.loadTime = system_time() - startTime;
+	}
+
+	return B_OK;
+}
+
+
+static void
+print_usage_and_exit(bool error)
+{
+	fprintf(error ? stderr : stdout,
+		"Usage: load_packages [ -t <threads> ] <package> ...\n"
+		"Loads the given packages using the given number of threads (default:\n"
+		"the number of CPUs) and prints how long it took.\n");
+	exit(error ? 1 : 0);
+}
+
+
+int
+main(int argc, char** argv)
+{
+	system_info info;
+	get_system_info(&info);
+	int32 threadCount = info.cpu_count;
+
+	int c;
+	while ((c = getopt(argc, argv, "ht:")) != -1) {
+		switch (c) {
+			case 'h':
+				print_usage_and_exit(false);
+				break;
+			case 't':
+				threadCount = atoi(optarg);
+				break;
+			default:
+				print_usage_and_exit(true);
+				break;
+		}
+	}
+
+	if (optind >= argc)
+		print_usage_and_exit(true);
+
+	if (threadCount < 1)
+		threadCount = 1;
+	else if (threadCount > kMaxThreads)
+		threadCount = kMaxThreads;
+
+	sItemCount = argc - optind;
+	sItems = new PackageItem[sItemCount];
+	for (int32 i = 0; i < sItemCount; i++) {
+		sItems[i].path = argv[optind + i];
+		sItems[i].error = B_OK;
+		sItems[i].entryCount = 0;
+		sItems[i].loadTime = 0;
+	}
+
+	bigtime_t startTime = system_time();
+
+	thread_id threads[kMaxThreads];
+	int32 spawnedCount = 0;
+	for (int32 i = 1; i < threadCount; i++) {
+		thread_id thread = spawn_thread(&load_packages, "package loader",
+			B_NORMAL_PRIORITY, NULL);
+		if (thread < 0)
+			break;
+
+		resume_thread(thread);
+		threads[spawnedCount++] = thread;
+	}
+
+	load_packages(NULL);
+
+	for (int32 i = 0; i < spawnedCount; i++) {
+		status_t result;
+		wait_for_thread(threads[i], &result);
+	}
+
+	bigtime_t totalTime = system_time() - startTime;
+
+	bigtime_t accumulatedTime = 0;
+	int64 entryCount = 0;
+	int32 failedCount = 0;
+	for (int32 i = 0; i < sItemCount; i++) {
+		PackageItem& item = sItems[i];
+		if (item.error != B_OK) {
+			fprintf(stderr, "%s: %s\n", item.path, strerror(item.error));
+			failedCount++;
+		}
+		accumulatedTime += item.loadTime;
+		entryCount += item.entryCount;
+	}
+
+	printf("%" B_PRId32 " packages (%" B_PRId64 " entries, %" B_PRId32
+		" failed), %" B_PRId32 " threads: %" B_PRIdBIGTIME " ms (%"
+		B_PRIdBIGTIME " ms accumulated)\n", sItemCount, entryCount,
+		failedCount, spawnedCount + 1, totalTime / 1000,
+		accumulatedTime / 1000);
+
+	delete[] sItems;
+	return failedCount == 0 ? 0 : 1;
+}
@@ -0,0 +1,293 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+/*!	Creates repository files for two versions of a local stand-in repository,
+	computes the delta between them, and checks that applying it to the old
+	repository file reproduces the new one byte for byte. Also checks that
+	malformed deltas, and deltas for another repository file, are refused.
+*/
+
+
+#include <errno.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <ByteOrder.h>
+#include <DataIO.h>
+#include <File.h>
+#include <String.h>
+
+#include <package/PackageInfo.h>
+#include <package/RepositoryInfo.h>
+#include <package/hpkg/HPKGDefsPrivate.h>
+#include <package/hpkg/RepositoryDelta.h>
+#include <package/hpkg/RepositoryWriter.h>
+
+
+using namespace BPackageKit;
+using namespace BPackageKit::BHPKG;
+using BPackageKit::BHPKG::BPrivate::RepositoryDelta;
+using BPackageKit::BHPKG::BPrivate::hpkg_repo_delta_header;
+using BPackageKit::BHPKG::BPrivate::hpkg_repo_header;
+
+
+static const int32 kPackageCount = 200;
+static const off_t kCommandsOffset
+	= sizeof(hpkg_repo_delta_header) + sizeof(hpkg_repo_header);
+
+
+struct ErrorOutput : BRepositoryWriterListener {
+	ErrorOutput(bool quiet)
+		:
+		fQuiet(quiet)
+	{
+	}
+
+	virtual void PrintErrorVarArgs(const char* format, va_list args)
+	{
+		if (!fQuiet)
+			vfprintf(stderr, format, args);
+	}
+
+	virtual void OnPackageAdded(const BPackageInfo& packageInfo)
+	{
+	}
+
+	virtual void OnRepositoryInfoSectionDone(uint32 uncompressedSize)
+	{
+	}
+
+	virtual void OnPackageAttributesSectionDone(uint32 stringCount,
+		uint32 uncompressedSize)
+	{
+	}
+
+	virtual void OnRepositoryDone(uint32 headerSize,
+		uint32 repositoryInfoLength, uint32 licenseCount, uint32 packageCount,
+		uint32 packageAttributesSize, uint64 totalSize)
+	{
+	}
+
+private:
+	bool	fQuiet;
+};
+
+
+static int32 sFailedCount = 0;
+
+
+static void
+check(bool condition, const char* test)
+{
+	printf("%s: %s\n", test, condition ? "ok" : "FAILED");
+	if (!condition)
+		sFailedCount++;
+}
+
+
+/*!	Writes a repository file with packages "pkg<first>" to "pkg<last>". All
+	packages have version 1.0, except for \a updatedPackage, which has 1.1.
+*/
+static status_t
+write_repository(const char* path, int32 first, int32 last,
+	int32 updatedPackage)
+{
+	BRepositoryInfo repositoryInfo;
+	repositoryInfo.SetName("test");
+	repositoryInfo.SetIdentifier("test");
+	repositoryInfo.SetBaseURL("file:///tmp/test");
+	repositoryInfo.SetVendor("Haiku");
+	repositoryInfo.SetSummary("Stand-in repository for the delta test");
+	repositoryInfo.SetPriority(1);
+	repositoryInfo.SetArchitecture(B_PACKAGE_ARCHITECTURE_X86_64);
+
+	ErrorOutput listener(false);
+	BRepositoryWriter writer(&listener, &repositoryInfo);
+	status_t error = writer.Init(path);
+	if (error != B_OK)
+		return error;
+
+	for (int32 i = first; i <= last; i++) {
+		BString name = BString("pkg") << i;
+		BPackageVersion version(i == updatedPackage ? "1.1" : "1.0");
+
+		BPackageInfo packageInfo;
+		packageInfo.SetName(name);
+		packageInfo.SetSummary(BString("Package number ") << i);
+		packageInfo.SetDescription(
+			BString("The package number ") << i << " of the test repository.");
+		packageInfo.SetVendor("Haiku");
+		packageInfo.SetPackager("repository_delta_test");
+		packageInfo.SetArchitecture(B_PACKAGE_ARCHITECTURE_X86_64);
+		packageInfo.SetVersion(version);
+		packageInfo.AddCopyright("2026 Haiku, Inc.");
+		packageInfo.AddLicense("MIT");
+		packageInfo.AddProvides(BPackageResolvable(name, version));
+		packageInfo.AddProvides(
+			BPackageResolvable(BString("cmd:") << name, version));
+
+		error = writer.AddPackageInfo(packageInfo);
+		if (error != B_OK)
+			return error;
+	}
+
+	return writer.Finish();
+}
+
+
+static bool
+equals(BPositionIO& file, const BMallocIO& data)
+{
+	off_t size;
+	if (file.GetSize(&size) != B_OK || size != (off_t)data.BufferLength())
+		return false;
+
+	uint8* buffer = (uint8*)malloc(size);
+	if (buffer == NULL)
+		return false;
+
+	bool equal = file.ReadAtExactly(0, buffer, size) == B_OK
+		&& memcmp(buffer, data.Buffer(), size) == 0;
+	free(buffer);
+	return equal;
+}
+
+
+/*!	Applies a modified copy of \a delta to \a base, and checks that this
+	fails.
+*/
+static void
+check_malformed(const char* test, BPositionIO& base, const BMallocIO& delta,
+	off_t offset, const void* data, size_t size, off_t truncatedSize = -1)
+{
+	BMallocIO malformedDelta;
+	malformedDelta.WriteAt(0, delta.Buffer(), delta.BufferLength());
+	if (data != NULL)
+		malformedDelta.WriteAt(offset, data, size);
+	if (truncatedSize >= 0)
+		malformedDelta.SetSize(truncatedSize);
+
+	ErrorOutput errorOutput(true);
+	BMallocIO result;
+	status_t error = RepositoryDelta::Apply(&errorOutput, &base,
+		&malformedDelta, &result);
+	check(error != B_OK, test);
+}
+
+
+int
+main(int argc, char** argv)
+{
+	char directory[] = "/tmp/repository_delta_test-XXXXXX";
+	if (mkdtemp(directory) == NULL) {
+		fprintf(stderr, "Failed to create temporary directory: %s\n",
+			strerror(errno));
+		return 1;
+	}
+
+	BString basePath = BString(directory) << "/repo.old";
+	BString targetPath = BString(directory) << "/repo.new";
+
+	// The new version of the repository drops the first package, updates
+	// one, and adds another one at the end.
+	status_t error = write_repository(basePath, 0, kPackageCount - 1, -1);
+	if (error == B_OK) {
+		error = write_repository(targetPath, 1, kPackageCount,
+			kPackageCount / 2);
+	}
+	if (error != B_OK) {
+		fprintf(stderr, "Failed to write the repository files: %s\n",
+			strerror(error));
+		return 1;
+	}
+
+	BFile base(basePath, B_READ_ONLY);
+	BFile target(targetPath, B_READ_ONLY);
+	if (base.InitCheck() != B_OK || target.InitCheck() != B_OK) {
+		fprintf(stderr, "Failed to open the repository files\n");
+		return 1;
+	}
+
+	ErrorOutput errorOutput(false);
+
+	// round trip
+	BMallocIO delta;
+	error = RepositoryDelta::Create(&errorOutput, &base, &target, &delta);
+	check(error == B_OK, "create delta");
+	if (error != B_OK)
+		return 1;
+
+	off_t targetSize;
+	target.GetSize(&targetSize);
+	printf("repository: %" B_PRIdOFF " bytes, delta: %" B_PRIuSIZE
+		" bytes\n", targetSize, delta.BufferLength());
+
+	BMallocIO result;
+	error = RepositoryDelta::Apply(&errorOutput, &base, &delta, &result);
+	check(error == B_OK && equals(target, result), "apply delta");
+
+	// a delta between identical files
+	BMallocIO identityDelta;
+	error = RepositoryDelta::Create(&errorOutput, &target, &target,
+		&identityDelta);
+	BMallocIO identityResult;
+	if (error == B_OK) {
+		error = RepositoryDelta::Apply(&errorOutput, &target, &identityDelta,
+			&identityResult);
+	}
+	check(error == B_OK && equals(target, identityResult),
+		"apply identity delta");
+
+	// a delta for another repository file
+	{
+		ErrorOutput quietErrorOutput(true);
+		BMallocIO otherResult;
+		error = RepositoryDelta::Apply(&quietErrorOutput, &target, &delta,
+			&otherResult);
+		check(error == B_MISMATCHED_VALUES, "refuse delta for other file");
+	}
+
+	// malformed deltas
+	const uint32 badMagic = 0;
+	check_malformed("refuse bad magic", base, delta,
+		offsetof(hpkg_repo_delta_header, magic), &badMagic, sizeof(badMagic));
+	check_malformed("refuse truncated delta", base, delta, 0, NULL, 0,
+		delta.BufferLength() - 1);
+	check_malformed("refuse delta without commands", base, delta, 0, NULL, 0,
+		kCommandsOffset);
+
+	const uint64 hugeSize = B_HOST_TO_BENDIAN_INT64(1LL << 40);
+	check_malformed("refuse huge target heap", base, delta,
+		offsetof(hpkg_repo_delta_header, target_heap_size), &hugeSize,
+		sizeof(hugeSize));
+	check_malformed("refuse wrong commands size", base, delta,
+		offsetof(hpkg_repo_delta_header, commands_size_uncompressed),
+		&hugeSize, sizeof(hugeSize));
+
+	uint8 targetChecksum[32];
+	memset(targetChecksum, 0, sizeof(targetChecksum));
+	check_malformed("refuse wrong target checksum", base, delta,
+		offsetof(hpkg_repo_delta_header, target_checksum), targetChecksum,
+		sizeof(targetChecksum));
+
+	for (off_t offset = kCommandsOffset; offset < (off_t)delta.BufferLength();
+			offset += (delta.BufferLength() - kCommandsOffset) / 4 + 1) {
+		uint8 byte = ((const uint8*)delta.Buffer())[offset] ^ 0xff;
+		BString test = BString("refuse corrupt commands at ") << offset;
+		check_malformed(test, base, delta, offset, &byte, 1);
+	}
+
+	unlink(basePath);
+	unlink(targetPath);
+	rmdir(directory);
+
+	printf("%" B_PRId32 " test(s) failed\n", sFailedCount);
+	return sFailedCount == 0 ? 0 : 1;
+}
@@ -16,6 +16,7 @@
 
 #include <Application.h>
 #include <Entry.h>
+#include <fs_query.h>
 #include <NodeMonitor.h>
 #include <Path.h>
 #include <Query.h>
@@ -35,6 +36,7 @@ static const char *kProgramName = __progname;
 static bool sAllVolumes = false;		// Query all volumes?
 static bool sEscapeMetaChars = true;	// Escape metacharacters?
 static bool sFilesOnly = false;			// Show only files?
+static bool sCoalesce = false;			// Coalesce query updates?
 
 
 class LiveQuery : public BApplication {
@@ -49,6 +51,7 @@ public:
 
 private:
 			void				_PrintUsage();
+			void				_QueryUpdate(BMessage* message);
 			void				_AddQuery(BVolume& volume,
 									const char* predicate);
 			void				_PerformQuery(BQuery& query);
@@ -84,8 +87,11 @@ LiveQuery::ArgvReceived(int32 argc, char** argv)
 
 	// Parse command-line arguments.
 	int opt;
-	while ((opt = getopt(argc, argv, "efav:")) != -1) {
+	while ((opt = getopt(argc, argv, "efacv:")) != -1) {
 		switch (opt) {
+			case 'c':
+				sCoalesce = true;
+				break;
 			case 'e':
 				sEscapeMetaChars = false;
 				break;
@@ -170,6 +176,8 @@ LiveQuery::MessageReceived(BMessage* message)
 			query->SetVolume(&volume);
 			query->SetPredicate(predicate);
 			query->SetTarget(this);
+			if (sCoalesce)
+				query->SetFlags(B_QUERY_COALESCE_UPDATES);
 
 			fQueries.AddItem(query);
 			_PerformQuery(*query);
@@ -177,31 +185,8 @@ LiveQuery::MessageReceived(BMessage* message)
 		}
 
 		case B_QUERY_UPDATE:
-		{
-			int32 what;
-			message->FindInt32("opcode", &what);
-
-			int32 device;
-			int64 directory;
-			int64 node;
-			const char* name;
-			message->FindInt32("device", &device);
-			message->FindInt64("directory", &directory);
-			message->FindInt64("node", &node);
-			message->FindString("name", &name);
-
-			switch (what) {
-				case B_ENTRY_CREATED:
-				{
-					printf("CREATED %s\n", name);
-					break;
-				}
-				case B_ENTRY_REMOVED:
-					printf("REMOVED %s\n", name);
-					break;
-			}
+			_QueryUpdate(message);
 			break;
-		}
 
 		default:
 			BApplication::MessageReceived(message);
@@ -210,12 +195,51 @@ LiveQuery::MessageReceived(BMessage* message)
 }
 
 
+void
+LiveQuery::_QueryUpdate(BMessage* message)
+{
+	int32 what;
+	message->FindInt32("opcode", &what);
+
+	if (what == B_EVENTS_COALESCED) {
+		BMessage event;
+		int32 count = 0;
+		for (; message->FindMessage("events", count, &event) == B_OK; count++)
+			_QueryUpdate(&event);
+
+		printf("(%" B_PRId32 " coalesced events)\n", count);
+		return;
+	}
+
+	int32 device;
+	int64 directory;
+	int64 node;
+	const char* name;
+	message->FindInt32("device", &device);
+	message->FindInt64("directory", &directory);
+	message->FindInt64("node", &node);
+	message->FindString("name", &name);
+
+	switch (what) {
+		case B_ENTRY_CREATED:
+		{
+			printf("CREATED %s\n", name);
+			break;
+		}
+		case B_ENTRY_REMOVED:
+			printf("REMOVED %s\n", name);
+			break;
+	}
+}
+
+
 void
 LiveQuery::_PrintUsage()
 {
-	printf("usage: %s [ -ef ] [ -a || -v <path-to-volume> ] expression\n"
+	printf("usage: %s [ -efc ] [ -a || -v <path-to-volume> ] expression\n"
 		"  -e\t\tdon't escape meta-characters\n"
 		"  -f\t\tshow only files (ie. no directories or symbolic links)\n"
+		"  -c\t\tcoalesce query updates\n"
 		"  -a\t\tperform the query on all volumes\n"
 		"  -v <file>\tperform the query on just one volume; <file> can be any\n"
 		"\t\tfile on that volume. Defaults to the current volume.\n"
@@ -0,0 +1,282 @@
+/*
+ * Copyright 2026, Haiku, Inc. All Rights Reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+/*!	Checks that coalescing node monitor and live query events (B_WATCH_COALESCE
+	and B_QUERY_COALESCE_UPDATES) neither loses, nor reorders any information.
+	Must be run on a volume that supports queries, i.e. BFS.
+*/
+
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <Application.h>
+#include <Autolock.h>
+#include <Entry.h>
+#include <fs_query.h>
+#include <Looper.h>
+#include <NodeMonitor.h>
+#include <ObjectList.h>
+#include <Query.h>
+#include <String.h>
+#include <Volume.h>
+#include <VolumeRoster.h>
+
+
+static const bigtime_t kSettleTime = 500000;
+	// long enough for the kernel to have delivered all coalesced events
+
+static int sFailures = 0;
+
+
+#define CHECK(condition) \
+	do { \
+		if (!(condition)) { \
+			printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, \
+				#condition); \
+			sFailures++; \
+		} \
+	} while (false)
+
+
+struct Event {
+	uint32	what;
+	int32	opcode;
+	bool	coalesced;
+};
+
+
+/*!	Records all events it receives. The contents of B_EVENTS_COALESCED
+	messages are recorded in order, as if they had been received one by one.
+*/
+class EventCollector : public BLooper {
+public:
+	EventCollector()
+		:
+		BLooper("event collector"),
+		fEvents(20)
+	{
+	}
+
+	virtual void MessageReceived(BMessage* message)
+	{
+		switch (message->what) {
+			case B_NODE_MONITOR:
+			case B_QUERY_UPDATE:
+				_AddEvent(message, false);
+				break;
+
+			default:
+				BLooper::MessageReceived(message);
+		}
+	}
+
+	int32 CountEvents(uint32 what, bool coalesced)
+	{
+		int32 count = 0;
+		for (int32 i = 0; Event* event = fEvents.ItemAt(i); i++) {
+			if (event->what == what && event->coalesced == coalesced)
+				count++;
+		}
+		return count;
+	}
+
+	Event* EventAt(uint32 what, bool coalesced, int32 index)
+	{
+		for (int32 i = 0; Event* event = fEvents.ItemAt(i); i++) {
+			if (event->what == what && event->coalesced == coalesced
+				&& index-- == 0)
+				return event;
+		}
+		return NULL;
+	}
+
+	void Clear()
+	{
+		fEvents.MakeEmpty();
+	}
+
+private:
+	void _AddEvent(BMessage* message, bool coalesced)
+	{
+		int32 opcode = message->GetInt32("opcode", -1);
+		if (opcode == B_EVENTS_COALESCED) {
+			BMessage event;
+			for (int32 i = 0; message->FindMessage("events", i, &event) == B_OK;
+					i++) {
+				_AddEvent(&event, true);
+			}
+			return;
+		}
+
+		Event* event = new Event;
+		event->what = message->what;
+		event->opcode = opcode;
+		event->coalesced = coalesced;
+		fEvents.AddItem(event);
+	}
+
+private:
+	BObjectList<Event, true> fEvents;
+};
+
+
+static void
+start_query(BQuery& query, const char* name, EventCollector* collector,
+	uint32 flags)
+{
+	BVolume volume;
+	BVolumeRoster().GetBootVolume(&volume);
+
+	BString predicate;
+	predicate.SetToFormat("name==\"%s\"", name);
+
+	query.SetVolume(&volume);
+	query.SetPredicate(predicate.String());
+	query.SetTarget(BMessenger(collector));
+	query.SetFlags(flags);
+	CHECK(query.Fetch() == B_OK);
+
+	entry_ref ref;
+	while (query.GetNextRef(&ref) == B_OK)
+		;
+}
+
+
+/*!	Removes, creates, and removes a file again that is in two live queries
+	with the same target. Only one of them coalesces its updates.
+*/
+static void
+test_query(const char* directory, EventCollector* collector)
+{
+	BString name;
+	name.SetToFormat("coalesce-test-%d", (int)getpid());
+	BString path;
+	path.SetToFormat("%s/%s", directory, name.String());
+
+	int fd = open(path.String(), O_CREAT | O_WRONLY, 0644);
+	CHECK(fd >= 0);
+	close(fd);
+
+	BQuery coalescedQuery;
+	BQuery query;
+	start_query(coalescedQuery, name.String(), collector,
+		B_QUERY_COALESCE_UPDATES);
+	start_query(query, name.String(), collector, 0);
+
+	unlink(path.String());
+	fd = open(path.String(), O_CREAT | O_WRONLY, 0644);
+	close(fd);
+	unlink(path.String());
+
+	snooze(kSettleTime);
+
+	BAutolock _(collector);
+
+	// the query that doesn't coalesce gets all updates as they are
+	CHECK(collector->CountEvents(B_QUERY_UPDATE, false) == 3);
+
+	// The other one only gets a single removal, unless a flush happened to
+	// come in between. In any case, the updates must alternate, and the file
+	// must end up removed.
+	int32 count = collector->CountEvents(B_QUERY_UPDATE, true);
+	CHECK(count % 2 == 1);
+	for (int32 i = 0; i < count; i++) {
+		Event* event = collector->EventAt(B_QUERY_UPDATE, true, i);
+		CHECK(event != NULL && event->opcode
+			== (i % 2 == 0 ? B_ENTRY_REMOVED : B_ENTRY_CREATED));
+	}
+
+	collector->Clear();
+}
+
+
+/*!	Changes the permissions of a file, renames it, and changes them again.
+	The stat changes must not be merged across the move.
+*/
+static void
+test_stat_order(const char* directory, EventCollector* collector)
+{
+	BString path;
+	path.SetToFormat("%s/stat-order", directory);
+	BString newPath;
+	newPath.SetToFormat("%s/stat-order-moved", directory);
+
+	int fd = open(path.String(), O_CREAT | O_WRONLY, 0644);
+	CHECK(fd >= 0);
+	close(fd);
+
+	node_ref directoryRef;
+	node_ref fileRef;
+	CHECK(BEntry(directory).GetNodeRef(&directoryRef) == B_OK);
+	CHECK(BEntry(path.String()).GetNodeRef(&fileRef) == B_OK);
+
+	BMessenger messenger(collector);
+	CHECK(watch_node(&directoryRef, B_WATCH_DIRECTORY | B_WATCH_COALESCE,
+		messenger) == B_OK);
+	CHECK(watch_node(&fileRef, B_WATCH_STAT | B_WATCH_COALESCE, messenger)
+		== B_OK);
+
+	chmod(path.String(), 0600);
+	rename(path.String(), newPath.String());
+	chmod(newPath.String(), 0644);
+
+	snooze(kSettleTime);
+	stop_watching(messenger);
+	unlink(newPath.String());
+
+	BAutolock _(collector);
+
+	CHECK(collector->CountEvents(B_NODE_MONITOR, false) == 0);
+	CHECK(collector->CountEvents(B_NODE_MONITOR, true) == 3);
+
+	static const int32 kExpectedOpcodes[] = {
+		B_STAT_CHANGED, B_ENTRY_MOVED, B_STAT_CHANGED
+	};
+	for (int32 i = 0; i < 3; i++) {
+		Event* event = collector->EventAt(B_NODE_MONITOR, true, i);
+		CHECK(event != NULL && event->opcode == kExpectedOpcodes[i]);
+	}
+
+	collector->Clear();
+}
+
+
+int
+main()
+{
+	BApplication application("application/x-vnd.Haiku-node-monitor-coalesce");
+
+	char directory[] = "/tmp/node-monitor-coalesce-XXXXXX";
+	if (mkdtemp(directory) == NULL) {
+		fprintf(stderr, "Failed to create test directory: %s\n",
+			strerror(errno));
+		return 1;
+	}
+
+	EventCollector* collector = new EventCollector;
+	collector->Run();
+
+	test_query(directory, collector);
+	test_stat_order(directory, collector);
+
+	collector->Lock();
+	collector->Quit();
+	rmdir(directory);
+
+	if (sFailures != 0) {
+		printf("%d checks failed\n", sFailures);
+		return 1;
+	}
+
+	printf("all checks passed\n");
+	return 0;
+}
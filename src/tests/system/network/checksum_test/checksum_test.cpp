@@ -0,0 +1,148 @@
+/*
+ * Copyright 2026, Haiku, Inc. All Rights Reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+//!	Verifies the checksum implementations of the stack, and compares their
+//!	speed; this is built for the build platform, too.
+
+
+#include "checksum.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+
+static const size_t kMaxLength = 65536;
+static const int32 kRandomRuns = 20000;
+static const size_t kBenchmarkSizes[] = {20, 64, 1500, 4096, 65536};
+static const size_t kBenchmarkBytes = 64 * 1024 * 1024;
+
+
+//!	Straightforward RFC 1071 checksum to check the others against.
+static uint16
+reference_checksum(const uint8* buffer, size_t length)
+{
+	uint32 sum = 0;
+	for (size_t i = 0; i + 1 < length; i += 2) {
+		uint16 word;
+		memcpy(&word, buffer + i, sizeof(word));
+		sum += word;
+	}
+	if ((length & 1) != 0) {
+		uint8 last[2] = {buffer[length - 1], 0};
+		uint16 word;
+		memcpy(&word, last, sizeof(word));
+		sum += word;
+	}
+
+	while ((sum >> 16) != 0)
+		sum = (sum & 0xffff) + (sum >> 16);
+
+	return sum;
+}
+
+
+static double
+current_time()
+{
+	struct timespec time;
+	clock_gettime(CLOCK_MONOTONIC, &time);
+	return time.tv_sec + time.tv_nsec / 1000000000.0;
+}
+
+
+static bool
+verify(const checksum_implementation& implementation, uint8* source)
+{
+	for (int32 run = 0; run < kRandomRuns; run++) {
+		size_t length;
+		if (run < 256)
+			length = run;
+		else
+			length = rand() % (kMaxLength - 64);
+		size_t sourceOffset = rand() % 64;
+
+		// sprinkle in all-ones and all-zero data to test the carries
+		int pattern = rand() % 8;
+		for (size_t i = 0; i < length; i++) {
+			source[sourceOffset + i] = pattern == 0 ? 0xff
+				: pattern == 1 ? 0 : rand();
+		}
+
+		uint16 expected = reference_checksum(source + sourceOffset, length);
+		uint16 sum = implementation.compute(source + sourceOffset, length);
+		if (sum != expected) {
+			printf("  %s: checksum of %zu bytes at offset %zu: %#x, expected "
+				"%#x\n", implementation.name, length, sourceOffset, sum,
+				expected);
+			return false;
+		}
+	}
+
+	return true;
+}
+
+
+static void
+benchmark(const checksum_implementation& implementation, uint8* source)
+{
+	for (size_t i = 0; i < sizeof(kBenchmarkSizes) / sizeof(size_t); i++) {
+		size_t length = kBenchmarkSizes[i];
+		size_t runs = kBenchmarkBytes / length;
+		uint32 dummy = 0;
+
+		double start = current_time();
+		for (size_t run = 0; run < runs; run++)
+			dummy += implementation.compute(source, length);
+		double checksumTime = current_time() - start;
+
+		printf("  %-8s %6zu bytes: %8.1f MB/s%s\n", implementation.name,
+			length, kBenchmarkBytes / checksumTime / 1000000,
+			dummy == 1 ? " " : "");
+	}
+}
+
+
+int
+main(int argc, char** argv)
+{
+	bool runBenchmark = argc < 2 || strcmp(argv[1], "--verify-only") != 0;
+
+	uint8* source = (uint8*)malloc(kMaxLength + 64);
+	if (source == NULL) {
+		printf("out of memory\n");
+		return 1;
+	}
+
+	srand(42);
+
+	int failed = 0;
+	for (size_t i = 0; i < gChecksumImplementationCount; i++) {
+		const checksum_implementation& implementation
+			= gChecksumImplementations[i];
+		if (!implementation.supported()) {
+			printf("%s: not supported by this CPU\n", implementation.name);
+			continue;
+		}
+
+		bool passed = verify(implementation, source);
+		printf("%s: %s\n", implementation.name, passed ? "passed" : "FAILED");
+		if (!passed) {
+			failed++;
+			continue;
+		}
+
+		if (runBenchmark) {
+			for (size_t j = 0; j < kMaxLength; j++)
+				source[j] = rand();
+			benchmark(implementation, source);
+		}
+	}
+
+	free(source);
+	return failed != 0 ? 1 : 0;
+}
@@ -0,0 +1,282 @@
+/*
+ * Copyright 2026, Haiku, Inc. All Rights Reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+/*!	Measures the rate at which a number of worker processes can accept
+	connections on the same port, either each with its own SO_REUSEPORT
+	listener, or all sharing a single listening socket.
+*/
+
+
+#include <errno.h>
+#include <netinet/in.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+
+static const int kMaxWorkers = 64;
+
+static int sWorkers = 4;
+static int sClients = 4;
+static int sSeconds = 5;
+static bool sShared = false;
+
+static sockaddr_in sAddress;
+static volatile bool sStop = false;
+
+
+static void
+usage(const char* name)
+{
+	fprintf(stderr, "usage: %s [-w workers] [-c clients] [-t seconds] [-s]\n"
+		"  -s\tlet all workers accept on a single listener instead of one\n"
+		"\tSO_REUSEPORT listener each\n", name);
+	exit(1);
+}
+
+
+static int64_t
+current_time()
+{
+	timeval time;
+	gettimeofday(&time, NULL);
+	return (int64_t)time.tv_sec * 1000000 + time.tv_usec;
+}
+
+
+static int
+create_listener(bool reusePort, unsigned short port)
+{
+	int fd = socket(AF_INET, SOCK_STREAM, 0);
+	if (fd < 0) {
+		fprintf(stderr, "failed to create listener socket: %s\n",
+			strerror(errno));
+		exit(1);
+	}
+
+	if (reusePort) {
+		int option = 1;
+		if (setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &option,
+				sizeof(option)) != 0) {
+			fprintf(stderr, "failed to set SO_REUSEPORT: %s\n",
+				strerror(errno));
+			exit(1);
+		}
+	}
+
+	sockaddr_in address;
+	memset(&address, 0, sizeof(address));
+	address.sin_family = AF_INET;
+	address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	address.sin_port = port;
+	if (bind(fd, (sockaddr*)&address, sizeof(address)) != 0) {
+		fprintf(stderr, "failed to bind listener socket: %s\n",
+			strerror(errno));
+		exit(1);
+	}
+
+	return fd;
+}
+
+
+static void
+stop_worker(int signal)
+{
+	sStop = true;
+}
+
+
+/*!	Accepts and closes connections until it is told to stop, and then
+	reports the number of accepted connections through \a reportPipe.
+*/
+static void
+run_worker(int listener, int reportPipe)
+{
+	struct sigaction action;
+	memset(&action, 0, sizeof(action));
+	action.sa_handler = stop_worker;
+	sigaction(SIGTERM, &action, NULL);
+
+	if (listener < 0) {
+		listener = create_listener(true, sAddress.sin_port);
+		if (listen(listener, 128) != 0) {
+			fprintf(stderr, "worker failed to listen: %s\n", strerror(errno));
+			exit(1);
+		}
+	}
+
+	// tell the parent that we're ready
+	int accepted = 0;
+	write(reportPipe, &accepted, sizeof(accepted));
+
+	while (!sStop) {
+		int fd = accept(listener, NULL, NULL);
+		if (fd < 0) {
+			if (errno == EINTR)
+				continue;
+			fprintf(stderr, "worker failed to accept: %s\n", strerror(errno));
+			break;
+		}
+
+		close(fd);
+		accepted++;
+	}
+
+	write(reportPipe, &accepted, sizeof(accepted));
+	exit(0);
+}
+
+
+static void*
+client_thread(void* _count)
+{
+	int* count = (int*)_count;
+
+	while (!sStop) {
+		int fd = socket(AF_INET, SOCK_STREAM, 0);
+		if (fd < 0) {
+			fprintf(stderr, "failed to create client socket: %s\n",
+				strerror(errno));
+			break;
+		}
+
+		// reset the connection on close, so that the ports don't linger
+		// in TIME_WAIT
+		linger linger;
+		linger.l_onoff = 1;
+		linger.l_linger = 0;
+		setsockopt(fd, SOL_SOCKET, SO_LINGER, &linger, sizeof(linger));
+
+		if (connect(fd, (sockaddr*)&sAddress, sizeof(sAddress)) == 0)
+			(*count)++;
+		else if (errno != ECONNREFUSED && errno != ETIMEDOUT) {
+			fprintf(stderr, "failed to connect: %s\n", strerror(errno));
+			close(fd);
+			break;
+		}
+
+		close(fd);
+	}
+
+	return NULL;
+}
+
+
+int
+main(int argc, char** argv)
+{
+	int option;
+	while ((option = getopt(argc, argv, "w:c:t:s")) != -1) {
+		switch (option) {
+			case 'w':
+				sWorkers = atoi(optarg);
+				break;
+			case 'c':
+				sClients = atoi(optarg);
+				break;
+			case 't':
+				sSeconds = atoi(optarg);
+				break;
+			case 's':
+				sShared = true;
+				break;
+			default:
+				usage(argv[0]);
+		}
+	}
+
+	if (sWorkers < 1 || sWorkers > kMaxWorkers || sClients < 1
+		|| sClients > kMaxWorkers || sSeconds < 1)
+		usage(argv[0]);
+
+	// Choose the port: with SO_REUSEPORT, this socket only reserves the
+	// port until all workers have joined it, and never listens itself.
+	int listener = create_listener(!sShared, 0);
+	socklen_t addressLength = sizeof(sAddress);
+	if (getsockname(listener, (sockaddr*)&sAddress, &addressLength) != 0) {
+		fprintf(stderr, "failed to get socket name: %s\n", strerror(errno));
+		return 1;
+	}
+
+	if (sShared && listen(listener, 128) != 0) {
+		fprintf(stderr, "failed to listen: %s\n", strerror(errno));
+		return 1;
+	}
+
+	pid_t workers[kMaxWorkers];
+	int reportPipes[kMaxWorkers];
+	for (int i = 0; i < sWorkers; i++) {
+		int fds[2];
+		if (pipe(fds) != 0) {
+			fprintf(stderr, "failed to create pipe: %s\n", strerror(errno));
+			return 1;
+		}
+
+		workers[i] = fork();
+		if (workers[i] < 0) {
+			fprintf(stderr, "fork() failed: %s\n", strerror(errno));
+			return 1;
+		}
+		if (workers[i] == 0) {
+			close(fds[0]);
+			run_worker(sShared ? listener : -1, fds[1]);
+		}
+
+		close(fds[1]);
+		reportPipes[i] = fds[0];
+
+		int ready;
+		read(reportPipes[i], &ready, sizeof(ready));
+	}
+
+	if (!sShared)
+		close(listener);
+
+	printf("%d workers on %s, %d clients, %d seconds\n", sWorkers,
+		sShared ? "a shared listener" : "SO_REUSEPORT listeners", sClients,
+		sSeconds);
+
+	pthread_t clients[kMaxWorkers];
+	int connected[kMaxWorkers];
+
+	int64_t start = current_time();
+	for (int i = 0; i < sClients; i++) {
+		connected[i] = 0;
+		pthread_create(&clients[i], NULL, client_thread, &connected[i]);
+	}
+
+	sleep(sSeconds);
+	sStop = true;
+
+	int totalConnected = 0;
+	for (int i = 0; i < sClients; i++) {
+		pthread_join(clients[i], NULL);
+		totalConnected += connected[i];
+	}
+	int64_t duration = current_time() - start;
+
+	int totalAccepted = 0;
+	for (int i = 0; i < sWorkers; i++) {
+		kill(workers[i], SIGTERM);
+
+		int accepted = 0;
+		read(reportPipes[i], &accepted, sizeof(accepted));
+		waitpid(workers[i], NULL, 0);
+
+		printf("  worker %2d: %8d connections\n", i, accepted);
+		totalAccepted += accepted;
+	}
+
+	printf("%d connections, %d accepted, %lld per second\n", totalConnected,
+		totalAccepted, (long long)totalAccepted * 1000000 / duration);
+	return 0;
+}
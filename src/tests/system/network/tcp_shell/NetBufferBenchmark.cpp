@@ -0,0 +1,129 @@
+/*
+ * Copyright 2026, Haiku, Inc. All Rights Reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+#include <net_buffer.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <OS.h>
+
+
+extern "C" status_t _add_builtin_module(module_info *info);
+
+extern struct net_buffer_module_info gNetBufferModule;
+	// from net_buffer.cpp
+
+struct net_buffer_module_info* gBufferModule;
+
+static const size_t kPayloadSizes[] = {1500, 65536};
+static const int32 kIterations = 10000;
+
+static uint8 sData[65536];
+
+
+static net_buffer*
+create_filled_buffer(size_t bytes)
+{
+	net_buffer* buffer = gBufferModule->create(256);
+	if (buffer == NULL) {
+		printf("creating a buffer failed!\n");
+		exit(1);
+	}
+
+	status_t status = gBufferModule->append(buffer, sData, bytes);
+	if (status != B_OK) {
+		printf("appending %lu bytes to buffer %p failed: %s\n", bytes, buffer,
+			strerror(status));
+		exit(1);
+	}
+
+	return buffer;
+}
+
+
+static void
+print_result(const char* name, size_t bytes, bigtime_t time)
+{
+	double perIteration = (double)time * 1000 / kIterations;
+	printf("  %-16s %6lu bytes: %10.1f ns, %8.1f MB/s\n", name, bytes,
+		perIteration, bytes * 1000.0 / perIteration);
+}
+
+
+static void
+benchmark_append(size_t bytes)
+{
+	bigtime_t start = system_time();
+
+	for (int32 i = 0; i < kIterations; i++)
+		gBufferModule->free(create_filled_buffer(bytes));
+
+	print_result("append_data", bytes, system_time() - start);
+}
+
+
+static void
+benchmark_read(size_t bytes)
+{
+	net_buffer* buffer = create_filled_buffer(bytes);
+	uint8* target = (uint8*)malloc(bytes);
+
+	bigtime_t start = system_time();
+
+	for (int32 i = 0; i < kIterations; i++)
+		gBufferModule->read(buffer, 0, target, bytes);
+
+	print_result("read_data", bytes, system_time() - start);
+
+	free(target);
+	gBufferModule->free(buffer);
+}
+
+
+static void
+benchmark_checksum(size_t bytes)
+{
+	net_buffer* buffer = create_filled_buffer(bytes);
+
+	bigtime_t start = system_time();
+
+	for (int32 i = 0; i < kIterations; i++)
+		gBufferModule->checksum(buffer, 0, bytes, true);
+
+	print_result("checksum_data", bytes, system_time() - start);
+
+	gBufferModule->free(buffer);
+}
+
+
+int
+main()
+{
+	_add_builtin_module((module_info*)&gNetBufferModule);
+	get_module(NET_BUFFER_MODULE_NAME, (module_info**)&gBufferModule);
+
+	for (size_t i = 0; i < sizeof(sData); i++)
+		sData[i] = (uint8)i;
+
+	for (size_t i = 0; i < sizeof(kPayloadSizes) / sizeof(kPayloadSizes[0]);
+			i++) {
+		size_t bytes = kPayloadSizes[i];
+
+		net_buffer* buffer = create_filled_buffer(bytes);
+		printf("%lu bytes (%" B_PRIu32 " nodes):\n", bytes,
+			gBufferModule->count_iovecs(buffer));
+		gBufferModule->free(buffer);
+
+		benchmark_append(bytes);
+		benchmark_read(bytes);
+		benchmark_checksum(bytes);
+	}
+
+	put_module(NET_BUFFER_MODULE_NAME);
+	return 0;
+}
@@ -0,0 +1,153 @@
+/*
+ * Copyright 2026, Haiku, Inc. All Rights Reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+#include "SackScoreboard.h"
+
+#include <stdio.h>
+
+
+static const uint32 kSegmentSize = 1000;
+
+static int sFailures = 0;
+
+
+#define CHECK(condition) \
+	do { \
+		if (!(condition)) { \
+			printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, \
+				#condition); \
+			sFailures++; \
+		} \
+	} while (false)
+
+
+static bool
+update(SackScoreboard& scoreboard, uint32 acknowledge, uint32 start,
+	uint32 end, uint32 now = 0)
+{
+	tcp_sack sack;
+	sack.left_edge = start;
+	sack.right_edge = end;
+	return scoreboard.Update(acknowledge, 100000, &sack, 1, now);
+}
+
+
+static void
+test_merge()
+{
+	SackScoreboard scoreboard;
+
+	CHECK(update(scoreboard, 1000, 3000, 4000));
+	CHECK(update(scoreboard, 1000, 5000, 6000));
+	CHECK(scoreboard.SackedBytes() == 2000);
+
+	// nothing new
+	CHECK(!update(scoreboard, 1000, 3000, 4000));
+	CHECK(!update(scoreboard, 1000, 3500, 4000));
+	// D-SACK of data below the cumulative acknowledgment
+	CHECK(!update(scoreboard, 1000, 0, 1000));
+	// beyond what has been sent
+	CHECK(!update(scoreboard, 1000, 200000, 201000));
+
+	// fill the gap between both blocks
+	CHECK(update(scoreboard, 1000, 4000, 5000));
+	CHECK(scoreboard.SackedBytes() == 3000);
+	CHECK(scoreboard.HighestSacked() == 6000);
+
+	tcp_sequence start, end;
+	CHECK(scoreboard.NextHole(1000, start, end));
+	CHECK(start == 1000 && end == 3000);
+	CHECK(!scoreboard.NextHole(3000, start, end));
+
+	scoreboard.RemoveUntil(3500);
+	CHECK(scoreboard.SackedBytes() == 2500);
+	scoreboard.RemoveUntil(6000);
+	CHECK(scoreboard.IsEmpty());
+	CHECK(scoreboard.SackedBytes() == 0);
+}
+
+
+static void
+test_loss()
+{
+	SackScoreboard scoreboard;
+
+	// the first segment is missing, and two are SACKed above it
+	update(scoreboard, 1000, 2000, 4000);
+	CHECK(!scoreboard.IsLost(1000, kSegmentSize));
+
+	// three segments are SACKed above it
+	update(scoreboard, 1000, 4000, 5000);
+	CHECK(scoreboard.IsLost(1000, kSegmentSize));
+	CHECK(!scoreboard.IsLost(2000, kSegmentSize));
+
+	// three discontiguous blocks make it lost as well
+	scoreboard.Reset();
+	update(scoreboard, 1000, 2000, 2100);
+	update(scoreboard, 1000, 2200, 2300);
+	CHECK(!scoreboard.IsLost(1000, kSegmentSize));
+	update(scoreboard, 1000, 2400, 2500);
+	CHECK(scoreboard.IsLost(1000, kSegmentSize));
+}
+
+
+static void
+test_pipe()
+{
+	SackScoreboard scoreboard;
+
+	// nothing SACKed: everything outstanding is in the pipe
+	CHECK(scoreboard.Pipe(1000, 11000, 1000, kSegmentSize) == 10000);
+
+	// 1000-2000 is lost, 5000-6000 isn't yet; the tail 7000-11000 never is
+	update(scoreboard, 1000, 2000, 5000);
+	update(scoreboard, 1000, 6000, 7000);
+	CHECK(scoreboard.Pipe(1000, 11000, 1000, kSegmentSize) == 5000);
+
+	// retransmitted data counts again
+	CHECK(scoreboard.Pipe(1000, 11000, 2000, kSegmentSize) == 6000);
+	CHECK(scoreboard.Pipe(1000, 11000, 5500, kSegmentSize) == 6500);
+}
+
+
+static void
+test_times()
+{
+	SackScoreboard scoreboard;
+	uint32 time;
+
+	CHECK(!scoreboard.FirstSackedAbove(1000, time));
+
+	update(scoreboard, 1000, 3000, 4000, 10);
+	update(scoreboard, 1000, 5000, 6000, 20);
+	CHECK(scoreboard.LastSackTime() == 20);
+
+	CHECK(scoreboard.FirstSackedAbove(1000, time) && time == 10);
+	CHECK(scoreboard.FirstSackedAbove(4000, time) && time == 20);
+
+	// merged blocks keep the earlier time
+	update(scoreboard, 1000, 4000, 5000, 30);
+	CHECK(scoreboard.FirstSackedAbove(2000, time) && time == 10);
+	CHECK(scoreboard.LastSackTime() == 30);
+}
+
+
+int
+main()
+{
+	test_merge();
+	test_loss();
+	test_pipe();
+	test_times();
+
+	if (sFailures != 0) {
+		printf("%d checks failed\n", sFailures);
+		return 1;
+	}
+
+	printf("all checks passed\n");
+	return 0;
+}
@@ -31,6 +31,7 @@
 
 #include <netinet/in.h>
 #include <netinet/ip.h>
+#include <netinet/tcp.h>
 
 #include <ctype.h>
 #include <errno.h>
@@ -698,6 +699,7 @@ net_socket_module_info gNetSocketModule = {
 	NULL, // listen,
 	NULL, // receive,
 	NULL, // send,
+	NULL, // send_external,
 	NULL, // setsockopt,
 	NULL, // shutdown,
 	NULL, // socketpair
@@ -1311,9 +1313,12 @@ server_thread(void*)
 
 		char buffer[1024];
 		ssize_t bytesRead;
+		off_t totalBytes = 0;
+		bigtime_t start = system_time();
 		while ((bytesRead = socket_recv(connectionSocket, buffer,
 				sizeof(buffer), 0)) > 0) {
 			printf("server: received %ld bytes\n", bytesRead);
+			totalBytes += bytesRead;
 
 			if (sServerActiveClose) {
 				printf("server: active close\n");
@@ -1326,6 +1331,12 @@ server_thread(void*)
 		else
 			printf("server: peer closed connection.\n");
 
+		// the goodput allows to compare loss recovery under "drop -r"
+		bigtime_t duration = max_c(system_time() - start, 1);
+		printf("server: received %" B_PRIdOFF " bytes in %" B_PRIdBIGTIME
+			" ms, %" B_PRIdOFF " KB/s\n", totalBytes, duration / 1000,
+			totalBytes * 1000000 / duration / 1024);
+
 		snooze(1000000);
 		close_protocol(connectionSocket->first_protocol);
 	}
@@ -1713,6 +1724,33 @@ do_round_trip_time(int argc, char** argv)
 }
 
 
+static void
+do_congestion_control(int argc, char** argv)
+{
+	if (argc == 1) {
+		char name[TCP_CA_NAME_MAX];
+		int length = sizeof(name);
+		status_t status = gTCPModule->getsockopt(gClientSocket->first_protocol,
+			IPPROTO_TCP, TCP_CONGESTION, name, &length);
+		if (status == B_OK)
+			printf("Congestion control: %.*s\n", length, name);
+		return;
+	}
+
+	// the server's socket is the listener, the connection inherits from it
+	net_socket* sockets[] = {gClientSocket, gServerSocket};
+	for (size_t i = 0; i < sizeof(sockets) / sizeof(sockets[0]); i++) {
+		status_t status = gTCPModule->setsockopt(sockets[i]->first_protocol,
+			IPPROTO_TCP, TCP_CONGESTION, argv[1], strlen(argv[1]));
+		if (status != B_OK) {
+			fprintf(stderr, "Could not set congestion control \"%s\": %s\n",
+				argv[1], strerror(status));
+			return;
+		}
+	}
+}
+
+
 static void
 do_dprintf(int argc, char** argv)
 {
@@ -1730,6 +1768,8 @@ static cmd_entry sBuiltinCommands[] = {
 	{"send", do_send, "Sends data from the client to the server"},
 	{"send_loop", do_send_loop, "Sends data in a loop"},
 	{"close", do_close, "Performs an active or simultaneous close"},
+	{"congestion", do_congestion_control,
+		"Shows or sets the congestion control algorithm"},
 	{"dprintf", do_dprintf, "Toggles debug output"},
 	{"drop", do_drop, "Lets you drop packets during transfer"},
 	{"reorder", do_reorder, "Lets you reorder packets during transfer"},
@@ -7,6 +7,7 @@
 #include "fssh.h"
 
 #include "command_checkfs.h"
+#include "command_compacttree.h"
 #include "command_resizefs.h"
 
 
@@ -20,6 +21,8 @@ register_additional_commands()
 		"check file system");
 	CommandManager::Default()->AddCommand(command_resizefs, "resizefs",
 		"resize file system");
+	CommandManager::Default()->AddCommand(command_compacttree, "compacttree",
+		"rebuild the B+tree of a directory or index");
 }
 
 
@@ -0,0 +1,61 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+#include "fssh_stdio.h"
+#include "fssh_string.h"
+#include "syscalls.h"
+
+#include "bfs.h"
+#include "bfs_control.h"
+
+
+namespace FSShell {
+
+
+fssh_status_t
+command_compacttree(int argc, const char* const* argv)
+{
+	if (argc < 2 || argc > 4) {
+		fssh_dprintf("Usage: %s <directory> [<index name> [<fill %%>]]\n"
+			"Rebuilds the B+tree of the directory, or the named index.\n",
+			argv[0]);
+		return B_ERROR;
+	}
+
+	compact_tree_control control;
+	fssh_memset(&control, 0, sizeof(control));
+
+	if (argc > 2)
+		fssh_strlcpy(control.index, argv[2], sizeof(control.index));
+	if (argc > 3
+		&& fssh_sscanf(argv[3], "%" B_SCNu32, &control.fill_percentage) < 1) {
+		fssh_dprintf("Invalid fill percentage\n");
+		return B_ERROR;
+	}
+
+	int dir = _kern_open_dir(-1, argv[1]);
+	if (dir < 0) {
+		fssh_dprintf("Error: Couldn't open directory \"%s\"\n", argv[1]);
+		return dir;
+	}
+
+	status_t status = _kern_ioctl(dir, BFS_IOCTL_COMPACT_TREE,
+		&control, sizeof(control));
+
+	_kern_close(dir);
+
+	if (status != B_OK) {
+		fssh_dprintf("Compacting failed, status: %s\n", fssh_strerror(status));
+		return status;
+	}
+
+	fssh_dprintf("B+tree size: %" B_PRIdOFF " -> %" B_PRIdOFF " bytes\n",
+		control.old_size, control.new_size);
+	return B_OK;
+}
+
+
+}	// namespace FSShell